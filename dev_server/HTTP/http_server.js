@@ -49,7 +49,7 @@ app.post("/api/v1/dispositivos", (req, res) => {
 })
 
 app.get("/api/v1/ping", (req, res) => {
-    res.json({ "epoch": Math.floor(Date.now() / 1000) })
+    res.json({ "epoch": Math.floor(Date.now() / 1000), "epoch_ms": Date.now() })
 });
 
 
@@ -3,6 +3,36 @@ const QRCode = require('qrcode');
 let payload = "";
 
 const segment_size = 50;
+const max_blocks = 32; // FOUNTAIN_MAX_BLOCKS on the device
+
+// Binary reconf protocol, see QR/reconf.h on the device
+const reconf_prefix = "RECONF:";
+const reconf_version = 1;
+const reconf_fields = {
+    wifi_ssid: 1,
+    wifi_psw: 2,
+    thingsboard_url: 3,
+    mqtt_broker_url: 4,
+    device_name: 5,
+    space_id: 6,
+    provisioning_device_key: 7,
+    provisioning_device_secret: 8,
+    totp_form_base_url: 9,
+    invalidate_thingsboard_auth: 10,
+    invalidate_backend_auth: 11,
+};
+// Longest UTF-8 string per field, RECONF_*_SIZE - 1 in QR/reconf.h. The device
+// gives up on a whole transfer with a field past its limit.
+const reconf_max_bytes = {
+    wifi_ssid: 29,
+    wifi_psw: 29,
+    thingsboard_url: 99,
+    mqtt_broker_url: 99,
+    device_name: 49,
+    provisioning_device_key: 20,
+    provisioning_device_secret: 20,
+    totp_form_base_url: 99,
+};
 const conf_defaults = {
     "thingsboard_url": { default_value: "https://tbm-asistencia.dev.fdi.ucm.es", type: "text" },
     "device_name": { default_value: "name_here", type: "text" },
@@ -101,17 +131,30 @@ window.addEventListener('load', function () {
         document.getElementById('qr_canvas').style.display = 'block';
         await wait(1);
 
-        set_text("reconf" + JSON.stringify({ packet_type: "start", segment_size, segment_count: Math.ceil(payload.length / segment_size) }))
-        await wait_click();
+        // Fountain coded: every frame is a new combination of blocks, so the device
+        // needs about as many frames as there are blocks, whichever ones it misses
+        let bytes;
+        try {
+            bytes = reconf_encode(conf);
+        } catch (e) {
+            alert(e.message);
+            document.getElementById('data_input').style.display = 'block';
+            document.getElementById('qr_canvas').style.display = 'none';
+            return;
+        }
+        const k = Math.ceil(bytes.length / segment_size);
+        const id = 1 + Math.floor(Math.random() * 65535);
+        if (k > max_blocks) {
+            alert(`configuration too long (${bytes.length} bytes, at most ${max_blocks * segment_size})`);
+        }
+
         click = false;
-        console.log("sending segments")
-        do {
-            for (let i = 0; i < payload.length; i += segment_size) {
-                set_text("reconf" + JSON.stringify({ packet_type: "segment", i: i / segment_size, data: payload.slice(i, i + segment_size) }))
-                await wait(transmision_interval);
-                if (click) break;
-            }
-        } while (!click)
+        console.log(`sending ${bytes.length} bytes in ${k} blocks`)
+        for (let seed = 0; !click && k <= max_blocks; seed++) {
+            const packet = new Uint8Array([reconf_version, id & 0xff, id >> 8, k, bytes.length & 0xff, bytes.length >> 8, seed & 0xff, (seed >> 8) & 0xff, ...fountain_packet(bytes, k, seed)]);
+            set_text(reconf_prefix + base45_encode(packet))
+            await wait(transmision_interval);
+        }
 
         document.getElementById('data_input').style.display = 'block';
         document.getElementById('qr_canvas').style.display = 'none';
@@ -144,4 +187,107 @@ function set_text(text) {
         console.log('success!');
     })
 
-}
\ No newline at end of file
+}
+// Must match fountain_neighbours() in QR/fountain.c on the device
+function fmix32(h) {
+    h ^= h >>> 16;
+    h = Math.imul(h, 0x85ebca6b);
+    h ^= h >>> 13;
+    h = Math.imul(h, 0xc2b2ae35);
+    h ^= h >>> 16;
+    return h >>> 0;
+}
+
+function fountain_neighbours(seed, k) {
+    if (seed < k) return (1 << seed) >>> 0;
+
+    let x = fmix32(seed) || 1;
+    let mask = 0;
+    while (mask === 0) {
+        x ^= x << 13;
+        x ^= x >>> 17;
+        x ^= x << 5;
+        x >>>= 0;
+        mask = k < 32 ? (x & ((1 << k) - 1)) >>> 0 : x;
+    }
+    return mask;
+}
+
+// XOR of the blocks selected by the seed
+function fountain_packet(bytes, k, seed) {
+    const mask = fountain_neighbours(seed, k);
+    const block = new Uint8Array(segment_size);
+    for (let i = 0; i < k; i++) {
+        if (!(mask & (1 << i))) continue;
+        const slice = bytes.subarray(i * segment_size, (i + 1) * segment_size);
+        for (let j = 0; j < slice.length; j++) block[j] ^= slice[j];
+    }
+    return block;
+}
+
+// Unsigned, up to the 32 bits the device reads: a negative value would never
+// reach 0 here, Math.floor keeps it at -1
+function varint(value) {
+    if (!Number.isInteger(value) || value < 0 || value > 0xffffffff) {
+        throw new RangeError(`${value} is not a whole number from 0 to ${0xffffffff}`);
+    }
+    const out = [];
+    do {
+        let byte = value & 0x7f;
+        value = Math.floor(value / 128);
+        if (value) byte |= 0x80;
+        out.push(byte);
+    } while (value);
+    return out;
+}
+
+function crc32(bytes) {
+    let crc = 0xffffffff;
+    for (const byte of bytes) {
+        crc ^= byte;
+        for (let bit = 0; bit < 8; bit++) crc = (crc >>> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return (~crc) >>> 0;
+}
+
+// version, then per field a varint key (id << 1 | wire type) and a varint value or
+// a length and the UTF-8 bytes, then the CRC-32 of all of it
+function reconf_encode(conf) {
+    const out = [reconf_version];
+    for (const key in conf) {
+        const id = reconf_fields[key];
+        const value = conf[key];
+        if (id === undefined) continue;
+        if (typeof value === "string") {
+            const bytes = new TextEncoder().encode(value);
+            if (bytes.length > reconf_max_bytes[key]) {
+                throw new RangeError(`${key}: ${bytes.length} bytes, the device holds at most ${reconf_max_bytes[key]}`);
+            }
+            out.push(...varint(id << 1 | 1), ...varint(bytes.length), ...bytes);
+        } else {
+            try {
+                out.push(...varint(id << 1), ...varint(Number(value)));
+            } catch (e) {
+                throw new RangeError(`${key}: ${e.message}`);
+            }
+        }
+    }
+    const crc = crc32(out);
+    out.push(crc & 0xff, (crc >>> 8) & 0xff, (crc >>> 16) & 0xff, crc >>> 24);
+    return new Uint8Array(out);
+}
+
+// RFC 9285, lands in the QR alphanumeric mode
+function base45_encode(bytes) {
+    const charset = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+    let text = "";
+    for (let i = 0; i < bytes.length; i += 2) {
+        let n = i + 1 < bytes.length ? bytes[i] * 256 + bytes[i + 1] : bytes[i];
+        const digits = i + 1 < bytes.length ? 3 : 2;
+        for (let j = 0; j < digits; j++) {
+            text += charset[n % 45];
+            n = Math.floor(n / 45);
+        }
+    }
+    return text;
+}
@@ -601,6 +601,36 @@ void lvgl_port_flush_ready(lv_disp_t *disp)
     lv_disp_flush_ready(disp->driver);
 }
 
+esp_err_t lvgl_port_get_panel(lv_disp_t *disp, esp_lcd_panel_handle_t *panel, esp_lcd_panel_io_handle_t *io)
+{
+    assert(disp);
+    assert(disp->driver);
+    lvgl_port_display_ctx_t *disp_ctx = (lvgl_port_display_ctx_t *)disp->driver->user_data;
+    assert(disp_ctx != NULL);
+
+    *panel = disp_ctx->panel_handle;
+    *io = disp_ctx->io_handle;
+    return ESP_OK;
+}
+
+esp_err_t lvgl_port_set_trans_done_cb(lv_disp_t *disp, esp_lcd_panel_io_color_trans_done_cb_t cb, void *user_ctx)
+{
+#if LVGL_PORT_HANDLE_FLUSH_READY
+    assert(disp);
+    assert(disp->driver);
+    lvgl_port_display_ctx_t *disp_ctx = (lvgl_port_display_ctx_t *)disp->driver->user_data;
+    assert(disp_ctx != NULL);
+
+    const esp_lcd_panel_io_callbacks_t cbs = {
+        .on_color_trans_done = cb != NULL ? cb : lvgl_port_flush_ready_callback,
+    };
+    return esp_lcd_panel_io_register_event_callbacks(disp_ctx->io_handle, &cbs,
+                                                     cb != NULL ? user_ctx : &disp_ctx->disp_drv);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 /*******************************************************************************
  * Private functions
  *******************************************************************************/
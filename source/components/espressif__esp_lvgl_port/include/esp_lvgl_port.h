@@ -273,6 +273,34 @@ esp_err_t lvgl_port_stop(void);
  */
 esp_err_t lvgl_port_resume(void);
 
+/**
+ * @brief Get the LCD handles of a display
+ *
+ * @note For drawing to the panel directly while LVGL is stopped (lvgl_port_stop).
+ *
+ * @param disp          LVGL display handle (returned from lvgl_port_add_disp)
+ * @param panel         LCD panel handle
+ * @param io            LCD panel IO handle
+ * @return
+ *      - ESP_OK on success
+ */
+esp_err_t lvgl_port_get_panel(lv_disp_t *disp, esp_lcd_panel_handle_t *panel, esp_lcd_panel_io_handle_t *io);
+
+/**
+ * @brief Replace the color transfer done callback of the display's panel IO
+ *
+ * @note LVGL's flush ready callback is registered there. Replace it only while LVGL is stopped,
+ *       and restore it (cb NULL) before resuming.
+ *
+ * @param disp          LVGL display handle (returned from lvgl_port_add_disp)
+ * @param cb            Callback called from ISR when a color transfer is done, NULL for LVGL's
+ * @param user_ctx      Passed to cb
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the port doesn't use the callback (IDF older than 4.4.4 or 5.0.0)
+ */
+esp_err_t lvgl_port_set_trans_done_cb(lv_disp_t *disp, esp_lcd_panel_io_color_trans_done_cb_t cb, void *user_ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,286 @@
+/*
+ * Builds a synthetic regression corpus from a single grayscale capture.
+ *
+ * Every variant is a 240x240 frame (the size qr_task sees) with the
+ * source scaled, rotated, blurred, washed by glare or inverted, written
+ * to <outdir>/<category>/<name>.pgm. Frames are mirrored vertically like
+ * the camera output (set_vflip), so quirc_bench decodes them with the
+ * same quirc_flip as qr_task.
+ *
+ * Rendering is integer only, so the frames are the same bytes on every
+ * host and compiler and corpus/baseline.txt describes them exactly. Each
+ * frame's FNV-1a hash is printed as "<category>/<name>.pgm <hash>"; with
+ * -c the hashes are checked against such a list (corpus/frames.txt) and
+ * any difference fails the run.
+ *
+ *   corpus_gen [-c frames.txt] <source.pgm> <outdir>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define FRAME_SIZE 240
+#define GLARE_RADIUS 70 // the curvature of the old 35 pixel gaussian at the centre
+
+struct variant {
+    const char *category;
+    const char *name;
+    int scale;   // percent
+    int cos_q16; // of the rotation angle, 16.16
+    int sin_q16;
+    int blur;    // box blur radius
+    int glare;   // peak brightness added at the glare spot
+    int invert;
+};
+
+/* cos and sin of 0, 10, 25, 45 and 90 degrees in 16.16 */
+#define ROT_000 65536, 0
+#define ROT_010 64540, 11380
+#define ROT_025 59396, 27697
+#define ROT_045 46341, 46341
+#define ROT_090 0, 65536
+
+static const struct variant variants[] = {
+    {"size", "scale_050", 50, ROT_000, 0, 0, 0},
+    {"size", "scale_075", 75, ROT_000, 0, 0, 0},
+    {"size", "scale_100", 100, ROT_000, 0, 0, 0},
+    {"size", "scale_150", 150, ROT_000, 0, 0, 0},
+    {"size", "scale_185", 185, ROT_000, 0, 0, 0},
+    {"angle", "rot_010", 120, ROT_010, 0, 0, 0},
+    {"angle", "rot_025", 120, ROT_025, 0, 0, 0},
+    {"angle", "rot_045", 120, ROT_045, 0, 0, 0},
+    {"angle", "rot_090", 120, ROT_090, 0, 0, 0},
+    {"blur", "box_1", 120, ROT_000, 1, 0, 0},
+    {"blur", "box_2", 120, ROT_000, 2, 0, 0},
+    {"blur", "box_3", 120, ROT_000, 3, 0, 0},
+    {"glare", "glare_080", 120, ROT_000, 0, 80, 0},
+    {"glare", "glare_160", 120, ROT_000, 0, 160, 0},
+    {"glare", "glare_240", 120, ROT_000, 0, 240, 0},
+    {"inverted", "inverted", 120, ROT_000, 0, 0, 1},
+    {"inverted", "inverted_scale_100", 100, ROT_000, 0, 0, 1},
+    {"inverted", "inverted_rot_025", 120, ROT_025, 0, 0, 1},
+};
+
+static uint8_t *load_pgm(const char *path, int *w, int *h)
+{
+    FILE *f = fopen(path, "rb");
+    int maxval;
+    uint8_t *pixels = NULL;
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    if (fscanf(f, "P5 %d %d %d", w, h, &maxval) == 3 && maxval == 255 && fgetc(f) != EOF) {
+        pixels = malloc(*w * *h);
+        if (pixels && fread(pixels, 1, *w * *h, f) != (size_t)(*w * *h)) {
+            free(pixels);
+            pixels = NULL;
+        }
+    }
+
+    if (!pixels) {
+        fprintf(stderr, "%s: not an 8-bit binary PGM\n", path);
+    }
+
+    fclose(f);
+    return pixels;
+}
+
+static int save_pgm(const char *path, const uint8_t *pixels)
+{
+    FILE *f = fopen(path, "wb");
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(f, "P5\n%d %d\n255\n", FRAME_SIZE, FRAME_SIZE);
+    fwrite(pixels, 1, FRAME_SIZE * FRAME_SIZE, f);
+    fclose(f);
+    return 0;
+}
+
+/* Bilinear sample at 16.16 coordinates, anything outside the source is paper white */
+static uint8_t sample(const uint8_t *src, int w, int h, int64_t x, int64_t y)
+{
+    int64_t x0 = x >> 16;
+    int64_t y0 = y >> 16;
+    int64_t fx = x & 0xffff;
+    int64_t fy = y & 0xffff;
+    int64_t p[4];
+
+    for (int i = 0; i < 4; i++) {
+        int64_t sx = x0 + (i & 1);
+        int64_t sy = y0 + (i >> 1);
+        p[i] = (sx < 0 || sy < 0 || sx >= w || sy >= h) ? 255 : src[sy * w + sx];
+    }
+
+    int64_t top = p[0] * (65536 - fx) + p[1] * fx;
+    int64_t bottom = p[2] * (65536 - fx) + p[3] * fx;
+    return (top * (65536 - fy) + bottom * fy + (1LL << 31)) >> 32;
+}
+
+/* Integer only, so every host writes the same bytes and the baseline holds */
+static void render(const struct variant *v, const uint8_t *src, int w, int h, uint8_t *dst)
+{
+    static uint8_t tmp[FRAME_SIZE * FRAME_SIZE];
+    int64_t c = (int64_t)v->cos_q16 * 100 / v->scale;
+    int64_t s = (int64_t)v->sin_q16 * 100 / v->scale;
+
+    /* Inverse map each output pixel back into the source, centred */
+    for (int y = 0; y < FRAME_SIZE; y++) {
+        for (int x = 0; x < FRAME_SIZE; x++) {
+            int dx = x - FRAME_SIZE / 2;
+            int dy = y - FRAME_SIZE / 2;
+            int64_t sx = c * dx + s * dy + ((int64_t)w << 15);
+            int64_t sy = -s * dx + c * dy + ((int64_t)h << 15);
+            tmp[y * FRAME_SIZE + x] = sample(src, w, h, sx, sy);
+        }
+    }
+
+    for (int y = 0; y < FRAME_SIZE; y++) {
+        for (int x = 0; x < FRAME_SIZE; x++) {
+            int sum = 0;
+            int n = 0;
+
+            for (int by = -v->blur; by <= v->blur; by++) {
+                for (int bx = -v->blur; bx <= v->blur; bx++) {
+                    int sx = x + bx;
+                    int sy = y + by;
+                    if (sx >= 0 && sy >= 0 && sx < FRAME_SIZE && sy < FRAME_SIZE) {
+                        sum += tmp[sy * FRAME_SIZE + sx];
+                        n++;
+                    }
+                }
+            }
+
+            int value = sum / n;
+
+            if (v->glare) {
+                /* Specular spot up and left of centre, falling off as (1 + d^2/r^2)^-2 */
+                int gx = x - FRAME_SIZE * 2 / 5;
+                int gy = y - FRAME_SIZE * 2 / 5;
+                int64_t r2 = GLARE_RADIUS * GLARE_RADIUS;
+                int64_t spread = r2 + gx * gx + gy * gy;
+                value += v->glare * r2 * r2 / (spread * spread);
+            }
+
+            if (value > 255) {
+                value = 255;
+            }
+
+            dst[(FRAME_SIZE - 1 - y) * FRAME_SIZE + x] = v->invert ? 255 - value : value;
+        }
+    }
+}
+
+/* mkdir -p */
+static void make_dirs(const char *dir)
+{
+    char path[1024];
+
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char *p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        mkdir(path, 0755);
+        *p = '/';
+    }
+    mkdir(path, 0755);
+}
+
+static uint32_t frame_hash(const uint8_t *pixels)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < FRAME_SIZE * FRAME_SIZE; i++) {
+        hash = (hash ^ pixels[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Looks name up in a "<name> <hash>" list as printed by a previous run */
+static int check_hash(FILE *list, const char *name, uint32_t hash)
+{
+    char listed[1024];
+    uint32_t expected;
+
+    rewind(list);
+    while (fscanf(list, "%1023s %x", listed, &expected) == 2) {
+        if (strcmp(listed, name) == 0) {
+            if (expected == hash) {
+                return 0;
+            }
+            fprintf(stderr, "%s: %08x, expected %08x\n", name, hash, expected);
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "%s: not in the frame list\n", name);
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t frame[FRAME_SIZE * FRAME_SIZE];
+    char path[1024];
+    char name[256];
+    FILE *list = NULL;
+    int mismatches = 0;
+    int w, h;
+
+    if (argc == 5 && strcmp(argv[1], "-c") == 0) {
+        list = fopen(argv[2], "r");
+        if (!list) {
+            fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s [-c frames.txt] <source.pgm> <outdir>\n", argv[0]);
+        return 2;
+    }
+
+    uint8_t *src = load_pgm(argv[1], &w, &h);
+    if (!src) {
+        return 1;
+    }
+
+    make_dirs(argv[2]);
+
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        const struct variant *v = &variants[i];
+
+        snprintf(path, sizeof(path), "%s/%s", argv[2], v->category);
+        mkdir(path, 0755);
+
+        snprintf(name, sizeof(name), "%s/%s.pgm", v->category, v->name);
+        snprintf(path, sizeof(path), "%s/%s", argv[2], name);
+        render(v, src, w, h, frame);
+        if (save_pgm(path, frame) < 0) {
+            free(src);
+            return 1;
+        }
+
+        uint32_t hash = frame_hash(frame);
+        printf("%s %08x\n", name, hash);
+        if (list && check_hash(list, name, hash) < 0) {
+            mismatches++;
+        }
+    }
+
+    if (list) {
+        fclose(list);
+    }
+    free(src);
+    return mismatches ? 1 : 0;
+}
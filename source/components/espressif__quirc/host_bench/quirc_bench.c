@@ -0,0 +1,576 @@
+/*
+ * Host benchmark for the vendored quirc.
+ *
+ * Runs every PGM found under the given paths through the same steps as
+ * qr_task (quirc_end, quirc_validate, quirc_extract, quirc_flip,
+ * quirc_decode) and reports decode yield, time per stage and memory.
+ * Results can be saved as a baseline and diffed against later runs.
+ *
+ * With -s the frames are fed to quirc_feed() in bands the way the camera
+ * delivers them, and "end" is the time left after the last band arrives.
+ *
+ * qr_task looks for light on dark codes in the frame after one without a
+ * valid grid. Such a frame is scanned again here with quirc_set_inverted(),
+ * standing in for that next frame, and both passes are timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <malloc.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "quirc.h"
+#include "quirc_internal.h"
+
+#define MAX_PATH 1024
+
+struct frame_result {
+    char path[MAX_PATH];
+    int grids;
+    int rejected_early;
+    int decoded;
+    int inverted; // decoded on the light on dark pass
+    uint32_t payload_hash;
+    double end_us;
+    double extract_us;
+    double decode_us;
+};
+
+struct summary {
+    int files;
+    int files_decoded;
+    int grids;
+    int rejected_early;
+    int decoded;
+    int inverted;
+    double end_us;
+    double extract_us;
+    double decode_us;
+};
+
+static struct quirc *decoder;
+static int repeats = 5;
+static int flip = 1;
+static int verbose = 0;
+static int band_rows = 0; // stream in bands of this many rows, 0 = quirc_end
+static int decode_all = 0; // keep decoding after the first success
+static int try_inverted = 1; // scan frames without a valid grid again, light on dark
+
+static struct frame_result *results;
+static int result_count;
+static int result_capacity;
+
+static size_t peak_heap;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sample_heap(void)
+{
+    struct mallinfo2 mi = mallinfo2();
+    if (mi.uordblks > peak_heap) {
+        peak_heap = mi.uordblks;
+    }
+}
+
+static uint32_t fnv1a(const uint8_t *data, int len)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Loads a binary (P5) PGM. Returns the pixels and fills w/h, or NULL. */
+static uint8_t *load_pgm(const char *path, int *w, int *h)
+{
+    FILE *f = fopen(path, "rb");
+    int maxval;
+    uint8_t *pixels = NULL;
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    if (fscanf(f, "P5 %d %d %d", w, h, &maxval) != 3 || maxval != 255 || fgetc(f) == EOF) {
+        fprintf(stderr, "%s: not an 8-bit binary PGM\n", path);
+        goto out;
+    }
+
+    pixels = malloc(*w * *h);
+    if (pixels && fread(pixels, 1, *w * *h, f) != (size_t)(*w * *h)) {
+        fprintf(stderr, "%s: truncated\n", path);
+        free(pixels);
+        pixels = NULL;
+    }
+
+out:
+    fclose(f);
+    return pixels;
+}
+
+static struct frame_result *new_result(const char *path)
+{
+    if (result_count == result_capacity) {
+        result_capacity = result_capacity ? result_capacity * 2 : 64;
+        results = realloc(results, result_capacity * sizeof(*results));
+    }
+
+    struct frame_result *res = &results[result_count++];
+    memset(res, 0, sizeof(*res));
+    snprintf(res->path, sizeof(res->path), "%s", path);
+    return res;
+}
+
+static void add_to_summary(struct summary *sum, const struct frame_result *res)
+{
+    sum->files++;
+    sum->files_decoded += res->decoded > 0;
+    sum->grids += res->grids;
+    sum->rejected_early += res->rejected_early;
+    sum->decoded += res->decoded;
+    sum->inverted += res->inverted;
+    sum->end_us += res->end_us;
+    sum->extract_us += res->extract_us;
+    sum->decode_us += res->decode_us;
+}
+
+static void merge_summary(struct summary *sum, const struct summary *sub)
+{
+    sum->files += sub->files;
+    sum->files_decoded += sub->files_decoded;
+    sum->grids += sub->grids;
+    sum->rejected_early += sub->rejected_early;
+    sum->decoded += sub->decoded;
+    sum->inverted += sub->inverted;
+    sum->end_us += sub->end_us;
+    sum->extract_us += sub->extract_us;
+    sum->decode_us += sub->decode_us;
+}
+
+static void print_summary(const char *name, const struct summary *sum)
+{
+    if (!sum->files) {
+        return;
+    }
+
+    printf("%s: %d frames, yield %d/%d (%d%%), %d grids, %d rejected early, %d decoded (%d inverted)\n",
+           name, sum->files, sum->files_decoded, sum->files,
+           (sum->files_decoded * 100 + sum->files / 2) / sum->files,
+           sum->grids, sum->rejected_early, sum->decoded, sum->inverted);
+    printf("    ms/frame: quirc_end %.3f, extract %.3f, decode %.3f, total %.3f\n",
+           sum->end_us / sum->files / 1000, sum->extract_us / sum->files / 1000,
+           sum->decode_us / sum->files / 1000,
+           (sum->end_us + sum->extract_us + sum->decode_us) / sum->files / 1000);
+}
+
+/* One pass over the frame, like one qr_task frame. Adds its grids and early
+ * rejections to the counts and its time to res, returns the codes decoded.
+ * Payloads are only recorded and printed on the first repeat.
+ */
+static int scan_pass(const uint8_t *image, int w, int h, int inverted, int first,
+                     struct frame_result *res, int *grids, int *rejected)
+{
+    static struct quirc_code code;
+    static struct quirc_data data;
+    double start;
+
+    quirc_set_inverted(decoder, inverted);
+    uint8_t *buf = quirc_begin(decoder, NULL, NULL);
+
+    if (band_rows) {
+        int y;
+
+        for (y = 0; y + band_rows < h; y += band_rows) {
+            memcpy(buf + y * w, image + y * w, band_rows * w);
+            quirc_feed(decoder, band_rows);
+        }
+        memcpy(buf + y * w, image + y * w, (h - y) * w);
+
+        start = now_us();
+        quirc_end_stream(decoder);
+    } else {
+        memcpy(buf, image, w * h);
+
+        start = now_us();
+        quirc_end(decoder);
+    }
+    res->end_us += now_us() - start;
+
+    int order[QUIRC_MAX_GRIDS];
+    int count = quirc_rank(decoder, order, QUIRC_MAX_GRIDS);
+    int decoded = 0;
+
+    /* Best candidates first, like qr_task */
+    for (int n = 0; n < count; n++) {
+        int i = order[n];
+
+        if (decoded && !decode_all) {
+            break;
+        }
+
+        if (quirc_validate(decoder, i, flip) != QUIRC_SUCCESS) {
+            (*rejected)++;
+            continue;
+        }
+
+        start = now_us();
+        quirc_extract(decoder, i, &code);
+        if (flip) {
+            quirc_flip(&code);
+        }
+        res->extract_us += now_us() - start;
+
+        start = now_us();
+        quirc_decode_error_t err = quirc_decode(&code, &data);
+        res->decode_us += now_us() - start;
+
+        if (err == QUIRC_SUCCESS) {
+            if (!decoded && first) {
+                res->payload_hash = fnv1a(data.payload, data.payload_len);
+            }
+            decoded++;
+            if (verbose && first) {
+                printf("    %s%s\n", data.payload, inverted ? " (inverted)" : "");
+            }
+        } else if (verbose && first) {
+            printf("    grid %d (quality %d): %s\n", i, quirc_grid_quality(decoder, i), quirc_strerror(err));
+        }
+    }
+
+    *grids += count;
+    return decoded;
+}
+
+static int scan_file(const char *path, struct summary *sum)
+{
+    int w, h;
+    uint8_t *image = load_pgm(path, &w, &h);
+
+    if (!image) {
+        return -1;
+    }
+
+    /* Resizing forgets the streamed threshold. Frames of the same size keep it,
+     * so the first pass over each one is scanned with the previous frame's
+     * threshold, like a camera frame after an exposure change.
+     */
+    if ((w != decoder->w || h != decoder->h) && quirc_resize(decoder, w, h) < 0) {
+        fprintf(stderr, "%s: quirc_resize failed\n", path);
+        free(image);
+        return -1;
+    }
+    sample_heap();
+
+    struct frame_result *res = new_result(path);
+
+    for (int r = 0; r < repeats; r++) {
+        int grids = 0;
+        int rejected = 0;
+        int decoded = scan_pass(image, w, h, 0, r == 0, res, &grids, &rejected);
+        int inverted = 0;
+
+        /* No valid grid, so qr_task's next frame looks for a light on dark code */
+        if (try_inverted && grids == rejected) {
+            inverted = scan_pass(image, w, h, 1, r == 0, res, &grids, &rejected);
+            decoded += inverted;
+        }
+
+        /* The first pass is the one a streamed frame gets on the device */
+        if (r == 0) {
+            res->grids = grids;
+            res->rejected_early = rejected;
+            res->decoded = decoded;
+            res->inverted = inverted;
+        }
+    }
+    sample_heap();
+
+    res->end_us /= repeats;
+    res->extract_us /= repeats;
+    res->decode_us /= repeats;
+
+    printf("  %-48s %4dx%-4d %3d %3d %3d %3d %8.3f %8.3f %8.3f\n", path, w, h,
+           res->grids, res->rejected_early, res->decoded, res->inverted,
+           res->end_us / 1000, res->extract_us / 1000, res->decode_us / 1000);
+
+    add_to_summary(sum, res);
+    free(image);
+    return 1;
+}
+
+static int scan_path(const char *path, struct summary *sum);
+
+static int scan_dir(const char *path, struct summary *sum)
+{
+    struct dirent **entries;
+    struct summary dir_sum = {0};
+    int n = scandir(path, &entries, NULL, alphasort);
+
+    if (n < 0) {
+        fprintf(stderr, "%s: scandir: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (entries[i]->d_name[0] != '.') {
+            char fullpath[MAX_PATH];
+            snprintf(fullpath, sizeof(fullpath), "%s/%s", path, entries[i]->d_name);
+            scan_path(fullpath, &dir_sum);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+
+    print_summary(path, &dir_sum);
+    merge_summary(sum, &dir_sum);
+    return dir_sum.files > 0;
+}
+
+static int scan_path(const char *path, struct summary *sum)
+{
+    struct stat st;
+    size_t len = strlen(path);
+
+    if (stat(path, &st) < 0) {
+        fprintf(stderr, "%s: stat: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        return scan_dir(path, sum);
+    }
+
+    if (S_ISREG(st.st_mode) && len > 4 && strcmp(path + len - 4, ".pgm") == 0) {
+        return scan_file(path, sum);
+    }
+
+    return 0;
+}
+
+/* Baseline format, one frame per line:
+ *   <path> <grids> <rejected_early> <decoded> <payload_hash> <end_us> <extract_us> <decode_us>
+ */
+static int write_baseline(const char *file)
+{
+    FILE *f = fopen(file, "w");
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", file, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < result_count; i++) {
+        const struct frame_result *res = &results[i];
+        fprintf(f, "%s %d %d %d %08x %.1f %.1f %.1f\n", res->path, res->grids,
+                res->rejected_early, res->decoded, res->payload_hash,
+                res->end_us, res->extract_us, res->decode_us);
+    }
+
+    fclose(f);
+    printf("baseline written to %s\n", file);
+    return 0;
+}
+
+static int diff_baseline(const char *file)
+{
+    FILE *f = fopen(file, "r");
+    struct frame_result old;
+    double old_total = 0;
+    double new_total = 0;
+    int matched = 0;
+    int lost = 0;
+    int gained = 0;
+    int miscounted = 0;
+    int changed = 0;
+    int missing = 0;
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", file, strerror(errno));
+        return -1;
+    }
+
+    printf("\ndiff against %s:\n", file);
+
+    while (fscanf(f, "%1023s %d %d %d %x %lf %lf %lf", old.path, &old.grids,
+                  &old.rejected_early, &old.decoded, &old.payload_hash,
+                  &old.end_us, &old.extract_us, &old.decode_us) == 8) {
+        int i;
+
+        for (i = 0; i < result_count; i++) {
+            const struct frame_result *res = &results[i];
+
+            if (strcmp(res->path, old.path) != 0) {
+                continue;
+            }
+
+            matched++;
+            old_total += old.end_us + old.extract_us + old.decode_us;
+            new_total += res->end_us + res->extract_us + res->decode_us;
+
+            if (old.decoded && !res->decoded) {
+                lost++;
+                printf("  LOST     %s\n", res->path);
+            } else if (!old.decoded && res->decoded) {
+                gained++;
+                printf("  GAINED   %s\n", res->path);
+            } else if (old.decoded != res->decoded) {
+                miscounted++;
+                printf("  COUNT    %s: %d decoded, expected %d\n", res->path, res->decoded, old.decoded);
+            } else if (old.decoded && old.payload_hash != res->payload_hash) {
+                changed++;
+                printf("  CHANGED  %s\n", res->path);
+            }
+            break;
+        }
+
+        /* A frame the baseline has and this run didn't scan is a lost frame too */
+        if (i == result_count) {
+            missing++;
+            printf("  MISSING  %s\n", old.path);
+        }
+    }
+    fclose(f);
+
+    if (!matched) {
+        printf("  no frames in common\n");
+        return missing ? 1 : 0;
+    }
+
+    printf("  %d frames compared, %d lost, %d gained, %d miscounted, %d payloads changed, %d missing\n",
+           matched, lost, gained, miscounted, changed, missing);
+    printf("  total time %.3f ms -> %.3f ms per frame (%+.1f%%)\n",
+           old_total / matched / 1000, new_total / matched / 1000,
+           (new_total - old_total) * 100 / old_total);
+
+    /* Every frame must decode exactly as many codes as the baseline says.
+     * A gain fails too, so an improvement is recorded with -w rather than
+     * left for the next regression to hide behind.
+     */
+    if (gained) {
+        printf("  decodes gained, store the new results with -w once they are understood\n");
+    }
+    return lost || gained || miscounted || changed || missing ? 1 : 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-r repeats] [-s rows] [-a] [-n] [-i] [-v] [-b baseline] [-w baseline] <pgm|dir>...\n"
+            "  -r  decode every frame this many times, timings are averaged (default %d)\n"
+            "  -s  stream frames in bands of this many rows, end time is what's left after the last band\n"
+            "  -a  decode every grid instead of stopping at the first success\n"
+            "  -n  don't quirc_flip codes before decoding (qr_task does)\n"
+            "  -i  don't scan frames without a valid grid again for light on dark codes (qr_task does)\n"
+            "  -v  print payloads and decode errors\n"
+            "  -b  diff the results against a stored baseline\n"
+            "  -w  store the results as a new baseline\n",
+            name, repeats);
+}
+
+int main(int argc, char **argv)
+{
+    const char *baseline_in = NULL;
+    const char *baseline_out = NULL;
+    struct summary total = {0};
+    struct rusage usage_info;
+    int ret = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:s:anivb:w:")) >= 0) {
+        switch (opt) {
+        case 'r':
+            repeats = atoi(optarg) > 0 ? atoi(optarg) : 1;
+            break;
+        case 's':
+            band_rows = atoi(optarg) > 0 ? atoi(optarg) : 0;
+            break;
+        case 'a':
+            decode_all = 1;
+            break;
+        case 'n':
+            flip = 0;
+            break;
+        case 'i':
+            try_inverted = 0;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'b':
+            baseline_in = optarg;
+            break;
+        case 'w':
+            baseline_out = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    decoder = quirc_new();
+    if (!decoder) {
+        perror("quirc_new");
+        return 1;
+    }
+    sample_heap();
+
+    printf("quirc %s, %d repeats per frame, flip %s, inverted %s", quirc_version(), repeats, flip ? "on" : "off",
+           try_inverted ? "on" : "off");
+    if (band_rows) {
+        printf(", streamed in %d row bands", band_rows);
+    }
+    printf("\n");
+    printf("  %-48s %9s %3s %3s %3s %3s %8s %8s %8s\n", "frame", "size", "grd", "rej", "dec",
+           "inv", "end ms", "extr ms", "dec ms");
+
+    for (int i = optind; i < argc; i++) {
+        scan_path(argv[i], &total);
+    }
+
+    puts("----------------------------------------"
+         "----------------------------------------");
+    print_summary("TOTAL", &total);
+
+    if (band_rows) {
+        struct quirc_stream_stats stream;
+
+        quirc_get_stream_stats(decoder, &stream);
+        printf("streamed: %u frames, %u scanned again with their own threshold, %u finder hits dropped\n",
+               stream.frames, stream.rethresholded, stream.finder_hits_dropped);
+    }
+
+    getrusage(RUSAGE_SELF, &usage_info);
+    printf("memory: struct quirc %zu bytes, peak heap %zu bytes, max rss %ld kB\n",
+           sizeof(struct quirc), peak_heap, usage_info.ru_maxrss);
+
+    if (baseline_in) {
+        ret = diff_baseline(baseline_in);
+    }
+
+    if (baseline_out) {
+        write_baseline(baseline_out);
+    }
+
+    quirc_destroy(decoder);
+    free(results);
+    return ret < 0 ? 1 : ret;
+}
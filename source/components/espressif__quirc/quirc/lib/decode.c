@@ -410,6 +410,14 @@ static quirc_decode_error_t correct_format(uint16_t *f_ret)
 	return QUIRC_SUCCESS;
 }
 
+/* Exposed for quirc_validate(), which samples the format strips straight
+ * from a grid instead of going through a full struct quirc_code.
+ */
+quirc_decode_error_t quirc_correct_format(uint16_t *f_ret)
+{
+	return correct_format(f_ret);
+}
+
 /************************************************************************
  * Decoder algorithm
  */
@@ -288,20 +288,20 @@ static void flood_fill_seed(struct quirc *q,
  * Adaptive thresholding
  */
 
-static uint8_t otsu(const struct quirc *q)
+static void histogram_rows(const struct quirc *q, unsigned int *histogram,
+			   int y, int rows)
 {
-	unsigned int numPixels = q->w * q->h;
-
-	// Calculate histogram
-	unsigned int histogram[UINT8_MAX + 1];
-	(void)memset(histogram, 0, sizeof(histogram));
-	uint8_t* ptr = q->image;
-	unsigned int length = numPixels;
+	uint8_t* ptr = q->image + y * q->w;
+	unsigned int length = rows * q->w;
 	while (length--) {
 		uint8_t value = *ptr++;
 		histogram[value]++;
 	}
+}
 
+static uint8_t otsu_threshold(const unsigned int *histogram,
+			      unsigned int numPixels)
+{
 	// Calculate weighted sum of histogram values
 	quirc_float_t sum = 0;
 	unsigned int i = 0;
@@ -339,6 +339,16 @@ static uint8_t otsu(const struct quirc *q)
 	return threshold;
 }
 
+static uint8_t otsu(const struct quirc *q)
+{
+	// Calculate histogram
+	unsigned int histogram[UINT8_MAX + 1];
+	(void)memset(histogram, 0, sizeof(histogram));
+	histogram_rows(q, histogram, 0, q->h);
+
+	return otsu_threshold(histogram, q->w * q->h);
+}
+
 static void area_count(void *user_data, int y, int left, int right)
 {
 	((struct quirc_region *)user_data)->count += right - left + 1;
@@ -471,7 +481,8 @@ static void record_capstone(struct quirc *q, int ring, int stone)
 	struct quirc_capstone *capstone;
 	int cs_index;
 
-	if (q->num_capstones >= QUIRC_MAX_CAPSTONES)
+	if (q->num_capstones >= q->capstones_size &&
+	    quirc_grow_capstones(q) < 0)
 		return;
 
 	cs_index = q->num_capstones;
@@ -531,9 +542,35 @@ static void test_capstone(struct quirc *q, unsigned int x, unsigned int y,
 	record_capstone(q, ring_left, stone);
 }
 
-static void finder_scan(struct quirc *q, unsigned int y)
+/* Keep a finder pattern for test_capstone() once the image is complete.
+ * Flood filling it now could run into rows which aren't thresholded yet.
+ */
+static void record_finder_hit(struct quirc *q, unsigned int x, unsigned int y,
+			      const unsigned int *pb)
 {
-	quirc_pixel_t *row = q->pixels + y * q->w;
+	struct quirc_finder_hit *hit;
+
+	if (q->num_finder_hits >= q->finder_hits_size &&
+	    quirc_grow_finder_hits(q) < 0) {
+		q->finder_hits_lost++;
+		return;
+	}
+
+	hit = &q->finder_hits[q->num_finder_hits++];
+	hit->x = x;
+	hit->y = y;
+	memcpy(hit->pb, pb, sizeof(hit->pb));
+}
+
+/* Deferred scans run on the grayscale rows as they stream in, thresholded
+ * on the fly with the previous frame's threshold. The image is only
+ * binarized in quirc_end_stream(), once the frame's own threshold is known
+ * and the rows can still be thresholded again with it.
+ */
+static void finder_scan(struct quirc *q, unsigned int y, int defer)
+{
+	const uint8_t *gray = q->image + y * q->w;
+	const quirc_pixel_t *row = defer ? NULL : q->pixels + y * q->w;
 	unsigned int x;
 	int last_color = 0;
 	unsigned int run_length = 0;
@@ -542,7 +579,7 @@ static void finder_scan(struct quirc *q, unsigned int y)
 
 	memset(pb, 0, sizeof(pb));
 	for (x = 0; x < q->w; x++) {
-		int color = row[x] ? 1 : 0;
+		int color = defer ? (gray[x] < q->stream_threshold) != q->inverted : (row[x] ? 1 : 0);
 
 		if (x && color != last_color) {
 			memmove(pb, pb + 1, sizeof(pb[0]) * 4);
@@ -565,7 +602,9 @@ static void finder_scan(struct quirc *q, unsigned int y)
 					    pb[i] * scale > check[i] * avg + err)
 						ok = 0;
 
-				if (ok)
+				if (ok && defer)
+					record_finder_hit(q, x, y, pb);
+				else if (ok)
 					test_capstone(q, x, y, pb);
 			}
 		}
@@ -841,6 +880,8 @@ static void jiggle_perspective(struct quirc *q, int index)
 		for (i = 0; i < 8; i++)
 			adjustments[i] *= 0.5;
 	}
+
+	qr->fitness = best;
 }
 
 /* Once the capstones are in place and an alignment point has been
@@ -903,7 +944,7 @@ static void record_qr_grid(struct quirc *q, int a, int b, int c)
 	int qr_index;
 	struct quirc_grid *qr;
 
-	if (q->num_grids >= QUIRC_MAX_GRIDS)
+	if (q->num_grids >= q->grids_size && quirc_grow_grids(q) < 0)
 		return;
 
 	/* Construct the hypotenuse line from A to C. B should be to
@@ -1072,26 +1113,38 @@ static void test_grouping(struct quirc *q, unsigned int i)
 	test_neighbours(q, i, &hlist, &vlist);
 }
 
-static void pixels_setup(struct quirc *q, uint8_t threshold)
+static void pixels_setup_rows(struct quirc *q, uint8_t threshold,
+			      int y, int rows)
 {
 	if (QUIRC_PIXEL_ALIAS_IMAGE) {
 		q->pixels = (quirc_pixel_t *)q->image;
 	}
 
-	uint8_t* source = q->image;
-	quirc_pixel_t* dest = q->pixels;
-	int length = q->w * q->h;
+	uint8_t* source = q->image + y * q->w;
+	quirc_pixel_t* dest = q->pixels + y * q->w;
+	const quirc_pixel_t dark = q->inverted ? QUIRC_PIXEL_WHITE : QUIRC_PIXEL_BLACK;
+	const quirc_pixel_t light = q->inverted ? QUIRC_PIXEL_BLACK : QUIRC_PIXEL_WHITE;
+	int length = q->w * rows;
 	while (length--) {
 		uint8_t value = *source++;
-		*dest++ = (value < threshold) ? QUIRC_PIXEL_BLACK : QUIRC_PIXEL_WHITE;
+		*dest++ = (value < threshold) ? dark : light;
 	}
 }
 
+static void pixels_setup(struct quirc *q, uint8_t threshold)
+{
+	pixels_setup_rows(q, threshold, 0, q->h);
+}
+
 uint8_t *quirc_begin(struct quirc *q, int *w, int *h)
 {
 	q->num_regions = QUIRC_PIXEL_REGION;
 	q->num_capstones = 0;
 	q->num_grids = 0;
+	q->num_finder_hits = 0;
+	q->finder_hits_lost = 0;
+	q->rows_fed = 0;
+	(void)memset(q->histogram, 0, sizeof(q->histogram));
 
 	if (w)
 		*w = q->w;
@@ -1109,12 +1162,74 @@ void quirc_end(struct quirc *q)
 	pixels_setup(q, threshold);
 
 	for (i = 0; i < q->h; i++)
-		finder_scan(q, i);
+		finder_scan(q, i, 0);
+
+	for (i = 0; i < q->num_capstones; i++)
+		test_grouping(q, i);
+}
+
+void quirc_feed(struct quirc *q, int rows)
+{
+	int y = q->rows_fed;
+	int i;
+
+	if (rows > q->h - y)
+		rows = q->h - y;
+	if (rows <= 0)
+		return;
+
+	histogram_rows(q, q->histogram, y, rows);
+
+	if (q->stream_threshold >= 0) {
+		for (i = y; i < y + rows; i++)
+			finder_scan(q, i, 1);
+	}
+
+	q->rows_fed += rows;
+}
+
+void quirc_end_stream(struct quirc *q)
+{
+	uint8_t threshold;
+	int i;
+
+	quirc_feed(q, q->h - q->rows_fed);
+	threshold = otsu_threshold(q->histogram, q->w * q->h);
+
+	q->stream_stats.frames++;
+	q->stream_stats.finder_hits_dropped += q->finder_hits_lost;
+
+	if (q->stream_threshold >= 0 && !q->finder_hits_lost &&
+	    abs(threshold - q->stream_threshold) <= QUIRC_STREAM_THRESHOLD_MARGIN) {
+		/* Close enough: keep the threshold the hits were found with */
+		pixels_setup(q, q->stream_threshold);
+		for (i = 0; i < q->num_finder_hits; i++) {
+			struct quirc_finder_hit *hit = &q->finder_hits[i];
+
+			test_capstone(q, hit->x, hit->y, hit->pb);
+		}
+	} else {
+		/* The exposure changed or hits were dropped, start over with
+		 * the frame's own threshold like quirc_end().
+		 */
+		if (q->stream_threshold >= 0)
+			q->stream_stats.rethresholded++;
+		pixels_setup(q, threshold);
+		for (i = 0; i < q->h; i++)
+			finder_scan(q, i, 0);
+	}
+	q->stream_threshold = threshold;
 
 	for (i = 0; i < q->num_capstones; i++)
 		test_grouping(q, i);
 }
 
+void quirc_get_stream_stats(const struct quirc *q,
+			    struct quirc_stream_stats *stats)
+{
+	*stats = q->stream_stats;
+}
+
 void quirc_extract(const struct quirc *q, int index,
 		   struct quirc_code *code)
 {
@@ -1151,3 +1266,164 @@ void quirc_extract(const struct quirc *q, int index,
 		}
 	}
 }
+
+/* Read a cell as quirc_decode() will see it: 1 for black, 0 otherwise.
+ * When the code is going to be flipped, the decoder's (x, y) is the
+ * grid's (y, x).
+ */
+static int validate_cell(const struct quirc *q, int index, int x, int y,
+			 int flipped)
+{
+	if (flipped)
+		return read_cell(q, index, y, x) > 0;
+
+	return read_cell(q, index, x, y) > 0;
+}
+
+static quirc_decode_error_t validate_format(const struct quirc *q, int index,
+					    int flipped, int which)
+{
+	const struct quirc_grid *qr = &q->grids[index];
+	uint16_t format = 0;
+	int i;
+
+	/* Same cell order as read_format() in decode.c */
+	if (which) {
+		for (i = 0; i < 7; i++)
+			format = (format << 1) |
+				validate_cell(q, index, 8,
+					      qr->grid_size - 1 - i, flipped);
+		for (i = 0; i < 8; i++)
+			format = (format << 1) |
+				validate_cell(q, index,
+					      qr->grid_size - 8 + i, 8, flipped);
+	} else {
+		static const int xs[15] = {
+			8, 8, 8, 8, 8, 8, 8, 8, 7, 5, 4, 3, 2, 1, 0
+		};
+		static const int ys[15] = {
+			0, 1, 2, 3, 4, 5, 7, 8, 8, 8, 8, 8, 8, 8, 8
+		};
+
+		for (i = 14; i >= 0; i--)
+			format = (format << 1) |
+				validate_cell(q, index, xs[i], ys[i], flipped);
+	}
+
+	format ^= 0x5412;
+
+	return quirc_correct_format(&format);
+}
+
+quirc_decode_error_t quirc_validate(const struct quirc *q, int index,
+				    int flipped)
+{
+	const struct quirc_grid *qr;
+	int score = 0;
+	int cells;
+	int i;
+
+	if (index < 0 || index >= q->num_grids)
+		return QUIRC_ERROR_INVALID_GRID_SIZE;
+
+	qr = &q->grids[index];
+
+	if (qr->grid_size > QUIRC_MAX_GRID_SIZE || qr->grid_size < 21 ||
+	    (qr->grid_size - 17) % 4)
+		return QUIRC_ERROR_INVALID_GRID_SIZE;
+
+	/* The timing patterns alternate strictly, so random texture scores
+	 * around zero. Ask for at least two thirds of the cells to match.
+	 * They are symmetric, so the orientation doesn't matter here.
+	 */
+	cells = (qr->grid_size - 14) * 2;
+	for (i = 0; i < qr->grid_size - 14; i++) {
+		int expect = (i & 1) ? 1 : -1;
+
+		score += read_cell(q, index, i + 7, 6) * expect;
+		score += read_cell(q, index, 6, i + 7) * expect;
+	}
+
+	if (score * 3 < cells)
+		return QUIRC_ERROR_FORMAT_ECC;
+
+	/* quirc_decode() accepts either copy of the format information */
+	if (validate_format(q, index, flipped, 0) &&
+	    validate_format(q, index, flipped, 1))
+		return QUIRC_ERROR_FORMAT_ECC;
+
+	return QUIRC_SUCCESS;
+}
+
+/* Best score fitness_all() can give a grid of this size: every sampled
+ * cell scoring its full 9 points.
+ */
+static int fitness_max(int grid_size)
+{
+	int version = (grid_size - 17) / 4;
+	const struct quirc_version_info *info = &quirc_version_db[version];
+	int cells = 0;
+	int ap_count;
+
+	cells += 2 * (grid_size - 14);	/* timing patterns */
+	cells += 3 * (1 + 8 + 16 + 24);	/* capstones, rings 1 to 3 */
+
+	if (version >= 0 && version <= QUIRC_MAX_VERSION) {
+		ap_count = 0;
+		while ((ap_count < QUIRC_MAX_ALIGNMENT) && info->apat[ap_count])
+			ap_count++;
+
+		/* alignment patterns, centre plus rings 1 and 2 */
+		if (ap_count > 2)
+			cells += 2 * (ap_count - 2) * 25;
+		if (ap_count > 1)
+			cells += (ap_count - 1) * (ap_count - 1) * 25;
+	}
+
+	return cells * 9;
+}
+
+int quirc_grid_quality(const struct quirc *q, int index)
+{
+	const struct quirc_grid *qr;
+	int quality;
+
+	if (index < 0 || index >= q->num_grids)
+		return 0;
+
+	qr = &q->grids[index];
+	if (qr->grid_size < 21)
+		return 0;
+
+	quality = qr->fitness * 1000 / fitness_max(qr->grid_size);
+	return quality < 0 ? 0 : quality;
+}
+
+int quirc_rank(const struct quirc *q, int *order, int max)
+{
+	int quality[QUIRC_MAX_GRIDS];
+	int count = q->num_grids < max ? q->num_grids : max;
+	int i, j;
+
+	if (count < 0)
+		count = 0;
+
+	/* Insertion sort over all grids, keeping the best max of them */
+	for (i = 0; i < q->num_grids; i++) {
+		int qi = quirc_grid_quality(q, i);
+
+		for (j = i < count ? i : count; j > 0 && quality[j - 1] < qi; j--) {
+			if (j < count) {
+				order[j] = order[j - 1];
+				quality[j] = quality[j - 1];
+			}
+		}
+
+		if (j < count) {
+			order[j] = i;
+			quality[j] = qi;
+		}
+	}
+
+	return count;
+}
@@ -26,12 +26,20 @@ const char *quirc_version(void)
 
 struct quirc *quirc_new(void)
 {
-	struct quirc *q = heap_caps_malloc(sizeof(*q), MALLOC_CAP_SPIRAM);
+	/* The struct itself is small and read on every pixel, keep it
+	   internal when possible */
+	struct quirc *q = heap_caps_malloc(sizeof(*q), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+	int i;
 
+	if (!q)
+		q = heap_caps_malloc(sizeof(*q), MALLOC_CAP_DEFAULT);
 	if (!q)
 		return NULL;
 
 	memset(q, 0, sizeof(*q));
+	for (i = 0; i < QUIRC_BUFFER_COUNT; i++)
+		q->caps[i] = MALLOC_CAP_SPIRAM;
+	q->stream_threshold = -1;
 	return q;
 }
 
@@ -42,14 +50,99 @@ void quirc_destroy(struct quirc *q)
 	   same size, so we need to be careful here to avoid a double free */
 	if (!QUIRC_PIXEL_ALIAS_IMAGE)
 		free(q->pixels);
+	free(q->regions);
+	free(q->capstones);
+	free(q->grids);
+	free(q->finder_hits);
 	free(q->flood_fill_vars);
 	free(q);
 }
 
+void quirc_set_caps(struct quirc *q, enum quirc_buffer buf, uint32_t caps)
+{
+	if (buf >= 0 && buf < QUIRC_BUFFER_COUNT)
+		q->caps[buf] = caps;
+}
+
+void quirc_set_inverted(struct quirc *q, int inverted)
+{
+	q->inverted = !!inverted;
+}
+
+void *quirc_alloc(const struct quirc *q, enum quirc_buffer buf, size_t size)
+{
+	void *ptr = heap_caps_malloc(size, q->caps[buf]);
+
+	if (!ptr && q->caps[buf] != MALLOC_CAP_DEFAULT)
+		ptr = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+	return ptr;
+}
+
+static void *grow_array(struct quirc *q, enum quirc_buffer buf, void *array,
+			int *size, size_t elem, int max)
+{
+	int new_size = *size ? *size * 2 : 8;
+	void *ptr;
+
+	if (*size >= max)
+		return NULL;
+	if (new_size > max)
+		new_size = max;
+
+	ptr = quirc_alloc(q, buf, new_size * elem);
+	if (!ptr)
+		return NULL;
+
+	if (array)
+		memcpy(ptr, array, *size * elem);
+	free(array);
+	*size = new_size;
+	return ptr;
+}
+
+int quirc_grow_capstones(struct quirc *q)
+{
+	struct quirc_capstone *capstones = grow_array(q, QUIRC_BUFFER_CAPSTONES,
+		q->capstones, &q->capstones_size, sizeof(*capstones),
+		QUIRC_MAX_CAPSTONES);
+
+	if (!capstones)
+		return -1;
+
+	q->capstones = capstones;
+	return 0;
+}
+
+int quirc_grow_grids(struct quirc *q)
+{
+	struct quirc_grid *grids = grow_array(q, QUIRC_BUFFER_GRIDS,
+		q->grids, &q->grids_size, sizeof(*grids), QUIRC_MAX_GRIDS);
+
+	if (!grids)
+		return -1;
+
+	q->grids = grids;
+	return 0;
+}
+
+int quirc_grow_finder_hits(struct quirc *q)
+{
+	struct quirc_finder_hit *hits = grow_array(q, QUIRC_BUFFER_FINDER_HITS,
+		q->finder_hits, &q->finder_hits_size, sizeof(*hits),
+		QUIRC_MAX_FINDER_HITS);
+
+	if (!hits)
+		return -1;
+
+	q->finder_hits = hits;
+	return 0;
+}
+
 int quirc_resize(struct quirc *q, int w, int h)
 {
 	uint8_t *image = NULL;
 	quirc_pixel_t *pixels = NULL;
+	struct quirc_region *regions = NULL;
 	size_t num_vars;
 	size_t vars_byte_size;
 	struct quirc_flood_fill_vars *vars = NULL;
@@ -67,7 +160,7 @@ int quirc_resize(struct quirc *q, int w, int h)
 	 * alloc a new buffer for q->image. We avoid realloc(3) because we want
 	 * on failure to be leave `q` in a consistant, unmodified state.
 	 */
-	image = heap_caps_malloc(w * h, MALLOC_CAP_SPIRAM); // calloc(w, h);
+	image = quirc_alloc(q, QUIRC_BUFFER_IMAGE, w * h); // calloc(w, h);
 	if (!image)
 		goto fail;
 
@@ -87,11 +180,15 @@ int quirc_resize(struct quirc *q, int w, int h)
 	/* alloc a new buffer for q->pixels if needed */
 	if (!QUIRC_PIXEL_ALIAS_IMAGE)
 	{
-		pixels = heap_caps_malloc(newdim, MALLOC_CAP_SPIRAM); // calloc(newdim, sizeof(quirc_pixel_t));
+		pixels = quirc_alloc(q, QUIRC_BUFFER_PIXELS, newdim * sizeof(quirc_pixel_t)); // calloc(newdim, sizeof(quirc_pixel_t));
 		if (!pixels)
 			goto fail;
 	}
 
+	regions = quirc_alloc(q, QUIRC_BUFFER_REGIONS, QUIRC_MAX_REGIONS * sizeof(*regions));
+	if (!regions)
+		goto fail;
+
 	/*
 	 * alloc the work area for the flood filling logic.
 	 *
@@ -118,7 +215,7 @@ int quirc_resize(struct quirc *q, int w, int h)
 	{
 		goto fail; /* size_t overflow */
 	}
-	vars = heap_caps_malloc(vars_byte_size, MALLOC_CAP_SPIRAM); // malloc(vars_byte_size);
+	vars = quirc_alloc(q, QUIRC_BUFFER_FLOOD_FILL, vars_byte_size); // malloc(vars_byte_size);
 	if (!vars)
 		goto fail;
 
@@ -132,15 +229,36 @@ int quirc_resize(struct quirc *q, int w, int h)
 		free(q->pixels);
 		q->pixels = pixels;
 	}
+	free(q->regions);
+	q->regions = regions;
 	free(q->flood_fill_vars);
 	q->flood_fill_vars = vars;
 	q->num_flood_fill_vars = num_vars;
 
+	/* Capstones and grids regrow on demand in their current placement */
+	free(q->capstones);
+	q->capstones = NULL;
+	q->capstones_size = 0;
+	q->num_capstones = 0;
+	free(q->grids);
+	q->grids = NULL;
+	q->grids_size = 0;
+	q->num_grids = 0;
+	free(q->finder_hits);
+	q->finder_hits = NULL;
+	q->finder_hits_size = 0;
+	q->num_finder_hits = 0;
+
+	/* The previous threshold belongs to a different image */
+	q->rows_fed = 0;
+	q->stream_threshold = -1;
+
 	return 0;
 	/* NOTREACHED */
 fail:
 	free(image);
 	free(pixels);
+	free(regions);
 	free(vars);
 
 	return -1;
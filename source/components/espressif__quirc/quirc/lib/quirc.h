@@ -44,6 +44,30 @@ void quirc_destroy(struct quirc *q);
  */
 int quirc_resize(struct quirc *q, int w, int h);
 
+/* Buffers owned by a recognizer. Each one can be placed in a different
+ * kind of memory with quirc_set_caps().
+ */
+enum quirc_buffer {
+	QUIRC_BUFFER_IMAGE,		/* input image, w * h bytes */
+	QUIRC_BUFFER_PIXELS,		/* region map, aliases the image unless
+					   QUIRC_MAX_REGIONS >= 255 */
+	QUIRC_BUFFER_REGIONS,		/* region table, touched for every pixel */
+	QUIRC_BUFFER_CAPSTONES,		/* grown on demand */
+	QUIRC_BUFFER_GRIDS,		/* grown on demand */
+	QUIRC_BUFFER_FLOOD_FILL,	/* flood fill work stack */
+	QUIRC_BUFFER_FINDER_HITS,	/* deferred finder patterns when
+					   streaming, grown on demand */
+	QUIRC_BUFFER_COUNT
+};
+
+/* Set the heap_caps_malloc() capability flags used for one of the
+ * recognizer's buffers. All buffers default to MALLOC_CAP_SPIRAM. The
+ * placement takes effect the next time the buffer is allocated, so call
+ * this before quirc_resize(). If the requested memory is exhausted the
+ * buffer falls back to MALLOC_CAP_DEFAULT.
+ */
+void quirc_set_caps(struct quirc *q, enum quirc_buffer buf, uint32_t caps);
+
 /* These functions are used to process images for QR-code recognition.
  * quirc_begin() must first be called to obtain access to a buffer into
  * which the input image should be placed. Optionally, the current
@@ -56,6 +80,46 @@ int quirc_resize(struct quirc *q, int w, int h);
 uint8_t *quirc_begin(struct quirc *q, int *w, int *h);
 void quirc_end(struct quirc *q);
 
+/* Streaming alternative to quirc_end(). After quirc_begin(), fill the
+ * buffer from top to bottom and call quirc_feed() every time another
+ * band of rows has been written. Each band is scanned for finder patterns
+ * straight away, so most of the work overlaps with producing the image.
+ * quirc_end_stream() must be called once the whole image is in the
+ * buffer; it feeds any remaining rows, binarizes the image, then turns
+ * the finder patterns into capstones and grids.
+ *
+ * The Otsu threshold for a frame is only known once all of its rows are
+ * in, so bands are scanned with the threshold of the previous streamed
+ * frame. If the frame's own threshold turns out to differ by more than a
+ * small margin (the exposure changed), or finder patterns were dropped
+ * past the internal limit, quirc_end_stream() throws the band scans away
+ * and does the same work as quirc_end(). So it does on the first frame
+ * after quirc_new() or quirc_resize(), when there is no threshold yet and
+ * quirc_feed() only gathers the histogram.
+ */
+void quirc_feed(struct quirc *q, int rows);
+void quirc_end_stream(struct quirc *q);
+
+/* Counts since quirc_new() of how streamed frames went. */
+struct quirc_stream_stats {
+	unsigned int	frames;			/* quirc_end_stream() calls */
+	unsigned int	rethresholded;		/* scanned again with their own
+						 * threshold */
+	unsigned int	finder_hits_dropped;	/* finder patterns past the
+						 * limit, their frame was
+						 * scanned again */
+};
+
+void quirc_get_stream_stats(const struct quirc *q,
+			    struct quirc_stream_stats *stats);
+
+/* Look for light on dark codes: pixels darker than the threshold count as
+ * white and the rest as black, so such codes are found, extracted and
+ * decoded as ordinary ones. Off after quirc_new(). Set it before
+ * quirc_begin(), it applies to the whole of the next image.
+ */
+void quirc_set_inverted(struct quirc *q, int inverted);
+
 /* This structure describes a location in the input image buffer. */
 struct quirc_point {
 	int	x;
@@ -164,6 +228,31 @@ int quirc_count(const struct quirc *q);
 void quirc_extract(const struct quirc *q, int index,
 		   struct quirc_code *code);
 
+/* Score the grid at the given index from 0 to 1000 by how well the
+ * capstones, timing patterns and alignment patterns fit the perspective
+ * transform found for it, as a fraction of a perfect fit.
+ */
+int quirc_grid_quality(const struct quirc *q, int index);
+
+/* Fill order with the indices of the grids found by quirc_end(), best
+ * quality first, so callers that expect a single code can decode the
+ * most promising candidate first and stop early. At most max indices are
+ * written. Returns the number written.
+ */
+int quirc_rank(const struct quirc *q, int *order, int max);
+
+/* Cheaply check that the grid at the given index looks like a real
+ * QR-code before paying for quirc_extract() and quirc_decode(). Only the
+ * timing patterns and the two format information strips are sampled.
+ * Set flipped if the code will be passed through quirc_flip() before
+ * decoding, so the format strips are read in the same orientation.
+ *
+ * Returns QUIRC_SUCCESS if the grid is worth extracting, or the error
+ * quirc_decode() would most likely have returned otherwise.
+ */
+quirc_decode_error_t quirc_validate(const struct quirc *q, int index,
+				    int flipped);
+
 /* Decode a QR-code, returning the payload data. */
 quirc_decode_error_t quirc_decode(const struct quirc_code *code,
 				  struct quirc_data *data);
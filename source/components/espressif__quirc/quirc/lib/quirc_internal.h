@@ -33,6 +33,13 @@
 #endif
 #define QUIRC_MAX_CAPSTONES	32
 #define QUIRC_MAX_GRIDS		(QUIRC_MAX_CAPSTONES * 2)
+#define QUIRC_MAX_FINDER_HITS	512
+
+/* How far a streamed frame's Otsu threshold may be from the previous
+ * frame's, which its bands were scanned with, before quirc_end_stream()
+ * scans it again with its own.
+ */
+#define QUIRC_STREAM_THRESHOLD_MARGIN	8
 
 #define QUIRC_PERSPECTIVE_PARAMS	8
 
@@ -91,6 +98,18 @@ struct quirc_grid {
 	/* Grid size and perspective transform */
 	int			grid_size;
 	quirc_float_t		c[QUIRC_PERSPECTIVE_PARAMS];
+
+	/* fitness_all() of the final perspective transform */
+	int			fitness;
+};
+
+/* A row run matching the 1:1:3:1:1 finder pattern, kept for
+ * test_capstone() until the image is complete.
+ */
+struct quirc_finder_hit {
+	int			x;
+	int			y;
+	unsigned int		pb[5];
 };
 
 struct quirc_flood_fill_vars {
@@ -107,18 +126,53 @@ struct quirc {
 	int			h;
 
 	int			num_regions;
-	struct quirc_region	regions[QUIRC_MAX_REGIONS];
+	struct quirc_region	*regions;	/* QUIRC_MAX_REGIONS entries */
 
 	int			num_capstones;
-	struct quirc_capstone	capstones[QUIRC_MAX_CAPSTONES];
+	int			capstones_size;
+	struct quirc_capstone	*capstones;
 
 	int			num_grids;
-	struct quirc_grid	grids[QUIRC_MAX_GRIDS];
+	int			grids_size;
+	struct quirc_grid	*grids;
 
 	size_t      		num_flood_fill_vars;
 	struct quirc_flood_fill_vars *flood_fill_vars;
+
+	/* Streaming state, see quirc_feed() */
+	int			rows_fed;
+	int			stream_threshold;	/* -1 until known */
+	unsigned int		histogram[UINT8_MAX + 1];
+	int			num_finder_hits;
+	int			finder_hits_size;
+	int			finder_hits_lost;	/* this frame, past the limit */
+	struct quirc_finder_hit	*finder_hits;
+	struct quirc_stream_stats stream_stats;
+
+	int			inverted;	/* see quirc_set_inverted() */
+
+	uint32_t		caps[QUIRC_BUFFER_COUNT];
 };
 
+/* Allocate one of the recognizer's buffers with the capabilities set by
+ * quirc_set_caps(). Defined in quirc.c.
+ */
+void *quirc_alloc(const struct quirc *q, enum quirc_buffer buf, size_t size);
+
+/* Make room for one more capstone or grid, doubling the array up to
+ * QUIRC_MAX_CAPSTONES or QUIRC_MAX_GRIDS. Returns 0 on success, or -1 if
+ * the limit was reached or memory ran out. Pointers into the old array
+ * are invalidated.
+ */
+int quirc_grow_capstones(struct quirc *q);
+int quirc_grow_grids(struct quirc *q);
+int quirc_grow_finder_hits(struct quirc *q);
+
+/* Correct a raw (unmasked) 15-bit format word in place. Defined in
+ * decode.c, shared with the early grid validation in identify.c.
+ */
+quirc_decode_error_t quirc_correct_format(uint16_t *f_ret);
+
 /************************************************************************
  * QR-code version information database
  */
@@ -51,6 +51,9 @@
     /*Size of the memory available for `lv_mem_alloc()` in bytes (>= 2kB)*/
     #define LV_MEM_SIZE (48U * 1024U)          /*[bytes]*/
 
+    /*Largest region `lv_mem_add_region()` takes next to the builtin pool (e.g. in PSRAM)*/
+    #define LV_MEM_REGION_MAX_SIZE (1024U * 1024U)          /*[bytes]*/
+
     /*Set an address for the memory pool instead of allocating it as a normal array. Can be in external SRAM too.*/
     #define LV_MEM_ADR 0     /*0: unused*/
     /*Instead of an address give a memory allocator that will be called to get a memory pool for LVGL. E.g. my_malloc*/
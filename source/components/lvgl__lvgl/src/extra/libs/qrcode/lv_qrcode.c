@@ -25,6 +25,8 @@
  **********************/
 static void lv_qrcode_constructor(const lv_obj_class_t * class_p, lv_obj_t * obj);
 static void lv_qrcode_destructor(const lv_obj_class_t * class_p, lv_obj_t * obj);
+static void expand_row(const uint8_t * qr, int y, int scale, int margin, uint8_t * row);
+static struct qrcodegen_Template * get_fixed_layout(int32_t version);
 
 /**********************
  *  STATIC VARIABLES
@@ -40,6 +42,17 @@ static lv_coord_t size_param;
 static lv_color_t dark_color_param;
 static lv_color_t light_color_param;
 
+/*8 modules, as qrcodegen packs them, expanded to 8 * `expand_scale` pixel bits*/
+static uint64_t expand_lut[256];
+static int expand_scale;
+
+/*Set by lv_qrcode_set_fixed_layout(), LV_QRCODE_FIXED_LAYOUTS of them*/
+static struct qrcodegen_Template * fixed_layout;
+static int8_t fixed_layout_mask;
+static int32_t fixed_layout_version[LV_QRCODE_FIXED_LAYOUTS];   /*0 if unused*/
+static uint32_t fixed_layout_use[LV_QRCODE_FIXED_LAYOUTS];
+static uint32_t fixed_layout_tick;
+
 /**********************
  *      MACROS
  **********************/
@@ -101,16 +114,25 @@ lv_res_t lv_qrcode_update(lv_obj_t * qrcode, const void * data, uint32_t data_le
                      qrcodegen_VERSION_MAX : qr_version + version_extend;
     }
 
-    uint8_t * qr0 = lv_mem_alloc(qrcodegen_BUFFER_LEN_FOR_VERSION(qr_version));
+    /*One spare byte, expand_row() reads modules 16 bits at a time*/
+    uint8_t * qr0 = lv_mem_alloc(qrcodegen_BUFFER_LEN_FOR_VERSION(qr_version) + 1);
     LV_ASSERT_MALLOC(qr0);
     uint8_t * data_tmp = lv_mem_alloc(qrcodegen_BUFFER_LEN_FOR_VERSION(qr_version));
     LV_ASSERT_MALLOC(data_tmp);
-    lv_memcpy(data_tmp, data, data_len);
 
-    bool ok = qrcodegen_encodeBinary(data_tmp, data_len,
-                                     qr0, qrcodegen_Ecc_MEDIUM,
-                                     qr_version, qr_version,
-                                     qrcodegen_Mask_AUTO, true);
+    bool ok;
+    if(fixed_layout && qr_version <= qrcodegen_TEMPLATE_VERSION_MAX) {
+        ok = qrcodegen_encodeBinaryTemplate(get_fixed_layout(qr_version), data, data_len, data_tmp,
+                                            qr0, qrcodegen_Ecc_MEDIUM, qr_version,
+                                            (enum qrcodegen_Mask)fixed_layout_mask, true);
+    }
+    else {
+        lv_memcpy(data_tmp, data, data_len);
+        ok = qrcodegen_encodeBinary(data_tmp, data_len,
+                                    qr0, qrcodegen_Ecc_MEDIUM,
+                                    qr_version, qr_version,
+                                    qrcodegen_Mask_AUTO, true);
+    }
 
     if(!ok) {
         lv_mem_free(qr0);
@@ -118,6 +140,8 @@ lv_res_t lv_qrcode_update(lv_obj_t * qrcode, const void * data, uint32_t data_le
         return LV_RES_INV;
     }
 
+    qr0[qrcodegen_BUFFER_LEN_FOR_VERSION(qr_version)] = 0;
+
     lv_coord_t obj_w = imgdsc->header.w;
     qr_size = qrcodegen_getSize(qr0);
     scale = obj_w / qr_size;
@@ -125,51 +149,17 @@ lv_res_t lv_qrcode_update(lv_obj_t * qrcode, const void * data, uint32_t data_le
     int margin = (obj_w - scaled) / 2;
     uint8_t * buf_u8 = (uint8_t *)imgdsc->data + 8;    /*+8 skip the palette*/
 
-    /* Copy the qr code canvas:
-     * A simple `lv_canvas_set_px` would work but it's slow for so many pixels.
-     * So buffer 1 byte (8 px) from the qr code and set it in the canvas image */
+    /* Expand each module row once into a packed bit row, then copy it for the
+     * scaled duplicates. The canvas is already light, only the code is written. */
     uint32_t row_byte_cnt = (imgdsc->header.w + 7) >> 3;
     int y;
-    for(y = margin; y < scaled + margin; y += scale) {
-        uint8_t b = 0;
-        uint8_t p = 0;
-        bool aligned = false;
-        int x;
-        for(x = margin; x < scaled + margin; x++) {
-            bool a = qrcodegen_getModule(qr0, (x - margin) / scale, (y - margin) / scale);
-
-            if(aligned == false && (x & 0x7) == 0) aligned = true;
-
-            if(aligned == false) {
-                c.full = a ? 0 : 1;
-                lv_canvas_set_px_color(qrcode, x, y, c);
-            }
-            else {
-                if(!a) b |= (1 << (7 - p));
-                p++;
-                if(p == 8) {
-                    uint32_t px = row_byte_cnt * y + (x >> 3);
-                    buf_u8[px] = b;
-                    b = 0;
-                    p = 0;
-                }
-            }
-        }
-
-        /*Process the last byte of the row*/
-        if(p) {
-            /*Make the rest of the bits white*/
-            b |= (1 << (8 - p)) - 1;
-
-            uint32_t px = row_byte_cnt * y + (x >> 3);
-            buf_u8[px] = b;
-        }
+    for(y = 0; y < qr_size; y++) {
+        uint8_t * row = buf_u8 + row_byte_cnt * (margin + y * scale);
+        expand_row(qr0, y, scale, margin, row);
 
-        /*The Qr is probably scaled so simply to the repeated rows*/
         int s;
-        const uint8_t * row_ori = buf_u8 + row_byte_cnt * y;
         for(s = 1; s < scale; s++) {
-            lv_memcpy((uint8_t *)buf_u8 + row_byte_cnt * (y + s), row_ori, row_byte_cnt);
+            lv_memcpy(row + row_byte_cnt * s, row, row_byte_cnt);
         }
     }
 
@@ -178,6 +168,28 @@ lv_res_t lv_qrcode_update(lv_obj_t * qrcode, const void * data, uint32_t data_le
     return LV_RES_OK;
 }
 
+/**
+ * Encode through a cached layout while the data keeps its length
+ * @param en true to enable, false to encode every update from scratch
+ * @param mask a mask number 0..7, or LV_QRCODE_MASK_AUTO to choose once per layout
+ */
+void lv_qrcode_set_fixed_layout(bool en, int8_t mask)
+{
+    if(en && fixed_layout == NULL) {
+        fixed_layout = lv_mem_alloc(sizeof(struct qrcodegen_Template) * LV_QRCODE_FIXED_LAYOUTS);
+        LV_ASSERT_MALLOC(fixed_layout);
+        if(fixed_layout == NULL) return;
+        lv_memset_00(fixed_layout, sizeof(struct qrcodegen_Template) * LV_QRCODE_FIXED_LAYOUTS);
+        lv_memset_00(fixed_layout_version, sizeof(fixed_layout_version));
+        lv_memset_00(fixed_layout_use, sizeof(fixed_layout_use));
+    }
+    else if(!en && fixed_layout) {
+        lv_mem_free(fixed_layout);
+        fixed_layout = NULL;
+    }
+
+    fixed_layout_mask = mask;
+}
 
 void lv_qrcode_delete(lv_obj_t * qrcode)
 {
@@ -212,4 +224,102 @@ static void lv_qrcode_destructor(const lv_obj_class_t * class_p, lv_obj_t * obj)
     img->data = NULL;
 }
 
+/*Appends the low `n` (at most 32) bits of `v` to the pending bits and writes
+ *out every full byte*/
+#define PUT_BITS(v, n) do { \
+        acc = (acc << (n)) | (v); \
+        acc_bits += (n); \
+        while(acc_bits >= 8) { \
+            acc_bits -= 8; \
+            *out++ = (uint8_t)(acc >> acc_bits); \
+        } \
+    } while(0)
+
+/**
+ * The cached layout of `version`, or the least recently used one to be rebuilt for it.
+ * QR codes of different sizes encode the same data at different versions, sharing one
+ * layout would rebuild it and score the masks again on every switch between them.
+ */
+static struct qrcodegen_Template * get_fixed_layout(int32_t version)
+{
+    int i;
+    int oldest = 0;
+    for(i = 0; i < LV_QRCODE_FIXED_LAYOUTS; i++) {
+        if(fixed_layout_version[i] == version) break;
+        if(fixed_layout_use[i] < fixed_layout_use[oldest]) oldest = i;
+    }
+    if(i == LV_QRCODE_FIXED_LAYOUTS) {
+        i = oldest;
+        fixed_layout_version[i] = version;
+    }
+
+    fixed_layout_use[i] = ++fixed_layout_tick;
+    return &fixed_layout[i];
+}
+
+static void build_expand_lut(int scale)
+{
+    uint64_t light = (1ULL << scale) - 1;
+    int b;
+    for(b = 0; b < 256; b++) {
+        uint64_t v = 0;
+        int m;
+        for(m = 0; m < 8; m++) {
+            v = (v << scale) | ((b >> m) & 1 ? 0 : light);
+        }
+        expand_lut[b] = v;
+    }
+    expand_scale = scale;
+}
+
+/**
+ * Write module row `y` scaled by `scale`, starting `margin` pixels into an
+ * indexed 1 bit canvas row. Pixels before the margin and after the code in the
+ * bytes touched are light, the rest of the row is left alone.
+ */
+static void expand_row(const uint8_t * qr, int y, int scale, int margin, uint8_t * row)
+{
+    int qr_size = qr[0];
+    uint32_t index = (uint32_t)y * qr_size;
+    uint8_t * out = row + (margin >> 3);
+    uint64_t acc = (1U << (margin & 7)) - 1;
+    int acc_bits = margin & 7;
+    int x;
+
+    if(scale <= 8) {
+        if(expand_scale != scale) build_expand_lut(scale);
+
+        for(x = 0; x < qr_size; x += 8, index += 8) {
+            const uint8_t * p = qr + 1 + (index >> 3);
+            uint32_t modules = ((p[0] | (uint32_t)p[1] << 8) >> (index & 7)) & 0xff;
+            int n = qr_size - x < 8 ? qr_size - x : 8;
+            uint64_t v = expand_lut[modules] >> ((8 - n) * scale);
+            int bits = n * scale;
+
+            if(bits > 32) {
+                PUT_BITS((uint32_t)(v >> 32), bits - 32);
+                PUT_BITS((uint32_t)v, 32);
+            }
+            else {
+                PUT_BITS((uint32_t)v, bits);
+            }
+        }
+    }
+    else {
+        for(x = 0; x < qr_size; x++, index++) {
+            bool dark = (qr[1 + (index >> 3)] >> (index & 7)) & 1;
+            int left = scale;
+            while(left > 0) {
+                int n = left < 32 ? left : 32;
+                PUT_BITS(dark ? 0 : (uint32_t)((1ULL << n) - 1), n);
+                left -= n;
+            }
+        }
+    }
+
+    if(acc_bits) {
+        *out = (uint8_t)(acc << (8 - acc_bits)) | ((1 << (8 - acc_bits)) - 1);
+    }
+}
+
 #endif /*LV_USE_QRCODE*/
@@ -19,6 +19,11 @@ extern "C" {
 /*********************
  *      DEFINES
  *********************/
+#define LV_QRCODE_MASK_AUTO (-1)
+
+/*Cached layouts of lv_qrcode_set_fixed_layout(), one per QR version in use. QR codes
+ *of different sizes pick different versions for the same data, each keeps its own.*/
+#define LV_QRCODE_FIXED_LAYOUTS 2
 
 extern const lv_obj_class_t lv_qrcode_class;
 
@@ -49,6 +54,16 @@ lv_obj_t * lv_qrcode_create(lv_obj_t * parent, lv_coord_t size, lv_color_t dark_
  */
 lv_res_t lv_qrcode_update(lv_obj_t * qrcode, const void * data, uint32_t data_len);
 
+/**
+ * Encode through a cached layout while the data keeps its length, e.g. a URL with
+ * a changing one time code. Applies to all QR code objects, up to
+ * LV_QRCODE_FIXED_LAYOUTS versions keep their layout at once.
+ * @param en true to enable, false to encode every update from scratch (default)
+ * @param mask a mask number 0..7 to always use, or LV_QRCODE_MASK_AUTO to score
+ *             all eight once per layout and keep the best
+ */
+void lv_qrcode_set_fixed_layout(bool en, int8_t mask);
+
 /**
  * DEPRECATED: Use normal lv_obj_del instead
  * Delete a QR code object
@@ -70,6 +70,9 @@ testable int getAlignmentPatternPositions(int version, uint8_t result[7]);
 static void fillRectangle(int left, int top, int width, int height, uint8_t qrcode[]);
 
 static void drawCodewords(const uint8_t data[], int dataLen, uint8_t qrcode[]);
+static void buildTemplate(struct qrcodegen_Template *tpl, int version, enum qrcodegen_Ecc codeEcl,
+	int mask, uint8_t tempBuffer[]);
+static void setTemplateMask(struct qrcodegen_Template *tpl, const uint8_t functionModules[], int mask);
 static void applyMask(const uint8_t functionModules[], uint8_t qrcode[], enum qrcodegen_Mask mask);
 static long getPenaltyScore(const uint8_t qrcode[]);
 static void addRunToHistory(unsigned char run, unsigned char history[7]);
@@ -282,6 +285,145 @@ bool qrcodegen_encodeSegmentsAdvanced(const struct qrcodegen_Segment segs[], siz
 
 
 
+/*---- Fixed layout encoding ----*/
+
+// Builds the function modules, codeword positions and, unless the mask is chosen
+// automatically, the mask pattern of a template. tempBuffer receives the function modules.
+static void buildTemplate(struct qrcodegen_Template *tpl, int version, enum qrcodegen_Ecc codeEcl,
+		int mask, uint8_t tempBuffer[]) {
+	uint8_t *grid = tpl->grid;
+	initializeFunctionModules(version, grid);
+	int qrsize = qrcodegen_getSize(grid);
+	memcpy(tempBuffer, grid, qrcodegen_BUFFER_LEN_FOR_VERSION(version));
+	
+	// Same zigzag scan as drawCodewords(), recording where each bit goes
+	tpl->numCodewords = getNumRawDataModules(version) / 8;
+	int i = 0;
+	for (int right = qrsize - 1; right >= 1; right -= 2) {
+		if (right == 6)
+			right = 5;
+		for (int vert = 0; vert < qrsize; vert++) {
+			for (int j = 0; j < 2; j++) {
+				int x = right - j;
+				bool upward = ((right + 1) & 2) == 0;
+				int y = upward ? qrsize - 1 - vert : vert;
+				if (!getModule(grid, x, y) && i < tpl->numCodewords * 8)
+					tpl->positions[i++] = (uint16_t)(y * qrsize + x);
+			}
+		}
+	}
+	assert(i == tpl->numCodewords * 8);
+	
+	// Codeword modules start out white, as all zero codewords
+	drawWhiteFunctionModules(grid, version);
+	memset(tpl->codewords, 0, sizeof(tpl->codewords));
+	tpl->codeEcl = codeEcl;
+	tpl->codeMask = -1;
+	if (mask != qrcodegen_Mask_AUTO)
+		setTemplateMask(tpl, tempBuffer, mask);
+}
+
+
+// Settles the template on a mask: draws its format bits and records which modules it inverts.
+// functionModules is as left by buildTemplate().
+static void setTemplateMask(struct qrcodegen_Template *tpl, const uint8_t functionModules[], int mask) {
+	int len = qrcodegen_BUFFER_LEN_FOR_VERSION(tpl->version);
+	memset(tpl->maskBits, 0, len);
+	tpl->maskBits[0] = tpl->grid[0];
+	applyMask(functionModules, tpl->maskBits, (enum qrcodegen_Mask)mask);
+	tpl->maskBits[0] = 0;  // The size byte passes through the XOR unchanged
+	drawFormatBits(tpl->codeEcl, (enum qrcodegen_Mask)mask, tpl->grid);
+	tpl->codeMask = mask;
+}
+
+
+// Public function - see documentation comment in header file.
+bool qrcodegen_encodeBinaryTemplate(struct qrcodegen_Template *tpl, const uint8_t data[], size_t dataLen,
+		uint8_t tempBuffer[], uint8_t qrcode[], enum qrcodegen_Ecc ecl, int version, enum qrcodegen_Mask mask,
+		bool boostEcl) {
+	assert(tpl != NULL && data != NULL);
+	assert(0 <= (int)ecl && (int)ecl <= 3 && -1 <= (int)mask && (int)mask <= 7);
+	
+	int dataUsedBits = 4 + numCharCountBits(qrcodegen_Mode_BYTE, version) + (int)dataLen * 8;
+	if (version < qrcodegen_VERSION_MIN || version > qrcodegen_TEMPLATE_VERSION_MAX
+			|| dataLen > INT16_MAX / 8 || dataUsedBits > getNumDataCodewords(version, ecl) * 8) {
+		qrcode[0] = 0;  // Set size to invalid value for safety
+		return false;
+	}
+	
+	int len = qrcodegen_BUFFER_LEN_FOR_VERSION(version);
+	if (tpl->version != version || tpl->dataLen != dataLen || tpl->ecl != ecl
+			|| tpl->boostEcl != boostEcl || tpl->mask != (int)mask) {
+		// Same boosting as qrcodegen_encodeSegmentsAdvanced()
+		enum qrcodegen_Ecc codeEcl = ecl;
+		for (int i = (int)qrcodegen_Ecc_MEDIUM; i <= (int)qrcodegen_Ecc_HIGH; i++) {
+			if (boostEcl && dataUsedBits <= getNumDataCodewords(version, (enum qrcodegen_Ecc)i) * 8)
+				codeEcl = (enum qrcodegen_Ecc)i;
+		}
+		tpl->version = version;
+		tpl->dataLen = dataLen;
+		tpl->ecl = ecl;
+		tpl->boostEcl = boostEcl;
+		tpl->mask = (int)mask;
+		buildTemplate(tpl, version, codeEcl, (int)mask, tempBuffer);
+	}
+	
+	// Data codewords: one byte segment, terminator and padding
+	uint8_t stream[qrcodegen_TEMPLATE_CODEWORDS_MAX];
+	uint8_t codewords[qrcodegen_TEMPLATE_CODEWORDS_MAX];
+	int dataCapacityBits = getNumDataCodewords(version, tpl->codeEcl) * 8;
+	int bitLen = 0;
+	memset(stream, 0, sizeof(stream));
+	appendBitsToBuffer((unsigned int)qrcodegen_Mode_BYTE, 4, stream, &bitLen);
+	appendBitsToBuffer((unsigned int)dataLen, numCharCountBits(qrcodegen_Mode_BYTE, version), stream, &bitLen);
+	for (size_t i = 0; i < dataLen; i++)
+		appendBitsToBuffer(data[i], 8, stream, &bitLen);
+	int terminatorBits = dataCapacityBits - bitLen;
+	if (terminatorBits > 4)
+		terminatorBits = 4;
+	appendBitsToBuffer(0, terminatorBits, stream, &bitLen);
+	appendBitsToBuffer(0, (8 - bitLen % 8) % 8, stream, &bitLen);
+	for (uint8_t padByte = 0xEC; bitLen < dataCapacityBits; padByte ^= 0xEC ^ 0x11)
+		appendBitsToBuffer(padByte, 8, stream, &bitLen);
+	addEccAndInterleave(stream, version, tpl->codeEcl, codewords);
+	
+	// Redraw only the bits of codewords that changed
+	for (int i = 0; i < tpl->numCodewords; i++) {
+		uint8_t diff = codewords[i] ^ tpl->codewords[i];
+		for (int j = 0; diff != 0; j++, diff <<= 1) {
+			if (diff & 0x80) {
+				int index = tpl->positions[i * 8 + j];
+				tpl->grid[(index >> 3) + 1] ^= 1 << (index & 7);
+			}
+		}
+		tpl->codewords[i] = codewords[i];
+	}
+	
+	// Score the masks once per layout, like qrcodegen_encodeSegmentsAdvanced() does every time
+	if (tpl->codeMask == -1) {
+		initializeFunctionModules(version, tempBuffer);
+		long minPenalty = LONG_MAX;
+		int best = 0;
+		for (int i = 0; i < 8; i++) {
+			memcpy(qrcode, tpl->grid, len);
+			applyMask(tempBuffer, qrcode, (enum qrcodegen_Mask)i);
+			drawFormatBits(tpl->codeEcl, (enum qrcodegen_Mask)i, qrcode);
+			long penalty = getPenaltyScore(qrcode);
+			if (penalty < minPenalty) {
+				best = i;
+				minPenalty = penalty;
+			}
+		}
+		setTemplateMask(tpl, tempBuffer, best);
+	}
+	
+	for (int i = 0; i < len; i++)
+		qrcode[i] = tpl->grid[i] ^ tpl->maskBits[i];
+	return true;
+}
+
+
+
 /*---- Error correction code generation functions ----*/
 
 // Appends error correction bytes to each block of the given data array, then interleaves
@@ -229,6 +229,50 @@ bool qrcodegen_encodeSegmentsAdvanced(const struct qrcodegen_Segment segs[], siz
 	int minVersion, int maxVersion, int mask, bool boostEcl, uint8_t tempBuffer[], uint8_t qrcode[]);
 
 
+/*
+ * Layout cache for qrcodegen_encodeBinaryTemplate(), for byte payloads that keep their
+ * length from one encode to the next and only change a few characters, such as a URL
+ * with a one time code in it. Versions above qrcodegen_TEMPLATE_VERSION_MAX aren't cached.
+ * Zero it before first use, the fields are private.
+ */
+#define qrcodegen_TEMPLATE_VERSION_MAX  10
+#define qrcodegen_TEMPLATE_BUFFER_LEN  qrcodegen_BUFFER_LEN_FOR_VERSION(qrcodegen_TEMPLATE_VERSION_MAX)
+#define qrcodegen_TEMPLATE_CODEWORDS_MAX  346  // Raw codewords at version 10
+
+struct qrcodegen_Template {
+	// What the layout was built for, version 0 when there is none
+	int version;
+	size_t dataLen;
+	enum qrcodegen_Ecc ecl;
+	bool boostEcl;
+	int mask;
+	
+	// The layout
+	enum qrcodegen_Ecc codeEcl;  // After boosting
+	int codeMask;  // -1 until chosen
+	int numCodewords;
+	uint8_t grid[qrcodegen_TEMPLATE_BUFFER_LEN];  // Function modules and format bits, unmasked codewords
+	uint8_t maskBits[qrcodegen_TEMPLATE_BUFFER_LEN];  // 1 where codeMask inverts a module
+	uint8_t codewords[qrcodegen_TEMPLATE_CODEWORDS_MAX];  // As drawn in grid
+	uint16_t positions[qrcodegen_TEMPLATE_CODEWORDS_MAX * 8];  // Module index of every codeword bit
+};
+
+
+/*
+ * Renders the same QR Code as qrcodegen_encodeBinary() with minVersion and maxVersion both
+ * set to version, except for the mask when it is qrcodegen_Mask_AUTO: all eight are scored
+ * on the first encode with a layout, the winner is then kept while the length stays the same.
+ * Function modules, the codeword placement and the mask pattern are computed once per layout,
+ * an encode then recomputes the codewords and redraws the modules of those that changed.
+ * tempBuffer and qrcode must have length qrcodegen_BUFFER_LEN_FOR_VERSION(version) and
+ * must not overlap data. Returns false, like qrcodegen_encodeBinary(), if the data doesn't
+ * fit the version, and also if the version is above qrcodegen_TEMPLATE_VERSION_MAX.
+ */
+bool qrcodegen_encodeBinaryTemplate(struct qrcodegen_Template *tpl, const uint8_t data[], size_t dataLen,
+	uint8_t tempBuffer[], uint8_t qrcode[], enum qrcodegen_Ecc ecl, int version, enum qrcodegen_Mask mask,
+	bool boostEcl);
+
+
 /*
  * Tests whether the given string can be encoded as a segment in alphanumeric mode.
  * A string is encodable iff each character is in the following set: 0 to 9, A to Z
@@ -218,9 +218,10 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter)
     uint16_t i;
     for(i = 0; i < fdsc->cmap_num; i++) {
 
-        /*Relative code point*/
+        /*Relative code point. The range holds range_length letters: the one after it
+         *would be read as the next cmap's first glyph*/
         uint32_t rcp = letter - fdsc->cmaps[i].range_start;
-        if(rcp > fdsc->cmaps[i].range_length) continue;
+        if(rcp >= fdsc->cmaps[i].range_length) continue;
         uint32_t glyph_id = 0;
         if(fdsc->cmaps[i].type == LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY) {
             glyph_id = fdsc->cmaps[i].glyph_id_start + rcp;
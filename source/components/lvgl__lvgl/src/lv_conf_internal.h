@@ -131,6 +131,15 @@
         #endif
     #endif
 
+    /*Largest region `lv_mem_add_region()` takes next to the builtin pool (e.g. in PSRAM)*/
+    #ifndef LV_MEM_REGION_MAX_SIZE
+        #ifdef CONFIG_LV_MEM_REGION_MAX_SIZE
+            #define LV_MEM_REGION_MAX_SIZE CONFIG_LV_MEM_REGION_MAX_SIZE
+        #else
+            #define LV_MEM_REGION_MAX_SIZE (1024U * 1024U)          /*[bytes]*/
+        #endif
+    #endif
+
     /*Set an address for the memory pool instead of allocating it as a normal array. Can be in external SRAM too.*/
     #ifndef LV_MEM_ADR
         #ifdef CONFIG_LV_MEM_ADR
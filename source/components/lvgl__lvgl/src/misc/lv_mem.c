@@ -42,22 +42,38 @@
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_MEM_CUSTOM == 0
+typedef struct {
+    lv_tlsf_t tlsf;     /*NULL if the region wasn't added*/
+    uint8_t * start;    /*The memory managed, to find the region of a pointer*/
+    uint8_t * end;
+    uint32_t cur_used;
+    uint32_t max_used;
+    uint32_t failed;
+    uint32_t spilled;
+} lv_mem_region_dsc_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 #if LV_MEM_CUSTOM == 0
     static void lv_mem_walker(void * ptr, size_t size, int used, void * user);
+    static bool region_create(lv_mem_region_t region, void * mem, size_t bytes);
+    static lv_mem_region_t region_of(const void * p);
+    static void * region_malloc(lv_mem_region_t region, size_t size);
+    static void region_used(lv_mem_region_t region, size_t freed, size_t allocated);
 #endif
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 #if LV_MEM_CUSTOM == 0
-    static lv_tlsf_t tlsf;
+    static lv_mem_region_dsc_t regions[_LV_MEM_REGION_NUM];
     static uint32_t cur_used;
     static uint32_t max_used;
 #endif
+static lv_mem_region_t cur_region = LV_MEM_REGION_FAST;
 
 static uint32_t zero_mem = ZERO_MEM_SENTINEL; /*Give the address of this variable if 0 byte should be allocated*/
 
@@ -87,18 +103,21 @@ void lv_mem_init(void)
 {
 #if LV_MEM_CUSTOM == 0
 
+    cur_used = 0;
+    max_used = 0;
 #if LV_MEM_ADR == 0
 #ifdef LV_MEM_POOL_ALLOC
-    tlsf = lv_tlsf_create_with_pool((void *)LV_MEM_POOL_ALLOC(LV_MEM_SIZE), LV_MEM_SIZE);
+    region_create(LV_MEM_REGION_FAST, (void *)LV_MEM_POOL_ALLOC(LV_MEM_SIZE), LV_MEM_SIZE);
 #else
     /*Allocate a large array to store the dynamically allocated data*/
     static LV_ATTRIBUTE_LARGE_RAM_ARRAY MEM_UNIT work_mem_int[LV_MEM_SIZE / sizeof(MEM_UNIT)];
-    tlsf = lv_tlsf_create_with_pool((void *)work_mem_int, LV_MEM_SIZE);
+    region_create(LV_MEM_REGION_FAST, (void *)work_mem_int, LV_MEM_SIZE);
 #endif
 #else
-    tlsf = lv_tlsf_create_with_pool((void *)LV_MEM_ADR, LV_MEM_SIZE);
+    region_create(LV_MEM_REGION_FAST, (void *)LV_MEM_ADR, LV_MEM_SIZE);
 #endif
 #endif
+    cur_region = LV_MEM_REGION_FAST;
 
 #if LV_MEM_ADD_JUNK
     LV_LOG_WARN("LV_MEM_ADD_JUNK is enabled which makes LVGL much slower");
@@ -112,7 +131,11 @@ void lv_mem_init(void)
 void lv_mem_deinit(void)
 {
 #if LV_MEM_CUSTOM == 0
-    lv_tlsf_destroy(tlsf);
+    /*The added regions are dropped, their memory can be freed*/
+    for(lv_mem_region_t region = 0; region < _LV_MEM_REGION_NUM; region++) {
+        if(regions[region].tlsf) lv_tlsf_destroy(regions[region].tlsf);
+    }
+    lv_memset_00(regions, sizeof(regions));
     lv_mem_init();
 #endif
 }
@@ -131,7 +154,17 @@ void * lv_mem_alloc(size_t size)
     }
 
 #if LV_MEM_CUSTOM == 0
-    void * alloc = lv_tlsf_malloc(tlsf, size);
+    /*The selected region first, then any other with room*/
+    lv_mem_region_t placed = cur_region;
+    void * alloc = region_malloc(placed, size);
+    for(lv_mem_region_t region = 0; alloc == NULL && region < _LV_MEM_REGION_NUM; region++) {
+        if(region == cur_region) continue;
+        placed = region;
+        alloc = region_malloc(region, size);
+    }
+
+    if(alloc == NULL) regions[cur_region].failed++;
+    else if(placed != cur_region && regions[cur_region].tlsf) regions[cur_region].spilled++;
 #else
     void * alloc = LV_MEM_CUSTOM_ALLOC(size);
 #endif
@@ -153,10 +186,6 @@ void * lv_mem_alloc(size_t size)
 #endif
 
     if(alloc) {
-#if LV_MEM_CUSTOM == 0
-        cur_used += size;
-        max_used = LV_MAX(cur_used, max_used);
-#endif
         MEM_TRACE("allocated at %p", alloc);
     }
     return alloc;
@@ -173,12 +202,13 @@ void lv_mem_free(void * data)
     if(data == NULL) return;
 
 #if LV_MEM_CUSTOM == 0
+    lv_mem_region_t region = region_of(data);
+    size_t size = lv_tlsf_block_size(data);
 #  if LV_MEM_ADD_JUNK
-    lv_memset(data, 0xbb, lv_tlsf_block_size(data));
+    lv_memset(data, 0xbb, size);
 #  endif
-    size_t size = lv_tlsf_free(tlsf, data);
-    if(cur_used > size) cur_used -= size;
-    else cur_used = 0;
+    lv_tlsf_free(regions[region].tlsf, data);
+    region_used(region, size, 0);
 #else
     LV_MEM_CUSTOM_FREE(data);
 #endif
@@ -203,7 +233,22 @@ void * lv_mem_realloc(void * data_p, size_t new_size)
     if(data_p == &zero_mem) return lv_mem_alloc(new_size);
 
 #if LV_MEM_CUSTOM == 0
-    void * new_p = lv_tlsf_realloc(tlsf, data_p, new_size);
+    if(data_p == NULL) return lv_mem_alloc(new_size);
+
+    /*Grow or shrink in its own region, else move it to wherever lv_mem_alloc() finds room*/
+    lv_mem_region_t region = region_of(data_p);
+    size_t old_size = lv_tlsf_block_size(data_p);
+    void * new_p = lv_tlsf_realloc(regions[region].tlsf, data_p, new_size);
+    if(new_p) {
+        region_used(region, old_size, lv_tlsf_block_size(new_p));
+    }
+    else {
+        new_p = lv_mem_alloc(new_size);
+        if(new_p) {
+            lv_memcpy(new_p, data_p, LV_MIN(old_size, new_size));
+            lv_mem_free(data_p);
+        }
+    }
 #else
     void * new_p = LV_MEM_CUSTOM_REALLOC(data_p, new_size);
 #endif
@@ -224,14 +269,18 @@ lv_res_t lv_mem_test(void)
     }
 
 #if LV_MEM_CUSTOM == 0
-    if(lv_tlsf_check(tlsf)) {
-        LV_LOG_WARN("failed");
-        return LV_RES_INV;
-    }
+    for(lv_mem_region_t region = 0; region < _LV_MEM_REGION_NUM; region++) {
+        if(regions[region].tlsf == NULL) continue;
 
-    if(lv_tlsf_check_pool(lv_tlsf_get_pool(tlsf))) {
-        LV_LOG_WARN("pool failed");
-        return LV_RES_INV;
+        if(lv_tlsf_check(regions[region].tlsf)) {
+            LV_LOG_WARN("failed (region %d)", region);
+            return LV_RES_INV;
+        }
+
+        if(lv_tlsf_check_pool(lv_tlsf_get_pool(regions[region].tlsf))) {
+            LV_LOG_WARN("pool failed (region %d)", region);
+            return LV_RES_INV;
+        }
     }
 #endif
     MEM_TRACE("passed");
@@ -250,9 +299,12 @@ void lv_mem_monitor(lv_mem_monitor_t * mon_p)
 #if LV_MEM_CUSTOM == 0
     MEM_TRACE("begin");
 
-    lv_tlsf_walk_pool(lv_tlsf_get_pool(tlsf), lv_mem_walker, mon_p);
+    for(lv_mem_region_t region = 0; region < _LV_MEM_REGION_NUM; region++) {
+        if(regions[region].tlsf == NULL) continue;
+        lv_tlsf_walk_pool(lv_tlsf_get_pool(regions[region].tlsf), lv_mem_walker, mon_p);
+        mon_p->total_size += regions[region].end - regions[region].start;
+    }
 
-    mon_p->total_size = LV_MEM_SIZE;
     mon_p->used_pct = 100 - (100U * mon_p->free_size) / mon_p->total_size;
     if(mon_p->free_size > 0) {
         mon_p->frag_pct = mon_p->free_biggest_size * 100U / mon_p->free_size;
@@ -268,6 +320,53 @@ void lv_mem_monitor(lv_mem_monitor_t * mon_p)
 #endif
 }
 
+bool lv_mem_add_region(lv_mem_region_t region, void * mem, size_t bytes)
+{
+#if LV_MEM_CUSTOM == 0
+    if(region >= _LV_MEM_REGION_NUM || regions[region].tlsf != NULL || mem == NULL) return false;
+
+    /*The index of every region is sized for LV_MEM_REGION_MAX_SIZE*/
+    if(bytes > LV_MEM_REGION_MAX_SIZE) bytes = LV_MEM_REGION_MAX_SIZE;
+    return region_create(region, mem, bytes);
+#else
+    LV_UNUSED(region);
+    LV_UNUSED(mem);
+    LV_UNUSED(bytes);
+    return false;
+#endif
+}
+
+lv_mem_region_t lv_mem_set_region(lv_mem_region_t region)
+{
+    lv_mem_region_t prev = cur_region;
+    if(region < _LV_MEM_REGION_NUM) cur_region = region;
+    return prev;
+}
+
+void lv_mem_region_monitor(lv_mem_region_t region, lv_mem_region_monitor_t * mon_p)
+{
+    lv_memset_00(mon_p, sizeof(lv_mem_region_monitor_t));
+#if LV_MEM_CUSTOM == 0
+    if(region >= _LV_MEM_REGION_NUM || regions[region].tlsf == NULL) return;
+
+    lv_mem_monitor_t walk;
+    lv_memset_00(&walk, sizeof(walk));
+    lv_tlsf_walk_pool(lv_tlsf_get_pool(regions[region].tlsf), lv_mem_walker, &walk);
+
+    mon_p->total_size = regions[region].end - regions[region].start;
+    mon_p->used_size = regions[region].cur_used;
+    mon_p->max_used = regions[region].max_used;
+    mon_p->free_biggest_size = walk.free_biggest_size;
+    mon_p->failed = regions[region].failed;
+    mon_p->spilled = regions[region].spilled;
+    if(walk.free_size > 0) {
+        mon_p->frag_pct = 100 - walk.free_biggest_size * 100U / walk.free_size;
+    }
+#else
+    LV_UNUSED(region);
+#endif
+}
+
 
 /**
  * Get a temporal buffer with the given size.
@@ -308,7 +407,10 @@ void * lv_mem_buf_get(uint32_t size)
     for(uint8_t i = 0; i < LV_MEM_BUF_MAX_NUM; i++) {
         if(LV_GC_ROOT(lv_mem_buf[i]).used == 0) {
             /*if this fails you probably need to increase your LV_MEM_SIZE/heap size*/
+            /*The render scratch is hot, keep it in the fast region whatever the caller selected*/
+            lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_FAST);
             void * buf = lv_mem_realloc(LV_GC_ROOT(lv_mem_buf[i]).p, size);
+            lv_mem_set_region(region);
             LV_ASSERT_MSG(buf != NULL, "Out of memory, can't allocate a new buffer (increase your LV_MEM_SIZE/heap size)");
             if(buf == NULL) return NULL;
 
@@ -563,4 +665,53 @@ static void lv_mem_walker(void * ptr, size_t size, int used, void * user)
             mon_p->free_biggest_size = size;
     }
 }
+
+static bool region_create(lv_mem_region_t region, void * mem, size_t bytes)
+{
+    lv_mem_region_dsc_t * r = &regions[region];
+    lv_memset_00(r, sizeof(lv_mem_region_dsc_t));
+
+    if(((lv_uintptr_t)mem % lv_tlsf_align_size()) != 0 ||
+       bytes < lv_tlsf_size() + lv_tlsf_pool_overhead() + lv_tlsf_block_size_min()) {
+        LV_LOG_WARN("region %d: %lu bytes at %p can't be used", region, (unsigned long)bytes, mem);
+        return false;
+    }
+
+    lv_tlsf_t tlsf = lv_tlsf_create(mem);
+    if(lv_tlsf_add_pool(tlsf, (uint8_t *)mem + lv_tlsf_size(), bytes - lv_tlsf_size()) == NULL) return false;
+
+    r->tlsf = tlsf;
+    r->start = mem;
+    r->end = (uint8_t *)mem + bytes;
+    return true;
+}
+
+static lv_mem_region_t region_of(const void * p)
+{
+    for(lv_mem_region_t region = 0; region < _LV_MEM_REGION_NUM; region++) {
+        if((const uint8_t *)p >= regions[region].start && (const uint8_t *)p < regions[region].end) return region;
+    }
+    return LV_MEM_REGION_FAST;
+}
+
+static void * region_malloc(lv_mem_region_t region, size_t size)
+{
+    if(regions[region].tlsf == NULL) return NULL;
+
+    void * alloc = lv_tlsf_malloc(regions[region].tlsf, size);
+    if(alloc) region_used(region, 0, lv_tlsf_block_size(alloc));
+    return alloc;
+}
+
+/*Accounts by block size, what the region really gives and takes back*/
+static void region_used(lv_mem_region_t region, size_t freed, size_t allocated)
+{
+    lv_mem_region_dsc_t * r = &regions[region];
+
+    r->cur_used = (r->cur_used > freed ? r->cur_used - freed : 0) + allocated;
+    r->max_used = LV_MAX(r->cur_used, r->max_used);
+
+    cur_used = (cur_used > freed ? cur_used - freed : 0) + allocated;
+    max_used = LV_MAX(cur_used, max_used);
+}
 #endif
@@ -17,6 +17,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include "lv_types.h"
@@ -43,6 +44,29 @@ typedef struct {
     uint8_t frag_pct; /**< Amount of fragmentation*/
 } lv_mem_monitor_t;
 
+/**
+ * Memory regions of the built-in allocator. Each region is its own TLSF heap.
+ */
+enum {
+    LV_MEM_REGION_FAST,     /**< The builtin pool of `LV_MEM_SIZE`, in internal RAM. The render scratch buffers stay here*/
+    LV_MEM_REGION_LARGE,    /**< Added with `lv_mem_add_region()`, e.g. in PSRAM, for objects and canvases*/
+    _LV_MEM_REGION_NUM
+};
+typedef uint8_t lv_mem_region_t;
+
+/**
+ * Statistics of one region, see `lv_mem_region_monitor()`
+ */
+typedef struct {
+    uint32_t total_size; /**< 0 if the region wasn't added*/
+    uint32_t used_size;
+    uint32_t max_used; /**< Peak of `used_size`*/
+    uint32_t free_biggest_size;
+    uint32_t failed; /**< Allocations meant for this region that no region had room for*/
+    uint32_t spilled; /**< Allocations meant for this region placed in another one*/
+    uint8_t frag_pct; /**< Amount of fragmentation*/
+} lv_mem_region_monitor_t;
+
 typedef struct {
     void * p;
     uint16_t size;
@@ -101,6 +125,32 @@ lv_res_t lv_mem_test(void);
  */
 void lv_mem_monitor(lv_mem_monitor_t * mon_p);
 
+/**
+ * Add a region to the built-in allocator, e.g. a block of PSRAM for the large allocations.
+ * @param region the region to add, `LV_MEM_REGION_FAST` is the builtin pool and always there
+ * @param mem the memory to manage, `lv_deinit()` drops the region and it can be freed
+ * @param bytes size of `mem`, cut to `LV_MEM_REGION_MAX_SIZE`
+ * @return true if the region was added
+ * @note It work only if `LV_MEM_CUSTOM == 0`
+ */
+bool lv_mem_add_region(lv_mem_region_t region, void * mem, size_t bytes);
+
+/**
+ * Select the region `lv_mem_alloc()` places the next allocations in. Set it around the
+ * creation of large widgets and restore it afterwards. If the region is full or wasn't
+ * added the allocation goes to another one.
+ * @param region the region to use from now on
+ * @return the region used until now, `LV_MEM_REGION_FAST` initially
+ */
+lv_mem_region_t lv_mem_set_region(lv_mem_region_t region);
+
+/**
+ * Give information about one region of the built-in allocator
+ * @param region the region to analyse
+ * @param mon_p pointer to a lv_mem_region_monitor_t variable,
+ *              the result of the analysis will be stored here
+ */
+void lv_mem_region_monitor(lv_mem_region_t region, lv_mem_region_monitor_t * mon_p);
 
 /**
  * Get a temporal buffer with the given size.
@@ -10,7 +10,12 @@
 #undef  printf
 #define printf LV_LOG_ERROR
 
-#define TLSF_MAX_POOL_SIZE LV_MEM_SIZE
+/*The builtin pool and the regions added with lv_mem_add_region() share the index size*/
+#if LV_MEM_REGION_MAX_SIZE > LV_MEM_SIZE
+    #define TLSF_MAX_POOL_SIZE LV_MEM_REGION_MAX_SIZE
+#else
+    #define TLSF_MAX_POOL_SIZE LV_MEM_SIZE
+#endif
 
 #if !defined(_DEBUG)
     #define _DEBUG 0
@@ -5,6 +5,8 @@
 #include "../common.h"
 #include "esp_timer.h"
 #include <string.h>
+#include <assert.h>
+#include <sys/param.h>
 #include "../SYS_MODE/sys_mode.h"
 
 #define TAG "camera"
@@ -14,10 +16,41 @@ void meta_frame_write(struct meta_frame *frame, uint8_t *buf)
     if (frame->state == empty)
     {
         memcpy(frame->buf, buf, sizeof(frame->buf));
+        frame->rows_ready = IMG_HEIGHT;
         frame->state = written;
     }
 }
 
+// Copies the frame a band at a time, publishing each band as it lands so the
+// reader can start working on the top of the image while the rest is copied.
+// The frame must have been claimed (state written, rows_ready 0) beforehand.
+void meta_frame_write_banded(struct meta_frame *frame, uint8_t *buf)
+{
+    const size_t row_bytes = IMG_WIDTH * 2;
+
+    for (int y = 0; y < IMG_HEIGHT; y += MF_BAND_ROWS)
+    {
+        int rows = MIN(MF_BAND_ROWS, IMG_HEIGHT - y);
+        memcpy(&frame->buf[y * row_bytes], &buf[y * row_bytes], rows * row_bytes);
+        frame->rows_ready = y + rows;
+        xSemaphoreGive(frame->band_ready);
+    }
+}
+
+// Blocks until at least the given number of rows are written. Returns the rows
+// available, which is less than asked for if the timeout expired.
+int meta_frame_wait_rows(struct meta_frame *frame, int rows, TickType_t timeout)
+{
+    while (frame->rows_ready < rows)
+    {
+        if (xSemaphoreTake(frame->band_ready, timeout) != pdPASS)
+        {
+            break;
+        }
+    }
+    return frame->rows_ready;
+}
+
 void meta_frame_free(struct meta_frame *frame)
 {
     frame->state = empty;
@@ -67,15 +100,24 @@ void camera_task(void *arg)
             continue;
         }
 
+        // Hand the frame to the QR task before copying it, so it can convert and
+        // scan each band while the following ones are still being copied
         struct meta_frame *qr_mf = get_meta_frame();
         if (qr_mf != NULL)
         {
-            meta_frame_write(qr_mf, pic->buf);
+            qr_mf->state = written;
+            qr_mf->rows_ready = 0;
+            xSemaphoreTake(qr_mf->band_ready, 0);
+
             int res = xQueueSend(conf->to_qr_queue, &qr_mf, 0);
             if (res == pdFAIL)
             {
                 meta_frame_free(qr_mf);
             }
+            else
+            {
+                meta_frame_write_banded(qr_mf, pic->buf);
+            }
         }
 
         if (get_mode() == mirror)
@@ -111,6 +153,9 @@ void camera_start(struct CameraConf *conf)
     for (size_t i = 0; i < MF_COUNT; i++)
     {
         metaframe_heap[i].state = empty;
+        metaframe_heap[i].rows_ready = 0;
+        metaframe_heap[i].band_ready = xSemaphoreCreateBinary();
+        assert(metaframe_heap[i].band_ready);
     }
 
     // heap_caps_print_heap_info(0x00000404);
@@ -119,7 +164,8 @@ void camera_start(struct CameraConf *conf)
     sensor_t *s = esp_camera_sensor_get();
     s->set_vflip(s, 1);
     ESP_LOGI(TAG, "Camera Init done");
-    TaskHandle_t handle = jTaskCreate(&camera_task, "Camera Task", 5000, conf, 1, MALLOC_CAP_SPIRAM);
+    TaskHandle_t handle = jTaskCreatePinned(&camera_task, "Camera Task", 5000, conf, CAMERA_TASK_PRIORITY,
+                                            MALLOC_CAP_SPIRAM, CAMERA_TASK_CORE);
     if (handle == NULL)
     {
         ESP_LOGE(TAG, "Problem on task start");
@@ -23,11 +23,22 @@ enum meta_frame_state
     readded
 };
 
+#define MF_BAND_ROWS 16 // rows published at a time by meta_frame_write_banded
+
+// Next to the camera driver (CONFIG_CAMERA_CORE0) and ahead of qr_task, which runs
+// on the other core: the copy never waits behind decoding, so the bands overlap it
+#define CAMERA_TASK_CORE 0
+#define CAMERA_TASK_PRIORITY 2
+
 struct meta_frame
 {
     uint8_t buf[IMG_WIDTH * IMG_HEIGHT * 2];
     enum meta_frame_state state;
+    volatile int rows_ready;      // rows of buf already written
+    SemaphoreHandle_t band_ready; // given every time rows_ready advances
 };
 
 void meta_frame_write(struct meta_frame *frame, uint8_t *buf);
+void meta_frame_write_banded(struct meta_frame *frame, uint8_t *buf);
+int meta_frame_wait_rows(struct meta_frame *frame, int rows, TickType_t timeout);
 void meta_frame_free(struct meta_frame *frame);
\ No newline at end of file
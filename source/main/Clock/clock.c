@@ -0,0 +1,174 @@
+#include "clock.h"
+#include "clock_discipline.h"
+#include "../common.h"
+#include "nvs_plugin.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define TAG "clock"
+
+static struct ClockDiscipline discipline;
+static struct ClockStatus status = {0};
+static int64_t ping_sent_us = -1;
+// What is kept in NVS, the drift and how sure the fit was of it
+struct ClockDrift
+{
+    int32_t drift_ppb;
+    int32_t drift_se_ppb;
+};
+
+static int32_t persisted_drift_ppb = 0;
+static int64_t persisted_us = 0;
+static SemaphoreHandle_t clock_mutex;
+
+#define clock_locked(section)                                \
+    do                                                       \
+    {                                                        \
+        if (xSemaphoreTake(clock_mutex, portMAX_DELAY))      \
+        {                                                    \
+            {                                                \
+                section;                                     \
+            }                                                \
+            xSemaphoreGive(clock_mutex);                     \
+        }                                                    \
+    } while (0)
+
+static int64_t clock_system_us(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+// Moves the system time towards the prediction, call with the mutex held
+static void clock_steer(void)
+{
+    int64_t predicted;
+    if (!clock_discipline_predict(&discipline, esp_timer_get_time(), &predicted))
+    {
+        return;
+    }
+
+    int64_t error = predicted - clock_system_us();
+
+    if (error > CLOCK_STEP_US || error < -CLOCK_STEP_US)
+    {
+        struct timeval now = {.tv_sec = predicted / 1000000, .tv_usec = predicted % 1000000};
+        settimeofday(&now, NULL);
+        ESP_LOGI(TAG, "stepped by %lld ms", error / 1000);
+        return;
+    }
+
+    // Replaces whatever is left of the previous adjustment
+    struct timeval delta = {.tv_sec = error / 1000000, .tv_usec = error % 1000000};
+    adjtime(&delta, NULL);
+}
+
+// Drift is written when it moved noticeably, at most once per CLOCK_PERSIST_PERIOD_US
+static void clock_persist(void)
+{
+    struct ClockDrift drift = {.drift_ppb = discipline.drift_ppb, .drift_se_ppb = discipline.drift_se_ppb};
+    int64_t now = esp_timer_get_time();
+
+    if (!discipline.fitted || abs(drift.drift_ppb - persisted_drift_ppb) < CLOCK_PERSIST_STEP_PPB ||
+        (persisted_us != 0 && now - persisted_us < CLOCK_PERSIST_PERIOD_US))
+    {
+        return;
+    }
+
+    j_nvs_set(nvs_clock_tag, &drift, sizeof(drift));
+    persisted_drift_ppb = drift.drift_ppb;
+    persisted_us = now;
+    ESP_LOGI(TAG, "drift %ld ppb (se %ld) saved", (long)drift.drift_ppb, (long)drift.drift_se_ppb);
+}
+
+void clock_ping_sent(void)
+{
+    clock_locked(ping_sent_us = esp_timer_get_time());
+}
+
+void clock_ping_received(int64_t server_us, int32_t resolution_us)
+{
+    if (!xSemaphoreTake(clock_mutex, portMAX_DELAY))
+    {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t rtt = ping_sent_us < 0 ? -1 : now - ping_sent_us;
+    ping_sent_us = -1;
+
+    // The server read its clock somewhere within the round trip, assume half way
+    int64_t mono = rtt < 0 ? now : now - rtt / 2;
+    int64_t error = resolution_us / 2 + (rtt < 0 ? CLOCK_MAX_RTT_US : rtt / 2);
+    if (rtt > CLOCK_MAX_RTT_US)
+    {
+        error += CLOCK_MAX_SAMPLE_ERROR_US;
+    }
+
+    int64_t predicted;
+    if (clock_discipline_predict(&discipline, mono, &predicted))
+    {
+        status.last_error_us = server_us - predicted;
+    }
+    status.last_rtt_us = rtt;
+
+    clock_discipline_sample(&discipline, mono, server_us, error);
+    clock_steer();
+    clock_persist();
+
+    status.synced = discipline.synced;
+    status.fitted = discipline.fitted;
+    status.drift_ppb = discipline.drift_ppb;
+    status.drift_se_ppb = discipline.drift_se_ppb;
+
+    ESP_LOGI(TAG, "ping: predicted %lld ms off, rtt %lld ms, drift %ld ppb%s", status.last_error_us / 1000,
+             rtt / 1000, (long)status.drift_ppb, status.fitted ? "" : " (learned earlier)");
+
+    xSemaphoreGive(clock_mutex);
+}
+
+void clock_get_status(struct ClockStatus *out)
+{
+    clock_locked(memcpy(out, &status, sizeof(struct ClockStatus)));
+}
+
+static void clock_task(void *arg)
+{
+    while (1)
+    {
+        vTaskDelay(CLOCK_STEER_PERIOD * 1000 / portTICK_PERIOD_MS);
+        clock_locked(clock_steer());
+    }
+}
+
+void clock_start(void)
+{
+    struct ClockDrift drift = {0};
+    if (j_nvs_get(nvs_clock_tag, &drift, sizeof(drift)) != ESP_OK)
+    {
+        memset(&drift, 0, sizeof(drift));
+    }
+    persisted_drift_ppb = drift.drift_ppb;
+
+    clock_mutex = xSemaphoreCreateMutex();
+    clock_discipline_init(&discipline, drift.drift_ppb, drift.drift_se_ppb);
+    status.drift_ppb = discipline.drift_ppb;
+    status.drift_se_ppb = discipline.drift_se_ppb;
+    ESP_LOGI(TAG, "drift from the last boot: %ld ppb (se %ld)", (long)discipline.drift_ppb,
+             (long)discipline.drift_se_ppb);
+
+    TaskHandle_t handle = jTaskCreate(&clock_task, "clock task", 4096, NULL, 1, MALLOC_CAP_SPIRAM);
+    if (handle == NULL)
+    {
+        ESP_LOGE(TAG, "Problem on task start");
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Keeps the system time on the backend's, from its answers to the ping. The clock
+// is slewed with adjtime() towards clock_discipline's prediction every
+// CLOCK_STEER_PERIOD, so TOTP codes don't jump when a ping lands and stay right
+// between pings as the crystal's drift is corrected for. adjtime() only runs the
+// clock 1/CLOCK_SLEW_RATE faster or slower, so an error past CLOCK_STEP_US, as on
+// the first sync after boot, is stepped instead: slewing a whole second out already
+// leaves the codes a second off for over a minute.
+
+#define CLOCK_STEER_PERIOD 30                // seconds
+#define CLOCK_SLEW_RATE 64                   // ESP-IDF's adjtime() corrects 1 s in 64 s
+#define CLOCK_STEP_US (1LL * 1000000)        // worst slew takes CLOCK_SLEW_RATE seconds
+#define CLOCK_MAX_RTT_US (4LL * 1000000)     // slower answers set the time but aren't fitted
+#define CLOCK_PERSIST_STEP_PPB 1000          // drift change worth an NVS write
+#define CLOCK_PERSIST_PERIOD_US (3600LL * 1000000)
+
+struct ClockStatus
+{
+    bool synced;
+    bool fitted;       // drift learned from this boot's pings, otherwise from NVS
+    int32_t drift_ppb; // how much faster the local clock runs than the backend's
+    int32_t drift_se_ppb;
+    int64_t last_error_us; // how far the prediction was off when the last ping came
+    int64_t last_rtt_us;
+};
+
+void clock_start(void);
+
+// Call when the ping goes out, the answer's RTT is measured from it
+void clock_ping_sent(void);
+
+// The backend's time in the ping answer, resolution_us is its granularity
+void clock_ping_received(int64_t server_us, int32_t resolution_us);
+
+// Reported as telemetry by the MQTT task each time a ping goes out
+void clock_get_status(struct ClockStatus *status);
@@ -0,0 +1,203 @@
+#include "clock_discipline.h"
+
+#include <math.h>
+#include <string.h>
+
+struct ClockPoint
+{
+    double dx; // mono_us relative to the newest ping
+    double dy; // offset_us relative to the newest ping
+    double w;  // pings in the bin
+};
+
+void clock_discipline_init(struct ClockDiscipline *discipline, int32_t drift_ppb, int32_t drift_se_ppb)
+{
+    memset(discipline, 0, sizeof(struct ClockDiscipline));
+
+    if (drift_ppb > CLOCK_MAX_DRIFT_PPB || drift_ppb < -CLOCK_MAX_DRIFT_PPB)
+    {
+        drift_ppb = 0;
+        drift_se_ppb = 0;
+    }
+    if (drift_se_ppb <= 0 || drift_se_ppb > CLOCK_UNKNOWN_DRIFT_SE_PPB)
+    {
+        drift_se_ppb = CLOCK_UNKNOWN_DRIFT_SE_PPB;
+    }
+    discipline->drift_ppb = drift_ppb;
+    discipline->drift_se_ppb = drift_se_ppb;
+}
+
+static void clock_close_bin(struct ClockDiscipline *discipline)
+{
+    struct ClockSample *sample = &discipline->samples[discipline->next];
+
+    sample->mono_us = discipline->bin_first_us + discipline->bin_sum_mono_us / discipline->bin_count;
+    sample->offset_us = discipline->bin_first_offset_us + discipline->bin_sum_offset_us / discipline->bin_count;
+    sample->count = discipline->bin_count;
+    discipline->next = (discipline->next + 1) % CLOCK_SAMPLES;
+    if (discipline->count < CLOCK_SAMPLES)
+    {
+        discipline->count++;
+    }
+    discipline->bin_count = 0;
+}
+
+// The closed bins and the open one, relative to (ref_mono, ref_offset) so the doubles
+// keep their precision
+static int clock_points(const struct ClockDiscipline *discipline, int64_t ref_mono, int64_t ref_offset,
+                        struct ClockPoint *points)
+{
+    int n = 0;
+
+    for (int i = 0; i < discipline->count; i++)
+    {
+        const struct ClockSample *sample = &discipline->samples[i];
+        points[n].dx = (double)(sample->mono_us - ref_mono);
+        points[n].dy = (double)(sample->offset_us - ref_offset);
+        points[n].w = sample->count;
+        n++;
+    }
+
+    if (discipline->bin_count > 0)
+    {
+        points[n].dx = (double)(discipline->bin_first_us - ref_mono) +
+                       (double)discipline->bin_sum_mono_us / discipline->bin_count;
+        points[n].dy = (double)(discipline->bin_first_offset_us - ref_offset) +
+                       (double)discipline->bin_sum_offset_us / discipline->bin_count;
+        points[n].w = discipline->bin_count;
+        n++;
+    }
+
+    return n;
+}
+
+// Weighted least squares line through the points. Returns false if they are too few
+// or too close together, or the slope is too uncertain to beat the drift known so far.
+static bool clock_fit(const struct ClockPoint *points, int n, double *slope, double *slope_se)
+{
+    double sw = 0, sx = 0, sy = 0;
+    double first = INFINITY, last = -INFINITY;
+
+    for (int i = 0; i < n; i++)
+    {
+        sw += points[i].w;
+        sx += points[i].w * points[i].dx;
+        sy += points[i].w * points[i].dy;
+        first = points[i].dx < first ? points[i].dx : first;
+        last = points[i].dx > last ? points[i].dx : last;
+    }
+
+    if (n < CLOCK_MIN_FIT_SAMPLES || last - first < CLOCK_MIN_FIT_SPAN_US)
+    {
+        return false;
+    }
+
+    double mx = sx / sw, my = sy / sw;
+    double sxx = 0, sxy = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double dx = points[i].dx - mx;
+        sxx += points[i].w * dx * dx;
+        sxy += points[i].w * dx * (points[i].dy - my);
+    }
+    *slope = sxy / sxx;
+
+    // Scatter of the bins around the line, per ping, and what it leaves of the slope
+    double ssr = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double r = points[i].dy - my - *slope * (points[i].dx - mx);
+        ssr += points[i].w * r * r;
+    }
+    *slope_se = sqrt(ssr / (n - 2) / sxx);
+
+    return true;
+}
+
+bool clock_discipline_sample(struct ClockDiscipline *discipline, int64_t mono_us, int64_t server_us,
+                             int32_t error_us)
+{
+    int64_t offset_us = server_us - mono_us;
+
+    if (error_us > CLOCK_MAX_SAMPLE_ERROR_US)
+    {
+        // Only good for a start, better than nothing
+        if (!discipline->synced)
+        {
+            discipline->anchor_mono_us = mono_us;
+            discipline->anchor_offset_us = offset_us;
+            discipline->synced = true;
+        }
+        return false;
+    }
+
+    if (discipline->bin_count > 0 &&
+        (mono_us - discipline->bin_first_us >= CLOCK_BIN_US || discipline->bin_count >= CLOCK_BIN_MAX_COUNT))
+    {
+        clock_close_bin(discipline);
+    }
+    if (discipline->bin_count == 0)
+    {
+        discipline->bin_first_us = mono_us;
+        discipline->bin_first_offset_us = offset_us;
+        discipline->bin_sum_mono_us = 0;
+        discipline->bin_sum_offset_us = 0;
+    }
+    discipline->bin_sum_mono_us += mono_us - discipline->bin_first_us;
+    discipline->bin_sum_offset_us += offset_us - discipline->bin_first_offset_us;
+    discipline->bin_count++;
+
+    struct ClockPoint points[CLOCK_SAMPLES + 1];
+    int n = clock_points(discipline, mono_us, offset_us, points);
+
+    bool moved = false;
+    double slope, slope_se;
+    if (clock_fit(points, n, &slope, &slope_se))
+    {
+        double drift_ppb = -slope * 1e9;
+        double drift_se_ppb = slope_se * 1e9;
+
+        // Once this boot's fit took over it tracks the crystal as it warms up and
+        // ages, before that it has to be better than what was learned earlier
+        if (drift_se_ppb <= CLOCK_MAX_DRIFT_SE_PPB && fabs(drift_ppb) <= CLOCK_MAX_DRIFT_PPB &&
+            (discipline->fitted || drift_se_ppb <= discipline->drift_se_ppb))
+        {
+            moved = (int32_t)drift_ppb != discipline->drift_ppb;
+            discipline->drift_ppb = (int32_t)drift_ppb;
+            discipline->drift_se_ppb = (int32_t)drift_se_ppb;
+            discipline->fitted = true;
+        }
+    }
+
+    // The offset now, from the points seen along the drift in use. The less certain
+    // the drift, the fewer of the older points are averaged.
+    double drift = discipline->drift_ppb / 1e9;
+    double span = CLOCK_ANCHOR_BIAS_US * 1e9 / discipline->drift_se_ppb;
+    double sw = 0, sy = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (points[i].dx < -span)
+        {
+            continue;
+        }
+        sw += points[i].w;
+        sy += points[i].w * (points[i].dy + drift * points[i].dx);
+    }
+
+    discipline->anchor_mono_us = mono_us;
+    discipline->anchor_offset_us = offset_us + (int64_t)llround(sy / sw);
+    discipline->synced = true;
+    return moved;
+}
+
+bool clock_discipline_predict(const struct ClockDiscipline *discipline, int64_t mono_us, int64_t *server_us)
+{
+    if (!discipline->synced)
+    {
+        return false;
+    }
+
+    int64_t elapsed = mono_us - discipline->anchor_mono_us;
+    *server_us = mono_us + discipline->anchor_offset_us - elapsed * discipline->drift_ppb / 1000000000;
+    return true;
+}
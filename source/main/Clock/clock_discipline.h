@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Predicts the server's time from the local monotonic clock, given the server time
+// seen at a few points. The offsets of the sync points are fitted with a line: its
+// slope is the local crystal's frequency error, so the prediction keeps tracking the
+// server between syncs instead of drifting by it. Nothing here depends on ESP-IDF.
+//
+// The backend's epoch has one second resolution, so single pings say little about
+// the slope. Pings are averaged into bins of CLOCK_BIN_US, the fit runs over hours of
+// bins and its slope is only trusted once its standard error is below
+// CLOCK_MAX_DRIFT_SE_PPB and that of the drift learned earlier (from NVS, across
+// reboots). Until then the earlier drift is used.
+
+#define CLOCK_SAMPLES 48                         // closed bins kept, 8 hours
+#define CLOCK_BIN_US (10LL * 60 * 1000000)
+#define CLOCK_BIN_MAX_COUNT 64
+#define CLOCK_MIN_FIT_SAMPLES 3
+#define CLOCK_MIN_FIT_SPAN_US (2LL * 3600 * 1000000)
+#define CLOCK_MAX_DRIFT_SE_PPB 5000              // 5 ppm, less certain fits are ignored
+#define CLOCK_MAX_DRIFT_PPB 500000               // 500 ppm, a fit beyond it is bad samples, not a crystal
+#define CLOCK_UNKNOWN_DRIFT_SE_PPB 50000      // nothing learned yet, a crystal's tolerance
+#define CLOCK_ANCHOR_BIAS_US 50000               // error the drift may add to the averaged offset
+#define CLOCK_MAX_SAMPLE_ERROR_US 2000000        // looser samples only set the time, they aren't binned
+
+// The mean of the pings in one bin
+struct ClockSample
+{
+    int64_t mono_us;   // local monotonic time
+    int64_t offset_us; // server time minus mono_us
+    int32_t count;
+};
+
+struct ClockDiscipline
+{
+    struct ClockSample samples[CLOCK_SAMPLES]; // ring of closed bins, oldest overwritten
+    int count;
+    int next;
+
+    int64_t bin_first_us; // the open bin, sums relative to its first ping
+    int64_t bin_first_offset_us;
+    int64_t bin_sum_mono_us;
+    int64_t bin_sum_offset_us;
+    int32_t bin_count;
+
+    bool synced;
+    bool fitted;       // drift_ppb comes from this boot's samples
+    int32_t drift_ppb; // how much faster the local clock runs than the server
+    int32_t drift_se_ppb; // its standard error
+    int64_t anchor_mono_us; // the prediction is anchor_offset_us at anchor_mono_us
+    int64_t anchor_offset_us;
+};
+
+// drift_se_ppb 0 if unknown
+void clock_discipline_init(struct ClockDiscipline *discipline, int32_t drift_ppb, int32_t drift_se_ppb);
+
+// Adds the server time seen at mono_us, good to error_us. Returns true if it moved
+// the drift estimate.
+bool clock_discipline_sample(struct ClockDiscipline *discipline, int64_t mono_us, int64_t server_us,
+                             int32_t error_us);
+
+// Server time at mono_us, false before the first sample
+bool clock_discipline_predict(const struct ClockDiscipline *discipline, int64_t mono_us, int64_t *server_us);
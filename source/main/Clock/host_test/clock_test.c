@@ -0,0 +1,179 @@
+/*
+ * Runs clock_discipline against a simulated device whose crystal is 46 ppm fast
+ * (1 s per 6 h, as measured in rtc_test) and a backend answering the ping with its
+ * epoch floored to the second, or in milliseconds, after a random round trip.
+ * clock_ping_received's RTT compensation is reproduced here. Checks how far the
+ * prediction is off at each ping, the learned drift, and the holdover when the
+ * pings stop, against the same run without drift correction.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock_discipline.h"
+
+#define DRIFT_PPB 46000
+#define EPOCH_US 1700000000000000LL
+#define MINUTE_US (60LL * 1000000)
+#define HOUR_US (60 * MINUTE_US)
+
+static bool verbose = false;
+
+struct Device
+{
+    struct ClockDiscipline discipline;
+    double true_us;  // server time, from EPOCH_US
+    int64_t boot_us; // server time at boot, the monotonic clock starts there at 0
+    int32_t drift_ppb;
+    int32_t resolution_us;
+};
+
+static double uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * rand() / ((double)RAND_MAX + 1);
+}
+
+static int64_t device_mono(const struct Device *device)
+{
+    double elapsed = device->true_us - device->boot_us;
+    return (int64_t)(elapsed * (1 + device->drift_ppb / 1e9));
+}
+
+static void device_boot(struct Device *device, int32_t learned_ppb, int32_t learned_se_ppb)
+{
+    device->boot_us = (int64_t)device->true_us;
+    clock_discipline_init(&device->discipline, learned_ppb, learned_se_ppb);
+}
+
+// One ping and its answer, returns how far the prediction was off when it came
+static double device_ping(struct Device *device)
+{
+    double rtt = uniform(50000, 800000);
+    int64_t sent = device_mono(device);
+    double server_read = device->true_us + uniform(0, rtt);
+    device->true_us += rtt;
+    int64_t received = device_mono(device);
+
+    int64_t res = device->resolution_us;
+    int64_t server = (int64_t)(server_read / res) * res + res / 2;
+    int64_t mono = received - (received - sent) / 2;
+    int32_t error = (int32_t)(res / 2 + (received - sent) / 2);
+
+    // Against the real time at the receive, as the clock would be read
+    int64_t predicted = 0;
+    double off = 0;
+    if (clock_discipline_predict(&device->discipline, received, &predicted))
+    {
+        off = predicted - device->true_us;
+    }
+
+    clock_discipline_sample(&device->discipline, mono, server, error);
+    return off;
+}
+
+static double device_error(const struct Device *device)
+{
+    int64_t predicted;
+    clock_discipline_predict(&device->discipline, device_mono(device), &predicted);
+    return predicted - device->true_us;
+}
+
+// Pings every period_us for duration_us, returns the worst prediction error at a ping
+// once settle_us has passed
+static double run(struct Device *device, int64_t period_us, int64_t duration_us, int64_t settle_us)
+{
+    double start = device->true_us;
+    double worst = 0;
+
+    while (device->true_us - start < duration_us)
+    {
+        double off = device_ping(device);
+        if (device->true_us - start >= settle_us && fabs(off) > worst)
+        {
+            worst = fabs(off);
+        }
+        if (verbose && fmod(device->true_us - start, HOUR_US) < period_us)
+        {
+            printf("  %5.1f h: %+8.1f ms, drift %6ld ppb (se %ld)%s\n", (device->true_us - start) / HOUR_US,
+                   off / 1000, (long)device->discipline.drift_ppb, (long)device->discipline.drift_se_ppb,
+                   device->discipline.fitted ? "" : ", not fitted");
+        }
+        device->true_us += period_us - uniform(0, 800000);
+    }
+
+    return worst;
+}
+
+static int check(bool ok, const char *what, double value, const char *unit)
+{
+    printf("%s %s: %.1f %s\n", ok ? "ok  " : "FAIL", what, value, unit);
+    return ok ? 0 : 1;
+}
+
+static double holdover(struct Device *device, int64_t gap_us)
+{
+    device->true_us += gap_us;
+    return fabs(device_error(device));
+}
+
+int main(int argc, char **argv)
+{
+    int failures = 0;
+    struct Device device;
+
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    srand(1);
+
+    // First boot, nothing learned, the backend's one second epoch every minute
+    memset(&device, 0, sizeof(device));
+    device.true_us = EPOCH_US;
+    device.drift_ppb = DRIFT_PPB;
+    device.resolution_us = 1000000;
+    device_boot(&device, 0, 0);
+
+    printf("first boot, 1 s epoch, ping every minute:\n");
+    double worst = run(&device, MINUTE_US, 24 * HOUR_US, 10 * MINUTE_US);
+    failures += check(worst < 400000, "worst error at a ping", worst / 1000, "ms");
+    failures += check(device.discipline.fitted, "drift fitted", device.discipline.drift_ppb, "ppb");
+    failures += check(abs(device.discipline.drift_ppb - DRIFT_PPB) < 5000, "drift error",
+                      abs(device.discipline.drift_ppb - DRIFT_PPB), "ppb");
+
+    int32_t learned = device.discipline.drift_ppb;
+    int32_t learned_se = device.discipline.drift_se_ppb;
+
+    // The pings stop for 6 h, the uncorrected clock would be a second off
+    struct Device corrected = device;
+    double held = holdover(&corrected, 6 * HOUR_US);
+    struct Device uncorrected = device;
+    uncorrected.discipline.drift_ppb = 0;
+    double free_running = holdover(&uncorrected, 6 * HOUR_US);
+    failures += check(held < 400000, "6 h holdover, drift corrected", held / 1000, "ms");
+    failures += check(free_running > 800000, "6 h holdover, uncorrected", free_running / 1000, "ms");
+
+    // Reboot with the drift from NVS and ping every 15 minutes
+    device_boot(&device, learned, learned_se);
+    printf("reboot with %ld ppb from NVS, 1 s epoch, ping every 15 minutes:\n", (long)learned);
+    worst = run(&device, 15 * MINUTE_US, 24 * HOUR_US, HOUR_US);
+    failures += check(worst < 400000, "worst error at a ping", worst / 1000, "ms");
+    failures += check(abs(device.discipline.drift_ppb - DRIFT_PPB) < 2000, "drift error",
+                      abs(device.discipline.drift_ppb - DRIFT_PPB), "ppb");
+
+    // epoch_ms, the round trip dominates
+    memset(&device, 0, sizeof(device));
+    device.true_us = EPOCH_US;
+    device.drift_ppb = DRIFT_PPB;
+    device.resolution_us = 1000;
+    device_boot(&device, 0, 0);
+
+    printf("first boot, ms epoch, ping every 5 minutes:\n");
+    worst = run(&device, 5 * MINUTE_US, 12 * HOUR_US, 3 * HOUR_US);
+    failures += check(worst < 250000, "worst error at a ping", worst / 1000, "ms");
+    failures += check(abs(device.discipline.drift_ppb - DRIFT_PPB) < 2000, "drift error",
+                      abs(device.discipline.drift_ppb - DRIFT_PPB), "ppb");
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
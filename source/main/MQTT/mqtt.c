@@ -145,5 +145,5 @@ void mqtt_start(struct MQTTConf *conf)
 void mqtt_ask_for_atributes()
 {
     mqtt_send("v1/devices/me/attributes/request/1",
-              "{\"clientKeys\":\"attribute1,attribute2\", \"sharedKeys\":\"fw_checksum,fw_checksum_algorithm,fw_size,fw_tag,fw_title,fw_version,ping_delay\"}");
+              "{\"clientKeys\":\"attribute1,attribute2\", \"sharedKeys\":\"fw_checksum,fw_checksum_algorithm,fw_size,fw_tag,fw_title,fw_version,ping_delay,qr_stop_after_first,qr_dedup_ttl,qr_prefix,qr_min_len,qr_max_len,qr_format,qr_accept_totp_form\"}");
 }
\ No newline at end of file
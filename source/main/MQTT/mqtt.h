@@ -40,7 +40,9 @@ enum MQTTCommand
     FetchBTMacs,
     TagScanned,
     StarterStateInformToMQTT,
-    
+    QRValidationReport,
+    LVGLMemReport,
+    ScreenStatsReport,
 };
 
 enum OTAState
@@ -95,6 +97,28 @@ struct MQTTMsg
             uint64_t sn;
         } tag_scanned;
         enum StarterState starter_state;
+        struct
+        {
+            int forwarded;
+            int rejected_length;
+            int rejected_prefix;
+            int rejected_format;
+        } qr_validation;
+        struct
+        {
+            // Per LVGL heap region: the internal RAM pool, the PSRAM one
+            uint32_t used[2];
+            uint32_t max_used[2];
+            uint32_t biggest_free[2];
+            uint32_t failed[2];  // allocations no region had room for
+            uint32_t spilled[2]; // allocations placed in the other region
+            int frag_pct[2];
+        } lvgl_mem;
+        struct
+        {
+            struct ScreenSwapStats swap;
+            struct ScreenDrawStats draw;
+        } screen_stats;
     } data;
 };
 
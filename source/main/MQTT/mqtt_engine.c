@@ -1,6 +1,7 @@
 #pragma once
 #include "mqtt.h"
 #include "nvs_plugin.h"
+#include "../Clock/clock.h"
 #include "esp_crt_bundle.h"
 #include "tb_shared_attribute_ingest.c"
 #include "tb_rpc_ingest.c"
@@ -112,6 +113,52 @@ void mqtt_task(void *arg)
                 });
             }
             break;
+        case QRValidationReport:
+            if (starter_state == Success)
+            {
+                char telemetry[150];
+                snprintf(telemetry, sizeof(telemetry),
+                         "{\"qr_forwarded\": %d, \"qr_rejected_length\": %d, \"qr_rejected_prefix\": %d, \"qr_rejected_format\": %d}",
+                         msg->data.qr_validation.forwarded, msg->data.qr_validation.rejected_length,
+                         msg->data.qr_validation.rejected_prefix, msg->data.qr_validation.rejected_format);
+                mqtt_send_telemetry(telemetry);
+            }
+            break;
+        case LVGLMemReport:
+            if (starter_state == Success)
+            {
+                char telemetry[500];
+                snprintf(telemetry, sizeof(telemetry),
+                         "{\"lvgl_fast_used\": %lu, \"lvgl_fast_max_used\": %lu, \"lvgl_fast_biggest_free\": %lu, "
+                         "\"lvgl_fast_frag_pct\": %d, \"lvgl_fast_failed\": %lu, \"lvgl_fast_spilled\": %lu, "
+                         "\"lvgl_psram_used\": %lu, \"lvgl_psram_max_used\": %lu, \"lvgl_psram_biggest_free\": %lu, "
+                         "\"lvgl_psram_frag_pct\": %d, \"lvgl_psram_failed\": %lu, \"lvgl_psram_spilled\": %lu}",
+                         msg->data.lvgl_mem.used[0], msg->data.lvgl_mem.max_used[0], msg->data.lvgl_mem.biggest_free[0],
+                         msg->data.lvgl_mem.frag_pct[0], msg->data.lvgl_mem.failed[0], msg->data.lvgl_mem.spilled[0],
+                         msg->data.lvgl_mem.used[1], msg->data.lvgl_mem.max_used[1], msg->data.lvgl_mem.biggest_free[1],
+                         msg->data.lvgl_mem.frag_pct[1], msg->data.lvgl_mem.failed[1], msg->data.lvgl_mem.spilled[1]);
+                mqtt_send_telemetry(telemetry);
+            }
+            break;
+        case ScreenStatsReport:
+            if (starter_state == Success)
+            {
+                struct ScreenSwapStats *swap = &msg->data.screen_stats.swap;
+                struct ScreenDrawStats *draw = &msg->data.screen_stats.draw;
+                char telemetry[500];
+                snprintf(telemetry, sizeof(telemetry),
+                         "{\"qr_swaps\": %d, \"qr_swaps_missed\": %d, \"qr_stale_dropped\": %d, "
+                         "\"qr_swap_avg_skew_us\": %lld, \"qr_swap_max_skew_us\": %lld, "
+                         "\"screen_wakeups\": %d, \"screen_applies\": %d, \"screen_lvgl_calls\": %d, "
+                         "\"screen_frames\": %d, \"screen_px\": %lld, \"screen_render_ms\": %lld, \"screen_busy_us\": %lld, "
+                         "\"screen_mirror_frames\": %d, \"screen_mirror_dropped\": %d, \"screen_mirror_us\": %lld}",
+                         swap->swaps, swap->missed, swap->stale_dropped,
+                         swap->swaps > 0 ? swap->total_skew_us / swap->swaps : 0, swap->max_skew_us,
+                         draw->wakeups, draw->applies, draw->lvgl_calls, draw->frames, draw->px, draw->render_ms,
+                         draw->busy_us, draw->mirror_frames, draw->mirror_dropped, draw->mirror_us);
+                mqtt_send_telemetry(telemetry);
+            }
+            break;
         case DoProvisioning:
         {
             ESP_LOGI(TAG, "doProvisioning client %d", (int)client);
@@ -219,6 +266,21 @@ void mqtt_task(void *arg)
         }
         case SendPingToServer:
         {
+            // How the previous ping's answer left the clock, before this one goes out
+            struct ClockStatus clock;
+            clock_get_status(&clock);
+            if (starter_state == Success && clock.synced)
+            {
+                char telemetry[200];
+                snprintf(telemetry, sizeof(telemetry),
+                         "{\"clock_drift_ppb\": %ld, \"clock_drift_se_ppb\": %ld, \"clock_drift_fitted\": %s, "
+                         "\"clock_error_us\": %lld, \"clock_rtt_us\": %lld}",
+                         (long)clock.drift_ppb, (long)clock.drift_se_ppb, clock.fitted ? "true" : "false",
+                         clock.last_error_us, clock.last_rtt_us);
+                mqtt_send_telemetry(telemetry);
+            }
+
+            clock_ping_sent();
             send_api_post("ping", "{}");
             break;
         }
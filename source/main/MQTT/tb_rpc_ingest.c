@@ -20,10 +20,16 @@ void tb_rpc_ingest(jparse_ctx_t *jctx, struct MQTTConf *conf)
     {
         long long int epoch;
 
-        if (json_obj_get_int64(jctx, "epoch", &epoch) == OS_SUCCESS)
+        // epoch_ms when the backend sends it, otherwise the floored seconds: its
+        // middle is the best guess and half a second the uncertainty
+        if (json_obj_get_int64(jctx, "epoch_ms", &epoch) == OS_SUCCESS)
         {
-            struct timeval now = {.tv_sec = epoch};
-            settimeofday(&now, NULL);
+            clock_ping_received(epoch * 1000 + 500, 1000);
+            ESP_LOGI(TAG, "epoch_ms is: %lld", epoch);
+        }
+        else if (json_obj_get_int64(jctx, "epoch", &epoch) == OS_SUCCESS)
+        {
+            clock_ping_received(epoch * 1000000 + 500000, 1000000);
             ESP_LOGI(TAG, "epoch is: %lld", epoch);
         }
 
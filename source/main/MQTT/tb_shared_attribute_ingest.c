@@ -2,6 +2,7 @@
 #include "mqtt.h"
 #include "nvs_plugin.h"
 #include "esp_crt_bundle.h"
+#include "../QR/qr_validate.h"
 
 static const char *TAG = "mqtt";
 
@@ -17,6 +18,76 @@ void tb_shared_attribute_ingest(jparse_ctx_t *jctx, struct MQTTConf *conf, bool
         set_ping_delay(ping_delay_secs * 1000 / portTICK_PERIOD_MS);
     }
 
+    bool qr_stop_after_first;
+
+    if (json_obj_get_bool(jctx, "qr_stop_after_first", &qr_stop_after_first) == OS_SUCCESS)
+    {
+        ESP_LOGE(TAG, "updated qr_stop_after_first: %d", qr_stop_after_first);
+
+        set_qr_stop_after_first(qr_stop_after_first);
+    }
+
+    char qr_dedup_ttl_string[20];
+
+    if (json_obj_get_string(jctx, "qr_dedup_ttl", qr_dedup_ttl_string, sizeof(qr_dedup_ttl_string)) == OS_SUCCESS)
+    {
+        int qr_dedup_ttl = atoi(qr_dedup_ttl_string);
+        ESP_LOGE(TAG, "updated qr_dedup_ttl: %d", qr_dedup_ttl);
+
+        set_qr_dedup_ttl(qr_dedup_ttl);
+    }
+
+    char qr_prefix[QR_PREFIX_SIZE];
+
+    if (json_obj_get_string(jctx, "qr_prefix", qr_prefix, sizeof(qr_prefix)) == OS_SUCCESS)
+    {
+        ESP_LOGE(TAG, "updated qr_prefix: %s", qr_prefix);
+
+        set_qr_prefix(qr_prefix);
+    }
+
+    char qr_min_len_string[20];
+
+    if (json_obj_get_string(jctx, "qr_min_len", qr_min_len_string, sizeof(qr_min_len_string)) == OS_SUCCESS)
+    {
+        int qr_min_len = atoi(qr_min_len_string);
+        ESP_LOGE(TAG, "updated qr_min_len: %d", qr_min_len);
+
+        set_qr_min_len(qr_min_len);
+    }
+
+    char qr_max_len_string[20];
+
+    if (json_obj_get_string(jctx, "qr_max_len", qr_max_len_string, sizeof(qr_max_len_string)) == OS_SUCCESS)
+    {
+        int qr_max_len = atoi(qr_max_len_string);
+        ESP_LOGE(TAG, "updated qr_max_len: %d", qr_max_len);
+
+        set_qr_max_len(qr_max_len);
+    }
+
+    char qr_format_string[20];
+
+    if (json_obj_get_string(jctx, "qr_format", qr_format_string, sizeof(qr_format_string)) == OS_SUCCESS)
+    {
+        int qr_format = qr_format_from_name(qr_format_string);
+        ESP_LOGE(TAG, "updated qr_format: %s (%d)", qr_format_string, qr_format);
+
+        if (qr_format >= 0)
+        {
+            set_qr_format(qr_format);
+        }
+    }
+
+    bool qr_accept_totp_form;
+
+    if (json_obj_get_bool(jctx, "qr_accept_totp_form", &qr_accept_totp_form) == OS_SUCCESS)
+    {
+        ESP_LOGE(TAG, "updated qr_accept_totp_form: %d", qr_accept_totp_form);
+
+        set_qr_accept_totp_form(qr_accept_totp_form);
+    }
+
     char totp_form_base_url[URL_SIZE];
 
     if (json_obj_get_string(jctx, "totp_form_base_url", totp_form_base_url, sizeof(totp_form_base_url)) == OS_SUCCESS)
@@ -0,0 +1,16 @@
+#include "crc32.h"
+
+uint32_t crc32_ieee(const uint8_t *buf, int len)
+{
+    uint32_t crc = 0xffffffff;
+
+    for (int i = 0; i < len; i++)
+    {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
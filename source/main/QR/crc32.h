@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, as in zlib), bitwise as the inputs are a few hundred bytes
+uint32_t crc32_ieee(const uint8_t *buf, int len);
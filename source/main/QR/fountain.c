@@ -0,0 +1,149 @@
+#include "fountain.h"
+
+#include <string.h>
+
+static uint32_t fmix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t fountain_neighbours(uint32_t seed, int k)
+{
+    if (seed < (uint32_t)k)
+    {
+        return 1u << seed;
+    }
+
+    uint32_t x = fmix32(seed);
+    uint32_t mask = 0;
+
+    if (x == 0)
+    {
+        x = 1;
+    }
+
+    // xorshift32 until the mask selects at least one block
+    while (mask == 0)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        mask = k < 32 ? x & ((1u << k) - 1) : x;
+    }
+    return mask;
+}
+
+int fountain_reset(struct FountainDecoder *dec, int id, int k, int len, int block_size)
+{
+    memset(dec, 0, sizeof(struct FountainDecoder));
+
+    if (k < 1 || k > FOUNTAIN_MAX_BLOCKS || block_size < 1 || block_size > FOUNTAIN_MAX_BLOCK_SIZE ||
+        len < 1 || len > k * block_size)
+    {
+        return -1;
+    }
+
+    dec->id = id;
+    dec->k = k;
+    dec->len = len;
+    dec->block_size = block_size;
+    return 0;
+}
+
+static void xor_block(uint8_t *dst, const uint8_t *src, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        dst[i] ^= src[i];
+    }
+}
+
+void fountain_encode(const uint8_t *payload, int len, int block_size, uint32_t seed, uint8_t *block)
+{
+    int k = (len + block_size - 1) / block_size;
+    uint32_t mask = fountain_neighbours(seed, k);
+
+    memset(block, 0, block_size);
+    for (int i = 0; i < k; i++)
+    {
+        if (mask & (1u << i))
+        {
+            int offset = i * block_size;
+            xor_block(block, &payload[offset], len - offset < block_size ? len - offset : block_size);
+        }
+    }
+}
+
+int fountain_add(struct FountainDecoder *dec, uint32_t seed, const uint8_t *block)
+{
+    if (dec->k == 0 || dec->complete)
+    {
+        return dec->rank;
+    }
+
+    uint32_t mask = fountain_neighbours(seed, dec->k);
+    uint8_t data[FOUNTAIN_MAX_BLOCK_SIZE];
+    memcpy(data, block, dec->block_size);
+
+    // Eliminate every block we already have a row for, highest first
+    for (int i = dec->k - 1; i >= 0 && mask; i--)
+    {
+        if ((mask & (1u << i)) && dec->masks[i])
+        {
+            mask ^= dec->masks[i];
+            xor_block(data, dec->rows[i], dec->block_size);
+        }
+    }
+
+    if (mask == 0)
+    {
+        return dec->rank; // nothing new
+    }
+
+    int top = 31 - __builtin_clz(mask);
+    dec->masks[top] = mask;
+    memcpy(dec->rows[top], data, dec->block_size);
+    dec->rank++;
+
+    dec->complete = dec->rank == dec->k;
+    return dec->rank;
+}
+
+int fountain_payload(struct FountainDecoder *dec, char *out, int out_size)
+{
+    if (!dec->complete || out_size < dec->len + 1)
+    {
+        return -1;
+    }
+
+    // Back substitution: row i only has blocks <= i, and rows below it are
+    // already single blocks by the time we get to it
+    for (int i = 0; i < dec->k; i++)
+    {
+        for (int j = 0; j < i; j++)
+        {
+            if (dec->masks[i] & (1u << j))
+            {
+                dec->masks[i] ^= dec->masks[j];
+                xor_block(dec->rows[i], dec->rows[j], dec->block_size);
+            }
+        }
+    }
+
+    for (int i = 0; i < dec->k; i++)
+    {
+        int offset = i * dec->block_size;
+        int size = dec->len - offset < dec->block_size ? dec->len - offset : dec->block_size;
+        if (size > 0)
+        {
+            memcpy(out + offset, dec->rows[i], size);
+        }
+    }
+    out[dec->len] = '\0';
+    return dec->len;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Rateless transfer of the reconf payload. The payload is cut into k blocks and
+// every QR frame carries one packet: a seed and the XOR of the blocks the seed
+// selects. Seeds below k select a single block, later seeds a pseudo-random set,
+// so any k or so packets received in any order rebuild the payload.
+//
+// The selection must match fountain_neighbours() in provisioning_app/src/index.js.
+
+#define FOUNTAIN_MAX_BLOCKS 32     // one bit per block in the neighbour masks
+#define FOUNTAIN_MAX_BLOCK_SIZE 64 // bytes
+
+struct FountainDecoder
+{
+    int id; // session, a new id restarts the decoder
+    int k;
+    int len;
+    int block_size;
+    int rank;
+    bool complete;
+
+    // Row i holds a combination whose highest block is i, 0 if there is none yet.
+    // Every packet is eliminated against these rows as it arrives, so degree one
+    // packets land straight in their row and duplicates cost nothing.
+    uint32_t masks[FOUNTAIN_MAX_BLOCKS];
+    uint8_t rows[FOUNTAIN_MAX_BLOCKS][FOUNTAIN_MAX_BLOCK_SIZE];
+};
+
+uint32_t fountain_neighbours(uint32_t seed, int k);
+
+// Writes the block_size bytes packet for seed, the XOR of the selected blocks with
+// the last one zero padded. k is len / block_size rounded up.
+void fountain_encode(const uint8_t *payload, int len, int block_size, uint32_t seed, uint8_t *block);
+
+// Returns -1 if the parameters don't fit the decoder, otherwise 0
+int fountain_reset(struct FountainDecoder *dec, int id, int k, int len, int block_size);
+
+// Adds a packet, returns the number of independent blocks known so far
+int fountain_add(struct FountainDecoder *dec, uint32_t seed, const uint8_t *block);
+
+// Once complete, writes the payload and a terminating nul. Returns its length or
+// -1 if it isn't complete or doesn't fit.
+int fountain_payload(struct FountainDecoder *dec, char *out, int out_size);
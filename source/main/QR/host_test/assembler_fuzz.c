@@ -0,0 +1,367 @@
+/*
+ * Feeds the reconf assembler transfers the way a phone held in front of
+ * the camera delivers them: out of order, repeated, interleaved with a
+ * stale session and with forged or corrupted segments mixed in. Every
+ * transfer must reassemble to exactly the bytes that were sent, and no
+ * forged segment may ever get in.
+ *
+ *   assembler_fuzz [iterations] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reconf_assembler.h"
+#include "crc32.h"
+
+#define TIMEOUT 60
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: %s (seed %u)\n", __FILE__, __LINE__, #cond, \
+                    seed);                                                      \
+            exit(1);                                                            \
+        }                                                                       \
+    } while (0)
+
+static unsigned seed;
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int rng_range(int lo, int hi)
+{
+    return lo + (int)(rng() % (uint32_t)(hi - lo + 1));
+}
+
+struct transfer {
+    uint32_t id;
+    int size;
+    int count;
+    int len;
+    bool with_ids; // newer apps send id, hash and per segment crc
+    char payload[ASSEMBLER_MAX_PAYLOAD];
+};
+
+static void make_transfer(struct transfer *t)
+{
+    t->with_ids = rng() & 1;
+    t->id = t->with_ids ? rng() & 0xffff : 0;
+    t->count = rng_range(1, ASSEMBLER_MAX_SEGMENTS);
+    t->size = rng_range(1, ASSEMBLER_MAX_PAYLOAD / t->count);
+    t->len = (t->count - 1) * t->size + rng_range(1, t->size);
+    for (int i = 0; i < t->len; i++) {
+        t->payload[i] = (char)rng_range(0x20, 0x7e);
+    }
+}
+
+static int segment_len(const struct transfer *t, int i)
+{
+    return i == t->count - 1 ? t->len - i * t->size : t->size;
+}
+
+static enum AssemblerResult send_start(struct ReconfAssembler *a, const struct transfer *t, int64_t now)
+{
+    uint32_t hash = crc32_ieee((const uint8_t *)t->payload, t->len);
+    return assembler_start(a, t->id, t->size, t->count, t->with_ids, t->with_ids ? hash : 0, now);
+}
+
+static enum AssemblerResult send_segment(struct ReconfAssembler *a, const struct transfer *t, int i, int64_t now)
+{
+    const char *data = &t->payload[i * t->size];
+    int len = segment_len(t, i);
+    uint32_t crc = crc32_ieee((const uint8_t *)data, len);
+    return assembler_segment(a, t->id, i, data, len, t->with_ids, t->with_ids ? crc : 0, now);
+}
+
+/* A segment that must be refused whatever state the session is in */
+static void send_forged(struct ReconfAssembler *a, const struct transfer *t, int64_t now)
+{
+    char junk[ASSEMBLER_MAX_PAYLOAD + 16];
+    int i = rng_range(0, t->count - 1);
+    int len = segment_len(t, i);
+    enum AssemblerResult res;
+
+    memcpy(junk, &t->payload[i * t->size], len);
+
+    switch (rng() % 5) {
+    case 0: /* index out of bounds */
+        res = assembler_segment(a, t->id, rng() & 1 ? -rng_range(1, 1000) : t->count + rng_range(0, 1000),
+                                junk, len, false, 0, now);
+        break;
+    case 1: /* longer than a segment */
+        memset(junk + len, 'X', t->size + 16 - len);
+        res = assembler_segment(a, t->id, i, junk, t->size + rng_range(1, 16), false, 0, now);
+        break;
+    case 2: /* short, but not the last segment */
+        if (i == t->count - 1 || t->size < 2) {
+            res = assembler_segment(a, t->id, i, junk, 0, false, 0, now);
+        } else {
+            res = assembler_segment(a, t->id, i, junk, rng_range(1, t->size - 1), false, 0, now);
+        }
+        break;
+    case 3: /* another session */
+        res = assembler_segment(a, t->id ^ rng_range(1, 0xffff), i, junk, len, false, 0, now);
+        break;
+    default: /* corrupted, with the crc of the original */
+        junk[rng_range(0, len - 1)] ^= (char)rng_range(1, 0x7f);
+        res = assembler_segment(a, t->id, i, junk, len, true, crc32_ieee((const uint8_t *)&t->payload[i * t->size], len), now);
+        break;
+    }
+
+    CHECK(res == AssemblerRejected);
+}
+
+static void shuffle(int *order, int n)
+{
+    for (int i = n - 1; i > 0; i--) {
+        int j = rng_range(0, i);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+/* One transfer from start to complete, returns the time it ended at */
+static int64_t run_transfer(struct ReconfAssembler *a, const struct transfer *t, int64_t now)
+{
+    int order[ASSEMBLER_MAX_SEGMENTS];
+    int seen[ASSEMBLER_MAX_SEGMENTS] = {0};
+    int received = 0;
+
+    for (int i = 0; i < t->count; i++) {
+        order[i] = i;
+    }
+    shuffle(order, t->count);
+
+    CHECK(send_start(a, t, now) == AssemblerStarted);
+
+    for (int n = 0; n < t->count;) {
+        now += rng_range(0, 2);
+
+        switch (rng() % 8) {
+        case 0:
+            CHECK(send_start(a, t, now) == AssemblerDuplicate);
+            continue;
+        case 1:
+            send_forged(a, t, now);
+            continue;
+        case 2:
+            if (n > 0) {
+                CHECK(send_segment(a, t, order[rng_range(0, n - 1)], now) == AssemblerDuplicate);
+            }
+            continue;
+        }
+
+        int i = order[n++];
+        enum AssemblerResult res = send_segment(a, t, i, now);
+        CHECK(!seen[i]);
+        seen[i] = 1;
+        received++;
+        CHECK(res == (received == t->count ? AssemblerComplete : AssemblerAccepted));
+        CHECK(assembler_received(a) == received);
+    }
+
+    CHECK(a->complete);
+    CHECK(assembler_payload_len(a) == t->len);
+    CHECK(memcmp(a->payload, t->payload, t->len) == 0);
+    CHECK(a->payload[t->len] == '\0');
+
+    /* The app keeps cycling after we are done */
+    CHECK(send_segment(a, t, rng_range(0, t->count - 1), now) == AssemblerDuplicate);
+    CHECK(send_start(a, t, now) == AssemblerDuplicate);
+    return now;
+}
+
+/* Without per segment crc only the payload hash can catch a bad segment */
+static int64_t check_hash_mismatch(struct ReconfAssembler *a, int64_t now)
+{
+    struct transfer t;
+    char bad[ASSEMBLER_MAX_PAYLOAD];
+
+    do {
+        make_transfer(&t);
+    } while (t.count < 2);
+
+    uint32_t hash = crc32_ieee((const uint8_t *)t.payload, t.len);
+    CHECK(assembler_start(a, t.id, t.size, t.count, true, hash, now) == AssemblerStarted);
+
+    int corrupt = rng_range(0, t.count - 1);
+    for (int i = 0; i < t.count; i++) {
+        const char *data = &t.payload[i * t.size];
+        int len = segment_len(&t, i);
+        if (i == corrupt) {
+            memcpy(bad, data, len);
+            bad[0] ^= 1;
+            data = bad;
+        }
+        enum AssemblerResult res = assembler_segment(a, t.id, i, data, len, false, 0, now);
+        CHECK(res == (i == t.count - 1 ? AssemblerRejected : AssemblerAccepted));
+    }
+
+    /* Collecting starts over within the same session */
+    CHECK(a->active && !a->complete);
+    CHECK(assembler_received(a) == 0);
+    for (int i = 0; i < t.count; i++) {
+        enum AssemblerResult res = assembler_segment(a, t.id, i, &t.payload[i * t.size], segment_len(&t, i), false, 0, now);
+        CHECK(res == (i == t.count - 1 ? AssemblerComplete : AssemblerAccepted));
+    }
+    CHECK(memcmp(a->payload, t.payload, t.len) == 0);
+    return now;
+}
+
+/* A new start mid transfer replaces the session, stale segments bounce */
+static int64_t check_restart(struct ReconfAssembler *a, int64_t now)
+{
+    struct transfer old, t;
+
+    make_transfer(&old);
+    old.with_ids = true;
+    do {
+        make_transfer(&t);
+        t.with_ids = true;
+    } while (t.id == old.id);
+
+    CHECK(send_start(a, &old, now) == AssemblerStarted);
+    CHECK(send_segment(a, &old, 0, now) == (old.count == 1 ? AssemblerComplete : AssemblerAccepted));
+
+    /* run_transfer checks the received count from zero */
+    now = run_transfer(a, &t, now);
+    CHECK(send_segment(a, &old, rng_range(0, old.count - 1), now) == AssemblerRejected);
+    return now;
+}
+
+/* Going quiet for the timeout drops the session */
+static int64_t check_timeout(struct ReconfAssembler *a, int64_t now)
+{
+    struct transfer t;
+
+    do {
+        make_transfer(&t);
+    } while (t.count < 2);
+
+    CHECK(send_start(a, &t, now) == AssemblerStarted);
+    CHECK(send_segment(a, &t, 0, now + TIMEOUT - 1) == AssemblerAccepted);
+    CHECK(!assembler_expire(a, now + 2 * TIMEOUT - 2));
+    CHECK(send_segment(a, &t, 1, now + 2 * TIMEOUT - 1 + TIMEOUT) == AssemblerRejected);
+    CHECK(!a->active);
+
+    /* and a completed one too, so the same transfer can be applied again */
+    now = run_transfer(a, &t, now + 10 * TIMEOUT);
+    CHECK(assembler_expire(a, now + TIMEOUT));
+    CHECK(send_start(a, &t, now + TIMEOUT) == AssemblerStarted);
+    return now + TIMEOUT;
+}
+
+/*
+ * Older apps slice the JSON with String.slice, so segment_size counts
+ * UTF-16 code units while the segments arrive as UTF-8. Spanish text makes
+ * segments longer in bytes than segment_size and uneven among themselves.
+ */
+static int64_t check_non_ascii(struct ReconfAssembler *a, int64_t now)
+{
+    static const char payload[] = "{\"device_name\":\"Aula 3 planta baja, configuración "
+                                  "de pruebas \u00f1\",\"wifi_ssid\":\"Cañón ☕ 🍕 días\"}";
+    const int size = 5;
+    int offset[ASSEMBLER_MAX_SEGMENTS + 1];
+    int order[ASSEMBLER_MAX_SEGMENTS];
+    int len = (int)strlen(payload);
+    int count = 0;
+
+    /* Split by code units as String.slice does, a pair never straddles here */
+    for (int i = 0, units = 0; i < len; i++) {
+        uint8_t c = (uint8_t)payload[i];
+        if ((c & 0xc0) == 0x80) {
+            continue;
+        }
+        if (units % size == 0) {
+            offset[count++] = i;
+        }
+        CHECK(c < 0xf0 || units % size != size - 1);
+        units += c >= 0xf0 ? 2 : 1;
+    }
+    offset[count] = len;
+    CHECK(count <= ASSEMBLER_MAX_SEGMENTS);
+    CHECK(len > assembler_utf16_len(payload, len));
+
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    shuffle(order, count);
+
+    CHECK(assembler_start(a, 0, size, count, false, 0, now) == AssemblerStarted);
+    for (int n = 0; n < count; n++) {
+        int i = order[n];
+        enum AssemblerResult res = assembler_segment(a, 0, i, &payload[offset[i]], offset[i + 1] - offset[i], false, 0, now);
+        CHECK(res == (n == count - 1 ? AssemblerComplete : AssemblerAccepted));
+    }
+    CHECK(assembler_payload_len(a) == len);
+    CHECK(strcmp(a->payload, payload) == 0);
+
+    /* A segment one code unit short is still refused */
+    now += 2 * TIMEOUT;
+    CHECK(assembler_start(a, 0, size, count, false, 0, now) == AssemblerStarted);
+    CHECK(assembler_segment(a, 0, 0, payload, offset[1] - 1, false, 0, now) == AssemblerRejected);
+    return now;
+}
+
+static void check_bad_start(struct ReconfAssembler *a, int64_t now)
+{
+    CHECK(assembler_start(a, 1, 0, 1, false, 0, now) == AssemblerRejected);
+    CHECK(assembler_start(a, 1, 16, 0, false, 0, now) == AssemblerRejected);
+    CHECK(assembler_start(a, 1, -16, 4, false, 0, now) == AssemblerRejected);
+    CHECK(assembler_start(a, 1, 1, ASSEMBLER_MAX_SEGMENTS + 1, false, 0, now) == AssemblerRejected);
+    CHECK(assembler_start(a, 1, ASSEMBLER_MAX_PAYLOAD / 2 + 1, 2, false, 0, now) == AssemblerRejected);
+    CHECK(assembler_start(a, 1, 0x7fffffff, 0x7fffffff, false, 0, now) == AssemblerRejected);
+    CHECK(assembler_segment(a, 1, 0, "x", 1, false, 0, now) == AssemblerRejected);
+}
+
+int main(int argc, char **argv)
+{
+    static struct ReconfAssembler a;
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    int64_t now = 1000;
+
+    seed = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 0x5eed;
+    rng_state = seed ? seed : 1;
+
+    assembler_init(&a, TIMEOUT);
+    check_bad_start(&a, now);
+
+    for (int n = 0; n < iterations; n++) {
+        struct transfer t;
+
+        /* Sessions always end in the timeout so every check starts clean */
+        now += 2 * TIMEOUT;
+
+        switch (n % 5) {
+        case 0:
+            make_transfer(&t);
+            now = run_transfer(&a, &t, now);
+            break;
+        case 4:
+            now = check_non_ascii(&a, now);
+            break;
+        case 1:
+            now = check_hash_mismatch(&a, now);
+            break;
+        case 2:
+            now = check_restart(&a, now);
+            break;
+        default:
+            now = check_timeout(&a, now);
+            break;
+        }
+    }
+
+    printf("%d transfers reassembled (seed 0x%x)\n", iterations, seed);
+    return 0;
+}
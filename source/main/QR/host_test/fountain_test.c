@@ -0,0 +1,206 @@
+/*
+ * Round trips payloads through fountain_encode and the decoder the way the
+ * provisioning app streams them: from a random seed on, with frames lost,
+ * repeated and out of order. Every transfer must rebuild exactly the bytes
+ * sent, the rank must only grow with independent packets, and parameters
+ * the decoder can't hold must be refused. The neighbour sets are checked
+ * against values from fountain_neighbours() in provisioning_app/src/index.js.
+ *
+ *   fountain_test [iterations] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fountain.h"
+
+#define MAX_PAYLOAD (FOUNTAIN_MAX_BLOCKS * FOUNTAIN_MAX_BLOCK_SIZE)
+#define MAX_FRAMES 2000
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: %s (seed %u)\n", __FILE__, __LINE__, #cond, \
+                    seed);                                                      \
+            exit(1);                                                            \
+        }                                                                       \
+    } while (0)
+
+static unsigned seed;
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int rng_range(int lo, int hi)
+{
+    return lo + (int)(rng() % (uint32_t)(hi - lo + 1));
+}
+
+/* From the app's fountain_neighbours(), printed with node */
+static void check_neighbours(void)
+{
+    static const struct {
+        uint32_t seed;
+        int k;
+        uint32_t mask;
+    } vectors[] = {
+        {0, 5, 0x1},           {4, 5, 0x10},          {5, 5, 0x17},
+        {6, 5, 0xd},           {100, 5, 0x3},         {32, 32, 0x2a1edd6a},
+        {33, 32, 0x3ec31325},  {1000, 32, 0x16e2e629}, {65535, 17, 0x1961c},
+        {40, 31, 0x474c4982},
+    };
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        CHECK(fountain_neighbours(vectors[i].seed, vectors[i].k) == vectors[i].mask);
+    }
+}
+
+static void check_limits(void)
+{
+    struct FountainDecoder dec;
+    uint8_t block[FOUNTAIN_MAX_BLOCK_SIZE] = {0};
+    char out[MAX_PAYLOAD + 1];
+
+    CHECK(fountain_reset(&dec, 1, FOUNTAIN_MAX_BLOCKS + 1, FOUNTAIN_MAX_BLOCKS * 10, 10) < 0);
+    CHECK(fountain_reset(&dec, 1, 0, 1, 10) < 0);
+    CHECK(fountain_reset(&dec, 1, 2, 10, FOUNTAIN_MAX_BLOCK_SIZE + 1) < 0);
+    CHECK(fountain_reset(&dec, 1, 2, 21, 10) < 0);
+    CHECK(fountain_reset(&dec, 1, 2, 0, 10) < 0);
+
+    /* A refused decoder takes nothing and has nothing to give */
+    CHECK(fountain_add(&dec, 0, block) == 0);
+    CHECK(fountain_payload(&dec, out, sizeof(out)) < 0);
+
+    CHECK(fountain_reset(&dec, 1, FOUNTAIN_MAX_BLOCKS, MAX_PAYLOAD, FOUNTAIN_MAX_BLOCK_SIZE) == 0);
+    CHECK(fountain_payload(&dec, out, sizeof(out)) < 0);
+
+    /* Complete, but the output doesn't fit the payload and its nul */
+    CHECK(fountain_reset(&dec, 1, 1, 5, 10) == 0);
+    memcpy(block, "hello", 5);
+    CHECK(fountain_add(&dec, 0, block) == 1);
+    CHECK(dec.complete);
+    CHECK(fountain_payload(&dec, out, 5) < 0);
+    CHECK(fountain_payload(&dec, out, 6) == 5);
+    CHECK(strcmp(out, "hello") == 0);
+}
+
+/* Repeats and combinations of packets already held add nothing */
+static void check_dependent(void)
+{
+    struct FountainDecoder dec;
+    uint8_t payload[MAX_PAYLOAD];
+    uint8_t block[FOUNTAIN_MAX_BLOCK_SIZE];
+    int k = 8;
+    int block_size = 16;
+    int len = k * block_size - 3;
+
+    for (int i = 0; i < len; i++) {
+        payload[i] = rng();
+    }
+    CHECK(fountain_reset(&dec, 7, k, len, block_size) == 0);
+
+    /* Two packets, then one whose set is the XOR of theirs */
+    uint32_t first = k;
+    uint32_t second = k + 1;
+    while (fountain_neighbours(second, k) == fountain_neighbours(first, k)) {
+        second++;
+    }
+    uint32_t sum = fountain_neighbours(first, k) ^ fountain_neighbours(second, k);
+    uint32_t dependent = second + 1;
+    while (fountain_neighbours(dependent, k) != sum) {
+        dependent++;
+    }
+
+    fountain_encode(payload, len, block_size, first, block);
+    CHECK(fountain_add(&dec, first, block) == 1);
+    CHECK(fountain_add(&dec, first, block) == 1);
+    fountain_encode(payload, len, block_size, second, block);
+    CHECK(fountain_add(&dec, second, block) == 2);
+    fountain_encode(payload, len, block_size, dependent, block);
+    CHECK(fountain_add(&dec, dependent, block) == 2);
+
+    /* The systematic packets finish it whichever the combinations were */
+    for (int i = 0; i < k; i++) {
+        fountain_encode(payload, len, block_size, i, block);
+        fountain_add(&dec, i, block);
+    }
+    CHECK(dec.complete);
+    CHECK(dec.rank == k);
+
+    char out[MAX_PAYLOAD + 1];
+    CHECK(fountain_payload(&dec, out, sizeof(out)) == len);
+    CHECK(memcmp(out, payload, len) == 0);
+}
+
+/* One transfer, returns the frames it took */
+static int round_trip(int loss_percent)
+{
+    struct FountainDecoder dec;
+    uint8_t payload[MAX_PAYLOAD];
+    uint8_t block[FOUNTAIN_MAX_BLOCK_SIZE];
+    char out[MAX_PAYLOAD + 1];
+    int k = rng_range(1, FOUNTAIN_MAX_BLOCKS);
+    int block_size = rng_range(1, FOUNTAIN_MAX_BLOCK_SIZE);
+    int len = (k - 1) * block_size + rng_range(1, block_size);
+
+    for (int i = 0; i < len; i++) {
+        payload[i] = rng();
+    }
+    CHECK(fountain_reset(&dec, rng() & 0xffff, k, len, block_size) == 0);
+
+    /* The app cycles from seed 0, the device starts watching anywhere */
+    uint32_t next = rng_range(0, 3 * k);
+    int frames = 0;
+    int rank = 0;
+
+    while (!dec.complete) {
+        CHECK(frames < MAX_FRAMES);
+        uint32_t s = next++;
+
+        if (rng_range(1, 100) <= loss_percent) {
+            continue;
+        }
+        /* A late frame still on the screen as the camera looks again */
+        if (rng_range(1, 10) == 1 && s > 0) {
+            s -= rng_range(1, s < 3 ? s : 3);
+        }
+
+        fountain_encode(payload, len, block_size, s, block);
+        int added = fountain_add(&dec, s, block);
+        CHECK(added == rank || added == rank + 1);
+        CHECK(added <= k);
+        rank = added;
+        frames++;
+    }
+
+    CHECK(dec.rank == k);
+    CHECK(fountain_payload(&dec, out, sizeof(out)) == len);
+    CHECK(memcmp(out, payload, len) == 0);
+    CHECK(out[len] == '\0');
+    return frames - k;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 5000;
+    seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+    rng_state = seed ? seed : 1;
+
+    check_neighbours();
+    check_limits();
+    check_dependent();
+
+    long extra = 0;
+    for (int n = 0; n < iterations; n++) {
+        extra += round_trip(rng_range(0, 50));
+    }
+    printf("%d transfers, %.2f frames over k on average\n", iterations, (double)extra / iterations);
+    return 0;
+}
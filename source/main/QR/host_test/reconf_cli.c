@@ -0,0 +1,681 @@
+/*
+ * Host side of the reconf protocol, built on the same reconf.c and
+ * fountain.c as the firmware.
+ *
+ *   reconf_cli encode [-b block] [-i id] [-n frames] [-m px] [-t] conf.json outdir
+ *       writes the frames the provisioning app would show as
+ *       outdir/frame_NNNN.pgm, -t prints their text instead
+ *   reconf_cli decode [-f] frame.pgm...
+ *       scans the frames in order like the device does and prints the
+ *       configuration as JSON once complete, -f for vertically mirrored
+ *       frames such as camera captures
+ *   reconf_cli bench [-c px] [-l loss] [-p ms] [-r runs] conf.json
+ *       renders every block size into a camera sized frame, decodes it with
+ *       quirc and reports the QR version, the frames needed with loss
+ *       percent of them missed and the resulting provisioning time at one
+ *       frame every ms milliseconds (the app's transmision_interval)
+ *
+ * conf.json is the flat object the app builds, e.g.
+ * {"wifi_ssid":"x","space_id":10,"invalidate_backend_auth":false}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "reconf.h"
+#include "fountain.h"
+#include "quirc.h"
+#include "qrcodegen.h"
+
+#define MAX_PAYLOAD (FOUNTAIN_MAX_BLOCKS * FOUNTAIN_MAX_BLOCK_SIZE)
+#define MAX_TEXT 256
+#define QUIET_ZONE 4 // modules
+
+/* Mirrors provisioning_app/src/index.js */
+#define APP_BLOCK_SIZE 50
+#define APP_INTERVAL_MS 1000
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    char *text;
+    long size;
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    text = malloc(size + 1);
+    if (text && fread(text, 1, size, f) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text) {
+        text[size] = '\0';
+    }
+
+    fclose(f);
+    return text;
+}
+
+/*
+ * Just enough JSON for the flat object the app produces: string, number
+ * and boolean values. Strings only support the escapes JSON.stringify
+ * emits for ASCII.
+ */
+static const char *skip_space(const char *p)
+{
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char *parse_string(const char *p, char *out, int out_size)
+{
+    int len = 0;
+
+    if (*p++ != '"') {
+        return NULL;
+    }
+
+    while (*p != '"') {
+        char c = *p++;
+
+        if (c == '\0') {
+            return NULL;
+        }
+
+        if (c == '\\') {
+            c = *p++;
+            switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'u': {
+                unsigned code;
+                if (sscanf(p, "%4x", &code) != 1 || code > 0x7f) {
+                    return NULL;
+                }
+                c = (char)code;
+                p += 4;
+                break;
+            }
+            default:
+                return NULL;
+            }
+        }
+
+        if (len + 1 >= out_size) {
+            return NULL;
+        }
+        out[len++] = c;
+    }
+
+    out[len] = '\0';
+    return p + 1;
+}
+
+/* Encodes conf.json into a reconf payload, returns its length or -1 */
+static int encode_config(const char *json, uint8_t *payload, int size)
+{
+    struct ReconfWriter writer;
+    const char *p = skip_space(json);
+    char key[64], value[MAX_PAYLOAD];
+
+    reconf_writer_init(&writer, payload, size);
+
+    if (*p++ != '{') {
+        return -1;
+    }
+
+    for (p = skip_space(p); *p != '}'; p = skip_space(p)) {
+        p = parse_string(p, key, sizeof(key));
+        if (!p || *(p = skip_space(p)) != ':') {
+            return -1;
+        }
+        p = skip_space(p + 1);
+
+        int field = reconf_field_id(key);
+        if (field < 0) {
+            fprintf(stderr, "skipping unknown field %s\n", key);
+        }
+
+        if (*p == '"') {
+            p = parse_string(p, value, sizeof(value));
+            if (!p) {
+                return -1;
+            }
+            if (field > 0 && (int)strlen(value) > reconf_field_max_len(field)) {
+                fprintf(stderr, "%s: %zu bytes, the device holds at most %d\n", key, strlen(value),
+                        reconf_field_max_len(field));
+                return -1;
+            }
+            if (field > 0) {
+                reconf_put_bytes(&writer, field, (const uint8_t *)value, strlen(value));
+            }
+        } else {
+            uint32_t number;
+            if (strncmp(p, "true", 4) == 0) {
+                number = 1;
+                p += 4;
+            } else if (strncmp(p, "false", 5) == 0) {
+                number = 0;
+                p += 5;
+            } else {
+                char *end;
+                number = strtoul(p, &end, 10);
+                if (end == p) {
+                    return -1;
+                }
+                p = end;
+            }
+            if (field > 0) {
+                reconf_put_number(&writer, field, number);
+            }
+        }
+
+        p = skip_space(p);
+        if (*p == ',') {
+            p++;
+        } else if (*p != '}') {
+            return -1;
+        }
+    }
+
+    return reconf_writer_finish(&writer);
+}
+
+static void print_json_string(const uint8_t *bytes, int len)
+{
+    putchar('"');
+    for (int i = 0; i < len; i++) {
+        if (bytes[i] == '"' || bytes[i] == '\\') {
+            printf("\\%c", bytes[i]);
+        } else if (bytes[i] < 0x20) {
+            printf("\\u%04x", bytes[i]);
+        } else {
+            putchar(bytes[i]);
+        }
+    }
+    putchar('"');
+}
+
+/* Prints a payload back as conf.json, returns -1 if it fails its checks */
+static int print_config(const uint8_t *payload, int len)
+{
+    struct ReconfValue value;
+    int end = reconf_check(payload, len);
+    int pos = 1;
+    int res;
+    const char *sep = "";
+
+    if (end < 0) {
+        return -1;
+    }
+
+    putchar('{');
+    while ((res = reconf_next_field(payload, end, &pos, &value)) > 0) {
+        const char *name = reconf_field_name(value.field);
+        if (!name) {
+            continue;
+        }
+
+        printf("%s\"%s\":", sep, name);
+        if (value.is_bytes) {
+            print_json_string(value.bytes, value.len);
+        } else if (value.field == ReconfInvalidateThingsboardAuth || value.field == ReconfInvalidateBackendAuth) {
+            printf("%s", value.number ? "true" : "false");
+        } else {
+            printf("%u", value.number);
+        }
+        sep = ",";
+    }
+    printf("}\n");
+    return res;
+}
+
+static int load_payload(const char *path, uint8_t *payload, int size)
+{
+    char *json = read_file(path);
+    int len;
+
+    if (!json) {
+        return -1;
+    }
+
+    len = encode_config(json, payload, size);
+    free(json);
+
+    if (len < 0) {
+        fprintf(stderr, "%s: not a flat JSON object or too long\n", path);
+    }
+    return len;
+}
+
+/* Symbol for a frame, or -1 if the text doesn't fit a QR code */
+static int render_qr(const char *text, uint8_t *qr)
+{
+    uint8_t temp[qrcodegen_BUFFER_LEN_MAX];
+
+    if (!qrcodegen_encodeText(text, temp, qr, qrcodegen_Ecc_MEDIUM, qrcodegen_VERSION_MIN,
+                              qrcodegen_VERSION_MAX, qrcodegen_Mask_AUTO, false)) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Draws the symbol centred in a white frame of frame_size pixels, as large
+ * as whole pixel modules allow. Returns the module size, 0 if it doesn't fit.
+ */
+static int draw_qr(const uint8_t *qr, uint8_t *frame, int frame_size, int module_px)
+{
+    int size = qrcodegen_getSize(qr);
+    int max_px = frame_size / (size + 2 * QUIET_ZONE);
+    int px = module_px ? module_px : max_px;
+
+    if (px < 1 || px > max_px) {
+        return 0;
+    }
+
+    int origin = (frame_size - size * px) / 2;
+
+    memset(frame, 255, frame_size * frame_size);
+    for (int y = 0; y < size * px; y++) {
+        for (int x = 0; x < size * px; x++) {
+            if (qrcodegen_getModule(qr, x / px, y / px)) {
+                frame[(origin + y) * frame_size + origin + x] = 0;
+            }
+        }
+    }
+    return px;
+}
+
+static int save_pgm(const char *path, const uint8_t *pixels, int w, int h)
+{
+    FILE *f = fopen(path, "wb");
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(f, "P5\n%d %d\n255\n", w, h);
+    fwrite(pixels, 1, w * h, f);
+    fclose(f);
+    return 0;
+}
+
+static uint8_t *load_pgm(const char *path, int *w, int *h)
+{
+    FILE *f = fopen(path, "rb");
+    int maxval;
+    uint8_t *pixels = NULL;
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    if (fscanf(f, "P5 %d %d %d", w, h, &maxval) == 3 && maxval == 255 && fgetc(f) != EOF) {
+        pixels = malloc(*w * *h);
+        if (pixels && fread(pixels, 1, *w * *h, f) != (size_t)(*w * *h)) {
+            free(pixels);
+            pixels = NULL;
+        }
+    }
+
+    if (!pixels) {
+        fprintf(stderr, "%s: not an 8-bit binary PGM\n", path);
+    }
+
+    fclose(f);
+    return pixels;
+}
+
+/*
+ * Scans one grayscale frame and feeds every reconf code found into the
+ * decoder, like qr_task and qr_seen on the device. Returns the number of
+ * codes decoded.
+ */
+static int scan_frame(struct quirc *q, const uint8_t *pixels, int w, int h, bool flip,
+                      struct FountainDecoder *dec)
+{
+    int decoded = 0;
+
+    if (quirc_resize(q, w, h) < 0) {
+        return 0;
+    }
+
+    memcpy(quirc_begin(q, NULL, NULL), pixels, w * h);
+    quirc_end(q);
+
+    for (int i = 0; i < quirc_count(q); i++) {
+        struct quirc_code code;
+        struct quirc_data data;
+
+        quirc_extract(q, i, &code);
+        if (flip) {
+            quirc_flip(&code);
+        }
+        if (quirc_decode(&code, &data) != QUIRC_SUCCESS) {
+            continue;
+        }
+
+        char *text = malloc(data.payload_len + 1);
+        memcpy(text, data.payload, data.payload_len);
+        text[data.payload_len] = '\0';
+        reconf_receive(dec, text);
+        free(text);
+        decoded++;
+    }
+    return decoded;
+}
+
+static int cmd_encode(int argc, char **argv)
+{
+    uint8_t payload[MAX_PAYLOAD];
+    static uint8_t qr[qrcodegen_BUFFER_LEN_MAX];
+    char text[MAX_TEXT], path[1024];
+    int block_size = APP_BLOCK_SIZE;
+    int id = 1;
+    int frames = 0;
+    int module_px = 4;
+    bool print_text = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:i:n:m:t")) != -1) {
+        switch (opt) {
+        case 'b':
+            block_size = atoi(optarg);
+            break;
+        case 'i':
+            id = atoi(optarg);
+            break;
+        case 'n':
+            frames = atoi(optarg);
+            break;
+        case 'm':
+            module_px = atoi(optarg);
+            break;
+        case 't':
+            print_text = true;
+            break;
+        default:
+            return 2;
+        }
+    }
+
+    if (optind + (print_text ? 1 : 2) != argc) {
+        fprintf(stderr, "usage: reconf_cli encode [-b block] [-i id] [-n frames] [-m px] [-t] conf.json outdir\n");
+        return 2;
+    }
+
+    int len = load_payload(argv[optind], payload, sizeof(payload));
+    if (len < 0) {
+        return 1;
+    }
+
+    int k = (len + block_size - 1) / block_size;
+    if (frames == 0) {
+        frames = 2 * k; // the device usually needs k + 2
+    }
+
+    if (!print_text) {
+        mkdir(argv[optind + 1], 0755);
+    }
+
+    for (int seed = 0; seed < frames; seed++) {
+        if (reconf_frame(payload, len, id, block_size, seed, text, sizeof(text)) < 0) {
+            fprintf(stderr, "%d bytes don't fit %d blocks of %d bytes\n", len, FOUNTAIN_MAX_BLOCKS, block_size);
+            return 1;
+        }
+
+        if (print_text) {
+            printf("%s\n", text);
+            continue;
+        }
+
+        if (render_qr(text, qr) < 0) {
+            fprintf(stderr, "frame %d doesn't fit a QR code\n", seed);
+            return 1;
+        }
+
+        int size = (qrcodegen_getSize(qr) + 2 * QUIET_ZONE) * module_px;
+        uint8_t *frame = malloc(size * size);
+        draw_qr(qr, frame, size, module_px);
+        snprintf(path, sizeof(path), "%s/frame_%04d.pgm", argv[optind + 1], seed);
+        int err = save_pgm(path, frame, size, size);
+        free(frame);
+        if (err < 0) {
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "%d byte payload, %d blocks of %d bytes, %d frames\n", len, k, block_size, frames);
+    return 0;
+}
+
+static int cmd_decode(int argc, char **argv)
+{
+    static struct FountainDecoder dec;
+    uint8_t payload[MAX_PAYLOAD + 1];
+    bool flip = false;
+    double elapsed = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f")) != -1) {
+        switch (opt) {
+        case 'f':
+            flip = true;
+            break;
+        default:
+            return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "usage: reconf_cli decode [-f] frame.pgm...\n");
+        return 2;
+    }
+
+    struct quirc *q = quirc_new();
+    if (!q) {
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        int w, h;
+        uint8_t *pixels = load_pgm(argv[i], &w, &h);
+        if (!pixels) {
+            continue;
+        }
+
+        double start = now_ms();
+        scan_frame(q, pixels, w, h, flip, &dec);
+        elapsed += now_ms() - start;
+        free(pixels);
+
+        if (dec.complete) {
+            int len = fountain_payload(&dec, (char *)payload, sizeof(payload));
+            quirc_destroy(q);
+            fprintf(stderr, "complete after %d frames, %.2f ms scanning\n", i - optind + 1, elapsed);
+            if (print_config(payload, len) < 0) {
+                fprintf(stderr, "payload failed its checks\n");
+                return 1;
+            }
+            return 0;
+        }
+    }
+
+    quirc_destroy(q);
+    fprintf(stderr, "incomplete: %d of %d blocks\n", dec.rank, dec.k);
+    return 1;
+}
+
+static uint32_t rng_state = 0x5eed;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int cmd_bench(int argc, char **argv)
+{
+    static const int block_sizes[] = {16, 24, 32, 40, 48, 56, 64};
+    static uint8_t qr[qrcodegen_BUFFER_LEN_MAX];
+    uint8_t payload[MAX_PAYLOAD];
+    char text[MAX_TEXT] = "";
+    int camera_px = 240;
+    int loss = 0;
+    int interval_ms = APP_INTERVAL_MS;
+    int runs = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:l:p:r:")) != -1) {
+        switch (opt) {
+        case 'c':
+            camera_px = atoi(optarg);
+            break;
+        case 'l':
+            loss = atoi(optarg);
+            break;
+        case 'p':
+            interval_ms = atoi(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        default:
+            return 2;
+        }
+    }
+
+    if (optind + 1 != argc || runs < 1 || loss < 0 || loss > 90) {
+        fprintf(stderr, "usage: reconf_cli bench [-c px] [-l loss] [-p ms] [-r runs] conf.json\n");
+        return 2;
+    }
+
+    int len = load_payload(argv[optind], payload, sizeof(payload));
+    if (len < 0) {
+        return 1;
+    }
+
+    struct quirc *q = quirc_new();
+    uint8_t *frame = malloc(camera_px * camera_px);
+    if (!q || !frame) {
+        return 1;
+    }
+
+    printf("%d byte payload, %dx%d frames, %d%% loss, one frame per %d ms, %d runs\n",
+           len, camera_px, camera_px, loss, interval_ms, runs);
+    printf("%5s %3s %4s %7s %8s %7s %10s %9s\n", "block", "k", "text", "version", "module", "frames", "scan ms", "total s");
+
+    for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+        int block_size = block_sizes[b];
+        int k = (len + block_size - 1) / block_size;
+        int version = 0, module_px = 0;
+        int frames_total = 0, scanned = 0, failed_runs = 0;
+        double scan_ms = 0;
+
+        if (k > FOUNTAIN_MAX_BLOCKS) {
+            printf("%5d %3d  too many blocks\n", block_size, k);
+            continue;
+        }
+
+        for (int run = 0; run < runs; run++) {
+            static struct FountainDecoder dec;
+            int id = 1 + run;
+            int frames = 0;
+
+            memset(&dec, 0, sizeof(dec));
+
+            // Give up well past what a person would wait for
+            for (uint32_t seed = 0; !dec.complete && seed < (uint32_t)(8 * k + 16); seed++) {
+                frames++;
+                if ((int)(rng() % 100) < loss) {
+                    continue;
+                }
+
+                reconf_frame(payload, len, id, block_size, seed, text, sizeof(text));
+                if (render_qr(text, qr) < 0 || !(module_px = draw_qr(qr, frame, camera_px, 0))) {
+                    break;
+                }
+                version = (qrcodegen_getSize(qr) - 17) / 4;
+
+                double start = now_ms();
+                scan_frame(q, frame, camera_px, camera_px, false, &dec);
+                scan_ms += now_ms() - start;
+                scanned++;
+            }
+
+            if (dec.complete) {
+                frames_total += frames;
+            } else {
+                failed_runs++;
+            }
+        }
+
+        if (failed_runs == runs) {
+            printf("%5d %3d %4d %7d %6dpx %7s\n", block_size, k, (int)strlen(text), version, module_px, "never");
+            continue;
+        }
+
+        double frames = (double)frames_total / (runs - failed_runs);
+        printf("%5d %3d %4d %7d %6dpx %7.1f %10.2f %9.1f", block_size, k, (int)strlen(text), version, module_px,
+               frames, scanned ? scan_ms / scanned : 0, frames * interval_ms / 1000);
+        if (failed_runs) {
+            printf("  (%d runs never completed)", failed_runs);
+        }
+        printf("\n");
+    }
+
+    free(frame);
+    quirc_destroy(q);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "encode") == 0) {
+        return cmd_encode(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && strcmp(argv[1], "decode") == 0) {
+        return cmd_decode(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return cmd_bench(argc - 1, argv + 1);
+    }
+
+    fprintf(stderr, "usage: reconf_cli encode|decode|bench ...\n");
+    return 2;
+}
@@ -0,0 +1,357 @@
+/*
+ * Checks the reconf codec against what the provisioning app sends: frames
+ * printed from provisioning_app/src/index.js must decode to its payload and
+ * fields, base45 must match the RFC 9285 examples, and bad input must be
+ * refused, not read past: a wrong CRC or version, truncated varints and
+ * lengths, text without RECONF_PREFIX or outside the base45 alphabet.
+ * Fields the device doesn't know come through with no name for the caller
+ * to skip. A session whose payload arrives whole but fails its checks, a
+ * bad CRC or a string longer than QRInfo holds, must be given up: the app
+ * loops the same frames, so they are ignored instead of decoded again.
+ *
+ *   reconf_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reconf.h"
+
+#define MAX_PAYLOAD (FOUNTAIN_MAX_BLOCKS * FOUNTAIN_MAX_BLOCK_SIZE)
+
+#define CHECK(cond)                                                   \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                  \
+        }                                                             \
+    } while (0)
+
+/*
+ * reconf_encode() of
+ * {wifi_ssid: "Aula 12 - planta baja", wifi_psw: "s3cr3t", device_name: "sala-ñ", space_id: 300,
+ *  invalidate_backend_auth: true, totp_form_base_url: "https://asistencia.example/qr"}
+ * and its frames for session 0x1234, printed with node
+ */
+static const char app_payload_hex[] =
+    "01031541756c61203132202d20706c616e74612062616a6105067333637233740b0773616c612dc3b10cac021601131d"
+    "68747470733a2f2f6173697374656e6369612e6578616d706c652f7172b030d8ab";
+static const char *const app_frame_seed0 =
+    "RECONF:%60KC2 AA000Y50-U20%EOCC*96234O44PVDG/DOCCUJC8KDQS0GPEXPCWM6XH1HQEPVDFZ59HMOXL8Z2XI2A9D";
+static const char *const app_frame_seed1 =
+    "RECONF:%60KC2 AAV50IWENPEJ/5HEC+ED7WE:.DMED.%5$9FQ$DTVD+:5KME*76 RL000000000000000000000000000";
+static const char *const app_frame_seed2 =
+    "RECONF:%60KC2 AAHB07%E0/CMIB%1037BLTA7*9KS0L48U83W+1AY0QG5R80/PADCJXH1HQEPVDFZ59HMOXL8Z2XI2A9D";
+static const char *const app_frame_seed7 =
+    "RECONF:%60KC2 AA$*07%E0/CMIB%1037BLTA7*9KS0L48U83W+1AY0QG5R80/PADCJXH1HQEPVDFZ59HMOXL8Z2XI2A9D";
+
+static int from_hex(const char *hex, uint8_t *buf)
+{
+    int len = strlen(hex) / 2;
+    for (int i = 0; i < len; i++) {
+        unsigned byte;
+        sscanf(&hex[2 * i], "%2x", &byte);
+        buf[i] = byte;
+    }
+    return len;
+}
+
+static void check_base45(void)
+{
+    static const struct {
+        const char *bytes;
+        const char *text;
+    } vectors[] = {
+        {"AB", "BB8"},
+        {"Hello!!", "%69 VD92EX0"},
+        {"base-45", "UJCLQE7W581"},
+        {"ietf!", "QED8WEX0"},
+    };
+    uint8_t buf[32];
+    char text[32];
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        int len = strlen(vectors[i].bytes);
+        CHECK(base45_encode((const uint8_t *)vectors[i].bytes, len, text, sizeof(text)) == (int)strlen(vectors[i].text));
+        CHECK(strcmp(text, vectors[i].text) == 0);
+        CHECK(base45_decode(vectors[i].text, buf, sizeof(buf)) == len);
+        CHECK(memcmp(buf, vectors[i].bytes, len) == 0);
+    }
+
+    CHECK(base45_decode("GGW", buf, sizeof(buf)) < 0); /* 65535 + 1 */
+    CHECK(base45_decode("BB8A", buf, sizeof(buf)) < 0); /* a lone trailing digit */
+    CHECK(base45_decode("bb8", buf, sizeof(buf)) < 0);
+    CHECK(base45_decode("BB8", buf, 1) < 0);
+    CHECK(base45_encode((const uint8_t *)"AB", 2, text, 3) < 0); /* no room for the nul */
+}
+
+static void check_app_frames(void)
+{
+    struct FountainDecoder dec = {0};
+    uint8_t expected[MAX_PAYLOAD];
+    char payload[MAX_PAYLOAD + 1];
+    int expected_len = from_hex(app_payload_hex, expected);
+
+    /* seed 7 selects the same blocks as seed 2 */
+    CHECK(reconf_receive(&dec, app_frame_seed2) == ReconfAccepted);
+    CHECK(dec.id == 0x1234 && dec.k == 2 && dec.len == expected_len && dec.rank == 1);
+    CHECK(reconf_receive(&dec, app_frame_seed7) == ReconfAccepted);
+    CHECK(dec.rank == 1);
+    CHECK(reconf_receive(&dec, app_frame_seed1) == ReconfComplete);
+    CHECK(reconf_receive(&dec, app_frame_seed0) == ReconfDuplicate);
+
+    CHECK(fountain_payload(&dec, payload, sizeof(payload)) == expected_len);
+    CHECK(memcmp(payload, expected, expected_len) == 0);
+
+    /* The encoder writes the same frames */
+    char text[256];
+    int len = reconf_frame(expected, expected_len, 0x1234, 50, 0, text, sizeof(text));
+    CHECK(len == (int)strlen(app_frame_seed0));
+    CHECK(strcmp(text, app_frame_seed0) == 0);
+
+    const uint8_t *p = (const uint8_t *)payload;
+    int end = reconf_check(p, expected_len);
+    CHECK(end == expected_len - 4);
+
+    static const struct {
+        int field;
+        const char *text;
+        uint32_t number;
+    } fields[] = {
+        {ReconfWifiSsid, "Aula 12 - planta baja", 0},
+        {ReconfWifiPsw, "s3cr3t", 0},
+        {ReconfDeviceName, "sala-\xc3\xb1", 0},
+        {ReconfSpaceId, NULL, 300},
+        {ReconfInvalidateBackendAuth, NULL, 1},
+        {ReconfTotpFormBaseUrl, "https://asistencia.example/qr", 0},
+    };
+    struct ReconfValue value;
+    int pos = 1;
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        CHECK(reconf_next_field(p, end, &pos, &value) == 1);
+        CHECK(value.field == fields[i].field);
+        CHECK(value.is_bytes == reconf_field_is_bytes(value.field));
+        if (fields[i].text) {
+            CHECK(value.len == (int)strlen(fields[i].text));
+            CHECK(memcmp(value.bytes, fields[i].text, value.len) == 0);
+        } else {
+            CHECK(value.number == fields[i].number);
+        }
+    }
+    CHECK(reconf_next_field(p, end, &pos, &value) == 0);
+}
+
+static void check_bad_crc(void)
+{
+    uint8_t payload[MAX_PAYLOAD];
+    int len = from_hex(app_payload_hex, payload);
+
+    CHECK(reconf_check(payload, len) == len - 4);
+    for (int i = 0; i < len; i++) {
+        payload[i] ^= 0x10;
+        CHECK(reconf_check(payload, len) < 0);
+        payload[i] ^= 0x10;
+    }
+    CHECK(reconf_check(payload, len - 1) < 0);
+    CHECK(reconf_check(payload, 4) < 0);
+}
+
+/* A field id the device doesn't have, either wire type, amid known ones */
+static void check_unknown_field(void)
+{
+    struct ReconfWriter writer;
+    struct ReconfValue value;
+    uint8_t buf[64];
+    int pos = 1;
+
+    reconf_writer_init(&writer, buf, sizeof(buf));
+    reconf_put_number(&writer, 40, 123456);
+    reconf_put_bytes(&writer, 41, (const uint8_t *)"future", 6);
+    reconf_put_number(&writer, ReconfSpaceId, 7);
+    int len = reconf_writer_finish(&writer);
+    CHECK(len > 0);
+
+    int end = reconf_check(buf, len);
+    CHECK(end > 0);
+
+    CHECK(reconf_next_field(buf, end, &pos, &value) == 1);
+    CHECK(value.field == 40 && !value.is_bytes && value.number == 123456);
+    CHECK(reconf_field_name(value.field) == NULL);
+    CHECK(reconf_next_field(buf, end, &pos, &value) == 1);
+    CHECK(value.field == 41 && value.is_bytes && value.len == 6);
+    CHECK(reconf_field_name(value.field) == NULL);
+    CHECK(reconf_next_field(buf, end, &pos, &value) == 1);
+    CHECK(value.field == ReconfSpaceId && value.number == 7);
+    CHECK(strcmp(reconf_field_name(value.field), "space_id") == 0);
+    CHECK(reconf_next_field(buf, end, &pos, &value) == 0);
+
+    /* No room: the writer says so instead of cutting the payload short */
+    reconf_writer_init(&writer, buf, 8);
+    reconf_put_bytes(&writer, ReconfWifiSsid, (const uint8_t *)"too long", 8);
+    CHECK(reconf_writer_finish(&writer) < 0);
+}
+
+static void check_truncated(void)
+{
+    struct ReconfValue value;
+    static const struct {
+        uint8_t bytes[8];
+        int len;
+    } cases[] = {
+        {{RECONF_VERSION, 0x8c}, 2},                        /* key varint cut */
+        {{RECONF_VERSION, 0x0c}, 2},                        /* no value */
+        {{RECONF_VERSION, 0x0c, 0xac}, 3},                  /* value varint cut */
+        {{RECONF_VERSION, 0x0c, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01}, 8}, /* over 5 bytes */
+        {{RECONF_VERSION, 0x03, 0x05, 'a', 'b'}, 5},        /* length past the end */
+        {{RECONF_VERSION, 0x03, 0xff, 0xff, 0xff, 0xff, 0x0f}, 7}, /* length wraps */
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int pos = 1;
+        CHECK(reconf_next_field(cases[i].bytes, cases[i].len, &pos, &value) < 0);
+    }
+}
+
+static void check_rejected_text(void)
+{
+    struct FountainDecoder dec = {0};
+    const char *body = app_frame_seed0 + strlen(RECONF_PREFIX);
+    char text[256];
+
+    CHECK(reconf_receive(&dec, body) == ReconfRejected);
+    snprintf(text, sizeof(text), "reconf:%s", body);
+    CHECK(reconf_receive(&dec, text) == ReconfRejected);
+    snprintf(text, sizeof(text), "RECONF%s", body);
+    CHECK(reconf_receive(&dec, text) == ReconfRejected);
+    CHECK(reconf_receive(&dec, "RECONF:") == ReconfRejected);
+    CHECK(reconf_receive(&dec, "RECONF:%60KC2 AA") == ReconfRejected); /* header only */
+
+    snprintf(text, sizeof(text), "%s", app_frame_seed0);
+    text[strlen(RECONF_PREFIX) + 5] = 'a';
+    CHECK(reconf_receive(&dec, text) == ReconfRejected);
+    CHECK(dec.k == 0);
+
+    /* Another version */
+    uint8_t packet[RECONF_PACKET_HEADER_SIZE + 1] = {RECONF_VERSION + 1, 0x34, 0x12, 1, 1, 0, 0, 0, 'x'};
+    memcpy(text, RECONF_PREFIX, strlen(RECONF_PREFIX));
+    base45_encode(packet, sizeof(packet), text + strlen(RECONF_PREFIX), sizeof(text) - strlen(RECONF_PREFIX));
+    CHECK(reconf_receive(&dec, text) == ReconfRejected);
+    packet[0] = RECONF_VERSION;
+    base45_encode(packet, sizeof(packet), text + strlen(RECONF_PREFIX), sizeof(text) - strlen(RECONF_PREFIX));
+    CHECK(reconf_receive(&dec, text) == ReconfComplete);
+
+    /* k beyond the decoder */
+    packet[3] = FOUNTAIN_MAX_BLOCKS + 1;
+    base45_encode(packet, sizeof(packet), text + strlen(RECONF_PREFIX), sizeof(text) - strlen(RECONF_PREFIX));
+    CHECK(reconf_receive(&dec, text) == ReconfRejected);
+}
+
+/* Strings up to reconf_field_max_len pass, one byte more fails the payload */
+static void check_field_limits(void)
+{
+    struct ReconfWriter writer;
+    uint8_t buf[256];
+    char text[128];
+
+    CHECK(reconf_field_max_len(ReconfDeviceName) == RECONF_DEVICE_NAME_SIZE - 1);
+    CHECK(reconf_field_max_len(ReconfWifiSsid) == RECONF_WIFI_SIZE - 1);
+    CHECK(reconf_field_max_len(ReconfSpaceId) == 0);
+    CHECK(reconf_field_max_len(40) == 0);
+
+    memset(text, 'n', sizeof(text));
+    for (int extra = 0; extra <= 1; extra++) {
+        reconf_writer_init(&writer, buf, sizeof(buf));
+        reconf_put_bytes(&writer, ReconfDeviceName, (const uint8_t *)text, RECONF_DEVICE_NAME_SIZE - 1 + extra);
+        int len = reconf_writer_finish(&writer);
+        CHECK(reconf_check(buf, len) > 0);
+        CHECK((reconf_validate(buf, len) > 0) == !extra);
+    }
+
+    /* Unknown fields aren't limited, the decoder skips them */
+    reconf_writer_init(&writer, buf, sizeof(buf));
+    reconf_put_bytes(&writer, 41, (const uint8_t *)text, sizeof(text));
+    CHECK(reconf_validate(buf, reconf_writer_finish(&writer)) > 0);
+
+    /* Nor a known id sent with the other wire type */
+    reconf_writer_init(&writer, buf, sizeof(buf));
+    reconf_put_bytes(&writer, ReconfSpaceId, (const uint8_t *)text, sizeof(text));
+    CHECK(reconf_validate(buf, reconf_writer_finish(&writer)) > 0);
+}
+
+/*
+ * Loops the frames of one session through reconf_receive_valid like the app
+ * does, from seed 0 for several rounds. Returns what the packet that finished
+ * the session got, and checks nothing after it restarted the decoder.
+ */
+static enum ReconfReceiveResult loop_session(struct FountainDecoder *dec, const uint8_t *payload, int len, int id)
+{
+    enum ReconfReceiveResult finished = ReconfAccepted;
+    char text[256];
+
+    for (uint32_t seed = 0; seed < 200; seed++) {
+        CHECK(reconf_frame(payload, len, id, 50, seed, text, sizeof(text)) > 0);
+        enum ReconfReceiveResult res = reconf_receive_valid(dec, text);
+
+        if (finished == ReconfAccepted) {
+            CHECK(res == ReconfAccepted || res == ReconfComplete || res == ReconfInvalid);
+            if (res != ReconfAccepted) {
+                finished = res;
+            }
+        } else {
+            /* Given up or applied, either way the decoder is left alone */
+            CHECK(res == ReconfDuplicate);
+            CHECK(dec->complete && dec->id == id && dec->rank == dec->k);
+        }
+    }
+    CHECK(finished != ReconfAccepted);
+    return finished;
+}
+
+static void check_invalid_session(void)
+{
+    struct FountainDecoder dec = {0};
+    struct ReconfWriter writer;
+    uint8_t payload[MAX_PAYLOAD];
+    char name[RECONF_DEVICE_NAME_SIZE + 1];
+    int len = from_hex(app_payload_hex, payload);
+
+    /* Decodes whole, then fails its CRC */
+    payload[len - 1] ^= 0x01;
+    CHECK(loop_session(&dec, payload, len, 0x0101) == ReconfInvalid);
+    payload[len - 1] ^= 0x01;
+
+    /* Another version */
+    payload[0] = RECONF_VERSION + 1;
+    CHECK(loop_session(&dec, payload, len, 0x0102) == ReconfInvalid);
+    payload[0] = RECONF_VERSION;
+
+    /* A device name one byte past what QRInfo holds */
+    memset(name, 'n', sizeof(name));
+    reconf_writer_init(&writer, payload, sizeof(payload));
+    reconf_put_bytes(&writer, ReconfWifiSsid, (const uint8_t *)"Aula 12", 7);
+    reconf_put_bytes(&writer, ReconfDeviceName, (const uint8_t *)name, RECONF_DEVICE_NAME_SIZE);
+    reconf_put_number(&writer, ReconfSpaceId, 300);
+    int long_len = reconf_writer_finish(&writer);
+    CHECK(long_len > 50); /* more than one block */
+    CHECK(loop_session(&dec, payload, long_len, 0x0103) == ReconfInvalid);
+
+    /* The app starts over with the name fixed: a new session, applied */
+    len = from_hex(app_payload_hex, payload);
+    CHECK(loop_session(&dec, payload, len, 0x0104) == ReconfComplete);
+}
+
+int main(void)
+{
+    check_base45();
+    check_app_frames();
+    check_bad_crc();
+    check_unknown_field();
+    check_truncated();
+    check_rejected_text();
+    check_field_limits();
+    check_invalid_session();
+    printf("reconf codec ok\n");
+    return 0;
+}
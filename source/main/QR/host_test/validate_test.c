@@ -0,0 +1,199 @@
+/*
+ * Checks qr_validate_payload on what the camera may decode: the formats an
+ * attendance code comes in, and payloads that don't fit the Found_TUI_qr
+ * buffer they are copied into. Those must be rejected whatever the rules
+ * allow, trailing newlines counted, and so must an oversized TOTP form link,
+ * which skips the other checks. The rules a device starts with must let
+ * attendance codes through and stop the codes found on everything else.
+ *
+ *   validate_test
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qr_validate.h"
+
+#define QUIRC_MAX_PAYLOAD 8896
+
+#define CHECK(cond)                                                   \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                  \
+        }                                                             \
+    } while (0)
+
+static char payload[QUIRC_MAX_PAYLOAD + 1];
+
+/* len copies of c, then tail */
+static const char *repeat(char c, int len, const char *tail)
+{
+    memset(payload, c, len);
+    strcpy(&payload[len], tail);
+    return payload;
+}
+
+static struct QRRules rules(enum QRFormat format, int max_len, bool accept_totp_form)
+{
+    struct QRRules r = {
+        .prefix = "",
+        .min_len = 1,
+        .max_len = max_len,
+        .format = format,
+        .accept_totp_form = accept_totp_form,
+    };
+    return r;
+}
+
+static void check_formats(void)
+{
+    struct QRRules text = rules(QRFormatText, QR_PAYLOAD_MAX_SIZE - 1, false);
+    struct QRRules b64url = rules(QRFormatBase64url, QR_PAYLOAD_MAX_SIZE - 1, false);
+    struct QRRules jwe = rules(QRFormatJwe, QR_PAYLOAD_MAX_SIZE - 1, false);
+    struct QRRules prefixed = rules(QRFormatText, QR_PAYLOAD_MAX_SIZE - 1, false);
+    strcpy(prefixed.prefix, "tui:");
+
+    CHECK(qr_validate_payload(&text, "alumno 12345\n") == QRValid);
+    CHECK(qr_validate_payload(&text, "\n") == QRBadLength);
+    CHECK(qr_validate_payload(&text, "say \"hi\"") == QRBadFormat);
+    CHECK(qr_validate_payload(&b64url, "eyJhbGciOiJkaXIifQ") == QRValid);
+    CHECK(qr_validate_payload(&b64url, "eyJh+GciOiJkaXIifQ") == QRBadFormat);
+    CHECK(qr_validate_payload(&b64url, "abcde") == QRBadFormat);
+    CHECK(qr_validate_payload(&jwe, "eyJhbGciOiJkaXIifQ..aXY.Y2lwaGVy.dGFn\r\n") == QRValid);
+    CHECK(qr_validate_payload(&jwe, "eyJhbGciOiJkaXIifQ..aXY.Y2lwaGVy") == QRBadFormat);
+    CHECK(qr_validate_payload(&jwe, "aaaa..aXY.Y2lwaGVy.dGFn") == QRBadFormat);
+    CHECK(qr_validate_payload(&prefixed, "tui:12345") == QRValid);
+    CHECK(qr_validate_payload(&prefixed, "12345") == QRBadPrefix);
+}
+
+static void check_length(void)
+{
+    struct QRRules r = rules(QRFormatText, QR_PAYLOAD_MAX_SIZE - 1, false);
+
+    CHECK(qr_validate_payload(&r, repeat('a', QR_PAYLOAD_MAX_SIZE - 1, "")) == QRValid);
+    CHECK(qr_validate_payload(&r, repeat('a', QR_PAYLOAD_MAX_SIZE - 2, "\n")) == QRValid);
+    CHECK(qr_validate_payload(&r, repeat('a', QR_PAYLOAD_MAX_SIZE, "")) == QRBadLength);
+
+    /* The rules' limit ignores trailing newlines, the buffer's doesn't */
+    CHECK(qr_validate_payload(&r, repeat('a', QR_PAYLOAD_MAX_SIZE - 1, "\n")) == QRBadLength);
+    CHECK(qr_validate_payload(&r, repeat('a', QR_PAYLOAD_MAX_SIZE - 1, "\r\n")) == QRBadLength);
+
+    /* A max_len from the shared attributes above the buffer changes nothing */
+    r.max_len = QUIRC_MAX_PAYLOAD;
+    CHECK(qr_validate_payload(&r, repeat('a', QR_PAYLOAD_MAX_SIZE, "")) == QRBadLength);
+    CHECK(qr_validate_payload(&r, repeat('a', QUIRC_MAX_PAYLOAD, "")) == QRBadLength);
+
+    r.max_len = 10;
+    CHECK(qr_validate_payload(&r, repeat('a', 10, "\n")) == QRValid);
+    CHECK(qr_validate_payload(&r, repeat('a', 11, "")) == QRBadLength);
+}
+
+static void check_totp_form(void)
+{
+    struct QRRules r = rules(QRFormatBase64url, 20, true);
+    const char *link = "https://asistencia.example/qr?totp=123456&espacioId=10&dispositivoId=3";
+    int link_len = strlen(link);
+
+    /* Let through past the rules, which it doesn't meet */
+    CHECK(qr_validate_payload(&r, link) == QRValid);
+    CHECK(qr_validate_payload(&r, "https://asistencia.example/qr?totp=12345&espacioId=10&dispositivoId=3") ==
+          QRBadLength);
+    r.accept_totp_form = false;
+    CHECK(qr_validate_payload(&r, link) == QRBadLength);
+    r.accept_totp_form = true;
+
+    /* Long ids or a long base up to the buffer and past it */
+    const char *id = repeat('7', QR_PAYLOAD_MAX_SIZE - 1 - link_len, "");
+    char form[QUIRC_MAX_PAYLOAD + 64];
+    snprintf(form, sizeof(form), "%s%s", link, id);
+    CHECK((int)strlen(form) == QR_PAYLOAD_MAX_SIZE - 1);
+    CHECK(qr_validate_payload(&r, form) == QRValid);
+    strcat(form, "7");
+    CHECK(qr_validate_payload(&r, form) == QRBadLength);
+
+    snprintf(form, sizeof(form), "%s%s", link, repeat('7', QUIRC_MAX_PAYLOAD - link_len, ""));
+    CHECK(qr_validate_payload(&r, form) == QRBadLength);
+
+    snprintf(form, sizeof(form), "https://%s/?totp=123456&espacioId=1&dispositivoId=1",
+             repeat('a', QR_PAYLOAD_MAX_SIZE, ""));
+    CHECK(qr_validate_payload(&r, form) == QRBadLength);
+}
+
+static void base64(const char *in, char *out)
+{
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    int len = strlen(in);
+
+    for (int i = 0; i < len; i += 3) {
+        int n = len - i < 3 ? len - i : 3;
+        uint32_t v = (uint8_t)in[i] << 16 | (n > 1 ? (uint8_t)in[i + 1] << 8 : 0) | (n > 2 ? (uint8_t)in[i + 2] : 0);
+        for (int j = 0; j < 4; j++) {
+            *out++ = j <= n ? digits[(v >> (18 - 6 * j)) & 63] : '=';
+        }
+    }
+    *out = '\0';
+}
+
+static void check_defaults(void)
+{
+    struct QRRules r = {
+        .prefix = QR_DEFAULT_PREFIX,
+        .min_len = QR_DEFAULT_MIN_LEN,
+        .max_len = QR_DEFAULT_MAX_LEN,
+        .format = QR_DEFAULT_FORMAT,
+        .accept_totp_form = QR_DEFAULT_ACCEPT_TOTP_FORM,
+    };
+    /* {"alg":"dir","enc":"A128GCM"}, a 96 bit IV, one byte, a 128 bit tag */
+    const char *jwe = "eyJhbGciOiJkaXIiLCJlbmMiOiJBMTI4R0NNIn0..aXZpdml2aXZpdml2.Yw.dGFndGFndGFndGFndGFndA";
+    char wrapped[256];
+
+    base64(jwe, wrapped);
+    CHECK(strlen(wrapped) == 112);
+
+    /* Let through: the TOTP form links and a base64 wrapped JWE, with the app's newline */
+    CHECK(qr_validate_payload(&r, "https://tbm-asistencia.dev.fdi.ucm.es/api/auth/login?totp=123456&espacioId=10"
+                                  "&dispositivoId=3") == QRValid);
+    CHECK(qr_validate_payload(&r, "http://a?totp=000000&espacioId=1&dispositivoId=1") == QRValid);
+    CHECK(qr_validate_payload(&r, wrapped) == QRValid);
+    strcat(wrapped, "\n");
+    CHECK(qr_validate_payload(&r, wrapped) == QRValid);
+
+    /* Stopped: product barcodes, Wi-Fi and contact codes, short text */
+    CHECK(qr_validate_payload(&r, "8410076472885") == QRBadLength);
+    CHECK(qr_validate_payload(&r, "WIFI:S:aula-3;T:WPA;P:contrasena;;") == QRBadLength);
+    CHECK(qr_validate_payload(&r, "BEGIN:VCARD\nVERSION:3.0\nFN:Secretaria\nEND:VCARD") == QRBadLength);
+    CHECK(qr_validate_payload(&r, "alumno 12345") == QRBadLength);
+
+    /* URLs that aren't the TOTP form, long ones fail the JWE check, the rest its length */
+    CHECK(qr_validate_payload(&r, "https://www.example.com/productos/cafe-molido-natural-250g?utm_source=qr"
+                                  "&utm_medium=envase&utm_campaign=2024") == QRBadFormat);
+    CHECK(qr_validate_payload(&r, "ftp://tbm-asistencia.dev.fdi.ucm.es/api/auth/login?totp=123456&espacioId=10"
+                                  "&dispositivoId=3") == QRBadLength);
+    CHECK(qr_validate_payload(&r, "https://tbm-asistencia.dev.fdi.ucm.es/api/auth/login?totp=1234567&espacioId=10"
+                                  "&dispositivoId=3") == QRBadLength);
+
+    /* A JWE that isn't wrapped, or base64 of something else */
+    const char *bare = "eyJhbGciOiJkaXIiLCJlbmMiOiJBMTI4R0NNIn0..aXZpdml2aXZpdml2.YWxndW5vcyBieXRlcyBtYXMgbGFyZ29z."
+                       "dGFndGFndGFndGFndGFndA";
+    CHECK((int)strlen(bare) >= QR_DEFAULT_MIN_LEN);
+    CHECK(qr_validate_payload(&r, bare) == QRBadFormat);
+    CHECK(qr_validate_payload(&r, repeat('Q', 120, "")) == QRBadFormat);
+    base64("<html><body>Menu del dia: lentejas, merluza, flan. Precio 9,50 euros</body></html>", wrapped);
+    CHECK(qr_validate_payload(&r, wrapped) == QRBadFormat);
+
+    /* and nothing past the buffer */
+    CHECK(qr_validate_payload(&r, repeat('Q', QR_PAYLOAD_MAX_SIZE, "")) == QRBadLength);
+}
+
+int main(void)
+{
+    check_defaults();
+    check_formats();
+    check_length();
+    check_totp_form();
+    printf("qr_validate_payload ok\n");
+    return 0;
+}
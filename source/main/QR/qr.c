@@ -10,6 +10,7 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
 #include "driver/spi_master.h"
 #include "driver/sdmmc_host.h"
 #include "freertos/FreeRTOS.h"
@@ -60,48 +61,220 @@ static void rgb565_to_grayscale_buf(const uint8_t *src, uint8_t *dst, int qr_wid
     }
 }
 
+#define QR_STATS_LOG_PERIOD 100 // frames
+#define QR_BAND_TIMEOUT pdMS_TO_TICKS(1000)
+// The camera task copies frames in on core 0 at a higher priority, this task
+// works through the bands on the other core as they arrive
+#define QR_TASK_CORE 1
+#define QR_TASK_PRIORITY 1
+
+static struct QRStats qr_stats = {0};
+
+void qr_get_stats(struct QRStats *stats)
+{
+    memcpy(stats, &qr_stats, sizeof(struct QRStats));
+}
+
+void qr_place(struct quirc *qr, uint32_t image_caps, uint32_t work_caps)
+{
+    quirc_set_caps(qr, QUIRC_BUFFER_IMAGE, image_caps);
+    quirc_set_caps(qr, QUIRC_BUFFER_PIXELS, work_caps);
+    quirc_set_caps(qr, QUIRC_BUFFER_REGIONS, work_caps);
+    quirc_set_caps(qr, QUIRC_BUFFER_CAPSTONES, work_caps);
+    quirc_set_caps(qr, QUIRC_BUFFER_GRIDS, work_caps);
+    quirc_set_caps(qr, QUIRC_BUFFER_FLOOD_FILL, work_caps);
+    quirc_set_caps(qr, QUIRC_BUFFER_FINDER_HITS, work_caps);
+}
+
+#define QR_PLACEMENT_BENCH_RUNS 10
+
+struct QRPlacement
+{
+    const char *name;
+    uint32_t image_caps;
+    uint32_t work_caps;
+};
+
+static const struct QRPlacement qr_placements[] = {
+    {"all PSRAM", MALLOC_CAP_SPIRAM, MALLOC_CAP_SPIRAM},
+    {"image PSRAM, work SRAM", MALLOC_CAP_SPIRAM, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT},
+    {"all SRAM", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT},
+};
+
+static const char *qr_memory_name(const void *ptr)
+{
+    return esp_ptr_external_ram(ptr) ? "PSRAM" : "SRAM";
+}
+
+// Runs the full recognition on one grayscale frame with every buffer placement
+// and logs the time per frame, so the cost of each placement is measured on
+// the real hardware. Each placement gets a throwaway recognizer.
+static void qr_placement_benchmark(const uint8_t *gray)
+{
+    for (size_t p = 0; p < sizeof(qr_placements) / sizeof(qr_placements[0]); p++)
+    {
+        const struct QRPlacement *placement = &qr_placements[p];
+        struct quirc *qr = quirc_new();
+        if (qr == NULL)
+        {
+            ESP_LOGE(TAG, "placement benchmark: out of memory");
+            return;
+        }
+
+        qr_place(qr, placement->image_caps, placement->work_caps);
+        if (quirc_resize(qr, IMG_WIDTH, IMG_HEIGHT) < 0)
+        {
+            ESP_LOGE(TAG, "placement %s: out of memory", placement->name);
+            quirc_destroy(qr);
+            continue;
+        }
+
+        int64_t elapsed = 0;
+        for (int run = 0; run < QR_PLACEMENT_BENCH_RUNS; run++)
+        {
+            memcpy(quirc_begin(qr, NULL, NULL), gray, IMG_WIDTH * IMG_HEIGHT);
+
+            int64_t start = esp_timer_get_time();
+            quirc_end(qr);
+            for (int i = 0; i < quirc_count(qr); i++)
+            {
+                struct quirc_code code = {};
+                struct quirc_data qr_data = {};
+                quirc_extract(qr, i, &code);
+                quirc_flip(&code);
+                quirc_decode(&code, &qr_data);
+            }
+            elapsed += esp_timer_get_time() - start;
+        }
+
+        ESP_LOGI(TAG, "placement %s: %.2f ms/frame (image in %s, regions in %s)", placement->name,
+                 elapsed / 1000.0 / QR_PLACEMENT_BENCH_RUNS, qr_memory_name(qr->image), qr_memory_name(qr->regions));
+        quirc_destroy(qr);
+    }
+}
+
+// Frees a frame without reading it. The camera task copies into a frame after
+// handing it over, so it is only freed once the copy is done, the slot could be
+// claimed again while that copy is still writing into it otherwise.
+static void qr_frame_release(struct meta_frame *mf)
+{
+    meta_frame_wait_rows(mf, IMG_HEIGHT, portMAX_DELAY);
+    meta_frame_free(mf);
+}
+
 static void qr_task(void *arg)
 {
     struct QRConf *conf = arg;
 
     struct quirc *qr = conf->qr;
 
+    // Benchmark the buffer placements on the first camera frame
+    struct meta_frame *first;
+    if (xQueueReceive(conf->to_qr_queue, &first, portMAX_DELAY) == pdPASS)
+    {
+        uint8_t *gray = quirc_begin(qr, NULL, NULL);
+        meta_frame_wait_rows(first, IMG_HEIGHT, portMAX_DELAY);
+        rgb565_to_grayscale_buf(first->buf, gray, IMG_WIDTH, IMG_HEIGHT);
+        meta_frame_free(first);
+        qr_placement_benchmark(gray);
+    }
+
+    // Whether the next frame is scanned for light on dark codes. Frames without a valid
+    // grid alternate, so such codes are found a frame late and an empty view costs nothing.
+    bool inverted = false;
+
     ESP_LOGI(TAG, "Processing task ready");
     while (1)
     {
+        struct meta_frame *mf;
+
+        // Wait for the camera task to hand a frame over, which it does before copying
+        // it in, so this task starts on the first band while the rest is copied. The
+        // camera task paces the frames.
+        if (xQueueReceive(conf->to_qr_queue, &mf, portMAX_DELAY) != pdPASS)
+        {
+            continue;
+        }
 
-        vTaskDelay(get_task_delay());
         if (is_ota_running())
         {
+            qr_frame_release(mf);
             continue;
         }
 
-        struct meta_frame *mf;
+        quirc_set_inverted(qr, inverted);
         uint8_t *qr_buf = quirc_begin(qr, NULL, NULL);
 
-        // Get the next frame from the queue
-        int res = xQueueReceive(conf->to_qr_queue, &mf, 0);
-        if (res != pdPASS)
+        // Convert the frame to grayscale band by band as the camera task copies it in,
+        // thresholding and scanning each band for finder patterns right away. We could
+        // have asked the camera for a grayscale frame, but then the image on the display
+        // would be grayscale too.
+        int rows = 0;
+        while (rows < IMG_HEIGHT)
         {
-            continue;
+            int ready = meta_frame_wait_rows(mf, rows + 1, QR_BAND_TIMEOUT);
+            if (ready <= rows)
+            {
+                break;
+            }
+
+            rgb565_to_grayscale_buf(&mf->buf[rows * IMG_WIDTH * 2], &qr_buf[rows * IMG_WIDTH], IMG_WIDTH, ready - rows);
+            quirc_feed(qr, ready - rows);
+            rows = ready;
         }
 
-        // Convert the frame to grayscale. We could have asked the camera for a grayscale frame,
-        // but then the image on the display would be grayscale too.
-        rgb565_to_grayscale_buf(mf->buf, qr_buf, IMG_WIDTH, IMG_HEIGHT);
+        if (rows < IMG_HEIGHT)
+        {
+            ESP_LOGE(TAG, "Frame stalled at row %d", rows);
+            qr_frame_release(mf);
+            continue;
+        }
 
         // Return the frame buffer to the camera driver ASAP to avoid DMA errors
         meta_frame_free(mf);
 
-        quirc_end(qr);
+        quirc_end_stream(qr);
         int count = quirc_count(qr);
+
+        struct quirc_stream_stats stream;
+        quirc_get_stream_stats(qr, &stream);
+        qr_stats.rethresholded = stream.rethresholded;
+        qr_stats.finder_hits_dropped = stream.finder_hits_dropped;
         quirc_decode_error_t err = QUIRC_ERROR_DATA_UNDERFLOW;
 
-        // If a QR code was detected, try to decode it:
-        for (int i = 0; i < count; i++)
+        qr_stats.frames++;
+        qr_stats.grids += count;
+
+        // If QR codes were detected, try to decode them, most promising first. Codes are
+        // shown one at a time, so once one decodes the rest are usually clutter.
+        int order[QUIRC_MAX_GRIDS];
+        int ranked = quirc_rank(qr, order, QUIRC_MAX_GRIDS);
+        bool stop_after_first = get_qr_stop_after_first();
+        bool decoded = false;
+        int validated = 0;
+
+        for (int n = 0; n < ranked; n++)
         {
+            int i = order[n];
+
+            if (decoded && stop_after_first)
+            {
+                qr_stats.skipped += ranked - n;
+                break;
+            }
+
+            // Textured backgrounds produce plenty of fake capstone triples, check the
+            // timing and format cells before paying for the full extract and decode
+            if (quirc_validate(qr, i, true) != QUIRC_SUCCESS)
+            {
+                qr_stats.rejected_early++;
+                continue;
+            }
+            validated++;
+
             struct quirc_code code = {};
             struct quirc_data qr_data = {};
+            int64_t start = esp_timer_get_time();
             // Extract raw QR code binary data (values of black/white modules)
             quirc_extract(qr, i, &code);
             quirc_flip(&code);
@@ -110,10 +283,16 @@ static void qr_task(void *arg)
             err = quirc_decode(&code, &qr_data);
             if (err != 0)
             {
-                ESP_LOGE(TAG, "QR err: %d, %s", err, quirc_strerror(err));
+                qr_stats.decode_failed++;
+                qr_stats.losing_us += esp_timer_get_time() - start;
+                ESP_LOGE(TAG, "QR err: %d, %s (quality %d)", err, quirc_strerror(err), quirc_grid_quality(qr, i));
             }
             else
             {
+                qr_stats.decoded++;
+                qr_stats.decoded_inverted += inverted;
+                decoded = true;
+
                 // Indicate that we have successfully decoded something by blinking an LED
                 bsp_led_set(BSP_LED_GREEN, true);
 
@@ -126,12 +305,41 @@ static void qr_task(void *arg)
                 bsp_led_set(BSP_LED_GREEN, false);
             }
         }
+
+        // A code that failed to decode keeps its polarity for the next try
+        if (validated == 0)
+        {
+            inverted = !inverted;
+        }
+
+        if (qr_stats.frames % QR_STATS_LOG_PERIOD == 0)
+        {
+            // Skipped grids would have cost about as much as the ones that failed
+            int64_t saved_us = qr_stats.decode_failed ? qr_stats.losing_us / qr_stats.decode_failed * qr_stats.skipped : 0;
+            ESP_LOGI(TAG, "frames: %d, grids: %d, rejected early: %d, decode failed: %d, decoded: %d (%d inverted)",
+                     qr_stats.frames, qr_stats.grids, qr_stats.rejected_early, qr_stats.decode_failed, qr_stats.decoded,
+                     qr_stats.decoded_inverted);
+            ESP_LOGI(TAG, "losing candidates: %lld ms, skipped after success: %d (~%lld ms saved)",
+                     qr_stats.losing_us / 1000, qr_stats.skipped, saved_us / 1000);
+            ESP_LOGI(TAG, "rethresholded: %d, finder hits dropped: %d", qr_stats.rethresholded,
+                     qr_stats.finder_hits_dropped);
+
+            struct QRDedupStats dedup;
+            qr_get_dedup_stats(&dedup);
+            ESP_LOGI(TAG, "dedup hits: %d, misses: %d", dedup.hits, dedup.misses);
+
+            struct QRValidationStats validation;
+            qr_get_validation_stats(&validation);
+            ESP_LOGI(TAG, "forwarded: %d, rejected for length: %d, prefix: %d, format: %d", validation.forwarded,
+                     validation.rejected[QRBadLength], validation.rejected[QRBadPrefix], validation.rejected[QRBadFormat]);
+        }
     }
 }
 
 void qr_start(struct QRConf *conf)
 {
-    TaskHandle_t handle = jTaskCreate(&qr_task, "QR task", 50000, conf, 1, MALLOC_CAP_SPIRAM);
+    TaskHandle_t handle = jTaskCreatePinned(&qr_task, "QR task", 50000, conf, QR_TASK_PRIORITY, MALLOC_CAP_SPIRAM,
+                                            QR_TASK_CORE);
     if (handle == NULL)
     {
         ESP_LOGE(TAG, "Problem on task start");
@@ -3,9 +3,11 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "esp_heap_caps.h"
 
 #include "quirc.h"
 #include "quirc_internal.h"
+#include "qr_validate.h"
 
 struct QRConf
 {
@@ -16,5 +18,41 @@ struct QRConf
     struct quirc *qr;
 };
 
+struct QRStats
+{
+    int frames;
+    int grids;
+    int rejected_early; // dropped by quirc_validate before extract/decode
+    int decode_failed;
+    int decoded;
+    int decoded_inverted; // of them, light on dark codes
+    int skipped;          // ranked below a grid that already decoded on the same frame
+    int64_t losing_us;    // extract + decode time spent on grids that failed to decode
+    int rethresholded;       // frames whose exposure moved too far from the previous one, scanned again
+    int finder_hits_dropped; // past QUIRC_MAX_FINDER_HITS, their frame was scanned again
+};
+
+// Heap capabilities for the quirc input image and for its hot working set
+// (pixel map, region table, capstones, grids, flood fill stack)
+#define QR_IMAGE_CAPS MALLOC_CAP_SPIRAM
+#define QR_WORK_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+
+void qr_place(struct quirc *qr, uint32_t image_caps, uint32_t work_caps);
+
+struct QRDedupStats
+{
+    int hits;   // repeats of a recently sent payload, dropped
+    int misses; // new payloads, passed on to validation
+};
+
+struct QRValidationStats
+{
+    int forwarded;                 // sent on as Found_TUI_qr
+    int rejected[QRVerdictCount]; // by reason, rejected[QRValid] stays 0
+};
+
 void qr_start(struct QRConf *conf);
+void qr_get_dedup_stats(struct QRDedupStats *stats);
+void qr_get_validation_stats(struct QRValidationStats *stats);
+void qr_get_stats(struct QRStats *stats);
 void qr_seen(struct QRConf *conf, char *data);
\ No newline at end of file
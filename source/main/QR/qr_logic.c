@@ -1,4 +1,7 @@
 #include "qr.h"
+#include "fountain.h"
+#include "reconf.h"
+#include "reconf_assembler.h"
 #include "../Starter/starter.h"
 #include "../MQTT/mqtt.h"
 #include "../Camera/camera.h"
@@ -31,197 +34,504 @@
 
 #define TAG "qr_logic"
 
-#define CONFIG_TRANSIMISSION_TIMEOUT_SEC 60;
+#define CONFIG_TRANSIMISSION_TIMEOUT_SEC 60
 
-char *payload_segment_validation = NULL;
-char *payload_buffer = NULL;
-int segment_size = 0;
-int segment_count = 0;
+static struct ReconfAssembler assembler = {.timeout = CONFIG_TRANSIMISSION_TIMEOUT_SEC};
 
-void removeChar(char *str, char c)
+// A student holding a code in front of the camera decodes it on every frame, only the
+// first decode within the TTL is sent on. Entries are keyed by a hash of the payload.
+#define QR_DEDUP_SLOTS 16
+
+struct QRDedupEntry
+{
+    uint32_t hash;
+    int64_t sent_us; // 0 for a free slot
+};
+
+static struct QRDedupEntry qr_dedup_cache[QR_DEDUP_SLOTS] = {0};
+static struct QRDedupStats qr_dedup_stats = {0};
+
+void qr_get_dedup_stats(struct QRDedupStats *stats)
+{
+    memcpy(stats, &qr_dedup_stats, sizeof(struct QRDedupStats));
+}
+
+static uint32_t qr_payload_hash(const char *data)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    while (*data)
+    {
+        hash = (hash ^ (uint8_t)*data++) * 16777619u;
+    }
+    return hash;
+}
+
+// Returns true if the payload was already sent less than the TTL ago, otherwise
+// records it, evicting the oldest entry when the cache is full
+static bool qr_dedup_check(const char *data)
+{
+    uint32_t hash = qr_payload_hash(data);
+    int64_t now = esp_timer_get_time();
+    int64_t ttl_us = (int64_t)get_qr_dedup_ttl() * 1000000;
+    struct QRDedupEntry *oldest = &qr_dedup_cache[0];
+
+    for (int i = 0; i < QR_DEDUP_SLOTS; i++)
+    {
+        struct QRDedupEntry *entry = &qr_dedup_cache[i];
+
+        if (entry->sent_us != 0 && entry->hash == hash && now - entry->sent_us < ttl_us)
+        {
+            qr_dedup_stats.hits++;
+            return true;
+        }
+
+        if (entry->sent_us < oldest->sent_us)
+        {
+            oldest = entry;
+        }
+    }
+
+    oldest->hash = hash;
+    oldest->sent_us = now;
+    qr_dedup_stats.misses++;
+    return false;
+}
+
+_Static_assert(QR_PREFIX_SIZE == QR_RULES_PREFIX_SIZE, "qr_prefix doesn't fit QRRules");
+_Static_assert(MAX_QR_SIZE == QR_PAYLOAD_MAX_SIZE, "qr_validate_payload lets through what Found_TUI_qr can't hold");
+
+static struct QRValidationStats qr_validation_stats = {0};
+static int64_t qr_validation_reported_us = 0;
+
+void qr_get_validation_stats(struct QRValidationStats *stats)
+{
+    memcpy(stats, &qr_validation_stats, sizeof(struct QRValidationStats));
+}
+
+// Rules from the shared attributes, the length capped to what Found_TUI_qr holds
+static void qr_get_rules(struct QRRules *rules)
+{
+    get_qr_prefix(rules->prefix);
+    rules->min_len = get_qr_min_len();
+    rules->max_len = MIN(get_qr_max_len(), MAX_QR_SIZE - 1);
+    rules->format = get_qr_format();
+    rules->accept_totp_form = get_qr_accept_totp_form();
+}
+
+// Sends the validation counters as telemetry, at most once per period
+static void qr_validation_report(struct QRConf *conf)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (qr_validation_reported_us != 0 && now - qr_validation_reported_us < (int64_t)QR_VALIDATION_TELEMETRY_PERIOD * 1000000)
+    {
+        return;
+    }
+    qr_validation_reported_us = now;
+
+    jsend(conf->to_mqtt_queue, MQTTMsg, {
+        msg->command = QRValidationReport;
+        msg->data.qr_validation.forwarded = qr_validation_stats.forwarded;
+        msg->data.qr_validation.rejected_length = qr_validation_stats.rejected[QRBadLength];
+        msg->data.qr_validation.rejected_prefix = qr_validation_stats.rejected[QRBadPrefix];
+        msg->data.qr_validation.rejected_format = qr_validation_stats.rejected[QRBadFormat];
+    });
+}
+
+// Undoes the escaping JSON.stringify applied to a segment, in place. Returns the
+// new length or -1 for escapes a reconf payload never contains.
+static int json_unescape(char *str)
 {
     int i, j;
-    int len = strlen(str);
-    for (i = j = 0; i < len; i++)
+    for (i = j = 0; str[i]; i++, j++)
     {
-        if (str[i] != c)
+        if (str[i] == '\\')
         {
-            str[j++] = str[i];
+            i++;
+            switch (str[i])
+            {
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            case 'n':
+                str[i] = '\n';
+                break;
+            case 't':
+                str[i] = '\t';
+                break;
+            default:
+                return -1;
+            }
         }
+        str[j] = str[i];
     }
     str[j] = '\0';
+    return j;
 }
 
-void qr_seen(struct QRConf *conf, char *data)
+// Hands a complete reconf JSON payload to the starter task
+static void reconf_apply(struct QRConf *conf, char *payload)
 {
-    ESP_LOGI(TAG, "the contents were: %s", data);
+    ESP_LOGI(TAG, "complete payload %s", payload);
+    jparse_ctx_t jctx;
+    json_parse_start(&jctx, (char *)payload, strlen(payload));
 
-    if (strncmp("reconf", (char *)data, 6) == 0)
-    {
+    jsend(conf->to_starter_queue, StarterMsg, {
+        msg->command = QrInfo;
 
-        char packet_type[20];
-        jparse_ctx_t jctx;
-        json_parse_start(&jctx, (char *)data + 6, strlen(data + 6));
+        struct ConnectionParameters parameters;
+        j_nvs_get(nvs_conf_tag, &parameters, sizeof(struct ConnectionParameters));
 
-        json_obj_get_string(&jctx, "packet_type", packet_type, 20);
+        msg->data.qr.qr_info = parameters.qr_info;
+        msg->data.qr.invalidate_backend_auth = false;
+        msg->data.qr.invalidate_thingsboard_auth = false;
 
-        if (strncmp(packet_type, "start", 5) == 0)
-        {
+        if (json_obj_get_string(&jctx, "device_name", msg->data.qr.qr_info.device_name, 50) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field device_name %s", msg->data.qr.qr_info.device_name);
 
-            ESP_LOGI(TAG, "start packet");
+        if (json_obj_get_int(&jctx, "space_id", &msg->data.qr.qr_info.space_id) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field space_id %d", msg->data.qr.qr_info.space_id);
 
-            json_obj_get_int(&jctx, "segment_size", &segment_size);
-            json_obj_get_int(&jctx, "segment_count", &segment_count);
+        if (json_obj_get_string(&jctx, "thingsboard_url", msg->data.qr.qr_info.thingsboard_url, URL_SIZE) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field thingsboard_url %s", msg->data.qr.qr_info.thingsboard_url);
 
-            ESP_LOGE(TAG, "segment_size %d", segment_size);
-            ESP_LOGE(TAG, "segment_count %d", segment_count);
+        if (json_obj_get_string(&jctx, "mqtt_broker_url", msg->data.qr.qr_info.mqtt_broker_url, URL_SIZE) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field mqtt_broker_url %s", msg->data.qr.qr_info.mqtt_broker_url);
 
-            if (payload_segment_validation != NULL)
-            {
-                free(payload_segment_validation);
-                payload_segment_validation = NULL;
-            }
+        if (json_obj_get_string(&jctx, "provisioning_device_key", msg->data.qr.qr_info.provisioning_device_key, 21) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field provisioning_device_key %s", msg->data.qr.qr_info.provisioning_device_key);
 
-            if (payload_buffer != NULL)
-            {
-                free(payload_buffer);
-                payload_buffer = NULL;
-            }
+        if (json_obj_get_string(&jctx, "provisioning_device_secret", msg->data.qr.qr_info.provisioning_device_secret, 21) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field provisioning_device_secret %s", msg->data.qr.qr_info.provisioning_device_secret);
+
+        if (json_obj_get_string(&jctx, "wifi_psw", msg->data.qr.qr_info.wifi_psw, 30) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field wifi_psw %s", msg->data.qr.qr_info.wifi_psw);
+
+        if (json_obj_get_string(&jctx, "wifi_ssid", msg->data.qr.qr_info.wifi_ssid, 30) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field wifi_ssid %s", msg->data.qr.qr_info.wifi_ssid);
+
+        if(json_obj_get_string(&jctx, "totp_form_base_url", msg->data.qr.qr_info.totp_form_base_url, URL_SIZE) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field totp_form_base_url %s", msg->data.qr.qr_info.totp_form_base_url);
+
+
+
+        if (json_obj_get_bool(&jctx, "invalidate_thingsboard_auth", &msg->data.qr.invalidate_thingsboard_auth) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field invalidate_thingsboard_auth %d", msg->data.qr.invalidate_thingsboard_auth);
 
-            payload_segment_validation = jalloc(segment_count * sizeof(char) + 1);
+        if (json_obj_get_bool(&jctx, "invalidate_backend_auth", &msg->data.qr.invalidate_backend_auth) == OS_SUCCESS)
+            ESP_LOGI(TAG, "json field invalidate_backend_auth %d", msg->data.qr.invalidate_backend_auth);
 
-            memset(payload_segment_validation, '_', segment_count * sizeof(char));
-            payload_segment_validation[segment_count] = '\0';
 
-            payload_buffer = jalloc(segment_count * segment_size + 1);
-            memset(payload_buffer, '\0', segment_count * segment_size + 1);
+    });
+
+    jsend(conf->to_screen_queue, ScreenMsg, {
+        msg->command = ShowMsg;
+        snprintf(msg->data.text, sizeof(msg->data.text), "Recieving configuration is over");
+    });
+}
+
+struct ReconfFlags
+{
+    bool invalidate_thingsboard_auth;
+    bool invalidate_backend_auth;
+};
+
+// Copies a length delimited string into a fixed size QRInfo field
+static int put_string(char *dst, int dst_size, const struct ReconfValue *value)
+{
+    if (value->len >= dst_size)
+    {
+        return -1;
+    }
+    memcpy(dst, value->bytes, value->len);
+    dst[value->len] = '\0';
+    return 0;
+}
+
+#define STRING_FIELD(field) put_string(field, sizeof(field), &value)
+
+#define QR_INFO_SIZE(field) sizeof(((struct QRInfo *)0)->field)
+_Static_assert(QR_INFO_SIZE(wifi_ssid) == RECONF_WIFI_SIZE && QR_INFO_SIZE(wifi_psw) == RECONF_WIFI_SIZE,
+               "reconf_validate lets through what QRInfo can't hold");
+_Static_assert(QR_INFO_SIZE(thingsboard_url) == RECONF_URL_SIZE && QR_INFO_SIZE(mqtt_broker_url) == RECONF_URL_SIZE &&
+                   QR_INFO_SIZE(totp_form_base_url) == RECONF_URL_SIZE,
+               "reconf_validate lets through what QRInfo can't hold");
+_Static_assert(QR_INFO_SIZE(device_name) == RECONF_DEVICE_NAME_SIZE &&
+                   QR_INFO_SIZE(provisioning_device_key) == RECONF_PROVISIONING_SIZE &&
+                   QR_INFO_SIZE(provisioning_device_secret) == RECONF_PROVISIONING_SIZE,
+               "reconf_validate lets through what QRInfo can't hold");
+
+// Overwrites the fields present in the payload, leaving the rest of info and flags
+// untouched. Returns -1 on a bad version, CRC or field, in which case info may be
+// partially written.
+static int reconf_decode(const uint8_t *payload, int len, struct QRInfo *info, struct ReconfFlags *flags)
+{
+    struct ReconfValue value;
+    int end = reconf_validate(payload, len);
+    int pos = 1;
+    int res;
+
+    if (end < 0)
+    {
+        return -1;
+    }
+
+    while ((res = reconf_next_field(payload, end, &pos, &value)) > 0)
+    {
+        int err = 0;
+
+        if (value.is_bytes != reconf_field_is_bytes(value.field))
+        {
+            continue; // unknown, or a type this version doesn't expect
         }
-        else if (strncmp(packet_type, "segment", 7) == 0)
+
+        switch (value.field)
         {
-            if (payload_segment_validation != NULL && payload_buffer != NULL)
-            {
-                int i;
-                char *buffer = alloca(2 * segment_size + 1);
-                json_obj_get_int(&jctx, "i", &i);
-                json_obj_get_string(&jctx, "data", buffer, 2 * segment_size + 1);
-                printf("buffer: %s\n", buffer);
-                removeChar(buffer, '\\');
-                printf("unscaped buffer: %s\n", buffer);
-
-                printf("i: %d\n", i);
-                memcpy(payload_buffer + i * segment_size, buffer, segment_size);
-                payload_segment_validation[i] = '#';
-
-                printf("current buffer:");
-
-                for (size_t i = 0; i < segment_size * segment_count; i++)
-                {
-                    if (payload_buffer[i] == '\0')
-                    {
-                        printf("_");
-                    }
-                    else
-                    {
-                        printf("%c", payload_buffer[i]);
-                    }
-                }
-                printf("\n");
-            }
+        case ReconfWifiSsid:
+            err = STRING_FIELD(info->wifi_ssid);
+            break;
+        case ReconfWifiPsw:
+            err = STRING_FIELD(info->wifi_psw);
+            break;
+        case ReconfThingsboardUrl:
+            err = STRING_FIELD(info->thingsboard_url);
+            break;
+        case ReconfMqttBrokerUrl:
+            err = STRING_FIELD(info->mqtt_broker_url);
+            break;
+        case ReconfDeviceName:
+            err = STRING_FIELD(info->device_name);
+            break;
+        case ReconfProvisioningDeviceKey:
+            err = STRING_FIELD(info->provisioning_device_key);
+            break;
+        case ReconfProvisioningDeviceSecret:
+            err = STRING_FIELD(info->provisioning_device_secret);
+            break;
+        case ReconfTotpFormBaseUrl:
+            err = STRING_FIELD(info->totp_form_base_url);
+            break;
+        case ReconfSpaceId:
+            info->space_id = value.number;
+            break;
+        case ReconfInvalidateThingsboardAuth:
+            flags->invalidate_thingsboard_auth = value.number != 0;
+            break;
+        case ReconfInvalidateBackendAuth:
+            flags->invalidate_backend_auth = value.number != 0;
+            break;
         }
-        if (payload_segment_validation != NULL && payload_buffer != NULL)
+        if (err < 0)
         {
+            return -1;
+        }
+    }
+    return res;
+}
 
-            bool complete_payload = true;
-
-            for (int i = 0; i < segment_count; i++)
-            {
-                if (payload_segment_validation[i] == '_')
-                {
-                    complete_payload = false;
-                    break;
-                }
-            }
+// Binary fountain coded reconf packet, see reconf.h
+static void reconf_packet(struct QRConf *conf, const char *text)
+{
+    static struct FountainDecoder fountain = {0};
+    int previous_id = fountain.id;
 
-            {
-                jsend(conf->to_screen_queue, ScreenMsg, {
-                    msg->command = ShowMsg;
-                    snprintf(msg->data.text, sizeof(msg->data.text), "Recieving configuration\n%s", payload_segment_validation);
-                });
-            }
+    enum ReconfReceiveResult res = reconf_receive_valid(&fountain, text);
+    if (res == ReconfRejected)
+    {
+        ESP_LOGE(TAG, "malformed reconf packet");
+        return;
+    }
 
-            if (complete_payload)
-            {
-                ESP_LOGI(TAG, "complete payload %s", payload_buffer);
-                jparse_ctx_t jctx;
-                json_parse_start(&jctx, (char *)payload_buffer, strlen(payload_buffer));
+    if (res == ReconfDuplicate)
+    {
+        return; // already applied or given up, the app keeps cycling until stopped
+    }
 
-                jsend(conf->to_starter_queue, StarterMsg, {
-                    msg->command = QrInfo;
+    if (res == ReconfInvalid)
+    {
+        // Decoding the same looping frames again would only fail again
+        ESP_LOGE(TAG, "reconf session %d: payload failed its checks, ignoring the session", fountain.id);
+        jsend(conf->to_screen_queue, ScreenMsg, {
+            msg->command = ShowMsg;
+            snprintf(msg->data.text, sizeof(msg->data.text), "configuración inválida");
+        });
+        return;
+    }
 
-                    struct ConnectionParameters parameters;
-                    j_nvs_get(nvs_conf_tag, &parameters, sizeof(struct ConnectionParameters));
+    if (fountain.id != previous_id)
+    {
+        ESP_LOGI(TAG, "reconf session %d: %d blocks, %d bytes", fountain.id, fountain.k, fountain.len);
+    }
 
-                    msg->data.qr.qr_info = parameters.qr_info;
-                    msg->data.qr.invalidate_backend_auth = false;
-                    msg->data.qr.invalidate_thingsboard_auth = false;
+    jsend(conf->to_screen_queue, ScreenMsg, {
+        msg->command = ShowMsg;
+        snprintf(msg->data.text, sizeof(msg->data.text), "Recieving configuration\n%d/%d", fountain.rank, fountain.k);
+    });
 
-                    if (json_obj_get_string(&jctx, "device_name", msg->data.qr.qr_info.device_name, 50) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field device_name %s", msg->data.qr.qr_info.device_name);
+    if (res != ReconfComplete)
+    {
+        return;
+    }
 
-                    if (json_obj_get_int(&jctx, "space_id", &msg->data.qr.qr_info.space_id) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field space_id %d", msg->data.qr.qr_info.space_id);
+    uint8_t *payload = alloca(fountain.len + 1);
+    fountain_payload(&fountain, (char *)payload, fountain.len + 1);
 
-                    if (json_obj_get_string(&jctx, "thingsboard_url", msg->data.qr.qr_info.thingsboard_url, URL_SIZE) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field thingsboard_url %s", msg->data.qr.qr_info.thingsboard_url);
+    struct ConnectionParameters parameters;
+    j_nvs_get(nvs_conf_tag, &parameters, sizeof(struct ConnectionParameters));
 
-                    if (json_obj_get_string(&jctx, "mqtt_broker_url", msg->data.qr.qr_info.mqtt_broker_url, URL_SIZE) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field mqtt_broker_url %s", msg->data.qr.qr_info.mqtt_broker_url);
+    struct QRInfo qr_info = parameters.qr_info;
+    struct ReconfFlags flags = {0};
 
-                    if (json_obj_get_string(&jctx, "provisioning_device_key", msg->data.qr.qr_info.provisioning_device_key, 21) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field provisioning_device_key %s", msg->data.qr.qr_info.provisioning_device_key);
+    if (reconf_decode(payload, fountain.len, &qr_info, &flags) < 0)
+    {
+        // reconf_receive_valid already checked it
+        ESP_LOGE(TAG, "reconf payload failed its checks");
+        return;
+    }
 
-                    if (json_obj_get_string(&jctx, "provisioning_device_secret", msg->data.qr.qr_info.provisioning_device_secret, 21) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field provisioning_device_secret %s", msg->data.qr.qr_info.provisioning_device_secret);
+    ESP_LOGI(TAG, "reconf device_name %s, space_id %d", qr_info.device_name, qr_info.space_id);
 
-                    if (json_obj_get_string(&jctx, "wifi_psw", msg->data.qr.qr_info.wifi_psw, 30) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field wifi_psw %s", msg->data.qr.qr_info.wifi_psw);
+    jsend(conf->to_starter_queue, StarterMsg, {
+        msg->command = QrInfo;
+        msg->data.qr.qr_info = qr_info;
+        msg->data.qr.invalidate_thingsboard_auth = flags.invalidate_thingsboard_auth;
+        msg->data.qr.invalidate_backend_auth = flags.invalidate_backend_auth;
+    });
 
-                    if (json_obj_get_string(&jctx, "wifi_ssid", msg->data.qr.qr_info.wifi_ssid, 30) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field wifi_ssid %s", msg->data.qr.qr_info.wifi_ssid);
+    jsend(conf->to_screen_queue, ScreenMsg, {
+        msg->command = ShowMsg;
+        snprintf(msg->data.text, sizeof(msg->data.text), "Recieving configuration is over");
+    });
+}
 
-                    if(json_obj_get_string(&jctx, "totp_form_base_url", msg->data.qr.qr_info.totp_form_base_url, URL_SIZE) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field totp_form_base_url %s", msg->data.qr.qr_info.totp_form_base_url);
+// Legacy JSON start/segment packet, see reconf_assembler.h
+static void reconf_legacy_packet(struct QRConf *conf, char *json)
+{
+    char packet_type[20];
+    int id = 0;
+    int64_t now = esp_timer_get_time() / 1000000;
+    enum AssemblerResult res;
+    jparse_ctx_t jctx;
 
+    if (json_parse_start(&jctx, json, strlen(json)) != OS_SUCCESS)
+    {
+        ESP_LOGE(TAG, "malformed reconf packet");
+        return;
+    }
 
+    if (json_obj_get_string(&jctx, "packet_type", packet_type, sizeof(packet_type)) != OS_SUCCESS)
+    {
+        packet_type[0] = '\0';
+    }
 
-                    if (json_obj_get_bool(&jctx, "invalidate_thingsboard_auth", &msg->data.qr.invalidate_thingsboard_auth) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field invalidate_thingsboard_auth %d", msg->data.qr.invalidate_thingsboard_auth);
+    json_obj_get_int(&jctx, "id", &id);
 
-                    if (json_obj_get_bool(&jctx, "invalidate_backend_auth", &msg->data.qr.invalidate_backend_auth) == OS_SUCCESS)
-                        ESP_LOGI(TAG, "json field invalidate_backend_auth %d", msg->data.qr.invalidate_backend_auth);
+    if (assembler_expire(&assembler, now))
+    {
+        ESP_LOGW(TAG, "reconf transfer timed out");
+    }
 
+    if (strcmp(packet_type, "start") == 0)
+    {
+        int segment_size = 0, segment_count = 0;
+        int64_t hash = 0;
+        bool has_hash = json_obj_get_int64(&jctx, "hash", &hash) == OS_SUCCESS;
 
-                });
+        json_obj_get_int(&jctx, "segment_size", &segment_size);
+        json_obj_get_int(&jctx, "segment_count", &segment_count);
 
-                jsend(conf->to_screen_queue, ScreenMsg, {
-                    msg->command = ShowMsg;
-                    snprintf(msg->data.text, sizeof(msg->data.text), "Recieving configuration is over");
-                });
+        res = assembler_start(&assembler, id, segment_size, segment_count, has_hash, hash, now);
+        if (res == AssemblerStarted)
+        {
+            ESP_LOGI(TAG, "reconf session %d: %d segments of %d characters", id, segment_count, segment_size);
+        }
+    }
+    else if (strcmp(packet_type, "segment") == 0)
+    {
+        int i = -1;
+        int64_t crc = 0;
+        char buffer[ASSEMBLER_MAX_PAYLOAD + 1];
+        bool has_crc = json_obj_get_int64(&jctx, "crc", &crc) == OS_SUCCESS;
 
-                free(payload_buffer);
-                payload_buffer = NULL;
-                free(payload_segment_validation);
-                payload_segment_validation = NULL;
-                segment_count = 0;
-                segment_size = 0;
-            }
+        json_obj_get_int(&jctx, "i", &i);
+        if (json_obj_get_string(&jctx, "data", buffer, sizeof(buffer)) != OS_SUCCESS)
+        {
+            res = AssemblerRejected;
+        }
+        else
+        {
+            int len = json_unescape(buffer);
+            res = len < 0 ? AssemblerRejected : assembler_segment(&assembler, id, i, buffer, len, has_crc, crc, now);
         }
     }
     else
     {
-        jsend(conf->to_mqtt_queue, MQTTMsg, {
-            msg->command = Found_TUI_qr;
-            strcpy((char *)msg->data.found_tui_qr.TUI_qr, (char *)data);
-        });
+        res = AssemblerRejected;
+    }
+
+    json_parse_end(&jctx);
+
+    if (res == AssemblerRejected)
+    {
+        ESP_LOGW(TAG, "reconf %s packet rejected", packet_type);
+        return;
+    }
+
+    if (res == AssemblerDuplicate || !assembler.active)
+    {
+        return;
+    }
+
+    jsend(conf->to_screen_queue, ScreenMsg, {
+        msg->command = ShowMsg;
+        snprintf(msg->data.text, sizeof(msg->data.text), "Recieving configuration\n%d/%d", assembler_received(&assembler), assembler.segment_count);
+    });
+
+    if (res == AssemblerComplete)
+    {
+        reconf_apply(conf, assembler.payload);
+    }
+}
+
+void qr_seen(struct QRConf *conf, char *data)
+{
+    ESP_LOGI(TAG, "the contents were: %s", data);
+
+    if (strncmp(RECONF_PREFIX, data, strlen(RECONF_PREFIX)) == 0)
+    {
+        reconf_packet(conf, data);
+    }
+    else if (strncmp("reconf", (char *)data, 6) == 0)
+    {
+        reconf_legacy_packet(conf, data + 6);
+    }
+    else if (!qr_dedup_check(data))
+    {
+        // Anything that isn't an attendance code fails here, without a round trip to
+        // the backend. Rejected payloads are deduplicated too, so the icon flashes once.
+        struct QRRules rules;
+        qr_get_rules(&rules);
+
+        enum QRVerdict verdict = qr_validate_payload(&rules, data);
+        if (verdict == QRValid)
+        {
+            qr_validation_stats.forwarded++;
+            jsend(conf->to_mqtt_queue, MQTTMsg, {
+                msg->command = Found_TUI_qr;
+                snprintf(msg->data.found_tui_qr.TUI_qr, sizeof(msg->data.found_tui_qr.TUI_qr), "%s", data);
+            });
+        }
+        else
+        {
+            qr_validation_stats.rejected[verdict]++;
+            ESP_LOGW(TAG, "payload rejected: bad %s", qr_verdict_name(verdict));
+            jsend(conf->to_screen_queue, ScreenMsg, {
+                msg->command = Flash;
+                msg->data.icon = NotFound_Icon;
+            });
+        }
+
+        qr_validation_report(conf);
     }
 }
\ No newline at end of file
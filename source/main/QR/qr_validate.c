@@ -0,0 +1,268 @@
+#include "qr_validate.h"
+
+#include <string.h>
+
+static const char *const format_names[QRFormatCount] = {
+    [QRFormatText] = "text",
+    [QRFormatBase64url] = "base64url",
+    [QRFormatJwe] = "jwe",
+    [QRFormatBase64Jwe] = "base64_jwe",
+};
+
+static const char *const verdict_names[QRVerdictCount] = {
+    [QRValid] = "valid",
+    [QRBadLength] = "length",
+    [QRBadPrefix] = "prefix",
+    [QRBadFormat] = "format",
+};
+
+int qr_format_from_name(const char *name)
+{
+    for (int format = 0; format < QRFormatCount; format++)
+    {
+        if (strcmp(format_names[format], name) == 0)
+        {
+            return format;
+        }
+    }
+    return -1;
+}
+
+const char *qr_format_name(enum QRFormat format)
+{
+    return format >= 0 && format < QRFormatCount ? format_names[format] : "?";
+}
+
+const char *qr_verdict_name(enum QRVerdict verdict)
+{
+    return verdict >= 0 && verdict < QRVerdictCount ? verdict_names[verdict] : "?";
+}
+
+// 6 bit value of a base64 (url = false) or base64url (url = true) digit, -1 if not one
+static int base64_value(char c, bool url)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == (url ? '-' : '+'))
+        return 62;
+    if (c == (url ? '_' : '/'))
+        return 63;
+    return -1;
+}
+
+static bool is_text(const char *data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        if (data[i] < 0x20 || data[i] > 0x7e || data[i] == '"' || data[i] == '\\')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_base64url(const char *data, int len)
+{
+    for (int padding = 0; padding < 2 && len > 0 && data[len - 1] == '='; padding++)
+    {
+        len--;
+    }
+
+    for (int i = 0; i < len; i++)
+    {
+        if (base64_value(data[i], true) < 0)
+        {
+            return false;
+        }
+    }
+    return len > 0 && len % 4 != 1;
+}
+
+// Checks a JWE one character at a time, so the base64 wrapped form can be checked
+// as it is decoded without a buffer for the inner text
+struct JweScan
+{
+    int segment;
+    int segment_len;
+    int header[2]; // first two digits of the protected header
+    bool bad;
+};
+
+static void jwe_feed(struct JweScan *scan, char c)
+{
+    if (c == '.')
+    {
+        // Only the encrypted key is empty, with direct encryption
+        if (scan->segment_len % 4 == 1 || (scan->segment != 1 && scan->segment_len == 0) || ++scan->segment > 4)
+        {
+            scan->bad = true;
+        }
+        scan->segment_len = 0;
+        return;
+    }
+
+    int value = base64_value(c, true);
+    if (value < 0)
+    {
+        scan->bad = true;
+        return;
+    }
+
+    if (scan->segment == 0 && scan->segment_len < 2)
+    {
+        scan->header[scan->segment_len] = value;
+    }
+    scan->segment_len++;
+}
+
+static bool jwe_finish(const struct JweScan *scan)
+{
+    // The header is a JSON object, its first byte a '{'
+    return !scan->bad && scan->segment == 4 && scan->segment_len > 0 && scan->segment_len % 4 != 1 &&
+           (scan->header[0] << 2 | scan->header[1] >> 4) == '{';
+}
+
+static bool is_jwe(const char *data, int len)
+{
+    struct JweScan scan = {0};
+
+    for (int i = 0; i < len && !scan.bad; i++)
+    {
+        jwe_feed(&scan, data[i]);
+    }
+    return jwe_finish(&scan);
+}
+
+static bool is_base64_jwe(const char *data, int len)
+{
+    struct JweScan scan = {0};
+    int padding = 0;
+
+    while (len > 0 && data[len - 1] == '=' && padding < 2)
+    {
+        len--;
+        padding++;
+    }
+
+    if ((len + padding) % 4 != 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < len && !scan.bad; i += 4)
+    {
+        int quad = 0;
+        int digits = len - i < 4 ? len - i : 4;
+
+        for (int j = 0; j < 4; j++)
+        {
+            int value = j < digits ? base64_value(data[i + j], false) : 0;
+            if (value < 0)
+            {
+                return false;
+            }
+            quad = quad << 6 | value;
+        }
+
+        // 4 digits carry 3 bytes, a padded final group 1 or 2
+        for (int j = 0; j < digits - 1; j++)
+        {
+            jwe_feed(&scan, (quad >> (16 - 8 * j)) & 0xff);
+        }
+    }
+    return jwe_finish(&scan);
+}
+
+// <base>?totp=NNNNNN&espacioId=N&dispositivoId=N as built by the TOTP task
+static bool is_totp_form(const char *data, int len)
+{
+    static const char *const params[] = {"?totp=", "&espacioId=", "&dispositivoId="};
+    const char *p = data;
+    const char *end = data + len;
+
+    if (strncmp(data, "http://", 7) != 0 && strncmp(data, "https://", 8) != 0)
+    {
+        return false;
+    }
+
+    p = memchr(data, '?', len);
+    for (int i = 0; i < 3; i++)
+    {
+        int param_len = strlen(params[i]);
+        int digits = 0;
+
+        if (p == NULL || end - p <= param_len || strncmp(p, params[i], param_len) != 0)
+        {
+            return false;
+        }
+
+        for (p += param_len; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            digits++;
+        }
+
+        if (digits == 0 || (i == 0 && digits != 6))
+        {
+            return false;
+        }
+    }
+    return p == end;
+}
+
+enum QRVerdict qr_validate_payload(const struct QRRules *rules, const char *data)
+{
+    int len = strnlen(data, QR_PAYLOAD_MAX_SIZE);
+    int prefix_len = strlen(rules->prefix);
+
+    // Before anything else, the TOTP form included: it is forwarded as it is
+    if (len > QR_PAYLOAD_MAX_SIZE - 1)
+    {
+        return QRBadLength;
+    }
+
+    while (len > 0 && (data[len - 1] == '\n' || data[len - 1] == '\r'))
+    {
+        len--;
+    }
+
+    if (rules->accept_totp_form && is_totp_form(data, len))
+    {
+        return QRValid;
+    }
+
+    if (len < rules->min_len || len > rules->max_len)
+    {
+        return QRBadLength;
+    }
+
+    if (len < prefix_len || strncmp(data, rules->prefix, prefix_len) != 0)
+    {
+        return QRBadPrefix;
+    }
+
+    data += prefix_len;
+    len -= prefix_len;
+
+    bool valid;
+    switch (rules->format)
+    {
+    case QRFormatBase64url:
+        valid = is_base64url(data, len);
+        break;
+    case QRFormatJwe:
+        valid = is_jwe(data, len);
+        break;
+    case QRFormatBase64Jwe:
+        valid = is_base64_jwe(data, len);
+        break;
+    default:
+        valid = is_text(data, len);
+        break;
+    }
+    return valid ? QRValid : QRBadFormat;
+}
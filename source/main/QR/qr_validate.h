@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Structural checks on a decoded payload before it costs an MQTT publish and a
+// backend round trip. Attendance codes are shown by the students' app, anything
+// else the camera happens to see (product QRs, URLs, Wi-Fi codes) is rejected
+// here. Nothing here depends on ESP-IDF.
+
+#define QR_RULES_PREFIX_SIZE 32
+#define QR_PAYLOAD_MAX_SIZE 300 // what Found_TUI_qr holds, the terminator included
+
+enum QRFormat
+{
+    QRFormatText,      // printable ASCII without quotes or backslashes
+    QRFormatBase64url, // unpadded or padded base64url
+    QRFormatJwe,       // JWE compact serialization: five base64url segments, a JSON header
+    QRFormatBase64Jwe, // a JWE compact serialization wrapped in standard base64
+    QRFormatCount,
+};
+
+enum QRVerdict
+{
+    QRValid,
+    QRBadLength,
+    QRBadPrefix,
+    QRBadFormat,
+    QRVerdictCount,
+};
+
+// Rules until the shared attributes say otherwise: the TOTP form links and the
+// students' base64 wrapped JWE, nothing else. Each of them checks its own start
+// (http:// or https://, the base64 of the JWE header's '{'), so there is no prefix.
+// The shortest real JWE, {"alg":"dir","enc":"A128GCM"} with a 96 bit IV, a 128 bit
+// tag and one byte of ciphertext, is 112 characters once wrapped.
+#define QR_DEFAULT_PREFIX ""
+#define QR_DEFAULT_MIN_LEN 100
+#define QR_DEFAULT_MAX_LEN (QR_PAYLOAD_MAX_SIZE - 1)
+#define QR_DEFAULT_FORMAT QRFormatBase64Jwe
+#define QR_DEFAULT_ACCEPT_TOTP_FORM true
+
+struct QRRules
+{
+    char prefix[QR_RULES_PREFIX_SIZE]; // required at the start, empty for none
+    int min_len;
+    int max_len;
+    enum QRFormat format; // of what follows the prefix
+    bool accept_totp_form; // also let through the TOTP form links the devices display
+};
+
+// Trailing newlines are ignored, the students' app adds one. Whatever the rules, a
+// payload that doesn't fit QR_PAYLOAD_MAX_SIZE as it is, newlines included, is
+// QRBadLength.
+enum QRVerdict qr_validate_payload(const struct QRRules *rules, const char *data);
+
+// "text", "base64url", "jwe" or "base64_jwe", -1 if unknown
+int qr_format_from_name(const char *name);
+const char *qr_format_name(enum QRFormat format);
+const char *qr_verdict_name(enum QRVerdict verdict);
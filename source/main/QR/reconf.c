@@ -0,0 +1,384 @@
+#include "reconf.h"
+#include "crc32.h"
+
+#include <string.h>
+
+static const char base45_charset[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+static int base45_value(char c)
+{
+    const char *p = c ? strchr(base45_charset, c) : NULL;
+    return p ? p - base45_charset : -1;
+}
+
+int base45_decode(const char *text, uint8_t *buf, int buf_size)
+{
+    int text_len = strlen(text);
+    int len = 0;
+
+    for (int i = 0; i < text_len; i += 3)
+    {
+        int chunk = text_len - i < 3 ? text_len - i : 3;
+        int value = 0;
+
+        if (chunk == 1)
+        {
+            return -1;
+        }
+
+        for (int j = chunk - 1; j >= 0; j--)
+        {
+            int digit = base45_value(text[i + j]);
+            if (digit < 0)
+            {
+                return -1;
+            }
+            value = value * 45 + digit;
+        }
+
+        if (chunk == 3)
+        {
+            if (value > 0xffff || len + 2 > buf_size)
+            {
+                return -1;
+            }
+            buf[len++] = value >> 8;
+            buf[len++] = value & 0xff;
+        }
+        else
+        {
+            if (value > 0xff || len + 1 > buf_size)
+            {
+                return -1;
+            }
+            buf[len++] = value;
+        }
+    }
+    return len;
+}
+
+int base45_encode(const uint8_t *buf, int len, char *text, int text_size)
+{
+    int text_len = 0;
+
+    for (int i = 0; i < len; i += 2)
+    {
+        int digits = i + 1 < len ? 3 : 2;
+        int value = i + 1 < len ? buf[i] << 8 | buf[i + 1] : buf[i];
+
+        if (text_len + digits >= text_size)
+        {
+            return -1;
+        }
+
+        for (int j = 0; j < digits; j++)
+        {
+            text[text_len++] = base45_charset[value % 45];
+            value /= 45;
+        }
+    }
+    text[text_len] = '\0';
+    return text_len;
+}
+
+static const char *const field_names[ReconfFieldCount] = {
+    [ReconfWifiSsid] = "wifi_ssid",
+    [ReconfWifiPsw] = "wifi_psw",
+    [ReconfThingsboardUrl] = "thingsboard_url",
+    [ReconfMqttBrokerUrl] = "mqtt_broker_url",
+    [ReconfDeviceName] = "device_name",
+    [ReconfSpaceId] = "space_id",
+    [ReconfProvisioningDeviceKey] = "provisioning_device_key",
+    [ReconfProvisioningDeviceSecret] = "provisioning_device_secret",
+    [ReconfTotpFormBaseUrl] = "totp_form_base_url",
+    [ReconfInvalidateThingsboardAuth] = "invalidate_thingsboard_auth",
+    [ReconfInvalidateBackendAuth] = "invalidate_backend_auth",
+};
+
+const char *reconf_field_name(int field)
+{
+    return field > 0 && field < ReconfFieldCount ? field_names[field] : NULL;
+}
+
+int reconf_field_id(const char *name)
+{
+    for (int field = 1; field < ReconfFieldCount; field++)
+    {
+        if (strcmp(field_names[field], name) == 0)
+        {
+            return field;
+        }
+    }
+    return -1;
+}
+
+static const int field_sizes[ReconfFieldCount] = {
+    [ReconfWifiSsid] = RECONF_WIFI_SIZE,
+    [ReconfWifiPsw] = RECONF_WIFI_SIZE,
+    [ReconfThingsboardUrl] = RECONF_URL_SIZE,
+    [ReconfMqttBrokerUrl] = RECONF_URL_SIZE,
+    [ReconfDeviceName] = RECONF_DEVICE_NAME_SIZE,
+    [ReconfProvisioningDeviceKey] = RECONF_PROVISIONING_SIZE,
+    [ReconfProvisioningDeviceSecret] = RECONF_PROVISIONING_SIZE,
+    [ReconfTotpFormBaseUrl] = RECONF_URL_SIZE,
+};
+
+int reconf_field_max_len(int field)
+{
+    return field > 0 && field < ReconfFieldCount && field_sizes[field] > 0 ? field_sizes[field] - 1 : 0;
+}
+
+bool reconf_field_is_bytes(int field)
+{
+    return field != ReconfSpaceId && field != ReconfInvalidateThingsboardAuth && field != ReconfInvalidateBackendAuth;
+}
+
+static int get_u16(const uint8_t *buf)
+{
+    return buf[0] | buf[1] << 8;
+}
+
+int reconf_parse_packet(const uint8_t *buf, int len, struct ReconfPacket *packet)
+{
+    if (len <= RECONF_PACKET_HEADER_SIZE || buf[0] != RECONF_VERSION)
+    {
+        return -1;
+    }
+
+    packet->id = get_u16(&buf[1]);
+    packet->k = buf[3];
+    packet->len = get_u16(&buf[4]);
+    packet->seed = get_u16(&buf[6]);
+    packet->block = &buf[RECONF_PACKET_HEADER_SIZE];
+    packet->block_size = len - RECONF_PACKET_HEADER_SIZE;
+    return 0;
+}
+
+// Reads a varint of up to 32 bits, returns the bytes used or -1
+static int get_varint(const uint8_t *buf, int len, uint32_t *value)
+{
+    *value = 0;
+    for (int i = 0; i < len && i < 5; i++)
+    {
+        *value |= (uint32_t)(buf[i] & 0x7f) << (7 * i);
+        if (!(buf[i] & 0x80))
+        {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+int reconf_next_field(const uint8_t *payload, int end, int *pos, struct ReconfValue *value)
+{
+    uint32_t key;
+
+    if (*pos >= end)
+    {
+        return 0;
+    }
+
+    int used = get_varint(&payload[*pos], end - *pos, &key);
+    if (used < 0)
+    {
+        return -1;
+    }
+    *pos += used;
+
+    used = get_varint(&payload[*pos], end - *pos, &value->number);
+    if (used < 0)
+    {
+        return -1;
+    }
+    *pos += used;
+
+    value->field = key >> 1;
+    value->is_bytes = key & 1;
+    value->bytes = NULL;
+    value->len = 0;
+
+    if (value->is_bytes)
+    {
+        // Length delimited, number is the length of the bytes that follow
+        if (value->number > (uint32_t)(end - *pos))
+        {
+            return -1;
+        }
+        value->bytes = &payload[*pos];
+        value->len = value->number;
+        *pos += value->len;
+    }
+    return 1;
+}
+
+int reconf_check(const uint8_t *payload, int len)
+{
+    if (len < 5 || payload[0] != RECONF_VERSION)
+    {
+        return -1;
+    }
+
+    len -= 4;
+    uint32_t crc = payload[len] | payload[len + 1] << 8 | payload[len + 2] << 16 | (uint32_t)payload[len + 3] << 24;
+    return crc32_ieee(payload, len) == crc ? len : -1;
+}
+
+int reconf_validate(const uint8_t *payload, int len)
+{
+    struct ReconfValue value;
+    int end = reconf_check(payload, len);
+    int pos = 1;
+    int res;
+
+    if (end < 0)
+    {
+        return -1;
+    }
+
+    while ((res = reconf_next_field(payload, end, &pos, &value)) > 0)
+    {
+        // Unknown fields and wire types are skipped by the decoder, not limited
+        int max_len = reconf_field_max_len(value.field);
+        if (value.is_bytes && max_len > 0 && value.len > max_len)
+        {
+            return -1;
+        }
+    }
+    return res < 0 ? -1 : end;
+}
+
+void reconf_writer_init(struct ReconfWriter *writer, uint8_t *buf, int size)
+{
+    writer->buf = buf;
+    writer->size = size;
+    writer->len = 0;
+    writer->overflow = false;
+
+    if (size < 1)
+    {
+        writer->overflow = true;
+        return;
+    }
+    writer->buf[writer->len++] = RECONF_VERSION;
+}
+
+static void put_byte(struct ReconfWriter *writer, uint8_t byte)
+{
+    if (writer->len >= writer->size)
+    {
+        writer->overflow = true;
+        return;
+    }
+    writer->buf[writer->len++] = byte;
+}
+
+static void put_varint(struct ReconfWriter *writer, uint32_t value)
+{
+    do
+    {
+        put_byte(writer, (value & 0x7f) | (value > 0x7f ? 0x80 : 0));
+        value >>= 7;
+    } while (value);
+}
+
+void reconf_put_number(struct ReconfWriter *writer, int field, uint32_t value)
+{
+    put_varint(writer, field << 1);
+    put_varint(writer, value);
+}
+
+void reconf_put_bytes(struct ReconfWriter *writer, int field, const uint8_t *bytes, int len)
+{
+    put_varint(writer, field << 1 | 1);
+    put_varint(writer, len);
+    for (int i = 0; i < len; i++)
+    {
+        put_byte(writer, bytes[i]);
+    }
+}
+
+int reconf_writer_finish(struct ReconfWriter *writer)
+{
+    uint32_t crc = crc32_ieee(writer->buf, writer->len);
+
+    for (int i = 0; i < 4; i++)
+    {
+        put_byte(writer, crc >> (8 * i));
+    }
+    return writer->overflow ? -1 : writer->len;
+}
+
+int reconf_frame(const uint8_t *payload, int len, int id, int block_size, uint32_t seed, char *text, int text_size)
+{
+    uint8_t buf[RECONF_PACKET_HEADER_SIZE + FOUNTAIN_MAX_BLOCK_SIZE];
+    int k = (len + block_size - 1) / block_size;
+    int prefix_len = strlen(RECONF_PREFIX);
+
+    if (block_size < 1 || block_size > FOUNTAIN_MAX_BLOCK_SIZE || k < 1 || k > FOUNTAIN_MAX_BLOCKS ||
+        text_size <= prefix_len)
+    {
+        return -1;
+    }
+
+    buf[0] = RECONF_VERSION;
+    buf[1] = id & 0xff;
+    buf[2] = id >> 8;
+    buf[3] = k;
+    buf[4] = len & 0xff;
+    buf[5] = len >> 8;
+    buf[6] = seed & 0xff;
+    buf[7] = seed >> 8;
+    fountain_encode(payload, len, block_size, seed, &buf[RECONF_PACKET_HEADER_SIZE]);
+
+    memcpy(text, RECONF_PREFIX, prefix_len);
+    int encoded = base45_encode(buf, RECONF_PACKET_HEADER_SIZE + block_size, text + prefix_len, text_size - prefix_len);
+    return encoded < 0 ? -1 : prefix_len + encoded;
+}
+
+enum ReconfReceiveResult reconf_receive(struct FountainDecoder *dec, const char *text)
+{
+    uint8_t buf[RECONF_PACKET_HEADER_SIZE + FOUNTAIN_MAX_BLOCK_SIZE];
+    struct ReconfPacket packet;
+    int prefix_len = strlen(RECONF_PREFIX);
+
+    if (strncmp(text, RECONF_PREFIX, prefix_len) != 0)
+    {
+        return ReconfRejected;
+    }
+
+    int size = base45_decode(text + prefix_len, buf, sizeof(buf));
+    if (size < 0 || reconf_parse_packet(buf, size, &packet) < 0)
+    {
+        return ReconfRejected;
+    }
+
+    if (dec->id != packet.id || dec->k != packet.k || dec->len != packet.len || dec->block_size != packet.block_size)
+    {
+        if (fountain_reset(dec, packet.id, packet.k, packet.len, packet.block_size) < 0)
+        {
+            return ReconfRejected;
+        }
+    }
+
+    if (dec->complete)
+    {
+        return ReconfDuplicate;
+    }
+
+    fountain_add(dec, packet.seed, packet.block);
+    return dec->complete ? ReconfComplete : ReconfAccepted;
+}
+
+enum ReconfReceiveResult reconf_receive_valid(struct FountainDecoder *dec, const char *text)
+{
+    char payload[FOUNTAIN_MAX_BLOCKS * FOUNTAIN_MAX_BLOCK_SIZE + 1];
+    enum ReconfReceiveResult res = reconf_receive(dec, text);
+
+    if (res != ReconfComplete)
+    {
+        return res;
+    }
+
+    int len = fountain_payload(dec, payload, sizeof(payload));
+    return len < 0 || reconf_validate((const uint8_t *)payload, len) < 0 ? ReconfInvalid : ReconfComplete;
+}
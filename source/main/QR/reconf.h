@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fountain.h"
+
+// Binary reconf protocol. Every frame is a QR in alphanumeric mode holding
+// RECONF_PREFIX followed by the base45 encoding of a packet:
+//
+//   u8 version | u16 session id | u8 k | u16 payload length | u16 seed | block
+//
+// (little endian) where block is one fountain combination of the payload, see
+// fountain.h. The payload itself is
+//
+//   u8 version | fields... | u32 CRC-32 of everything before it
+//
+// with every field a varint key (field id << 1 | wire type) followed by a varint
+// (wire type 0) or a varint length and that many bytes (wire type 1). Unknown
+// fields are skipped.
+//
+// Nothing here depends on ESP-IDF: the firmware decodes with it and the host CLI
+// in host_test/ encodes and decodes with it. provisioning_app/src/index.js is a
+// port of the encoder, `reconf_cli encode -t` prints the frames to check it against.
+
+#define RECONF_PREFIX "RECONF:"
+#define RECONF_VERSION 1
+#define RECONF_PACKET_HEADER_SIZE 8
+
+// Room for each string field in the firmware's QRInfo, the nul included. Longer
+// strings make the whole payload invalid; provisioning_app/src/index.js checks
+// the same limits before encoding.
+#define RECONF_WIFI_SIZE 30
+#define RECONF_URL_SIZE 100
+#define RECONF_DEVICE_NAME_SIZE 50
+#define RECONF_PROVISIONING_SIZE 21
+
+enum ReconfField
+{
+    ReconfWifiSsid = 1,
+    ReconfWifiPsw = 2,
+    ReconfThingsboardUrl = 3,
+    ReconfMqttBrokerUrl = 4,
+    ReconfDeviceName = 5,
+    ReconfSpaceId = 6,
+    ReconfProvisioningDeviceKey = 7,
+    ReconfProvisioningDeviceSecret = 8,
+    ReconfTotpFormBaseUrl = 9,
+    ReconfInvalidateThingsboardAuth = 10,
+    ReconfInvalidateBackendAuth = 11,
+    ReconfFieldCount,
+};
+
+enum ReconfReceiveResult
+{
+    ReconfRejected,  // not a reconf packet or doesn't fit the decoder
+    ReconfAccepted,  // progress, see the decoder rank
+    ReconfDuplicate, // the session is already complete
+    ReconfComplete,  // this packet completed the session
+    ReconfInvalid,   // this packet completed the session, its payload failed reconf_validate
+};
+
+struct ReconfPacket
+{
+    int id;
+    int k;
+    int len;
+    int seed;
+    const uint8_t *block;
+    int block_size;
+};
+
+// One payload field, either a number or a length delimited string
+struct ReconfValue
+{
+    int field;
+    bool is_bytes;
+    uint32_t number;
+    const uint8_t *bytes;
+    int len;
+};
+
+struct ReconfWriter
+{
+    uint8_t *buf;
+    int size;
+    int len;
+    bool overflow;
+};
+
+// Name used by the provisioning app and the config JSON, NULL if unknown
+const char *reconf_field_name(int field);
+
+// Field id for a name, -1 if unknown
+int reconf_field_id(const char *name);
+
+// True for the fields carried as strings
+bool reconf_field_is_bytes(int field);
+
+// Writes the base45 text of buf and a terminating nul. Returns the text length or
+// -1 if it doesn't fit.
+int base45_encode(const uint8_t *buf, int len, char *text, int text_size);
+
+// Decodes base45 text into buf. Returns the number of bytes or -1 on bad input.
+int base45_decode(const char *text, uint8_t *buf, int buf_size);
+
+// Parses a base45 decoded packet. block points into buf. Returns -1 if malformed.
+int reconf_parse_packet(const uint8_t *buf, int len, struct ReconfPacket *packet);
+
+// Writes the text of one frame, RECONF_PREFIX included, for a payload cut into
+// block_size blocks. Returns the text length or -1 if it doesn't fit.
+int reconf_frame(const uint8_t *payload, int len, int id, int block_size, uint32_t seed, char *text, int text_size);
+
+// Feeds the text of one frame into the decoder, a new session restarts it
+enum ReconfReceiveResult reconf_receive(struct FountainDecoder *dec, const char *text);
+
+// reconf_receive, then reconf_validate on the payload the session completes with.
+// An invalid session is given up rather than decoded again: the app loops the same
+// frames, so they would only fail again. The decoder stays complete, the session's
+// later packets are ReconfDuplicate until the app starts another.
+enum ReconfReceiveResult reconf_receive_valid(struct FountainDecoder *dec, const char *text);
+
+void reconf_writer_init(struct ReconfWriter *writer, uint8_t *buf, int size);
+void reconf_put_number(struct ReconfWriter *writer, int field, uint32_t value);
+void reconf_put_bytes(struct ReconfWriter *writer, int field, const uint8_t *bytes, int len);
+
+// Appends the CRC, returns the payload length or -1 if it didn't fit
+int reconf_writer_finish(struct ReconfWriter *writer);
+
+// Checks the version and CRC. Returns -1 if either is wrong, otherwise the offset
+// of the CRC, where the fields end.
+int reconf_check(const uint8_t *payload, int len);
+
+// Longest string a field may carry, 0 for numbers and unknown fields
+int reconf_field_max_len(int field);
+
+// reconf_check, then every field must read and every known string fit in
+// reconf_field_max_len. Returns where the fields end or -1.
+int reconf_validate(const uint8_t *payload, int len);
+
+// Reads the field at *pos and moves past it, to be called from offset 1 up to the
+// offset reconf_check returned. Returns 1 for a field, 0 at the end and -1 if
+// malformed.
+int reconf_next_field(const uint8_t *payload, int end, int *pos, struct ReconfValue *value);
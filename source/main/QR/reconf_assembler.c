@@ -0,0 +1,156 @@
+#include "reconf_assembler.h"
+#include "crc32.h"
+
+#include <string.h>
+
+void assembler_init(struct ReconfAssembler *assembler, int timeout)
+{
+    memset(assembler, 0, sizeof(struct ReconfAssembler));
+    assembler->timeout = timeout;
+}
+
+bool assembler_expire(struct ReconfAssembler *assembler, int64_t now)
+{
+    if (assembler->active && now - assembler->last_activity >= assembler->timeout)
+    {
+        assembler_init(assembler, assembler->timeout);
+        return true;
+    }
+    return false;
+}
+
+enum AssemblerResult assembler_start(struct ReconfAssembler *assembler, uint32_t id, int segment_size,
+                                     int segment_count, bool has_hash, uint32_t hash, int64_t now)
+{
+    assembler_expire(assembler, now);
+
+    if (segment_size < 1 || segment_count < 1 || segment_count > ASSEMBLER_MAX_SEGMENTS ||
+        segment_size > ASSEMBLER_MAX_PAYLOAD / segment_count)
+    {
+        return AssemblerRejected;
+    }
+
+    if (assembler->active && assembler->id == id && assembler->segment_size == segment_size &&
+        assembler->segment_count == segment_count && assembler->has_hash == has_hash && assembler->hash == hash)
+    {
+        assembler->last_activity = now;
+        return AssemblerDuplicate;
+    }
+
+    assembler_init(assembler, assembler->timeout);
+    assembler->active = true;
+    assembler->id = id;
+    assembler->segment_size = segment_size;
+    assembler->segment_count = segment_count;
+    assembler->has_hash = has_hash;
+    assembler->hash = hash;
+    assembler->last_activity = now;
+    return AssemblerStarted;
+}
+
+int assembler_received(const struct ReconfAssembler *assembler)
+{
+    int count = 0;
+    for (int i = 0; i < ASSEMBLER_MAX_SEGMENTS / 32; i++)
+    {
+        count += __builtin_popcount(assembler->received[i]);
+    }
+    return count;
+}
+
+int assembler_utf16_len(const char *data, int len)
+{
+    int units = 0;
+    for (int i = 0; i < len; i++)
+    {
+        uint8_t c = (uint8_t)data[i];
+        if ((c & 0xc0) == 0x80)
+        {
+            continue; // continuation byte
+        }
+        // Four byte sequences are outside the BMP, a surrogate pair in JS
+        units += c >= 0xf0 ? 2 : 1;
+    }
+    return units;
+}
+
+int assembler_payload_len(const struct ReconfAssembler *assembler)
+{
+    return assembler->payload_len;
+}
+
+enum AssemblerResult assembler_segment(struct ReconfAssembler *assembler, uint32_t id, int index,
+                                       const char *data, int len, bool has_crc, uint32_t crc, int64_t now)
+{
+    assembler_expire(assembler, now);
+
+    if (!assembler->active || id != assembler->id || index < 0 || index >= assembler->segment_count)
+    {
+        return AssemblerRejected;
+    }
+
+    if (assembler->complete)
+    {
+        assembler->last_activity = now;
+        return AssemblerDuplicate;
+    }
+
+    // Every segment is full size except possibly the last one
+    bool last = index == assembler->segment_count - 1;
+    int units = assembler_utf16_len(data, len);
+    if (len < 1 || units > assembler->segment_size || (!last && units != assembler->segment_size))
+    {
+        return AssemblerRejected;
+    }
+
+    if (has_crc && crc32_ieee((const uint8_t *)data, len) != crc)
+    {
+        return AssemblerRejected;
+    }
+
+    uint32_t bit = 1u << (index % 32);
+    if (assembler->received[index / 32] & bit)
+    {
+        assembler->last_activity = now;
+        return AssemblerDuplicate;
+    }
+
+    if (len > ASSEMBLER_MAX_PAYLOAD - assembler->stored_len)
+    {
+        return AssemblerRejected;
+    }
+
+    memcpy(&assembler->stored[assembler->stored_len], data, len);
+    assembler->segment_offset[index] = assembler->stored_len;
+    assembler->segment_len[index] = len;
+    assembler->stored_len += len;
+    assembler->received[index / 32] |= bit;
+    assembler->last_activity = now;
+
+    if (assembler_received(assembler) < assembler->segment_count)
+    {
+        return AssemblerAccepted;
+    }
+
+    int payload_len = 0;
+    for (int i = 0; i < assembler->segment_count; i++)
+    {
+        memcpy(&assembler->payload[payload_len], &assembler->stored[assembler->segment_offset[i]],
+               assembler->segment_len[i]);
+        payload_len += assembler->segment_len[i];
+    }
+    assembler->payload[payload_len] = '\0';
+
+    if (assembler->has_hash && crc32_ieee((const uint8_t *)assembler->payload, payload_len) != assembler->hash)
+    {
+        // Some segment was bad without a crc of its own to tell, start collecting again
+        memset(assembler->received, 0, sizeof(assembler->received));
+        assembler->stored_len = 0;
+        return AssemblerRejected;
+    }
+
+    assembler->payload_len = payload_len;
+
+    assembler->complete = true;
+    return AssemblerComplete;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Assembles the legacy JSON reconf transfer:
+//
+//   reconf{"packet_type":"start","segment_size":S,"segment_count":N[,"id":I][,"hash":H]}
+//   reconf{"packet_type":"segment","i":n,"data":"..."[,"id":I][,"crc":C]}
+//
+// id, hash (CRC-32 of the whole payload) and crc (CRC-32 of the segment) are
+// optional so older apps keep working, they are checked whenever present. Segments
+// may arrive in any order and any number of times. Repeating the start of the
+// running session doesn't reset it, a start with another id replaces it. Nothing
+// here depends on ESP-IDF, the clock is passed in so it can be tested on a host.
+//
+// The app slices a JS string, so S counts UTF-16 code units while data arrives as
+// UTF-8: a segment with non-ASCII text is longer in bytes than S. Segments are
+// stored as they come and laid out in order once all of them are in.
+
+#define ASSEMBLER_MAX_SEGMENTS 64
+#define ASSEMBLER_MAX_PAYLOAD 2048
+
+enum AssemblerResult
+{
+    AssemblerAccepted,  // new segment stored
+    AssemblerDuplicate, // segment or start already seen
+    AssemblerRejected,  // out of bounds, wrong session or failed a check
+    AssemblerStarted,   // new session
+    AssemblerComplete,  // last segment stored and the payload hash matched
+};
+
+struct ReconfAssembler
+{
+    bool active;
+    bool complete; // kept until the timeout so a cycling app doesn't apply it twice
+    uint32_t id;
+    int segment_size;
+    int segment_count;
+    bool has_hash;
+    uint32_t hash;
+    int64_t last_activity; // seconds
+    int timeout;           // seconds
+    uint32_t received[ASSEMBLER_MAX_SEGMENTS / 32];
+    int segment_offset[ASSEMBLER_MAX_SEGMENTS]; // into stored
+    int segment_len[ASSEMBLER_MAX_SEGMENTS];    // bytes
+    int stored_len;
+    char stored[ASSEMBLER_MAX_PAYLOAD]; // segments in the order they arrived
+    int payload_len;
+    char payload[ASSEMBLER_MAX_PAYLOAD + 1];
+};
+
+void assembler_init(struct ReconfAssembler *assembler, int timeout);
+
+// Drops the session if nothing arrived for timeout seconds, returns true if it did
+bool assembler_expire(struct ReconfAssembler *assembler, int64_t now);
+
+enum AssemblerResult assembler_start(struct ReconfAssembler *assembler, uint32_t id, int segment_size,
+                                     int segment_count, bool has_hash, uint32_t hash, int64_t now);
+
+enum AssemblerResult assembler_segment(struct ReconfAssembler *assembler, uint32_t id, int index,
+                                       const char *data, int len, bool has_crc, uint32_t crc, int64_t now);
+
+int assembler_received(const struct ReconfAssembler *assembler);
+
+// Length of UTF-8 data in UTF-16 code units, the unit segment_size is given in
+int assembler_utf16_len(const char *data, int len);
+
+// Payload length in bytes once complete
+int assembler_payload_len(const struct ReconfAssembler *assembler);
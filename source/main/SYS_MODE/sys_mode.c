@@ -7,6 +7,7 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "../common.h"
+#include "../QR/qr_validate.h"
 
 #define TAG "sys_mode"
 
@@ -15,6 +16,13 @@ struct sys_mode_state state = {
     .task_delay = DEFAULT_TASK_DELAY,
     .idle_task_delay = DEFAULT_IDLE_TASK_DELAY,
     .ping_delay = DEFAULT_PING_DELAY,
+    .qr_stop_after_first = DEFAULT_QR_STOP_AFTER_FIRST,
+    .qr_dedup_ttl = DEFAULT_QR_DEDUP_TTL,
+    .qr_prefix = DEFAULT_QR_PREFIX,
+    .qr_min_len = DEFAULT_QR_MIN_LEN,
+    .qr_max_len = DEFAULT_QR_MAX_LEN,
+    .qr_format = DEFAULT_QR_FORMAT,
+    .qr_accept_totp_form = DEFAULT_QR_ACCEPT_TOTP_FORM,
     .ota_running = false,
     .mqtt_normal_operation = false,
     .last_ping_time = -1,
@@ -148,6 +156,88 @@ int get_ping_delay()
     return ret;
 }
 
+void set_qr_stop_after_first(bool qr_stop_after_first)
+{
+    critical_section(state.qr_stop_after_first = qr_stop_after_first);
+}
+
+bool get_qr_stop_after_first()
+{
+    bool ret = DEFAULT_QR_STOP_AFTER_FIRST;
+    critical_section(ret = state.qr_stop_after_first);
+    return ret;
+}
+
+void set_qr_dedup_ttl(int qr_dedup_ttl)
+{
+    critical_section(state.qr_dedup_ttl = qr_dedup_ttl);
+}
+
+int get_qr_dedup_ttl()
+{
+    int ret = DEFAULT_QR_DEDUP_TTL;
+    critical_section(ret = state.qr_dedup_ttl);
+    return ret;
+}
+
+void set_qr_prefix(const char *qr_prefix)
+{
+    critical_section(snprintf(state.qr_prefix, sizeof(state.qr_prefix), "%s", qr_prefix));
+}
+
+void get_qr_prefix(char qr_prefix[QR_PREFIX_SIZE])
+{
+    critical_section(strcpy(qr_prefix, state.qr_prefix));
+}
+
+void set_qr_min_len(int qr_min_len)
+{
+    critical_section(state.qr_min_len = qr_min_len);
+}
+
+int get_qr_min_len()
+{
+    int ret = DEFAULT_QR_MIN_LEN;
+    critical_section(ret = state.qr_min_len);
+    return ret;
+}
+
+void set_qr_max_len(int qr_max_len)
+{
+    critical_section(state.qr_max_len = qr_max_len);
+}
+
+int get_qr_max_len()
+{
+    int ret = DEFAULT_QR_MAX_LEN;
+    critical_section(ret = state.qr_max_len);
+    return ret;
+}
+
+void set_qr_format(int qr_format)
+{
+    critical_section(state.qr_format = qr_format);
+}
+
+int get_qr_format()
+{
+    int ret = DEFAULT_QR_FORMAT;
+    critical_section(ret = state.qr_format);
+    return ret;
+}
+
+void set_qr_accept_totp_form(bool qr_accept_totp_form)
+{
+    critical_section(state.qr_accept_totp_form = qr_accept_totp_form);
+}
+
+bool get_qr_accept_totp_form()
+{
+    bool ret = DEFAULT_QR_ACCEPT_TOTP_FORM;
+    critical_section(ret = state.qr_accept_totp_form);
+    return ret;
+}
+
 void set_ota_running(bool ota_running)
 {
     critical_section(state.ota_running = ota_running);
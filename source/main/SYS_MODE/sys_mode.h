@@ -30,6 +30,13 @@ struct sys_mode_state
     int rt_task_delay;
     int idle_task_delay;
     int ping_delay;
+    bool qr_stop_after_first;
+    int qr_dedup_ttl;
+    char qr_prefix[QR_PREFIX_SIZE];
+    int qr_min_len;
+    int qr_max_len;
+    int qr_format;
+    bool qr_accept_totp_form;
     bool ota_running;
     char totp_form_base_url[URL_SIZE];
     enum ScreenMode mode;
@@ -69,6 +76,27 @@ int get_idle_task_delay();
 void set_ping_delay(int ping_delay);
 int get_ping_delay();
 
+void set_qr_stop_after_first(bool qr_stop_after_first);
+bool get_qr_stop_after_first();
+
+void set_qr_dedup_ttl(int qr_dedup_ttl);
+int get_qr_dedup_ttl();
+
+void set_qr_prefix(const char *qr_prefix);
+void get_qr_prefix(char qr_prefix[QR_PREFIX_SIZE]);
+
+void set_qr_min_len(int qr_min_len);
+int get_qr_min_len();
+
+void set_qr_max_len(int qr_max_len);
+int get_qr_max_len();
+
+void set_qr_format(int qr_format);
+int get_qr_format();
+
+void set_qr_accept_totp_form(bool qr_accept_totp_form);
+bool get_qr_accept_totp_form();
+
 void set_ota_running(bool ota_running);
 bool is_ota_running();
 
@@ -0,0 +1,355 @@
+#!/usr/bin/env python3
+"""Writes an LVGL font holding only the glyphs the firmware's strings use.
+
+Run by the build (main/CMakeLists.txt) and the host test, nothing generated is
+committed. The string literals of the given C sources are collected, leaving out
+the ones only logged (ESP_LOGx, printf) and the preprocessor lines, printf
+conversions are replaced by the characters they can print, and the extra
+characters given with -e are added. The glyphs are copied from a font
+lv_font_conv wrote (the Montserrat fonts vendored with LVGL), so no rasterizer
+is needed: a character the source font lacks is reported and left out, LVGL
+draws its placeholder box as it did before.
+
+    font_subset.py -o screen_font.c -n screen_font -f lv_font_montserrat_14.c \\
+                   --extra=0123456789 screen.c ota.c ...
+
+The glyphs are renumbered in codepoint order. The Latin-1 ones, all the
+firmware shows, get one direct lookup cmap with a byte per codepoint of their
+span: the glyph id, 0 for a letter left out, so a lookup is an index as in the
+source font's ASCII range. Above Latin-1, runs of at least RUN_MIN consecutive
+codepoints get a direct lookup cmap each, longest first, the rest go to one
+sorted codepoint list LVGL binary searches. Only the kerning classes of the kept
+glyphs are written.
+
+Only the standard library is used.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+RUN_MIN = 8
+DIRECT_MAX = 0xff  # codepoints in the one id per codepoint cmap, its ids fit a byte
+
+TOKEN = re.compile(r'''
+    (?P<comment>//[^\n]*|/\*.*?\*/)
+  | (?P<string>"(?:[^"\\\n]|\\.)*")
+  | (?P<char>'(?:[^'\\\n]|\\.)*')
+  | (?P<directive>^[ \t]*\#(?:[^\n]*\\\n)*[^\n]*)
+  | (?P<ident>[A-Za-z_]\w*)
+  | (?P<paren>[()])
+''', re.S | re.M | re.X)
+
+LOG_CALL = re.compile(r'ESP_LOG\w*|ESP_EARLY_LOG\w*|printf|puts')
+
+CONVERSION = re.compile(r'%[-+ #0]*(?:\d+|\*)?(?:\.(?:\d+|\*))?(?:hh|h|ll|l|j|z|t|L)?([diouxXeEfgGcspn%])')
+
+# What a conversion can print, %s and %c print strings the sources hold anyway
+CONVERSION_CHARS = {
+    'd': '-0123456789', 'i': '-0123456789', 'u': '0123456789', 'o': '01234567',
+    'x': '0123456789abcdef', 'X': '0123456789ABCDEF', 'f': '-.0123456789', 'e': '-+.0123456789e',
+    'E': '-+.0123456789E', 'g': '-+.0123456789e', 'G': '-+.0123456789E', 'p': '0123456789abcdefx', '%': '%',
+}
+
+ESCAPES = {'n': '\n', 't': '\t', 'r': '\r', '0': '\0', 'a': '\a', 'b': '\b', 'f': '\f', 'v': '\v'}
+
+CMAP_FORMAT0_TINY = 'LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY'
+CMAP_FORMAT0_FULL = 'LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL'
+CMAP_SPARSE_TINY = 'LV_FONT_FMT_TXT_CMAP_SPARSE_TINY'
+
+# sizeof on the ESP32: lv_font_fmt_txt_glyph_dsc_t and lv_font_fmt_txt_cmap_t
+GLYPH_DSC_SIZE = 8
+CMAP_SIZE = 20
+
+
+def unescape(body):
+    """The bytes of a C string literal's body, as UTF-8 text"""
+    out = bytearray()
+    i = 0
+    while i < len(body):
+        c = body[i]
+        if c != '\\':
+            out += c.encode()
+            i += 1
+            continue
+        c = body[i + 1]
+        if c == 'x':
+            digits = re.match(r'[0-9a-fA-F]+', body[i + 2:]).group()
+            out.append(int(digits, 16) & 0xff)
+            i += 2 + len(digits)
+        elif c in '01234567':
+            digits = re.match(r'[0-7]{1,3}', body[i + 1:]).group()
+            out.append(int(digits, 8) & 0xff)
+            i += 1 + len(digits)
+        else:
+            out += ESCAPES.get(c, c).encode()
+            i += 2
+    return out.decode('utf-8', errors='replace')
+
+
+def shown_strings(path):
+    """The string literals of a C source but the logged ones and the directives'"""
+    strings = []
+    skip_depth = 0   # parentheses still open in a logging call
+    skip_next = False
+    for token in TOKEN.finditer(open(path, encoding='utf-8').read()):
+        kind = token.lastgroup
+        text = token.group()
+        if kind == 'ident':
+            skip_next = skip_depth == 0 and LOG_CALL.fullmatch(text) is not None
+        elif kind == 'paren':
+            if skip_next:
+                skip_depth, skip_next = 1, False
+            elif skip_depth:
+                skip_depth += 1 if text == '(' else -1
+        elif kind == 'string':
+            skip_next = False
+            if not skip_depth:
+                strings.append(unescape(text[1:-1]))
+    return strings
+
+
+def charset(strings, extra):
+    chars = set(extra)
+    for s in strings:
+        for conversion in CONVERSION.finditer(s):
+            chars.update(CONVERSION_CHARS.get(conversion.group(1), ''))
+        chars.update(CONVERSION.sub('', s))
+    return sorted(ord(c) for c in chars if ord(c) >= 0x20 and ord(c) != 0x7f)
+
+
+def array(source, name):
+    """The body of a static array definition, comments removed"""
+    match = re.search(r'\b' + name + r'\[\]\s*=\s*\{(.*?)\};', source, re.S)
+    if match is None:
+        sys.exit(f'font: no {name}[] in the source font')
+    return re.sub(r'/\*.*?\*/', '', match.group(1), flags=re.S)
+
+
+def numbers(body):
+    return [int(v, 0) for v in re.findall(r'-?(?:0x[0-9a-fA-F]+|\d+)', body)]
+
+
+def field(source, name):
+    match = re.search(r'\.' + name + r'\s*=\s*(-?\d+)', source)
+    if match is None:
+        sys.exit(f'font: no .{name} in the source font')
+    return int(match.group(1))
+
+
+def read_font(path):
+    """Returns the glyphs of an lv_font_conv font: {codepoint: glyph} and its parameters"""
+    source = open(path, encoding='utf-8').read()
+    params = {name: field(source, name) for name in
+              ('line_height', 'base_line', 'underline_position', 'underline_thickness', 'bpp', 'kern_scale',
+               'bitmap_format', 'kern_classes')}
+    if params['bitmap_format'] != 0 or params['kern_classes'] != 1:
+        sys.exit(f'{path}: only uncompressed fonts with class kerning are supported')
+
+    bitmap = bytes(numbers(array(source, 'glyph_bitmap')))
+    dscs = [tuple(int(v) for v in m) for m in re.findall(
+        r'\.bitmap_index = (\d+), \.adv_w = (\d+), \.box_w = (\d+), \.box_h = (\d+), '
+        r'\.ofs_x = (-?\d+), \.ofs_y = (-?\d+)', source)]
+    left_classes = numbers(array(source, 'kern_left_class_mapping'))
+    right_classes = numbers(array(source, 'kern_right_class_mapping'))
+    class_values = numbers(array(source, 'kern_class_values'))
+    right_class_cnt = field(source, 'right_class_cnt')
+
+    glyphs = {}
+    for cmap in re.finditer(r'\.range_start = (\d+), \.range_length = (\d+), \.glyph_id_start = (\d+),\s*'
+                            r'\.unicode_list = (\w+), \.glyph_id_ofs_list = (\w+), \.list_length = (\d+), '
+                            r'\.type = (\w+)', source):
+        start, length, first_id = int(cmap.group(1)), int(cmap.group(2)), int(cmap.group(3))
+        if cmap.group(7) == CMAP_FORMAT0_TINY:
+            offsets = range(length)
+        elif cmap.group(7) == CMAP_SPARSE_TINY:
+            offsets = numbers(array(source, cmap.group(4)))
+        else:
+            sys.exit(f'{path}: {cmap.group(7)} cmaps are not supported')
+
+        for i, offset in enumerate(offsets):
+            gid = first_id + i
+            index, adv_w, box_w, box_h, ofs_x, ofs_y = dscs[gid]
+            size = (box_w * box_h * params['bpp'] + 7) // 8
+            glyphs[start + offset] = {
+                'bitmap': bitmap[index:index + size], 'adv_w': adv_w, 'box_w': box_w, 'box_h': box_h,
+                'ofs_x': ofs_x, 'ofs_y': ofs_y, 'left': left_classes[gid], 'right': right_classes[gid],
+            }
+
+    def kern(left, right):
+        return class_values[(left - 1) * right_class_cnt + right - 1]
+
+    return glyphs, params, kern
+
+
+def source_size(glyphs, path):
+    """Flash the source font's tables take, to report against"""
+    source = open(path, encoding='utf-8').read()
+    bitmap = len(numbers(array(source, 'glyph_bitmap')))
+    lists = sum(len(numbers(body)) for body in re.findall(r'unicode_list_\d+\[\]\s*=\s*\{(.*?)\};', source, re.S))
+    cmaps = len(re.findall(r'\.range_start =', source))
+    kern = len(numbers(array(source, 'kern_class_values')))
+    return bitmap + (len(glyphs) + 1) * (GLYPH_DSC_SIZE + 2) + lists * 2 + cmaps * CMAP_SIZE + kern
+
+
+def cmaps_for(codepoints):
+    """Splits the sorted codepoints in a Latin-1 table, direct lookup runs and a sparse rest: [(kind, [codepoints])]"""
+    table = [cp for cp in codepoints if cp <= DIRECT_MAX][:255]
+    codepoints = codepoints[len(table):]
+    runs = []
+    rest = []
+    i = 0
+    while i < len(codepoints):
+        end = i + 1
+        while end < len(codepoints) and codepoints[end] == codepoints[end - 1] + 1:
+            end += 1
+        if end - i >= RUN_MIN:
+            runs.append(codepoints[i:end])
+        else:
+            rest += codepoints[i:end]
+        i = end
+
+    # LVGL walks the cmaps in order and stops at the first whose range holds the
+    # letter, so the runs go before the sparse list that may span them
+    runs.sort(key=len, reverse=True)
+    return (([(CMAP_FORMAT0_FULL, table)] if table else []) + [(CMAP_FORMAT0_TINY, run) for run in runs] +
+            ([(CMAP_SPARSE_TINY, rest)] if rest else []))
+
+
+def c_values(values, per_line=16, fmt='{}'):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append('    ' + ', '.join(fmt.format(v) for v in values[i:i + per_line]) + ',')
+    return '\n'.join(lines)
+
+
+def write_font(name, font_path, glyphs, params, kern, codepoints):
+    cmaps = cmaps_for(codepoints)
+    order = [cp for _, cps in cmaps for cp in cps]
+
+    # Keep only the kerning classes some kept glyph has, renumbered from 1
+    lefts = sorted(set(glyphs[cp]['left'] for cp in order) - {0})
+    rights = sorted(set(glyphs[cp]['right'] for cp in order) - {0})
+    left_of = {c: i + 1 for i, c in enumerate(lefts)}
+    right_of = {c: i + 1 for i, c in enumerate(rights)}
+    values = [kern(left, right) for left in lefts for right in rights]
+    if not any(values):
+        lefts, rights, values = [], [], []
+
+    out = [f'// Generated by font_subset.py from {os.path.basename(font_path)}, do not edit',
+           '#include "lvgl.h"', '']
+
+    bitmap = bytearray()
+    dscs = ['    {.bitmap_index = 0, .adv_w = 0, .box_w = 0, .box_h = 0, .ofs_x = 0, .ofs_y = 0},']
+    for cp in order:
+        g = glyphs[cp]
+        dscs.append(f'    {{.bitmap_index = {len(bitmap)}, .adv_w = {g["adv_w"]}, .box_w = {g["box_w"]}, '
+                    f'.box_h = {g["box_h"]}, .ofs_x = {g["ofs_x"]}, .ofs_y = {g["ofs_y"]}}}, '
+                    f'/* U+{cp:04X} */')
+        bitmap += g['bitmap']
+
+    out.append(f'static LV_ATTRIBUTE_LARGE_CONST const uint8_t glyph_bitmap[] = {{\n'
+               f'{c_values(list(bitmap), fmt="0x{:02x}")}\n}};\n')
+    out.append('static const lv_font_fmt_txt_glyph_dsc_t glyph_dsc[] = {\n' + '\n'.join(dscs) + '\n};\n')
+
+    entries = []
+    gid = 1
+    for kind, cps in cmaps:
+        unicode_list = 'NULL'
+        ofs_list = 'NULL'
+        first_id = gid
+        if kind == CMAP_SPARSE_TINY:
+            unicode_list = 'unicode_list'
+            out.append(f'static const uint16_t unicode_list[] = {{\n'
+                       f'{c_values([cp - cps[0] for cp in cps], 8, "0x{:x}")}\n}};\n')
+        elif kind == CMAP_FORMAT0_FULL:
+            # Ids counted from 0 so a letter left out maps to glyph 0, not found
+            ids = {cp: gid + i for i, cp in enumerate(cps)}
+            ofs_list = 'glyph_id_ofs_list'
+            first_id = 0
+            out.append(f'static const uint8_t glyph_id_ofs_list[] = {{\n'
+                       f'{c_values([ids.get(cp, 0) for cp in range(cps[0], cps[-1] + 1)])}\n}};\n')
+        entries.append(f'    {{\n        .range_start = {cps[0]}, .range_length = {cps[-1] - cps[0] + 1}, '
+                       f'.glyph_id_start = {first_id},\n        .unicode_list = {unicode_list}, '
+                       f'.glyph_id_ofs_list = {ofs_list}, '
+                       f'.list_length = {len(cps) if kind == CMAP_SPARSE_TINY else 0}, .type = {kind}\n    }},')
+        gid += len(cps)
+    out.append('static const lv_font_fmt_txt_cmap_t cmaps[] = {\n' + '\n'.join(entries) + '\n};\n')
+
+    if values:
+        out.append(f'static const uint8_t kern_left_class_mapping[] = {{\n'
+                   f'{c_values([0] + [left_of.get(glyphs[cp]["left"], 0) for cp in order])}\n}};\n')
+        out.append(f'static const uint8_t kern_right_class_mapping[] = {{\n'
+                   f'{c_values([0] + [right_of.get(glyphs[cp]["right"], 0) for cp in order])}\n}};\n')
+        out.append(f'static const int8_t kern_class_values[] = {{\n{c_values(values)}\n}};\n')
+        out.append('static const lv_font_fmt_txt_kern_classes_t kern_classes = {\n'
+                   '    .class_pair_values = kern_class_values,\n'
+                   '    .left_class_mapping = kern_left_class_mapping,\n'
+                   '    .right_class_mapping = kern_right_class_mapping,\n'
+                   f'    .left_class_cnt = {len(lefts)},\n'
+                   f'    .right_class_cnt = {len(rights)},\n'
+                   '};\n')
+
+    out.append('static lv_font_fmt_txt_glyph_cache_t cache;\n')
+    out.append('static const lv_font_fmt_txt_dsc_t font_dsc = {\n'
+               '    .glyph_bitmap = glyph_bitmap,\n'
+               '    .glyph_dsc = glyph_dsc,\n'
+               '    .cmaps = cmaps,\n'
+               f'    .kern_dsc = {"&kern_classes" if values else "NULL"},\n'
+               f'    .kern_scale = {params["kern_scale"]},\n'
+               f'    .cmap_num = {len(cmaps)},\n'
+               f'    .bpp = {params["bpp"]},\n'
+               f'    .kern_classes = {1 if values else 0},\n'
+               '    .bitmap_format = LV_FONT_FMT_TXT_PLAIN,\n'
+               '    .cache = &cache,\n'
+               '};\n')
+    out.append(f'const lv_font_t {name} = {{\n'
+               '    .get_glyph_dsc = lv_font_get_glyph_dsc_fmt_txt,\n'
+               '    .get_glyph_bitmap = lv_font_get_bitmap_fmt_txt,\n'
+               f'    .line_height = {params["line_height"]},\n'
+               f'    .base_line = {params["base_line"]},\n'
+               '    .subpx = LV_FONT_SUBPX_NONE,\n'
+               f'    .underline_position = {params["underline_position"]},\n'
+               f'    .underline_thickness = {params["underline_thickness"]},\n'
+               '    .dsc = &font_dsc,\n'
+               '};\n')
+
+    size = (len(bitmap) + len(dscs) * GLYPH_DSC_SIZE + len(cmaps) * CMAP_SIZE +
+            sum(len(cps) * 2 for kind, cps in cmaps if kind == CMAP_SPARSE_TINY) +
+            sum(cps[-1] - cps[0] + 1 for kind, cps in cmaps if kind == CMAP_FORMAT0_FULL) +
+            (len(dscs) * 2 + len(values) if values else 0))
+    return '\n'.join(out), size, cmaps
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('-o', '--output', required=True)
+    parser.add_argument('-n', '--name', required=True, help='the lv_font_t to define')
+    parser.add_argument('-f', '--font', required=True, help='an lv_font_conv C font to take the glyphs from')
+    parser.add_argument('-e', '--extra', default='', help='characters to keep besides the sources\' ones')
+    parser.add_argument('sources', nargs='+')
+    args = parser.parse_args()
+
+    glyphs, params, kern = read_font(args.font)
+    wanted = charset([s for path in args.sources for s in shown_strings(path)], args.extra)
+    for cp in wanted:
+        if cp not in glyphs:
+            print(f'warning: {os.path.basename(args.font)} has no glyph for {chr(cp)!r} (U+{cp:04X}), '
+                  f'it is shown as a placeholder', file=sys.stderr)
+    codepoints = [cp for cp in wanted if cp in glyphs]
+
+    text, size, cmaps = write_font(args.name, args.font, glyphs, params, kern, codepoints)
+    total = source_size(glyphs, args.font)
+    print(f'{args.name}: {len(codepoints)} of {len(glyphs)} glyphs, '
+          f'{sum(kind != CMAP_SPARSE_TINY for kind, _ in cmaps)} direct and '
+          f'{sum(kind == CMAP_SPARSE_TINY for kind, _ in cmaps)} sparse cmaps, '
+          f'{total} -> {size} bytes of flash ({100.0 * size / total:.1f}%)')
+
+    if not os.path.exists(args.output) or open(args.output).read() != text:
+        with open(args.output, 'w') as f:
+            f.write(text)
+
+
+if __name__ == '__main__':
+    main()
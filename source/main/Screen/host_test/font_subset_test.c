@@ -0,0 +1,215 @@
+/*
+ * Compares the font font_subset.py writes for the firmware's strings with the
+ * Montserrat 14 it was cut from: every letter it has must give the same glyph,
+ * bitmap and kerning as there, every letter it doesn't must not be found (the
+ * one after each direct lookup range included), and the strings screen_task
+ * shows must be covered but for the accents Montserrat lacks. With -b it prints
+ * the best time of a few rounds to look the strings' glyphs up and to draw them
+ * in a label with each font.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl.h"
+
+#define DRAW_BUF_LINES 10
+#define BENCH_RUNS 2000
+#define BENCH_ROUNDS 7
+#define LAST_LETTER 0xffff
+
+LV_FONT_DECLARE(screen_font);
+
+/* As screen_task, ota.c, qr_logic.c and bt_logic.c fill them in */
+static const char *shown[] = {
+    "estado: NoBackendAuth",
+    "estado: Success",
+    "tarjeta leida",
+    "Recieving configuration\n12/40",
+    "Recieving configuration is over",
+    "Downloaded: 57%\nETA: 13s",
+    "downloaded data couldnt be verified",
+    "pulse los 4 botones para continuar",
+    "la version del ota es la misma que la versi\xc3\xb3n actual",
+};
+
+#define SHOWN_COUNT (sizeof(shown) / sizeof(shown[0]))
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    lv_disp_flush_ready(drv);
+}
+
+static void headless_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[240 * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, 240 * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = 240;
+    drv.ver_res = 240;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    lv_disp_drv_register(&drv);
+}
+
+static bool has_glyph(const lv_font_t *font, uint32_t letter)
+{
+    lv_font_glyph_dsc_t dsc;
+    return font->get_glyph_dsc(font, &dsc, letter, 0);
+}
+
+static int check_glyph(uint32_t letter)
+{
+    lv_font_glyph_dsc_t sub, full;
+    bool in_sub = lv_font_get_glyph_dsc(&screen_font, &sub, letter, 0);
+    bool in_full = lv_font_get_glyph_dsc(&lv_font_montserrat_14, &full, letter, 0);
+
+    if (!in_sub) {
+        return 0;
+    }
+    if (!in_full) {
+        printf("U+%04X: not in Montserrat 14 but found in the subset\n", letter);
+        return 1;
+    }
+    if (sub.adv_w != full.adv_w || sub.box_w != full.box_w || sub.box_h != full.box_h || sub.ofs_x != full.ofs_x ||
+        sub.ofs_y != full.ofs_y || sub.bpp != full.bpp) {
+        printf("U+%04X: glyph differs\n", letter);
+        return 1;
+    }
+
+    size_t size = (sub.box_w * sub.box_h * sub.bpp + 7) / 8;
+    const uint8_t *sub_bitmap = lv_font_get_glyph_bitmap(&screen_font, letter);
+    const uint8_t *full_bitmap = lv_font_get_glyph_bitmap(&lv_font_montserrat_14, letter);
+    if (size && memcmp(sub_bitmap, full_bitmap, size) != 0) {
+        printf("U+%04X: bitmap differs\n", letter);
+        return 1;
+    }
+    return 0;
+}
+
+static int check_kerning(const uint32_t *letters, int count)
+{
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < count; j++) {
+            uint16_t sub = lv_font_get_glyph_width(&screen_font, letters[i], letters[j]);
+            uint16_t full = lv_font_get_glyph_width(&lv_font_montserrat_14, letters[i], letters[j]);
+            if (sub != full) {
+                printf("U+%04X U+%04X: %u wide, %u in Montserrat 14\n", letters[i], letters[j], sub, full);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int check_shown(void)
+{
+    int failures = 0;
+
+    for (size_t i = 0; i < SHOWN_COUNT; i++) {
+        uint32_t ofs = 0;
+        while (shown[i][ofs]) {
+            uint32_t letter = _lv_txt_encoded_next(shown[i], &ofs);
+            if (letter >= 0x20 && !has_glyph(&screen_font, letter) && has_glyph(&lv_font_montserrat_14, letter)) {
+                printf("\"%s\": U+%04X missing from the subset\n", shown[i], letter);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+static double lookup_time(const lv_font_t *font)
+{
+    lv_font_glyph_dsc_t dsc;
+    double start = now_us();
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        for (size_t i = 0; i < SHOWN_COUNT; i++) {
+            uint32_t ofs = 0;
+            uint32_t letter = _lv_txt_encoded_next(shown[i], &ofs);
+            while (letter) {
+                uint32_t next = _lv_txt_encoded_next(shown[i], &ofs);
+                lv_font_get_glyph_dsc(font, &dsc, letter, next);
+                letter = next;
+            }
+        }
+    }
+    return (now_us() - start) / BENCH_RUNS;
+}
+
+static double draw_time(const lv_font_t *font)
+{
+    lv_obj_t *label = lv_label_create(lv_scr_act());
+    lv_obj_set_width(label, 150);
+    lv_obj_center(label);
+    lv_obj_set_style_text_font(label, font, LV_PART_MAIN);
+
+    double start = now_us();
+    for (int run = 0; run < BENCH_RUNS / 10; run++) {
+        lv_label_set_text_static(label, shown[run % SHOWN_COUNT]);
+        lv_refr_now(NULL);
+    }
+    double time = (now_us() - start) / (BENCH_RUNS / 10);
+
+    lv_obj_del(label);
+    return time;
+}
+
+/* The best of rounds taking turns between the fonts, so neither pays for a cold cache or the other's noise */
+static void benchmark(void)
+{
+    double lookup[2] = {1e9, 1e9};
+    double draw[2] = {1e9, 1e9};
+    const lv_font_t *fonts[2] = {&screen_font, &lv_font_montserrat_14};
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int f = 0; f < 2; f++) {
+            const lv_font_t *font = fonts[(f + round) % 2];
+            int i = font == &lv_font_montserrat_14;
+            double time = lookup_time(font);
+            lookup[i] = time < lookup[i] ? time : lookup[i];
+            time = draw_time(font);
+            draw[i] = time < draw[i] ? time : draw[i];
+        }
+    }
+    printf("glyph lookup of the shown strings: %7.2f us subset, %7.2f us Montserrat 14\n", lookup[0], lookup[1]);
+    printf("label draw:                        %7.2f us subset, %7.2f us Montserrat 14\n", draw[0], draw[1]);
+}
+
+int main(int argc, char **argv)
+{
+    static uint32_t letters[LAST_LETTER + 1];
+    int glyphs = 0;
+    int failures = 0;
+
+    headless_display();
+
+    for (uint32_t letter = 0x20; letter <= LAST_LETTER; letter++) {
+        failures += check_glyph(letter);
+        if (has_glyph(&screen_font, letter)) {
+            letters[glyphs++] = letter;
+        }
+    }
+    failures += check_kerning(letters, glyphs);
+    failures += check_shown();
+    printf("%d glyphs, %d failures\n", glyphs, failures);
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        benchmark();
+    }
+
+    return failures ? 1 : 0;
+}
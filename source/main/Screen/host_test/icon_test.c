@@ -0,0 +1,173 @@
+/*
+ * Expands every icon packed by pack_icons.py and checks the pixels against the
+ * CRC the packer took of them, that truncated data is refused, and that
+ * icon_get() expands once and serves the same image afterwards. With -b it
+ * prints the flash taken by the packed icons, the time to expand each and the
+ * time to show it on the headless display the first time and from the cache.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl.h"
+#include "icon/icon_pack.h"
+#include "QR/crc32.h"
+
+#define DRAW_BUF_LINES 10
+#define BENCH_RUNS 200
+
+extern const struct PackedIcon success_packed, failure_packed, warning_packed, noQr_packed, noWifi_packed,
+    noTB_packed, noBackend_packed, noBackendAuth_packed, noTBAuth_packed;
+
+static const struct PackedIcon *icons[] = {&success_packed, &failure_packed, &warning_packed,
+                                           &noQr_packed, &noWifi_packed, &noTB_packed,
+                                           &noBackend_packed, &noBackendAuth_packed, &noTBAuth_packed};
+
+#define ICON_COUNT (sizeof(icons) / sizeof(icons[0]))
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    lv_disp_flush_ready(drv);
+}
+
+static void headless_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[240 * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, 240 * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = 240;
+    drv.ver_res = 240;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    lv_disp_drv_register(&drv);
+}
+
+static const char *format_name(uint8_t format)
+{
+    static const char *names[] = {"rgb565 packbits", "indexed packbits", "rgb565 lz4", "indexed lz4"};
+    return names[format & 3];
+}
+
+static int check_unpack(const struct PackedIcon *icon)
+{
+    size_t size = (size_t)icon->width * icon->height * 2;
+    uint8_t *pixels = malloc(size);
+    int failures = 0;
+
+    if (!icon_unpack(icon, pixels)) {
+        printf("%s: not expanded\n", icon->name);
+        failures++;
+    }
+    else if (crc32_ieee(pixels, size) != icon->crc) {
+        printf("%s: expanded pixels differ from the packed ones\n", icon->name);
+        failures++;
+    }
+
+    // Cut short anywhere, the data must be refused rather than read past
+    struct PackedIcon cut = *icon;
+    for (uint32_t keep = 0; keep < icon->data_size; keep += 1 + icon->data_size / 97) {
+        cut.data_size = keep;
+        if (icon_unpack(&cut, pixels)) {
+            printf("%s: accepted with %u of %u bytes\n", icon->name, keep, icon->data_size);
+            failures++;
+            break;
+        }
+    }
+
+    free(pixels);
+    return failures;
+}
+
+static int check_cache(void)
+{
+    struct IconCacheStats stats;
+    int failures = 0;
+
+    const lv_img_dsc_t *first = icon_get(&noWifi_packed);
+    const lv_img_dsc_t *again = icon_get(&noWifi_packed);
+    icon_get_stats(&stats);
+
+    if (first == NULL || first != again || stats.misses != 1 || stats.hits != 1) {
+        printf("cache: %p then %p, %d misses %d hits\n", (void *)first, (void *)again, stats.misses, stats.hits);
+        failures++;
+    }
+    if (first != NULL && (first->header.w != 240 || first->header.cf != LV_IMG_CF_TRUE_COLOR ||
+                          crc32_ieee(first->data, first->data_size) != noWifi_packed.crc)) {
+        printf("cache: wrong image\n");
+        failures++;
+    }
+
+    return failures;
+}
+
+static void benchmark(void)
+{
+    size_t raw = 0, packed = 0;
+    uint8_t *pixels = malloc(240 * 240 * 2);
+    lv_obj_t *img = lv_img_create(lv_scr_act());
+    lv_obj_center(img);
+
+    for (size_t i = 0; i < ICON_COUNT; i++) {
+        const struct PackedIcon *icon = icons[i];
+        raw += (size_t)icon->width * icon->height * 2;
+        packed += icon->data_size + icon->palette_size * 2;
+
+        double start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            icon_unpack(icon, pixels);
+        }
+        double unpack = (now_us() - start) / BENCH_RUNS;
+
+        // The cache check already showed noWifi once
+        start = now_us();
+        lv_img_set_src(img, icon_get(icon));
+        lv_refr_now(NULL);
+        double first = now_us() - start;
+
+        start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            lv_img_set_src(img, icon_get(icon));
+            lv_obj_invalidate(img);
+            lv_refr_now(NULL);
+        }
+        double cached = (now_us() - start) / BENCH_RUNS;
+
+        printf("%-14s %-17s %6u bytes, expand %7.1f us, first show %7.1f us, cached show %7.1f us\n", icon->name,
+               format_name(icon->format), icon->data_size + icon->palette_size * 2, unpack, first, cached);
+    }
+
+    printf("flash: %zu bytes packed, %zu as true colour arrays (%.1f%%)\n", packed, raw, 100.0 * packed / raw);
+    free(pixels);
+}
+
+int main(int argc, char **argv)
+{
+    int failures = 0;
+
+    headless_display();
+
+    for (size_t i = 0; i < ICON_COUNT; i++) {
+        failures += check_unpack(icons[i]);
+    }
+    failures += check_cache();
+    printf("%zu icons, %d failures\n", ICON_COUNT, failures);
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        benchmark();
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,322 @@
+/*
+ * Runs LVGL on its builtin allocator with a second region, as the firmware does
+ * with PSRAM, and checks that the widgets created with the region selected land
+ * in it, that the render scratch stays in the builtin pool, that an allocation
+ * the selected region has no room for spills to the other one, that one no
+ * region has room for is counted as failed and that realloc moves a block across
+ * when it must. With -b it prints what the firmware's widgets take from each
+ * region, the peak of the builtin pool while they are redrawn and the cost of an
+ * allocation in each region.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl.h"
+#include "src/misc/lv_gc.h"
+
+#define DRAW_BUF_LINES 10
+#define LARGE_SIZE LV_MEM_REGION_MAX_SIZE // SCREEN_LVGL_PSRAM_SIZE
+#define REDRAWS 50
+#define FILL_BLOCK 256
+#define FILL_MAX 1024
+#define BENCH_RUNS 100000
+
+static uint8_t large_mem[LARGE_SIZE] __attribute__((aligned(8)));
+static uint32_t fast_at_start;
+static lv_mem_region_monitor_t fast_redrawn; // after check_placement, before the pool is filled on purpose
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    lv_disp_flush_ready(drv);
+}
+
+static void headless_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[240 * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, 240 * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = 240;
+    drv.ver_res = 240;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    lv_disp_drv_register(&drv);
+}
+
+static bool in_large(const void *p)
+{
+    return (const uint8_t *)p >= large_mem && (const uint8_t *)p < large_mem + LARGE_SIZE;
+}
+
+static uint32_t used(lv_mem_region_t region)
+{
+    lv_mem_region_monitor_t mon;
+    lv_mem_region_monitor(region, &mon);
+    return mon.used_size;
+}
+
+/* The widgets screen_task creates, with their styles */
+struct Widgets {
+    lv_obj_t *label;
+    lv_obj_t *notification;
+    lv_obj_t *qr_full;
+    lv_obj_t *qr_small;
+    lv_obj_t *img;
+};
+
+static void create_widgets(struct Widgets *widgets)
+{
+    static lv_style_t label_style;
+    lv_style_init(&label_style);
+    lv_style_set_text_color(&label_style, lv_color_black());
+
+    widgets->label = lv_label_create(lv_scr_act());
+    lv_obj_set_width(widgets->label, 150);
+    lv_obj_align(widgets->label, LV_ALIGN_CENTER, 0, 60);
+    lv_obj_add_style(widgets->label, &label_style, LV_PART_MAIN);
+
+    widgets->qr_full = lv_qrcode_create(lv_scr_act(), 240, lv_color_black(), lv_color_white());
+    lv_obj_center(widgets->qr_full);
+    widgets->qr_small = lv_qrcode_create(lv_scr_act(), 170, lv_color_black(), lv_color_white());
+    lv_obj_center(widgets->qr_small);
+    lv_qrcode_set_fixed_layout(true, LV_QRCODE_MASK_AUTO);
+
+    widgets->notification = lv_label_create(lv_scr_act());
+    lv_obj_set_width(widgets->notification, 150);
+    lv_obj_align(widgets->notification, LV_ALIGN_CENTER, 0, -100);
+    lv_obj_add_style(widgets->notification, &label_style, LV_PART_MAIN);
+
+    widgets->img = lv_img_create(lv_scr_act());
+    lv_obj_align(widgets->img, LV_ALIGN_CENTER, 0, 0);
+}
+
+static void delete_widgets(struct Widgets *widgets)
+{
+    lv_obj_del(widgets->label);
+    lv_obj_del(widgets->notification);
+    lv_obj_del(widgets->qr_full);
+    lv_obj_del(widgets->qr_small);
+    lv_obj_del(widgets->img);
+    lv_qrcode_set_fixed_layout(false, LV_QRCODE_MASK_AUTO);
+}
+
+/* A TOTP code each time, the label and notification texts changing with it */
+static void redraw(const struct Widgets *widgets, int runs)
+{
+    char text[100];
+
+    for (int run = 0; run < runs; run++) {
+        snprintf(text, sizeof(text), "https://example.org/a?totp=%06d&espacioId=1", run);
+        lv_obj_t *shown = run % 2 ? widgets->qr_small : widgets->qr_full;
+        lv_obj_t *hidden = run % 2 ? widgets->qr_full : widgets->qr_small;
+        lv_obj_add_flag(hidden, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(shown, LV_OBJ_FLAG_HIDDEN);
+        lv_qrcode_update(shown, text, strlen(text));
+
+        snprintf(text, sizeof(text), "estado: %s", run % 3 ? "NoTB" : "pulse los 4 botones para continuar");
+        lv_label_set_text(widgets->notification, text);
+        lv_refr_now(NULL);
+    }
+}
+
+static int check_placement(const struct Widgets *widgets, uint32_t fast_before)
+{
+    int failures = 0;
+    const void *large[] = {widgets->label, widgets->notification, widgets->qr_full, widgets->qr_small, widgets->img,
+                           lv_canvas_get_img(widgets->qr_full)->data, lv_canvas_get_img(widgets->qr_small)->data};
+
+    for (size_t i = 0; i < sizeof(large) / sizeof(large[0]); i++) {
+        if (!in_large(large[i])) {
+            printf("placement: allocation %zu of the widgets not in the large region\n", i);
+            failures++;
+        }
+    }
+    if (used(LV_MEM_REGION_FAST) != fast_before) {
+        printf("placement: the widgets took %u bytes of the builtin pool\n",
+               used(LV_MEM_REGION_FAST) - fast_before);
+        failures++;
+    }
+
+    redraw(widgets, REDRAWS);
+
+    for (int i = 0; i < LV_MEM_BUF_MAX_NUM; i++) {
+        if (LV_GC_ROOT(lv_mem_buf)[i].p != NULL && in_large(LV_GC_ROOT(lv_mem_buf)[i].p)) {
+            printf("placement: render scratch %d in the large region\n", i);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+/* Fills the builtin pool until an allocation lands elsewhere, returns the count */
+static int fill_fast(void **blocks)
+{
+    int n = 0;
+    while (n < FILL_MAX) {
+        blocks[n] = lv_mem_alloc(FILL_BLOCK);
+        if (blocks[n] == NULL || in_large(blocks[n++])) {
+            break;
+        }
+    }
+    return n;
+}
+
+static int check_spill(void)
+{
+    static void *blocks[FILL_MAX];
+    lv_mem_region_monitor_t fast, large, after;
+    int failures = 0;
+
+    lv_mem_region_monitor(LV_MEM_REGION_FAST, &fast);
+    lv_mem_region_monitor(LV_MEM_REGION_LARGE, &large);
+
+    uint8_t *moved = lv_mem_alloc(64);
+    memset(moved, 0x5a, 64);
+
+    int n = fill_fast(blocks);
+    lv_mem_region_monitor(LV_MEM_REGION_FAST, &after);
+    if (n == FILL_MAX || !in_large(blocks[n - 1]) || after.spilled != fast.spilled + 1) {
+        printf("spill: %d blocks, last %s, %u spilled\n", n, in_large(blocks[n - 1]) ? "large" : "fast",
+               after.spilled);
+        failures++;
+    }
+
+    // Grown past what the full pool has, the block moves with its content
+    bool was_fast = !in_large(moved);
+    moved = lv_mem_realloc(moved, 4096);
+    if (!was_fast || moved == NULL || !in_large(moved) || moved[0] != 0x5a || moved[63] != 0x5a) {
+        printf("realloc: not moved to the large region with its content\n");
+        failures++;
+    }
+    lv_mem_free(moved);
+
+    for (int i = 0; i < n; i++) {
+        lv_mem_free(blocks[i]);
+    }
+
+    lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_LARGE);
+    void *none = lv_mem_alloc(2 * LARGE_SIZE);
+    lv_mem_set_region(region);
+    lv_mem_region_monitor(LV_MEM_REGION_LARGE, &after);
+    if (none != NULL || after.failed != large.failed + 1) {
+        printf("failed: %p for more than any region, %u failed\n", none, after.failed);
+        failures++;
+    }
+
+    if (used(LV_MEM_REGION_FAST) != fast.used_size || used(LV_MEM_REGION_LARGE) != large.used_size) {
+        printf("spill: %u and %u bytes used after freeing, %u and %u before\n", used(LV_MEM_REGION_FAST),
+               used(LV_MEM_REGION_LARGE), fast.used_size, large.used_size);
+        failures++;
+    }
+
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    if (mon.total_size != LV_MEM_SIZE + LARGE_SIZE || lv_mem_test() != LV_RES_OK) {
+        printf("heap: %u bytes in total, test %s\n", mon.total_size, lv_mem_test() == LV_RES_OK ? "ok" : "failed");
+        failures++;
+    }
+
+    return failures;
+}
+
+static double alloc_free_us(lv_mem_region_t region)
+{
+    static void *blocks[16];
+    lv_mem_region_t prev = lv_mem_set_region(region);
+
+    double start = now_us();
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        int i = run % 16;
+        if (blocks[i]) {
+            lv_mem_free(blocks[i]);
+        }
+        blocks[i] = lv_mem_alloc(16 + (run * 37) % 200);
+    }
+    double elapsed = now_us() - start;
+
+    for (int i = 0; i < 16; i++) {
+        lv_mem_free(blocks[i]);
+        blocks[i] = NULL;
+    }
+    lv_mem_set_region(prev);
+    return elapsed / BENCH_RUNS;
+}
+
+static void benchmark(void)
+{
+    lv_mem_region_monitor_t fast, large;
+    struct Widgets widgets;
+
+    printf("builtin pool: %u bytes, %u used by LVGL and the display, peak %u redrawing the widgets, frag %d%%\n",
+           fast_redrawn.total_size, fast_at_start, fast_redrawn.max_used, fast_redrawn.frag_pct);
+
+    uint32_t fast_before = used(LV_MEM_REGION_FAST);
+    uint32_t large_before = used(LV_MEM_REGION_LARGE);
+    lv_mem_region_monitor(LV_MEM_REGION_FAST, &fast);
+    uint32_t spilled = fast.spilled;
+    create_widgets(&widgets);
+    redraw(&widgets, 1);
+    lv_mem_region_monitor(LV_MEM_REGION_FAST, &fast);
+    printf("widgets in the builtin pool: %u bytes of it, %u bytes in the large region, %u spilled\n",
+           fast.used_size - fast_before, used(LV_MEM_REGION_LARGE) - large_before, fast.spilled - spilled);
+    delete_widgets(&widgets);
+
+    lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_LARGE);
+    create_widgets(&widgets);
+    lv_mem_set_region(region);
+    redraw(&widgets, 1);
+    printf("widgets in the large region: %u bytes of the builtin pool, %u bytes in the large region\n",
+           used(LV_MEM_REGION_FAST) - fast_before, used(LV_MEM_REGION_LARGE) - large_before);
+    delete_widgets(&widgets);
+
+    lv_mem_region_monitor(LV_MEM_REGION_LARGE, &large);
+    printf("large region: %u bytes, peak %u, frag %d%%\n", large.total_size, large.max_used, large.frag_pct);
+
+    printf("alloc + free: %.3f us in the builtin pool, %.3f us in the large region\n",
+           alloc_free_us(LV_MEM_REGION_FAST), alloc_free_us(LV_MEM_REGION_LARGE));
+}
+
+int main(int argc, char **argv)
+{
+    struct Widgets widgets;
+    int failures = 0;
+
+    headless_display();
+
+    if (!lv_mem_add_region(LV_MEM_REGION_LARGE, large_mem, sizeof(large_mem)) ||
+        lv_mem_add_region(LV_MEM_REGION_LARGE, large_mem, sizeof(large_mem))) {
+        printf("region: not added once\n");
+        failures++;
+    }
+
+    fast_at_start = used(LV_MEM_REGION_FAST);
+    lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_LARGE);
+    create_widgets(&widgets);
+    lv_mem_set_region(region);
+
+    failures += check_placement(&widgets, fast_at_start);
+    lv_mem_region_monitor(LV_MEM_REGION_FAST, &fast_redrawn);
+    failures += check_spill();
+    printf("%d failures\n", failures);
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        delete_widgets(&widgets);
+        benchmark();
+    }
+
+    return failures ? 1 : 0;
+}
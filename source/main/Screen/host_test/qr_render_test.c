@@ -0,0 +1,269 @@
+/*
+ * Runs qr_render and qr_render_prepare on the firmware's two QR widgets
+ * and compares every canvas byte, palette included, with what a plain
+ * lv_qrcode_update of the same text draws on a twin widget. A prepared
+ * code must not touch what the widget shows, and the render that follows
+ * must be a copy rather than a second encode. Also checks the slot cache
+ * itself: hits and misses per widget size, which slot is evicted, that a
+ * widget already showing a text is left alone while the other one isn't,
+ * and that a prepared code carries the widget's own palette.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lvgl.h"
+#include "qr_render.h"
+
+#define DRAW_BUF_LINES 10
+#define CODES 40
+
+#define CHECK(cond)                                                   \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                  \
+        }                                                             \
+    } while (0)
+
+/* SCREEN_LVGL_PSRAM_SIZE, the internal pool has no room for the canvases */
+static uint8_t psram_region[LV_MEM_REGION_MAX_SIZE] __attribute__((aligned(8)));
+
+struct Widget {
+    lv_obj_t *qrcode; /* goes through qr_render */
+    lv_obj_t *twin;   /* lv_qrcode_update only */
+};
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    lv_disp_flush_ready(drv);
+}
+
+static void headless_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[240 * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_mem_add_region(LV_MEM_REGION_LARGE, psram_region, sizeof(psram_region));
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, 240 * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = 240;
+    drv.ver_res = 240;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    lv_disp_drv_register(&drv);
+}
+
+/* As screen_task creates them, in the PSRAM region */
+static void create_widget(struct Widget *widget, lv_coord_t size)
+{
+    lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_LARGE);
+    widget->qrcode = lv_qrcode_create(lv_scr_act(), size, lv_color_black(), lv_color_white());
+    widget->twin = lv_qrcode_create(lv_scr_act(), size, lv_color_black(), lv_color_white());
+    lv_mem_set_region(region);
+}
+
+/* The palette and the rows, LV_CANVAS_BUF_SIZE_INDEXED_1BIT has a spare row's worth after them */
+static uint32_t canvas_size(lv_obj_t *qrcode)
+{
+    lv_img_dsc_t *img = lv_canvas_get_img(qrcode);
+    return 2 * sizeof(lv_color32_t) + (img->header.w + 7) / 8 * img->header.h;
+}
+
+static const uint8_t *canvas(lv_obj_t *qrcode)
+{
+    return lv_canvas_get_img(qrcode)->data;
+}
+
+/* The widget shows text, byte for byte as lv_qrcode_update draws it */
+static void check_shows(struct Widget *widget, const char *text)
+{
+    CHECK(lv_qrcode_update(widget->twin, text, strlen(text)) == LV_RES_OK);
+    CHECK(canvas_size(widget->qrcode) == canvas_size(widget->twin));
+    CHECK(memcmp(canvas(widget->qrcode), canvas(widget->twin), canvas_size(widget->twin)) == 0);
+}
+
+static void code_text(char *text, size_t size, int n)
+{
+    snprintf(text, size, "https://asistencia.example/qr?totp=%06d&espacioId=%d&dispositivoId=3",
+             n * 7919 % 1000000, 10 + n % 3);
+}
+
+/* What the stats moved by since the last call */
+static struct QRRenderStats stats_delta(void)
+{
+    static struct QRRenderStats last = {0};
+    struct QRRenderStats stats, delta;
+
+    qr_render_get_stats(&stats);
+    delta.unchanged = stats.unchanged - last.unchanged;
+    delta.hits = stats.hits - last.hits;
+    delta.misses = stats.misses - last.misses;
+    delta.prepared = stats.prepared - last.prepared;
+    last = stats;
+    return delta;
+}
+
+/* Renders text and returns which of unchanged, hit or miss it was */
+static char render(struct Widget *widget, const char *text)
+{
+    stats_delta();
+    CHECK(qr_render(widget->qrcode, text, strlen(text)) == LV_RES_OK);
+    check_shows(widget, text);
+
+    struct QRRenderStats delta = stats_delta();
+    CHECK(delta.unchanged + delta.hits + delta.misses == 1 && delta.prepared == 0);
+    return delta.unchanged ? 'u' : delta.hits ? 'h' : 'm';
+}
+
+/* The same text on both widget sizes is two slots */
+static void check_hits(struct Widget *widgets)
+{
+    const char *a = "https://asistencia.example/qr?totp=100001&espacioId=10&dispositivoId=3";
+    const char *b = "https://asistencia.example/qr?totp=100002&espacioId=10&dispositivoId=3";
+
+    CHECK(render(&widgets[0], a) == 'm');
+    CHECK(render(&widgets[0], a) == 'u');
+    CHECK(render(&widgets[0], b) == 'm');
+    CHECK(render(&widgets[0], a) == 'h');
+    CHECK(render(&widgets[1], a) == 'm');
+    CHECK(render(&widgets[1], b) == 'm');
+    CHECK(render(&widgets[1], a) == 'h');
+}
+
+/* Each widget remembers its own text, the other one drawing doesn't change it */
+static void check_shown(struct Widget *widgets)
+{
+    const char *a = "https://asistencia.example/qr?totp=200001&espacioId=10&dispositivoId=3";
+    const char *b = "https://asistencia.example/qr?totp=200002&espacioId=10&dispositivoId=3";
+
+    CHECK(render(&widgets[0], a) == 'm');
+    CHECK(render(&widgets[1], b) == 'm');
+    CHECK(render(&widgets[0], a) == 'u');
+    CHECK(render(&widgets[1], b) == 'u');
+    CHECK(render(&widgets[1], a) == 'm');
+    CHECK(render(&widgets[0], a) == 'u');
+
+    /* A text too long to cache goes straight to lv_qrcode_update and forgets what was shown */
+    char big[QR_RENDER_TEXT_SIZE + 2];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    for (int i = 0; i < 2; i++) {
+        stats_delta();
+        CHECK(qr_render(widgets[0].qrcode, big, strlen(big)) == LV_RES_OK);
+        check_shows(&widgets[0], big);
+        struct QRRenderStats delta = stats_delta();
+        CHECK(delta.unchanged + delta.hits + delta.misses + delta.prepared == 0);
+    }
+    CHECK(render(&widgets[0], a) == 'h');
+}
+
+/* The least recently used slot goes, a hit counts as a use */
+static void check_lru(struct Widget *widgets)
+{
+    char text[QR_RENDER_SLOTS + 1][128];
+
+    for (int i = 0; i <= QR_RENDER_SLOTS; i++) {
+        code_text(text[i], sizeof(text[i]), 1000 + i);
+    }
+    for (int i = 0; i < QR_RENDER_SLOTS; i++) {
+        CHECK(render(&widgets[0], text[i]) == 'm');
+    }
+
+    /* text[0] used again, then a new code takes text[1]'s slot */
+    CHECK(render(&widgets[0], text[0]) == 'h');
+    CHECK(render(&widgets[0], text[QR_RENDER_SLOTS]) == 'm');
+    CHECK(render(&widgets[0], text[1]) == 'm');
+    CHECK(render(&widgets[0], text[0]) == 'h');
+    CHECK(render(&widgets[0], text[QR_RENDER_SLOTS - 1]) == 'h');
+    CHECK(render(&widgets[0], text[2]) == 'm');
+}
+
+/* A prepared code is encoded off screen, it must come back in the widget's colours */
+static void check_palette(struct Widget *widgets)
+{
+    const char *a = "https://asistencia.example/qr?totp=300001&espacioId=10&dispositivoId=3";
+    lv_obj_t *objs[2] = {widgets[1].qrcode, widgets[1].twin};
+
+    for (int i = 0; i < 2; i++) {
+        lv_canvas_set_palette(objs[i], 0, lv_color_make(0x20, 0x40, 0x80));
+        lv_canvas_set_palette(objs[i], 1, lv_color_make(0xf0, 0xe0, 0xc0));
+    }
+
+    CHECK(qr_render_prepare(widgets[1].qrcode, a, strlen(a)) == LV_RES_OK);
+    CHECK(render(&widgets[1], a) == 'h');
+
+    for (int i = 0; i < 2; i++) {
+        lv_canvas_set_palette(objs[i], 0, lv_color_black());
+        lv_canvas_set_palette(objs[i], 1, lv_color_white());
+    }
+}
+
+/* Each TOTP window: prepare the next code ahead, render it at the swap */
+static void check_prepared(struct Widget *widgets)
+{
+    static uint8_t before[LV_CANVAS_BUF_SIZE_INDEXED_1BIT(240, 240)];
+    struct QRRenderStats stats, last;
+    char text[128];
+
+    qr_render_get_stats(&last);
+    for (int n = 0; n < CODES; n++) {
+        struct Widget *widget = &widgets[n % 3 == 0];
+        uint32_t size = canvas_size(widget->qrcode);
+
+        code_text(text, sizeof(text), n);
+        memcpy(before, canvas(widget->qrcode), size);
+        CHECK(qr_render_prepare(widget->qrcode, text, strlen(text)) == LV_RES_OK);
+        CHECK(memcmp(before, canvas(widget->qrcode), size) == 0);
+
+        CHECK(qr_render(widget->qrcode, text, strlen(text)) == LV_RES_OK);
+        check_shows(widget, text);
+        lv_refr_now(NULL);
+
+        qr_render_get_stats(&stats);
+        CHECK(stats.prepared == last.prepared + 1);
+        CHECK(stats.hits == last.hits + 1);
+        CHECK(stats.misses == last.misses);
+        last = stats;
+    }
+}
+
+/* Without a prepare, the same widget drawn straight by qr_render */
+static void check_direct(struct Widget *widgets)
+{
+    char text[128];
+
+    for (int n = CODES; n < 2 * CODES; n++) {
+        struct Widget *widget = &widgets[n % 2];
+
+        code_text(text, sizeof(text), n);
+        CHECK(qr_render(widget->qrcode, text, strlen(text)) == LV_RES_OK);
+        check_shows(widget, text);
+    }
+}
+
+int main(void)
+{
+    struct Widget widgets[2];
+
+    headless_display();
+    create_widget(&widgets[0], 240);
+    create_widget(&widgets[1], 170);
+    lv_qrcode_set_fixed_layout(true, LV_QRCODE_MASK_AUTO);
+
+    check_hits(widgets);
+    check_shown(widgets);
+    check_lru(widgets);
+    check_palette(widgets);
+    check_prepared(widgets);
+    check_direct(widgets);
+
+    struct QRRenderStats stats;
+    qr_render_get_stats(&stats);
+    printf("qr_render: %d prepared, %d hits, %d misses, %d unchanged\n", stats.prepared, stats.hits,
+           stats.misses, stats.unchanged);
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*
+ * Plays the messages screen_task gets around a TOTP boundary through
+ * qr_swap and scene_apply() on the firmware's QR widgets: DrawQr with the old
+ * code, PrepareQr with the next one, SwapQr from the timer at the boundary,
+ * DrawQr with the old code that was queued behind it and then with the new
+ * one. The prepared code must only reach the widget at the swap, the stale
+ * DrawQr must neither put the old code back nor cost a redraw, and a code
+ * that stops coming must give way to the placeholder.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lvgl.h"
+#include "scene.h"
+#include "qr_swap.h"
+
+#define DRAW_BUF_LINES 10
+#define PLACEHOLDER "no tenemos el totp todavía"
+
+#define CHECK(cond)                                                   \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                  \
+        }                                                             \
+    } while (0)
+
+static const char *const code_a = "https://asistencia.example/qr?totp=111111&espacioId=10&dispositivoId=3";
+static const char *const code_b = "https://asistencia.example/qr?totp=222222&espacioId=10&dispositivoId=3";
+static const char *const code_c = "https://asistencia.example/qr?totp=333333&espacioId=10&dispositivoId=3";
+
+static int qr_updates = 0;
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    lv_disp_flush_ready(drv);
+}
+
+static void headless_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[240 * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, 240 * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = 240;
+    drv.ver_res = 240;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    lv_disp_drv_register(&drv);
+}
+
+static lv_res_t render_qr(lv_obj_t *qrcode, const void *data, uint32_t data_len)
+{
+    qr_updates++;
+    return lv_qrcode_update(qrcode, data, data_len);
+}
+
+/* The same widgets as screen_task */
+static void create_widgets(struct SceneWidgets *widgets)
+{
+    widgets->msg_label = lv_label_create(lv_scr_act());
+    widgets->qr_full = lv_qrcode_create(lv_scr_act(), 240, lv_color_black(), lv_color_white());
+    widgets->qr_small = lv_qrcode_create(lv_scr_act(), 170, lv_color_black(), lv_color_white());
+    widgets->mirror_img = lv_img_create(lv_scr_act());
+    widgets->notification = lv_label_create(lv_scr_act());
+    widgets->flash_img = lv_img_create(lv_scr_act());
+    widgets->render_qr = render_qr;
+}
+
+struct Screen {
+    struct SceneWidgets widgets;
+    struct SceneState applied;
+    struct Scene scene;
+    struct QRSwap swap;
+    int stale_dropped;
+};
+
+/* The qr_display branch of screen_task's tick, then the apply. Returns the redraws. */
+static int tick(struct Screen *screen, time_t now)
+{
+    const char *shown = qr_swap_shown(&screen->swap, now);
+    int updates = qr_updates;
+
+    screen->scene.view = SceneQr;
+    screen->scene.notification_shown = false;
+    screen->scene.qr_small = false;
+    strncpy(screen->scene.qr_text, shown != NULL ? shown : PLACEHOLDER, sizeof(screen->scene.qr_text));
+
+    scene_apply(&screen->widgets, &screen->applied, &screen->scene);
+    CHECK(scene_changes(&screen->applied, &screen->scene) == 0);
+    return qr_updates - updates;
+}
+
+static void draw(struct Screen *screen, const char *text, time_t now)
+{
+    if (!qr_swap_draw(&screen->swap, text, now)) {
+        screen->stale_dropped++;
+    }
+}
+
+static const char *on_widget(const struct Screen *screen)
+{
+    return screen->applied.qr_text[0];
+}
+
+static void reset(struct Screen *screen)
+{
+    qr_swap_init(&screen->swap);
+    screen->stale_dropped = 0;
+}
+
+/* The boundary as it happens: the swap overtakes a DrawQr with the old code */
+static void check_boundary(struct Screen *screen)
+{
+    time_t t = 1000;
+    int64_t boundary_us = (int64_t)(t + 30) * 1000000;
+
+    reset(screen);
+    draw(screen, code_a, t);
+    CHECK(tick(screen, t) == 1);
+    CHECK(strcmp(on_widget(screen), code_a) == 0);
+
+    /* Prepared ahead, still the old code until the timer fires */
+    qr_swap_prepare(&screen->swap, code_b, boundary_us);
+    CHECK(tick(screen, t) == 0);
+    draw(screen, code_a, t + 29);
+    CHECK(tick(screen, t + 29) == 0);
+    CHECK(strcmp(on_widget(screen), code_a) == 0);
+
+    CHECK(qr_swap_due(&screen->swap, t + 30) == boundary_us);
+    CHECK(tick(screen, t + 30) == 1);
+    CHECK(strcmp(on_widget(screen), code_b) == 0);
+
+    /* The DrawQr queued behind the swap, and one more a second later */
+    draw(screen, code_a, t + 30);
+    CHECK(tick(screen, t + 30) == 0);
+    draw(screen, code_a, t + 31);
+    CHECK(tick(screen, t + 31) == 0);
+    CHECK(strcmp(on_widget(screen), code_b) == 0);
+    CHECK(screen->stale_dropped == 2);
+
+    /* The totp task catches up */
+    draw(screen, code_b, t + 31);
+    CHECK(tick(screen, t + 31) == 0);
+    CHECK(strcmp(on_widget(screen), code_b) == 0);
+    CHECK(screen->stale_dropped == 2);
+
+    /* Nothing prepared, or prepared and already swapped: the timer does nothing */
+    CHECK(qr_swap_due(&screen->swap, t + 32) == 0);
+    CHECK(tick(screen, t + 32) == 0);
+    CHECK(strcmp(on_widget(screen), code_b) == 0);
+}
+
+/* The old code is only held off for a while, a device can go back to a code */
+static void check_retired_expiry(struct Screen *screen)
+{
+    time_t t = 2000;
+
+    reset(screen);
+    draw(screen, code_a, t);
+    qr_swap_prepare(&screen->swap, code_b, (int64_t)(t + 1) * 1000000);
+    CHECK(qr_swap_due(&screen->swap, t + 1) != 0);
+    tick(screen, t + 1);
+    CHECK(strcmp(on_widget(screen), code_b) == 0);
+
+    draw(screen, code_a, t + QR_SWAP_RETIRED_TIME);
+    CHECK(screen->stale_dropped == 1);
+    draw(screen, code_a, t + 1 + QR_SWAP_RETIRED_TIME);
+    CHECK(screen->stale_dropped == 1);
+    CHECK(tick(screen, t + 1 + QR_SWAP_RETIRED_TIME) == 1);
+    CHECK(strcmp(on_widget(screen), code_a) == 0);
+
+    /* A newer code ends the wait for the stale ones at once */
+    qr_swap_prepare(&screen->swap, code_b, (int64_t)(t + 10) * 1000000);
+    qr_swap_due(&screen->swap, t + 10);
+    draw(screen, code_c, t + 10);
+    CHECK(tick(screen, t + 10) == 1);
+    CHECK(strcmp(on_widget(screen), code_c) == 0);
+    draw(screen, code_a, t + 10);
+    CHECK(tick(screen, t + 10) == 1);
+    CHECK(strcmp(on_widget(screen), code_a) == 0);
+    CHECK(screen->stale_dropped == 1);
+}
+
+/* The totp task sent the new code before the timer fired: nothing to retire */
+static void check_drawn_before_swap(struct Screen *screen)
+{
+    time_t t = 3000;
+
+    reset(screen);
+    draw(screen, code_a, t);
+    qr_swap_prepare(&screen->swap, code_b, (int64_t)(t + 1) * 1000000);
+    draw(screen, code_b, t + 1);
+    CHECK(tick(screen, t + 1) == 1);
+    CHECK(qr_swap_due(&screen->swap, t + 1) != 0);
+    CHECK(tick(screen, t + 1) == 0);
+    CHECK(strcmp(on_widget(screen), code_b) == 0);
+    draw(screen, code_b, t + 2);
+    CHECK(screen->stale_dropped == 0);
+}
+
+static void check_placeholder(struct Screen *screen)
+{
+    time_t t = 4000;
+
+    reset(screen);
+    CHECK(qr_swap_shown(&screen->swap, t) == NULL);
+    tick(screen, t);
+    CHECK(strcmp(on_widget(screen), PLACEHOLDER) == 0);
+
+    draw(screen, code_a, t);
+    tick(screen, t + QR_SWAP_MAX_AGE - 1);
+    CHECK(strcmp(on_widget(screen), code_a) == 0);
+    tick(screen, t + QR_SWAP_MAX_AGE);
+    CHECK(strcmp(on_widget(screen), PLACEHOLDER) == 0);
+
+    /* A swap counts as a fresh code */
+    qr_swap_prepare(&screen->swap, code_b, (int64_t)(t + 20) * 1000000);
+    qr_swap_due(&screen->swap, t + 20);
+    tick(screen, t + 20 + QR_SWAP_MAX_AGE - 1);
+    CHECK(strcmp(on_widget(screen), code_b) == 0);
+}
+
+int main(void)
+{
+    static struct Screen screen;
+
+    headless_display();
+    create_widgets(&screen.widgets);
+    scene_state_init(&screen.applied);
+
+    check_boundary(&screen);
+    check_retired_expiry(&screen);
+    check_drawn_before_swap(&screen);
+    check_placeholder(&screen);
+    printf("qr swap ok\n");
+    return 0;
+}
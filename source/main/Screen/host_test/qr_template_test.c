@@ -0,0 +1,180 @@
+/*
+ * Checks qrcodegen_encodeBinaryTemplate() against qrcodegen_encodeBinary():
+ * with a pinned mask every symbol must be identical, with the automatic
+ * mask the first one of a layout must be, and the later ones identical to
+ * encodeBinary() forced to the mask that was kept. Every symbol is also
+ * rendered and decoded with the vendored quirc. With -b it prints the time
+ * per encode of TOTP style URLs both ways.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "qrcodegen.h"
+#include "quirc.h"
+
+#define BENCH_RUNS 2000
+#define MODULE_PX 4
+#define QUIET_ZONE 4 // modules
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* What totp.c draws, the base URL length picks the layout */
+static int make_url(char *text, int base, int n)
+{
+    static const char path[] = "https://asistencia.example.org/formulario/alumnos/registro/presente";
+    int len = snprintf(text, 300, "%.*s?totp=%06d&espacioId=%d&dispositivoId=%d", base, path,
+                       (n * 7919 + 13) % 1000000, 10 + n % 90, 100 + n % 900);
+    return len;
+}
+
+static bool encode_reference(const char *text, int len, int version, int mask, uint8_t *qr)
+{
+    static uint8_t tmp[qrcodegen_BUFFER_LEN_MAX];
+    memcpy(tmp, text, len);
+    return qrcodegen_encodeBinary(tmp, len, qr, qrcodegen_Ecc_MEDIUM, version, version, mask, true);
+}
+
+static bool scans(struct quirc *q, const uint8_t *qr, const char *text, int len)
+{
+    int size = qrcodegen_getSize(qr);
+    int side = (size + 2 * QUIET_ZONE) * MODULE_PX;
+
+    if (quirc_resize(q, side, side) < 0) {
+        return false;
+    }
+
+    uint8_t *pixels = quirc_begin(q, NULL, NULL);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            bool dark = qrcodegen_getModule(qr, x / MODULE_PX - QUIET_ZONE, y / MODULE_PX - QUIET_ZONE);
+            pixels[y * side + x] = dark ? 0 : 255;
+        }
+    }
+    quirc_end(q);
+
+    for (int i = 0; i < quirc_count(q); i++) {
+        struct quirc_code code;
+        struct quirc_data data;
+
+        quirc_extract(q, i, &code);
+        if (quirc_decode(&code, &data) == QUIRC_SUCCESS && data.payload_len == len &&
+            memcmp(data.payload, text, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Encodes a run of URLs per base length (so the layout changes between runs
+ * and stays put within one) and compares each symbol */
+static int check(int mask, struct quirc *q)
+{
+    static struct qrcodegen_Template tpl;
+    static uint8_t qr[qrcodegen_BUFFER_LEN_MAX + 1], expected[qrcodegen_BUFFER_LEN_MAX];
+    static uint8_t tmp[qrcodegen_BUFFER_LEN_MAX];
+    char text[300];
+    int failures = 0;
+    int encoded = 0;
+
+    memset(&tpl, 0, sizeof(tpl));
+
+    for (int base = 8; base <= 68; base += 6) {
+        for (int n = 0; n < 40; n++) {
+            int len = make_url(text, base, n);
+            int version = qrcodegen_getMinFitVersion(qrcodegen_Ecc_MEDIUM, len);
+            int first = tpl.version != version || tpl.dataLen != (size_t)len;
+
+            if (!qrcodegen_encodeBinaryTemplate(&tpl, (const uint8_t *)text, len, tmp, qr, qrcodegen_Ecc_MEDIUM,
+                                                version, mask, true)) {
+                printf("mask %d, %s: template encode failed\n", mask, text);
+                failures++;
+                continue;
+            }
+
+            int expected_mask = mask == qrcodegen_Mask_AUTO && !first ? tpl.codeMask : mask;
+            encode_reference(text, len, version, expected_mask, expected);
+
+            int bytes = qrcodegen_BUFFER_LEN_FOR_VERSION(version);
+            if (memcmp(qr, expected, bytes) != 0) {
+                printf("mask %d, %s: symbol differs from qrcodegen_encodeBinary (mask %d)\n", mask, text,
+                       expected_mask);
+                failures++;
+            } else if (!scans(q, qr, text, len)) {
+                printf("mask %d, %s: quirc can't read it back\n", mask, text);
+                failures++;
+            }
+            encoded++;
+        }
+    }
+
+    /* Past the cached versions it refuses, lv_qrcode falls back to encodeBinary */
+    memset(text, 'x', 250);
+    if (qrcodegen_encodeBinaryTemplate(&tpl, (const uint8_t *)text, 250, tmp, qr, qrcodegen_Ecc_MEDIUM,
+                                       qrcodegen_getMinFitVersion(qrcodegen_Ecc_MEDIUM, 250), mask, true)) {
+        printf("mask %d: accepted a version above qrcodegen_TEMPLATE_VERSION_MAX\n", mask);
+        failures++;
+    }
+
+    printf("mask %2d: %d symbols identical and scanned, %d failures\n", mask, encoded, failures);
+    return failures;
+}
+
+static void benchmark(void)
+{
+    static struct qrcodegen_Template tpl;
+    static uint8_t qr[qrcodegen_BUFFER_LEN_MAX + 1], tmp[qrcodegen_BUFFER_LEN_MAX];
+    char text[300];
+
+    for (int base = 20; base <= 68; base += 24) {
+        int len = make_url(text, base, 0);
+        int version = qrcodegen_getMinFitVersion(qrcodegen_Ecc_MEDIUM, len);
+
+        double start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            make_url(text, base, run);
+            encode_reference(text, len, version, qrcodegen_Mask_AUTO, qr);
+        }
+        double automatic = now_us() - start;
+
+        memset(&tpl, 0, sizeof(tpl));
+        start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            make_url(text, base, run);
+            qrcodegen_encodeBinaryTemplate(&tpl, (const uint8_t *)text, len, tmp, qr, qrcodegen_Ecc_MEDIUM, version,
+                                           qrcodegen_Mask_AUTO, true);
+        }
+        double cached = now_us() - start;
+
+        printf("%3d bytes, version %d: Mask_AUTO %7.2f us, template %7.2f us\n", len, version,
+               automatic / BENCH_RUNS, cached / BENCH_RUNS);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct quirc *q = quirc_new();
+    int failures = 0;
+
+    if (!q) {
+        return 1;
+    }
+
+    for (int mask = qrcodegen_Mask_AUTO; mask <= qrcodegen_Mask_7; mask++) {
+        failures += check(mask, q);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        benchmark();
+    }
+
+    quirc_destroy(q);
+    return failures ? 1 : 0;
+}
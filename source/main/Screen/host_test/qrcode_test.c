@@ -0,0 +1,226 @@
+/*
+ * Checks lv_qrcode_update() pixel for pixel against the original per pixel
+ * renderer, kept here as the reference, for every widget size the firmware
+ * uses and a few with odd margins. With -b it prints the time per update
+ * of both for the 240 and 170 px widgets.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl.h"
+#include "qrcodegen.h"
+
+#define BENCH_RUNS 2000
+#define DRAW_BUF_LINES 10
+
+static const int sizes[] = {240, 170, 100, 129, 57, 203};
+
+#define SIZE_COUNT (sizeof(sizes) / sizeof(sizes[0]))
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    lv_disp_flush_ready(drv);
+}
+
+static void headless_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[240 * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, 240 * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = 240;
+    drv.ver_res = 240;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    lv_disp_drv_register(&drv);
+}
+
+/* The lv_qrcode_update() blit before the row expander, on a bare indexed 1 bit
+ * buffer (8 byte palette first). Without blit only the encoding is done. */
+static int reference_update(uint8_t *canvas, int w, const void *data, uint32_t data_len, bool blit)
+{
+    uint8_t *buf_u8 = canvas + 8;
+    uint32_t row_byte_cnt = (w + 7) >> 3;
+    static uint8_t qr0[qrcodegen_BUFFER_LEN_MAX];
+    static uint8_t data_tmp[qrcodegen_BUFFER_LEN_MAX];
+
+    memset(buf_u8, 0xff, row_byte_cnt * w);
+
+    int32_t qr_version = qrcodegen_getMinFitVersion(qrcodegen_Ecc_MEDIUM, data_len);
+    if (qr_version <= 0) {
+        return -1;
+    }
+    int32_t qr_size = qrcodegen_version2size(qr_version);
+    int32_t scale = w / qr_size;
+    if (scale <= 0) {
+        return -1;
+    }
+    int32_t remain = w % qr_size;
+    uint32_t version_extend = remain / (scale << 2);
+    if (version_extend && qr_version < qrcodegen_VERSION_MAX) {
+        qr_version = qr_version + version_extend > qrcodegen_VERSION_MAX ? qrcodegen_VERSION_MAX
+                                                                          : qr_version + version_extend;
+    }
+
+    memcpy(data_tmp, data, data_len);
+    if (!qrcodegen_encodeBinary(data_tmp, data_len, qr0, qrcodegen_Ecc_MEDIUM, qr_version, qr_version,
+                                qrcodegen_Mask_AUTO, true)) {
+        return -1;
+    }
+
+    if (!blit) {
+        return 0;
+    }
+
+    qr_size = qrcodegen_getSize(qr0);
+    scale = w / qr_size;
+    int scaled = qr_size * scale;
+    int margin = (w - scaled) / 2;
+
+    for (int y = margin; y < scaled + margin; y += scale) {
+        uint8_t b = 0;
+        uint8_t p = 0;
+        bool aligned = false;
+        int x;
+        for (x = margin; x < scaled + margin; x++) {
+            bool a = qrcodegen_getModule(qr0, (x - margin) / scale, (y - margin) / scale);
+
+            if (aligned == false && (x & 0x7) == 0) {
+                aligned = true;
+            }
+
+            if (aligned == false) {
+                uint8_t *px = &buf_u8[row_byte_cnt * y + (x >> 3)];
+                *px &= ~(1 << (7 - (x & 7)));
+                *px |= (a ? 0 : 1) << (7 - (x & 7));
+            } else {
+                if (!a) {
+                    b |= (1 << (7 - p));
+                }
+                p++;
+                if (p == 8) {
+                    buf_u8[row_byte_cnt * y + (x >> 3)] = b;
+                    b = 0;
+                    p = 0;
+                }
+            }
+        }
+
+        if (p) {
+            b |= (1 << (8 - p)) - 1;
+            buf_u8[row_byte_cnt * y + (x >> 3)] = b;
+        }
+
+        for (int s = 1; s < scale; s++) {
+            memcpy(buf_u8 + row_byte_cnt * (y + s), buf_u8 + row_byte_cnt * y, row_byte_cnt);
+        }
+    }
+
+    return 0;
+}
+
+/* What totp.c draws, with payloads of every length up to what a code holds */
+static int make_payload(char *text, int n)
+{
+    int len = snprintf(text, 300, "https://asistencia.example.org/form?totp=%06d&espacioId=%d&dispositivoId=%d",
+                       (n * 7919) % 1000000, n % 97, n % 13);
+    for (int i = 0; i < n % 180; i++) {
+        text[len++] = 'a' + (n + i) % 26;
+    }
+    text[len] = 0;
+    return len;
+}
+
+static int check(lv_obj_t *qrcodes[])
+{
+    static uint8_t expected[8 + 32 * 240];
+    char text[300];
+    int failures = 0;
+    int checked = 0;
+
+    for (int n = 0; n < 200; n++) {
+        int len = make_payload(text, n);
+
+        for (size_t i = 0; i < SIZE_COUNT; i++) {
+            lv_img_dsc_t *img = lv_canvas_get_img(qrcodes[i]);
+            uint32_t bytes = ((sizes[i] + 7) >> 3) * sizes[i];
+            int ref = reference_update(expected, sizes[i], text, len, true);
+            lv_res_t res = lv_qrcode_update(qrcodes[i], text, len);
+
+            if ((ref == 0) != (res == LV_RES_OK)) {
+                printf("%d px, payload %d: reference %s, lv_qrcode %s\n", sizes[i], n, ref ? "failed" : "ok",
+                       res == LV_RES_OK ? "ok" : "failed");
+                failures++;
+            } else if (ref == 0 && memcmp(img->data + 8, expected + 8, bytes) != 0) {
+                printf("%d px, payload %d (%d bytes): canvas differs\n", sizes[i], n, len);
+                failures++;
+            } else if (ref == 0) {
+                checked++;
+            }
+        }
+    }
+
+    printf("%d canvases identical, %d failures\n", checked, failures);
+    return failures;
+}
+
+static void benchmark(lv_obj_t *qrcodes[])
+{
+    static uint8_t canvas[8 + 32 * 240];
+    char text[300];
+    int len = make_payload(text, 0);
+
+    for (size_t i = 0; i < 2; i++) {
+        double start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            lv_qrcode_update(qrcodes[i], text, len);
+        }
+        double updated = now_us() - start;
+
+        start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            reference_update(canvas, sizes[i], text, len, true);
+        }
+        double reference = now_us() - start;
+
+        start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            reference_update(canvas, sizes[i], text, len, false);
+        }
+        double encode = now_us() - start;
+
+        printf("%d px: lv_qrcode_update %7.2f us, per pixel reference %7.2f us, of which encoding %7.2f us\n",
+               sizes[i], updated / BENCH_RUNS, reference / BENCH_RUNS, encode / BENCH_RUNS);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    lv_obj_t *qrcodes[SIZE_COUNT];
+
+    headless_display();
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        qrcodes[i] = lv_qrcode_create(lv_scr_act(), sizes[i], lv_color_black(), lv_color_white());
+    }
+
+    int failures = check(qrcodes);
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        benchmark(qrcodes);
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * Drives scene_apply() with random scenes on the firmware's widgets and checks
+ * after each one that every widget is shown or hidden and holds the content the
+ * scene asks for, that applying it again makes no LVGL call, and that
+ * scene_changes() predicts the calls made. With -b it compares the redraws of
+ * the screen_task loop before the scene (every widget reapplied on each wake
+ * up) with scene_apply() for the same run of ticks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl.h"
+#include "scene.h"
+
+#define DRAW_BUF_LINES 10
+#define CHECK_RUNS 5000
+#define BENCH_TICKS 2000
+#define BENCH_CODE_PERIOD 120 // ticks between TOTP codes, 60 s at the old 2 wake ups/s
+
+static int frames = 0;
+static uint32_t px = 0;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    lv_disp_flush_ready(drv);
+}
+
+static void monitor(lv_disp_drv_t *drv, uint32_t time_ms, uint32_t pixels)
+{
+    frames++;
+    px += pixels;
+}
+
+static void headless_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[240 * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, 240 * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = 240;
+    drv.ver_res = 240;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    drv.monitor_cb = monitor;
+    lv_disp_drv_register(&drv);
+}
+
+/* qr_render() without its bitmap slots: nothing when the widget shows the text */
+static char rendered[2][SCENE_TEXT_SIZE];
+static lv_obj_t *qr_widgets[2];
+static int qr_updates = 0;
+
+static lv_res_t render_qr(lv_obj_t *qrcode, const void *data, uint32_t data_len)
+{
+    char *shown = rendered[qrcode == qr_widgets[1]];
+
+    if (strlen(shown) == data_len && memcmp(shown, data, data_len) == 0) {
+        return LV_RES_OK;
+    }
+
+    memcpy(shown, data, data_len);
+    shown[data_len] = 0;
+    qr_updates++;
+    return lv_qrcode_update(qrcode, data, data_len);
+}
+
+/* The same widgets as screen_task */
+static void create_widgets(struct SceneWidgets *widgets)
+{
+    widgets->msg_label = lv_label_create(lv_scr_act());
+    lv_obj_set_width(widgets->msg_label, 150);
+    lv_obj_align(widgets->msg_label, LV_ALIGN_CENTER, 0, 60);
+
+    widgets->qr_full = lv_qrcode_create(lv_scr_act(), 240, lv_color_black(), lv_color_white());
+    lv_obj_center(widgets->qr_full);
+    widgets->qr_small = lv_qrcode_create(lv_scr_act(), 170, lv_color_black(), lv_color_white());
+    lv_obj_center(widgets->qr_small);
+    qr_widgets[0] = widgets->qr_full;
+    qr_widgets[1] = widgets->qr_small;
+
+    widgets->mirror_img = lv_img_create(lv_scr_act());
+    lv_obj_align(widgets->mirror_img, LV_ALIGN_CENTER, 0, 0);
+
+    widgets->notification = lv_label_create(lv_scr_act());
+    lv_obj_set_width(widgets->notification, 150);
+    lv_obj_align(widgets->notification, LV_ALIGN_CENTER, 0, -100);
+
+    widgets->flash_img = lv_img_create(lv_scr_act());
+    lv_obj_align(widgets->flash_img, LV_ALIGN_CENTER, 0, 0);
+
+    widgets->render_qr = render_qr;
+}
+
+#define ICON_SIDE 32
+
+static uint16_t icon_pixels[3][ICON_SIDE * ICON_SIDE];
+static lv_img_dsc_t icons[3];
+static uint16_t mirror_pixels[240 * 240];
+static lv_img_dsc_t mirror_dsc;
+
+static void make_images(void)
+{
+    for (int i = 0; i < 3; i++) {
+        icons[i].header.cf = LV_IMG_CF_TRUE_COLOR;
+        icons[i].header.w = ICON_SIDE;
+        icons[i].header.h = ICON_SIDE;
+        icons[i].data_size = sizeof(icon_pixels[i]);
+        icons[i].data = (const uint8_t *)icon_pixels[i];
+    }
+
+    mirror_dsc.header.cf = LV_IMG_CF_TRUE_COLOR;
+    mirror_dsc.header.w = 240;
+    mirror_dsc.header.h = 240;
+    mirror_dsc.data_size = sizeof(mirror_pixels);
+    mirror_dsc.data = (const uint8_t *)mirror_pixels;
+}
+
+static void random_scene(struct Scene *scene, uint32_t *mirror_seq)
+{
+    static const char *messages[] = {"pulse los 4 botones para continuar", "hola", "adios"};
+    static const char *states[] = {"estado: NoWifi", "estado: NoBackend", "estado: NoTB"};
+
+    scene->view = rand() % 4;
+    scene->notification_shown = rand() % 2;
+    strcpy(scene->notification, states[rand() % 3]);
+    scene->flash_src = &icons[rand() % 3];
+    strcpy(scene->message, messages[rand() % 3]);
+    scene->qr_small = rand() % 2;
+    snprintf(scene->qr_text, sizeof(scene->qr_text), "https://example.org/a?totp=%06d&espacioId=1", rand() % 4);
+    scene->mirror_src = &mirror_dsc;
+    if (rand() % 2) {
+        (*mirror_seq)++;
+    }
+    scene->mirror_seq = *mirror_seq;
+}
+
+static int check_shown(const char *name, lv_obj_t *obj, bool expected, int run)
+{
+    bool shown = !lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN);
+
+    if (shown != expected) {
+        printf("run %d: %s %s, expected %s\n", run, name, shown ? "shown" : "hidden", expected ? "shown" : "hidden");
+        return 1;
+    }
+    return 0;
+}
+
+static int check_scene(const struct SceneWidgets *widgets, const struct Scene *scene, int run)
+{
+    int failures = 0;
+    bool qr = scene->view == SceneQr;
+
+    failures += check_shown("flash", widgets->flash_img, scene->view == SceneFlash, run);
+    failures += check_shown("message", widgets->msg_label, scene->view == SceneMessage, run);
+    failures += check_shown("full qr", widgets->qr_full, qr && !scene->qr_small, run);
+    failures += check_shown("small qr", widgets->qr_small, qr && scene->qr_small, run);
+    failures += check_shown("mirror", widgets->mirror_img, scene->view == SceneMirror, run);
+    failures += check_shown("notification", widgets->notification, scene->notification_shown, run);
+
+    if (scene->notification_shown && strcmp(lv_label_get_text(widgets->notification), scene->notification) != 0) {
+        printf("run %d: notification '%s'\n", run, lv_label_get_text(widgets->notification));
+        failures++;
+    }
+    if (scene->view == SceneMessage && strcmp(lv_label_get_text(widgets->msg_label), scene->message) != 0) {
+        printf("run %d: message '%s'\n", run, lv_label_get_text(widgets->msg_label));
+        failures++;
+    }
+    if (scene->view == SceneFlash && lv_img_get_src(widgets->flash_img) != scene->flash_src) {
+        printf("run %d: wrong flash icon\n", run);
+        failures++;
+    }
+    if (scene->view == SceneMirror && lv_img_get_src(widgets->mirror_img) != scene->mirror_src) {
+        printf("run %d: mirror not set\n", run);
+        failures++;
+    }
+    if (qr && strcmp(rendered[scene->qr_small], scene->qr_text) != 0) {
+        printf("run %d: qr shows '%s'\n", run, rendered[scene->qr_small]);
+        failures++;
+    }
+
+    return failures;
+}
+
+static int check_apply(const struct SceneWidgets *widgets)
+{
+    static struct SceneState state;
+    struct Scene scene;
+    uint32_t mirror_seq = 0;
+    int failures = 0;
+
+    scene_state_init(&state);
+    srand(1);
+
+    for (int run = 0; run < CHECK_RUNS && failures < 10; run++) {
+        random_scene(&scene, &mirror_seq);
+
+        int predicted = scene_changes(&state, &scene);
+        int calls = scene_apply(widgets, &state, &scene);
+        if (predicted != calls) {
+            printf("run %d: scene_changes said %d calls, scene_apply made %d\n", run, predicted, calls);
+            failures++;
+        }
+
+        failures += check_scene(widgets, &scene, run);
+
+        if (scene_changes(&state, &scene) != 0 || scene_apply(widgets, &state, &scene) != 0) {
+            printf("run %d: applying the same scene again made calls\n", run);
+            failures++;
+        }
+
+        lv_refr_now(NULL);
+    }
+
+    return failures;
+}
+
+/* The qr_display branch of screen_task as it was, run on every wake up */
+static void legacy_tick(const struct SceneWidgets *widgets, const struct Scene *scene)
+{
+    lv_obj_add_flag(widgets->flash_img, LV_OBJ_FLAG_HIDDEN);
+
+    if (scene->notification_shown) {
+        char notification[100];
+        lv_obj_clear_flag(widgets->notification, LV_OBJ_FLAG_HIDDEN);
+        snprintf(notification, sizeof(notification), "%s", scene->notification);
+        lv_label_set_text(widgets->notification, notification);
+    }
+    else {
+        lv_obj_add_flag(widgets->notification, LV_OBJ_FLAG_HIDDEN);
+    }
+
+    lv_obj_add_flag(widgets->msg_label, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(widgets->mirror_img, LV_OBJ_FLAG_HIDDEN);
+
+    lv_obj_t *used = scene->qr_small ? widgets->qr_small : widgets->qr_full;
+    lv_obj_t *unused = scene->qr_small ? widgets->qr_full : widgets->qr_small;
+    lv_obj_add_flag(unused, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_clear_flag(used, LV_OBJ_FLAG_HIDDEN);
+
+    widgets->render_qr(used, scene->qr_text, strlen(scene->qr_text));
+}
+
+static void benchmark(const struct SceneWidgets *widgets, bool small)
+{
+    static struct SceneState state;
+    struct Scene scene = {.view = SceneQr, .qr_small = small, .notification_shown = small};
+    strcpy(scene.notification, "estado: NoTB");
+
+    for (int way = 0; way < 2; way++) {
+        scene_state_init(&state);
+        memset(rendered, 0, sizeof(rendered));
+        lv_refr_now(NULL);
+        frames = 0;
+        px = 0;
+        qr_updates = 0;
+
+        double start = now_us();
+        for (int tick = 0; tick < BENCH_TICKS; tick++) {
+            snprintf(scene.qr_text, sizeof(scene.qr_text), "https://example.org/a?totp=%06d&espacioId=1",
+                     tick / BENCH_CODE_PERIOD);
+            if (way == 0) {
+                legacy_tick(widgets, &scene);
+            }
+            else if (scene_changes(&state, &scene) > 0) {
+                scene_apply(widgets, &state, &scene);
+            }
+            lv_refr_now(NULL);
+        }
+        double elapsed = now_us() - start;
+
+        printf("%s qr, %s: %d frames in %d ticks, %.0f px/tick, %.2f us/tick, %d qr updates\n",
+               small ? "small" : "full", way == 0 ? "every widget every tick" : "scene_apply",
+               frames, BENCH_TICKS, (double)px / BENCH_TICKS, elapsed / BENCH_TICKS, qr_updates);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct SceneWidgets widgets;
+
+    headless_display();
+    make_images();
+    create_widgets(&widgets);
+
+    int failures = check_apply(&widgets);
+    printf("%d scenes, %d failures\n", CHECK_RUNS, failures);
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        benchmark(&widgets, false);
+        benchmark(&widgets, true);
+    }
+
+    return failures ? 1 : 0;
+}
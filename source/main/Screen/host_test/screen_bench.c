@@ -0,0 +1,313 @@
+/*
+ * Replays the scenes screen_task draws on LVGL configured from the firmware's
+ * sdkconfig, with the widgets, styles and heap regions screen_task sets up and a
+ * display driver that flushes into a 240x240 framebuffer in memory. For each
+ * scene, entered from the previous one and then updated every frame as on the
+ * device (a new TOTP code, a new icon, a new camera frame), it prints the render
+ * and flush time per frame, the area redrawn and what the LVGL heap holds, in
+ * the manner of lv_demo_benchmark. It fails if a frame the scene changed redraws
+ * nothing, if applying the same scene again redraws anything or if an LVGL
+ * allocation fails.
+ *
+ *   screen_bench [-n frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lvgl.h"
+#include "scene.h"
+#include "icon/icon_pack.h"
+
+#define HOR_RES 240
+#define VER_RES 240
+#define DRAW_BUF_LINES 50 // BSP_LCD_DRAW_BUFF_SIZE of the S3-EYE BSP
+#define PSRAM_REGION_SIZE LV_MEM_REGION_MAX_SIZE // SCREEN_LVGL_PSRAM_SIZE
+#define DEFAULT_FRAMES 100
+
+extern const struct PackedIcon success_packed, failure_packed, warning_packed, noQr_packed, noWifi_packed,
+    noTB_packed, noBackend_packed;
+
+static const struct PackedIcon *flash_icons[] = {&success_packed, &failure_packed, &warning_packed, &noQr_packed,
+                                                 &noWifi_packed, &noTB_packed, &noBackend_packed};
+
+LV_FONT_DECLARE(screen_font);
+
+static uint16_t framebuffer[HOR_RES * VER_RES];
+static uint8_t psram_region[PSRAM_REGION_SIZE] __attribute__((aligned(8)));
+
+static uint16_t camera_frame[HOR_RES * VER_RES];
+static lv_img_dsc_t mirror_dsc = {
+    .header.cf = LV_IMG_CF_TRUE_COLOR,
+    .header.w = HOR_RES,
+    .header.h = VER_RES,
+    .data_size = sizeof(camera_frame),
+    .data = (const uint8_t *)camera_frame,
+};
+
+/* What the display driver saw during one lv_refr_now() */
+struct FrameStats {
+    double flush_us;
+    uint32_t px;
+    int areas;
+};
+
+static struct FrameStats frame;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *pixels)
+{
+    double start = now_us();
+    lv_coord_t width = lv_area_get_width(area);
+
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        memcpy(&framebuffer[y * HOR_RES + area->x1], pixels, width * sizeof(lv_color_t));
+        pixels += width;
+    }
+
+    frame.flush_us += now_us() - start;
+    frame.areas++;
+    lv_disp_flush_ready(drv);
+}
+
+static void monitor(lv_disp_drv_t *drv, uint32_t time_ms, uint32_t px)
+{
+    frame.px += px;
+}
+
+static void framebuffer_display(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t pixels[HOR_RES * DRAW_BUF_LINES];
+    static lv_disp_drv_t drv;
+
+    lv_init();
+    lv_mem_add_region(LV_MEM_REGION_LARGE, psram_region, sizeof(psram_region));
+
+    lv_disp_draw_buf_init(&draw_buf, pixels, NULL, HOR_RES * DRAW_BUF_LINES);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = HOR_RES;
+    drv.ver_res = VER_RES;
+    drv.draw_buf = &draw_buf;
+    drv.flush_cb = flush;
+    drv.monitor_cb = monitor;
+    lv_disp_drv_register(&drv);
+}
+
+/* screen_task's widgets and styles, created in the PSRAM region as there */
+static void create_widgets(struct SceneWidgets *widgets)
+{
+    lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_LARGE);
+
+    static lv_style_t bg_style;
+    lv_style_init(&bg_style);
+    lv_style_set_bg_color(&bg_style, lv_color_white());
+    lv_obj_add_style(lv_scr_act(), &bg_style, LV_PART_MAIN);
+
+    static lv_style_t label_style;
+    lv_style_init(&label_style);
+    lv_style_set_text_color(&label_style, lv_color_black());
+    lv_style_set_text_font(&label_style, &screen_font);
+
+    lv_obj_t *bg_image = lv_img_create(lv_scr_act());
+    lv_obj_align(bg_image, LV_ALIGN_CENTER, 0, 0);
+
+    widgets->msg_label = lv_label_create(lv_scr_act());
+    lv_obj_set_width(widgets->msg_label, 150);
+    lv_obj_align(widgets->msg_label, LV_ALIGN_CENTER, 0, 60);
+    lv_obj_add_style(widgets->msg_label, &label_style, LV_PART_MAIN);
+
+    widgets->qr_full = lv_qrcode_create(lv_scr_act(), 240, lv_color_black(), lv_color_white());
+    lv_obj_center(widgets->qr_full);
+    widgets->qr_small = lv_qrcode_create(lv_scr_act(), 170, lv_color_black(), lv_color_white());
+    lv_obj_center(widgets->qr_small);
+    lv_qrcode_set_fixed_layout(true, LV_QRCODE_MASK_AUTO);
+
+    widgets->mirror_img = lv_img_create(lv_scr_act());
+    lv_img_set_zoom(widgets->mirror_img, (int)(255.0 * 240.0 / HOR_RES));
+    lv_img_set_antialias(widgets->mirror_img, false);
+    lv_obj_align(widgets->mirror_img, LV_ALIGN_CENTER, 0, 0);
+
+    widgets->notification = lv_label_create(lv_scr_act());
+    lv_obj_set_width(widgets->notification, 150);
+    lv_obj_align(widgets->notification, LV_ALIGN_CENTER, 0, -100);
+    lv_obj_add_style(widgets->notification, &label_style, LV_PART_MAIN);
+
+    widgets->flash_img = lv_img_create(lv_scr_act());
+    lv_obj_align(widgets->flash_img, LV_ALIGN_CENTER, 0, 0);
+
+    lv_obj_add_flag(bg_image, LV_OBJ_FLAG_HIDDEN);
+    widgets->render_qr = lv_qrcode_update;
+
+    lv_mem_set_region(region);
+}
+
+/* The scenes, as screen_task builds them for frame n of each */
+
+static void totp_url(struct Scene *scene, int n)
+{
+    snprintf(scene->qr_text, sizeof(scene->qr_text), "https://example.org/asistencia?totp=%06d&espacioId=17",
+             (n * 7919) % 1000000);
+}
+
+static void qr_full_screen(struct Scene *scene, int n)
+{
+    scene->view = SceneQr;
+    scene->qr_small = false;
+    scene->notification_shown = false;
+    totp_url(scene, n);
+}
+
+static void qr_small_with_status(struct Scene *scene, int n)
+{
+    static const char *states[] = {"estado: NoTB", "estado: NoBackend", "estado: NoWifi"};
+
+    scene->view = SceneQr;
+    scene->qr_small = true;
+    scene->notification_shown = true;
+    snprintf(scene->notification, sizeof(scene->notification), "%s", states[(n / 4) % 3]);
+    totp_url(scene, n);
+}
+
+static void flash_icon(struct Scene *scene, int n)
+{
+    scene->view = SceneFlash;
+    scene->notification_shown = false;
+    scene->flash_src = icon_get(flash_icons[n % (sizeof(flash_icons) / sizeof(flash_icons[0]))]);
+}
+
+/* A moving gradient with noise, so every frame differs all over as a camera's does */
+static void mirror_frame(struct Scene *scene, int n)
+{
+    uint32_t seed = n * 2654435761u;
+
+    for (int y = 0; y < VER_RES; y++) {
+        for (int x = 0; x < HOR_RES; x++) {
+            seed = seed * 1103515245u + 12345u;
+            uint16_t v = ((x + n) & 0x1f) << 11 | ((y + n) & 0x3f) << 5 | ((seed >> 16) & 0x1f);
+            camera_frame[y * HOR_RES + x] = v >> 8 | v << 8; // big endian, as the camera gives it
+        }
+    }
+
+    scene->view = SceneMirror;
+    scene->notification_shown = false;
+    scene->mirror_src = &mirror_dsc;
+    scene->mirror_seq = n + 1;
+}
+
+struct BenchScene {
+    const char *name;
+    void (*build)(struct Scene *scene, int n);
+};
+
+static const struct BenchScene scenes[] = {
+    {"qr full screen", qr_full_screen},
+    {"qr small + status", qr_small_with_status},
+    {"flash icon", flash_icon},
+    {"mirror image", mirror_frame},
+};
+
+#define SCENE_COUNT (sizeof(scenes) / sizeof(scenes[0]))
+
+/* Applies the scene and redraws, returns the time lv_refr_now() took */
+static double draw(const struct SceneWidgets *widgets, struct SceneState *state, const struct Scene *scene)
+{
+    memset(&frame, 0, sizeof(frame));
+    scene_apply(widgets, state, scene);
+
+    double start = now_us();
+    lv_refr_now(NULL);
+    return now_us() - start;
+}
+
+static int run_scene(const struct SceneWidgets *widgets, struct SceneState *state, const struct BenchScene *bench,
+                     int frames)
+{
+    static struct Scene scene;
+    int failures = 0;
+
+    bench->build(&scene, 0);
+    double enter_us = draw(widgets, state, &scene);
+    uint32_t enter_px = frame.px;
+
+    double render_us = 0, max_render_us = 0, flush_us = 0;
+    uint64_t px = 0;
+    int areas = 0;
+
+    for (int n = 1; n <= frames; n++) {
+        bench->build(&scene, n);
+        double us = draw(widgets, state, &scene);
+
+        if (frame.px == 0) {
+            printf("%s: frame %d redrew nothing\n", bench->name, n);
+            failures++;
+        }
+        render_us += us - frame.flush_us;
+        max_render_us = us - frame.flush_us > max_render_us ? us - frame.flush_us : max_render_us;
+        flush_us += frame.flush_us;
+        px += frame.px;
+        areas += frame.areas;
+    }
+
+    // Nothing changed, nothing may be redrawn
+    draw(widgets, state, &scene);
+    if (frame.px != 0) {
+        printf("%s: the same scene again redrew %u px\n", bench->name, frame.px);
+        failures++;
+    }
+
+    lv_mem_region_monitor_t fast, psram;
+    lv_mem_region_monitor(LV_MEM_REGION_FAST, &fast);
+    lv_mem_region_monitor(LV_MEM_REGION_LARGE, &psram);
+    if (fast.failed != 0 || psram.failed != 0) {
+        printf("%s: %u lvgl allocations failed\n", bench->name, fast.failed + psram.failed);
+        failures++;
+    }
+
+    printf("%-18s %8.0f %7u %9.1f %9.1f %9.1f %9.0f %6.1f %6u %6u %6u %7u %7u %4u\n", bench->name, enter_us,
+           enter_px, render_us / frames, max_render_us, flush_us / frames, (double)px / frames,
+           (double)areas / frames, fast.used_size, fast.max_used, fast.frag_pct, psram.used_size, psram.max_used,
+           fast.spilled);
+
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    struct SceneWidgets widgets;
+    static struct SceneState state;
+    int frames = DEFAULT_FRAMES;
+    int failures = 0;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        frames = atoi(argv[2]) > 0 ? atoi(argv[2]) : DEFAULT_FRAMES;
+    }
+
+    framebuffer_display();
+    create_widgets(&widgets);
+    scene_state_init(&state);
+    lv_refr_now(NULL);
+
+    printf("LVGL %d.%d.%d from sdkconfig: %d bit colour, LV_DRAW_COMPLEX %d, %dx%d, %d line draw buffer, "
+           "%u KB pool + %u KB region, %d frames per scene\n",
+           LVGL_VERSION_MAJOR, LVGL_VERSION_MINOR, LVGL_VERSION_PATCH, LV_COLOR_DEPTH, LV_DRAW_COMPLEX, HOR_RES,
+           VER_RES, DRAW_BUF_LINES, LV_MEM_SIZE / 1024, PSRAM_REGION_SIZE / 1024, frames);
+    printf("%-18s %8s %7s %9s %9s %9s %9s %6s %6s %6s %6s %7s %7s %4s\n", "", "enter", "", "render", "", "flush", "",
+           "", "pool", "", "", "region", "", "");
+    printf("%-18s %8s %7s %9s %9s %9s %9s %6s %6s %6s %6s %7s %7s %4s\n", "scene", "us", "px", "avg us", "max us",
+           "avg us", "px/frame", "areas", "used", "peak", "frag%", "used", "peak", "spill");
+
+    for (size_t i = 0; i < SCENE_COUNT; i++) {
+        failures += run_scene(&widgets, &state, &scenes[i], frames);
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+"""Writes the sdkconfig.h ESP-IDF would generate from an sdkconfig, for the host builds.
+
+LVGL reads its options from it through LV_CONF_KCONFIG_EXTERNAL_INCLUDE, so the
+host library is configured as the firmware's is. Enabled booleans become 1,
+options that are not set are left out, as in the IDF header.
+
+    sdkconfig_h.py -o sdkconfig.h ../../../sdkconfig
+"""
+
+import argparse
+import os
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('-o', '--output', required=True)
+    parser.add_argument('sdkconfig')
+    args = parser.parse_args()
+
+    out = ['// Generated by sdkconfig_h.py from sdkconfig, do not edit', '#pragma once', '']
+    for line in open(args.sdkconfig):
+        line = line.strip()
+        if not line.startswith('CONFIG_') or '=' not in line:
+            continue
+        name, value = line.split('=', 1)
+        out.append(f'#define {name} {1 if value == "y" else value}')
+
+    text = '\n'.join(out) + '\n'
+    if not os.path.exists(args.output) or open(args.output).read() != text:
+        with open(args.output, 'w') as f:
+            f.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,147 @@
+#include "panel_blit.h"
+
+#include <assert.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_lvgl_port.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define TAG "panel_blit"
+
+// Swaps the two bytes of every pixel on the way out. Not needed here: LVGL sends
+// lv_color_t as it is in memory (LV_COLOR_16_SWAP off) and the camera frames were
+// shown as LV_IMG_CF_TRUE_COLOR, so their bytes already are what the panel gets.
+#define PANEL_BLIT_SWAP_BYTES 0
+
+#define PANEL_BLIT_TIMEOUT pdMS_TO_TICKS(100) // a chunk takes a few ms at the panel's SPI clock
+
+static struct
+{
+    lv_disp_t *disp;
+    esp_lcd_panel_handle_t panel;
+    int width;
+    int height;
+    uint8_t *bufs[2];       // LVGL's draw buffers, the same one twice if it has only one
+    int depth;              // chunks that can be in flight
+    int rows;               // rows per chunk
+    int next;               // buffer the next chunk is copied to
+    int in_flight;          // chunks sent and not seen done
+    SemaphoreHandle_t done; // given by the IO for each chunk sent
+} blit = {0};
+
+static bool panel_blit_done_cb(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata,
+                               void *user_ctx)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(blit.done, &woken);
+    return woken == pdTRUE;
+}
+
+// Chunks finish in order, so waiting until at most `left` are in flight frees the oldest buffers
+static void panel_blit_wait(int left)
+{
+    while (blit.in_flight > left)
+    {
+        if (xSemaphoreTake(blit.done, PANEL_BLIT_TIMEOUT) != pdPASS)
+        {
+            ESP_LOGE(TAG, "chunk not done in time");
+            blit.in_flight = 0;
+            break;
+        }
+        blit.in_flight--;
+    }
+}
+
+#if PANEL_BLIT_SWAP_BYTES
+static void panel_blit_copy(uint8_t *dst, const uint8_t *src, size_t bytes)
+{
+    const uint32_t *from = (const uint32_t *)src;
+    uint32_t *to = (uint32_t *)dst;
+
+    for (size_t i = 0; i < bytes / 4; i++)
+    {
+        uint32_t two = from[i];
+        to[i] = ((two & 0x00ff00ff) << 8) | ((two >> 8) & 0x00ff00ff);
+    }
+}
+#else
+#define panel_blit_copy memcpy
+#endif
+
+bool panel_blit_begin(int width, int height)
+{
+    lv_disp_t *disp = lv_disp_get_default();
+    lv_disp_draw_buf_t *draw_buf = disp->driver->draw_buf;
+
+    if (width != lv_disp_get_hor_res(disp) || height != lv_disp_get_ver_res(disp) || draw_buf->size < width)
+    {
+        ESP_LOGW(TAG, "%dx%d frames on a %dx%d panel, left to LVGL", width, height, (int)lv_disp_get_hor_res(disp),
+                 (int)lv_disp_get_ver_res(disp));
+        return false;
+    }
+
+    if (blit.done == NULL)
+    {
+        blit.done = xSemaphoreCreateCounting(2, 0);
+        assert(blit.done);
+    }
+
+    // The lock keeps LVGL from starting a refresh, the last one may still be flushing
+    while (draw_buf->flushing)
+    {
+        vTaskDelay(1);
+    }
+
+    esp_lcd_panel_io_handle_t io;
+    lvgl_port_get_panel(disp, &blit.panel, &io);
+    if (lvgl_port_set_trans_done_cb(disp, panel_blit_done_cb, NULL) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "no transfer done callback, left to LVGL");
+        return false;
+    }
+    lvgl_port_stop();
+
+    blit.disp = disp;
+    blit.width = width;
+    blit.height = height;
+    blit.bufs[0] = draw_buf->buf1;
+    blit.bufs[1] = draw_buf->buf2 != NULL ? draw_buf->buf2 : draw_buf->buf1;
+    blit.depth = draw_buf->buf2 != NULL ? 2 : 1;
+    blit.rows = MIN(draw_buf->size / width, height);
+    blit.next = 0;
+    blit.in_flight = 0;
+    xSemaphoreTake(blit.done, 0);
+    xSemaphoreTake(blit.done, 0);
+
+    ESP_LOGI(TAG, "blitting %dx%d in chunks of %d rows, %d deep", width, height, blit.rows, blit.depth);
+    return true;
+}
+
+void panel_blit_frame(const uint8_t *frame)
+{
+    const size_t row_bytes = blit.width * 2;
+
+    for (int y = 0; y < blit.height; y += blit.rows)
+    {
+        int rows = MIN(blit.rows, blit.height - y);
+        uint8_t *buf = blit.bufs[blit.next];
+
+        panel_blit_wait(blit.depth - 1);
+        panel_blit_copy(buf, &frame[y * row_bytes], rows * row_bytes);
+        esp_lcd_panel_draw_bitmap(blit.panel, 0, y, blit.width, y + rows, buf);
+        blit.in_flight++;
+        blit.next = (blit.next + 1) % 2;
+    }
+}
+
+void panel_blit_end(void)
+{
+    panel_blit_wait(0);
+    lvgl_port_set_trans_done_cb(blit.disp, NULL, NULL);
+
+    // What LVGL last drew is gone from the panel
+    lv_obj_invalidate(lv_disp_get_scr_act(blit.disp));
+    lvgl_port_resume();
+}
@@ -0,0 +1,26 @@
+#ifndef __PANEL_BLIT_H__
+#define __PANEL_BLIT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Draws whole frames straight to the panel, without LVGL. The camera frames in
+// mirror mode are RGB565 at the panel's size, so going through an lv_img only
+// added a software transform and a copy into LVGL's draw buffer per frame. While
+// blitting LVGL is stopped and its DMA capable draw buffers are used as the two
+// bounce buffers: a chunk of rows is copied out of PSRAM into one while the
+// other is on its way to the panel.
+
+// Stops LVGL and takes its panel. Returns false, leaving LVGL running, if the
+// frames don't match the panel. Call with the display lock held.
+bool panel_blit_begin(int width, int height);
+
+// Sends a frame of the size given to panel_blit_begin. Returns once it is
+// copied, the last chunk may still be on its way.
+void panel_blit_frame(const uint8_t *frame);
+
+// Waits for the transfers, gives the panel back and has LVGL redraw all of it.
+// Call with the display lock held.
+void panel_blit_end(void);
+
+#endif
@@ -0,0 +1,274 @@
+#include "qr_render.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef ESP_PLATFORM
+#include "../common.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#define qr_render_alloc(size) heap_caps_malloc(size, MALLOC_CAP_SPIRAM)
+#define qr_render_free(ptr) heap_caps_free(ptr)
+
+_Static_assert(QR_RENDER_TEXT_SIZE == MAX_QR_SIZE, "qr_render doesn't cache every DrawQr text");
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#define qr_render_alloc(size) malloc(size)
+#define qr_render_free(ptr) free(ptr)
+#define ESP_LOGI(tag, format, ...) ((void)0)
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "%s: " format "\n", tag, __VA_ARGS__)
+#endif
+
+#define TAG "qr_render"
+
+// A slot holds a copy of the whole canvas buffer, palette included, for one
+// (text, widget size, ECC) key
+struct QRRenderSlot
+{
+    uint32_t hash; // of the text, to skip most comparisons
+    uint16_t len;
+    lv_coord_t size;
+    uint8_t ecc;
+    char text[QR_RENDER_TEXT_SIZE];
+    uint8_t *bitmap; // NULL for a free slot
+    uint32_t bitmap_size;
+    uint32_t used; // render counter at the last use, the smallest one is evicted
+};
+
+// What each widget currently displays, kept apart from the slots as the canvas
+// still shows a code after its slot is evicted
+struct QRRenderShown
+{
+    lv_obj_t *qrcode;
+    bool valid;
+    uint16_t len;
+    char text[QR_RENDER_TEXT_SIZE];
+};
+
+#define QR_RENDER_WIDGETS 2
+
+static struct QRRenderSlot qr_render_slots[QR_RENDER_SLOTS] = {0};
+static struct QRRenderShown qr_render_shown[QR_RENDER_WIDGETS] = {0};
+static struct QRRenderStats qr_render_stats = {0};
+static uint32_t qr_render_counter = 0;
+
+// Off-screen canvas qr_render_prepare encodes into, its buffer in PSRAM as the
+// LVGL heap is too small for a spare full screen code
+static lv_obj_t *qr_render_scratch = NULL;
+static uint8_t *qr_render_scratch_buf = NULL;
+static lv_coord_t qr_render_scratch_size = 0;
+
+void qr_render_get_stats(struct QRRenderStats *stats)
+{
+    memcpy(stats, &qr_render_stats, sizeof(struct QRRenderStats));
+}
+
+static uint32_t qr_render_hash(const uint8_t *data, uint32_t len)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (uint32_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static struct QRRenderShown *qr_render_widget(lv_obj_t *qrcode)
+{
+    struct QRRenderShown *free_entry = NULL;
+
+    for (int i = 0; i < QR_RENDER_WIDGETS; i++)
+    {
+        if (qr_render_shown[i].qrcode == qrcode)
+        {
+            return &qr_render_shown[i];
+        }
+        if (qr_render_shown[i].qrcode == NULL && free_entry == NULL)
+        {
+            free_entry = &qr_render_shown[i];
+        }
+    }
+
+    if (free_entry != NULL)
+    {
+        free_entry->qrcode = qrcode;
+    }
+    return free_entry;
+}
+
+static struct QRRenderSlot *qr_render_find(uint32_t hash, const void *data, uint32_t len, lv_coord_t size)
+{
+    for (int i = 0; i < QR_RENDER_SLOTS; i++)
+    {
+        struct QRRenderSlot *slot = &qr_render_slots[i];
+        if (slot->bitmap != NULL && slot->hash == hash && slot->len == len && slot->size == size &&
+            slot->ecc == QR_RENDER_ECC && memcmp(slot->text, data, len) == 0)
+        {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+// Copies a freshly drawn canvas into the least recently used slot. A failed
+// allocation only costs the caching.
+static void qr_render_store(uint32_t hash, const void *data, uint32_t len, const lv_img_dsc_t *img)
+{
+    struct QRRenderSlot *victim = &qr_render_slots[0];
+
+    for (int i = 1; i < QR_RENDER_SLOTS; i++)
+    {
+        if (qr_render_slots[i].used < victim->used)
+        {
+            victim = &qr_render_slots[i];
+        }
+    }
+
+    uint32_t bitmap_size = LV_CANVAS_BUF_SIZE_INDEXED_1BIT(img->header.w, img->header.h);
+    if (victim->bitmap_size != bitmap_size)
+    {
+        qr_render_free(victim->bitmap);
+        victim->bitmap = qr_render_alloc(bitmap_size);
+        victim->bitmap_size = victim->bitmap ? bitmap_size : 0;
+        if (victim->bitmap == NULL)
+        {
+            ESP_LOGE(TAG, "no memory to keep a %d px code", img->header.w);
+            return;
+        }
+    }
+
+    memcpy(victim->bitmap, img->data, bitmap_size);
+    memcpy(victim->text, data, len);
+    victim->hash = hash;
+    victim->len = len;
+    victim->size = img->header.w;
+    victim->ecc = QR_RENDER_ECC;
+    victim->used = qr_render_counter;
+}
+
+lv_res_t qr_render(lv_obj_t *qrcode, const void *data, uint32_t data_len)
+{
+    lv_img_dsc_t *img = lv_canvas_get_img(qrcode);
+    lv_coord_t size = img->header.w;
+    struct QRRenderShown *shown = qr_render_widget(qrcode);
+
+    qr_render_counter++;
+
+    if (shown != NULL && shown->valid && shown->len == data_len && memcmp(shown->text, data, data_len) == 0)
+    {
+        qr_render_stats.unchanged++;
+        return LV_RES_OK;
+    }
+
+    if (data_len > QR_RENDER_TEXT_SIZE)
+    {
+        if (shown != NULL)
+        {
+            shown->valid = false;
+        }
+        return lv_qrcode_update(qrcode, data, data_len);
+    }
+
+    uint32_t hash = qr_render_hash(data, data_len);
+    struct QRRenderSlot *slot = qr_render_find(hash, data, data_len, size);
+    if (slot != NULL)
+    {
+        memcpy((uint8_t *)img->data, slot->bitmap, slot->bitmap_size);
+        lv_obj_invalidate(qrcode);
+        slot->used = qr_render_counter;
+        qr_render_stats.hits++;
+    }
+    else
+    {
+        // The canvas is cleared even when encoding fails
+        if (shown != NULL)
+        {
+            shown->valid = false;
+        }
+
+        lv_res_t res = lv_qrcode_update(qrcode, data, data_len);
+        if (res != LV_RES_OK)
+        {
+            return res;
+        }
+
+        qr_render_store(hash, data, data_len, img);
+        qr_render_stats.misses++;
+        ESP_LOGI(TAG, "encoded a %d px code, unchanged: %d, hits: %d, misses: %d", size,
+                 qr_render_stats.unchanged, qr_render_stats.hits, qr_render_stats.misses);
+    }
+
+    if (shown != NULL)
+    {
+        memcpy(shown->text, data, data_len);
+        shown->len = data_len;
+        shown->valid = true;
+    }
+    return LV_RES_OK;
+}
+
+static lv_obj_t *qr_render_get_scratch(lv_coord_t size)
+{
+    if (qr_render_scratch == NULL)
+    {
+        // Created as a screen of its own that is never loaded, so it is never drawn
+        lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_LARGE);
+        qr_render_scratch = lv_canvas_create(NULL);
+        lv_mem_set_region(region);
+    }
+
+    if (qr_render_scratch_size != size)
+    {
+        qr_render_free(qr_render_scratch_buf);
+        qr_render_scratch_buf = qr_render_alloc(LV_CANVAS_BUF_SIZE_INDEXED_1BIT(size, size));
+        qr_render_scratch_size = qr_render_scratch_buf ? size : 0;
+        if (qr_render_scratch_buf == NULL)
+        {
+            ESP_LOGE(TAG, "no memory to prepare a %d px code", size);
+            return NULL;
+        }
+        lv_canvas_set_buffer(qr_render_scratch, qr_render_scratch_buf, size, size, LV_IMG_CF_INDEXED_1BIT);
+    }
+
+    return qr_render_scratch;
+}
+
+lv_res_t qr_render_prepare(lv_obj_t *qrcode, const void *data, uint32_t data_len)
+{
+    lv_img_dsc_t *img = lv_canvas_get_img(qrcode);
+    lv_coord_t size = img->header.w;
+
+    if (data_len > QR_RENDER_TEXT_SIZE)
+    {
+        return LV_RES_INV;
+    }
+
+    uint32_t hash = qr_render_hash(data, data_len);
+    if (qr_render_find(hash, data, data_len, size) != NULL)
+    {
+        return LV_RES_OK;
+    }
+
+    lv_obj_t *scratch = qr_render_get_scratch(size);
+    if (scratch == NULL)
+    {
+        return LV_RES_INV;
+    }
+
+    // The widget's palette, two colours ahead of the bits, as the slot is later
+    // copied over the widget whole
+    lv_img_dsc_t *scratch_img = lv_canvas_get_img(scratch);
+    memcpy((uint8_t *)scratch_img->data, img->data, 2 * sizeof(lv_color32_t));
+
+    qr_render_counter++;
+    lv_res_t res = lv_qrcode_update(scratch, data, data_len);
+    if (res != LV_RES_OK)
+    {
+        return res;
+    }
+
+    qr_render_store(hash, data, data_len, scratch_img);
+    qr_render_stats.prepared++;
+    return LV_RES_OK;
+}
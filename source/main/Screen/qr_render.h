@@ -0,0 +1,37 @@
+#ifndef __QR_RENDER_H__
+#define __QR_RENDER_H__
+
+#include <stdint.h>
+#include "lvgl.h"
+
+// Renders text into an lv_qrcode, remembering the last few bitmaps. The screen
+// task asks for the same code on every tick while it only changes once per TOTP
+// window, and flips between the full screen and the smaller widget with the
+// starter state.
+#define QR_RENDER_SLOTS 4
+
+// Longest text kept, MAX_QR_SIZE in common.h
+#define QR_RENDER_TEXT_SIZE 300
+
+// ECC level lv_qrcode_update encodes with, part of the key in case it changes
+#define QR_RENDER_ECC 1 // qrcodegen_Ecc_MEDIUM
+
+struct QRRenderStats
+{
+    int unchanged; // the widget already showed it, nothing done
+    int hits;      // copied from a remembered bitmap
+    int misses;    // encoded and drawn by lv_qrcode_update
+    int prepared;  // encoded ahead of time by qr_render_prepare
+};
+
+// Call with the display lock held
+lv_res_t qr_render(lv_obj_t *qrcode, const void *data, uint32_t data_len);
+
+// Encodes text for the widget's size into a slot without touching what it shows,
+// so a later qr_render of the same text is only a copy. Call with the display
+// lock held.
+lv_res_t qr_render_prepare(lv_obj_t *qrcode, const void *data, uint32_t data_len);
+
+void qr_render_get_stats(struct QRRenderStats *stats);
+
+#endif
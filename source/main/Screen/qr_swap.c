@@ -0,0 +1,54 @@
+#include "qr_swap.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void qr_swap_init(struct QRSwap *swap)
+{
+    memset(swap, 0, sizeof(struct QRSwap));
+}
+
+bool qr_swap_draw(struct QRSwap *swap, const char *text, time_t now)
+{
+    // Queued before the swap, the totp task sends the new code after it
+    if (now < swap->retired_until && strcmp(text, swap->retired) == 0)
+    {
+        return false;
+    }
+    swap->retired_until = 0;
+
+    snprintf(swap->shown, sizeof(swap->shown), "%s", text);
+    swap->shown_at = now;
+    return true;
+}
+
+void qr_swap_prepare(struct QRSwap *swap, const char *text, int64_t from_us)
+{
+    snprintf(swap->prepared, sizeof(swap->prepared), "%s", text);
+    swap->prepared_from_us = from_us;
+}
+
+int64_t qr_swap_due(struct QRSwap *swap, time_t now)
+{
+    int64_t from_us = swap->prepared_from_us;
+
+    if (from_us == 0)
+    {
+        return 0;
+    }
+
+    if (strcmp(swap->shown, swap->prepared) != 0)
+    {
+        memcpy(swap->retired, swap->shown, sizeof(swap->retired));
+        swap->retired_until = now + QR_SWAP_RETIRED_TIME;
+    }
+    memcpy(swap->shown, swap->prepared, sizeof(swap->shown));
+    swap->shown_at = now;
+    swap->prepared_from_us = 0;
+    return from_us;
+}
+
+const char *qr_swap_shown(const struct QRSwap *swap, time_t now)
+{
+    return QR_SWAP_MAX_AGE > now - swap->shown_at ? swap->shown : NULL;
+}
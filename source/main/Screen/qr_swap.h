@@ -0,0 +1,43 @@
+#ifndef __QR_SWAP_H__
+#define __QR_SWAP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+// The TOTP code screen_task shows and the next one. The totp task sends PrepareQr
+// with the next window's code ahead of the boundary and DrawQr with the current
+// one every tick, the swap timer SwapQr at the boundary. SwapQr goes to the front
+// of the queue, so DrawQr with the old code sent before it still arrive after it;
+// those are dropped for a while instead of putting the old code back. Plain data,
+// the host tests drive it with their own clock.
+
+#define QR_SWAP_TEXT_SIZE 300  // MAX_QR_SIZE
+#define QR_SWAP_MAX_AGE 10     // seconds a code is shown without a DrawQr or swap
+#define QR_SWAP_RETIRED_TIME 2 // seconds DrawQr with the code a swap replaced are dropped
+
+struct QRSwap
+{
+    char shown[QR_SWAP_TEXT_SIZE];
+    time_t shown_at;
+    char prepared[QR_SWAP_TEXT_SIZE];
+    int64_t prepared_from_us; // 0 if nothing is prepared
+    char retired[QR_SWAP_TEXT_SIZE]; // the code the last swap replaced
+    time_t retired_until;
+};
+
+void qr_swap_init(struct QRSwap *swap);
+
+// DrawQr. Returns false if the text was dropped as the code the last swap replaced.
+bool qr_swap_draw(struct QRSwap *swap, const char *text, time_t now);
+
+// PrepareQr, the text is due at from_us (system time)
+void qr_swap_prepare(struct QRSwap *swap, const char *text, int64_t from_us);
+
+// SwapQr. Returns the from_us of the code swapped in, 0 if none was prepared.
+int64_t qr_swap_due(struct QRSwap *swap, time_t now);
+
+// The code to show, NULL if none came in the last QR_SWAP_MAX_AGE seconds
+const char *qr_swap_shown(const struct QRSwap *swap, time_t now);
+
+#endif
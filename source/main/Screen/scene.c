@@ -0,0 +1,153 @@
+#include "scene.h"
+
+#include <string.h>
+
+void scene_state_init(struct SceneState *state)
+{
+    memset(state, 0, sizeof(struct SceneState));
+}
+
+static bool scene_shows(const struct Scene *scene, enum SceneView view)
+{
+    return scene->view == view;
+}
+
+// Shows or hides obj if it isn't already, widgets NULL only counts
+static int scene_show(const struct SceneWidgets *widgets, lv_obj_t *obj, bool shown, bool was_shown, bool force)
+{
+    if (!force && shown == was_shown)
+    {
+        return 0;
+    }
+
+    if (widgets != NULL)
+    {
+        if (shown)
+        {
+            lv_obj_clear_flag(obj, LV_OBJ_FLAG_HIDDEN);
+        }
+        else
+        {
+            lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+        }
+    }
+    return 1;
+}
+
+// The single walk behind scene_changes and scene_apply, so they can't disagree.
+// With widgets NULL nothing is touched.
+static int scene_diff(const struct SceneWidgets *widgets, struct SceneState *state, const struct Scene *scene)
+{
+    bool force = !state->valid;
+    int calls = 0;
+
+    bool was_flash = state->view == SceneFlash;
+    bool was_message = state->view == SceneMessage;
+    bool was_full = state->view == SceneQr && !state->qr_small;
+    bool was_small = state->view == SceneQr && state->qr_small;
+    bool was_mirror = state->view == SceneMirror;
+
+    bool full = scene_shows(scene, SceneQr) && !scene->qr_small;
+    bool small = scene_shows(scene, SceneQr) && scene->qr_small;
+
+    // Hide first, so two widgets are never shown together
+    lv_obj_t *objs[] = {widgets ? widgets->flash_img : NULL, widgets ? widgets->msg_label : NULL,
+                        widgets ? widgets->qr_full : NULL, widgets ? widgets->qr_small : NULL,
+                        widgets ? widgets->mirror_img : NULL};
+    bool shown[] = {scene_shows(scene, SceneFlash), scene_shows(scene, SceneMessage), full, small,
+                    scene_shows(scene, SceneMirror)};
+    bool was_shown[] = {was_flash, was_message, was_full, was_small, was_mirror};
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < sizeof(objs) / sizeof(objs[0]); i++)
+        {
+            if (shown[i] == (pass == 1))
+            {
+                calls += scene_show(widgets, objs[i], shown[i], was_shown[i], force);
+            }
+        }
+    }
+
+    calls += scene_show(widgets, widgets ? widgets->notification : NULL, scene->notification_shown,
+                        state->notification_shown, force);
+
+    // Content only for what is shown, hidden widgets keep theirs until they are
+    if (scene->notification_shown && (force || strcmp(state->notification, scene->notification) != 0))
+    {
+        if (widgets != NULL)
+        {
+            lv_label_set_text(widgets->notification, scene->notification);
+            strncpy(state->notification, scene->notification, SCENE_NOTIFICATION_SIZE);
+        }
+        calls++;
+    }
+
+    if (scene_shows(scene, SceneFlash) && (force || state->flash_src != scene->flash_src))
+    {
+        if (widgets != NULL)
+        {
+            lv_img_set_src(widgets->flash_img, scene->flash_src);
+            state->flash_src = scene->flash_src;
+        }
+        calls++;
+    }
+
+    if (scene_shows(scene, SceneMessage) && (force || strcmp(state->message, scene->message) != 0))
+    {
+        if (widgets != NULL)
+        {
+            lv_label_set_text(widgets->msg_label, scene->message);
+            strncpy(state->message, scene->message, SCENE_TEXT_SIZE);
+        }
+        calls++;
+    }
+
+    if (scene_shows(scene, SceneQr))
+    {
+        char *shown_text = state->qr_text[scene->qr_small];
+        if (force || strcmp(shown_text, scene->qr_text) != 0)
+        {
+            if (widgets != NULL)
+            {
+                lv_obj_t *qrcode = scene->qr_small ? widgets->qr_small : widgets->qr_full;
+                widgets->render_qr(qrcode, scene->qr_text, strlen(scene->qr_text));
+                strncpy(shown_text, scene->qr_text, SCENE_TEXT_SIZE);
+            }
+            calls++;
+        }
+    }
+
+    if (scene_shows(scene, SceneMirror) && scene->mirror_src != NULL &&
+        (force || state->mirror_src != scene->mirror_src || state->mirror_seq != scene->mirror_seq))
+    {
+        if (widgets != NULL)
+        {
+            // The descriptor is the same for every frame, the cache would keep the old data
+            lv_img_cache_invalidate_src(scene->mirror_src);
+            lv_img_set_src(widgets->mirror_img, scene->mirror_src);
+            state->mirror_src = scene->mirror_src;
+            state->mirror_seq = scene->mirror_seq;
+        }
+        calls++;
+    }
+
+    if (widgets != NULL)
+    {
+        state->view = scene->view;
+        state->qr_small = scene->qr_small;
+        state->notification_shown = scene->notification_shown;
+        state->valid = true;
+    }
+    return calls;
+}
+
+int scene_changes(const struct SceneState *state, const struct Scene *scene)
+{
+    return scene_diff(NULL, (struct SceneState *)state, scene);
+}
+
+int scene_apply(const struct SceneWidgets *widgets, struct SceneState *state, const struct Scene *scene)
+{
+    return scene_diff(widgets, state, scene);
+}
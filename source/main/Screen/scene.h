@@ -0,0 +1,74 @@
+#ifndef __SCENE_H__
+#define __SCENE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl.h"
+
+// What the screen should show, as plain data. screen_task builds the scene it
+// wants on every wake up and scene_apply turns the difference with the one last
+// applied into LVGL calls, so nothing is invalidated, and redrawn, unless it
+// changed. Only LVGL is used here, the host tests drive it headless.
+
+#define SCENE_TEXT_SIZE 300 // MAX_QR_SIZE
+#define SCENE_NOTIFICATION_SIZE 100
+
+enum SceneView
+{
+    SceneFlash,
+    SceneMessage,
+    SceneQr,
+    SceneMirror,
+};
+
+struct SceneWidgets
+{
+    lv_obj_t *flash_img;
+    lv_obj_t *msg_label;
+    lv_obj_t *notification;
+    lv_obj_t *qr_full;
+    lv_obj_t *qr_small;
+    lv_obj_t *mirror_img;
+    lv_res_t (*render_qr)(lv_obj_t *qrcode, const void *data, uint32_t data_len);
+};
+
+struct Scene
+{
+    enum SceneView view;
+    bool notification_shown;
+    char notification[SCENE_NOTIFICATION_SIZE];
+
+    // Only read for the view they belong to
+    const void *flash_src;
+    char message[SCENE_TEXT_SIZE];
+    bool qr_small;
+    char qr_text[SCENE_TEXT_SIZE];
+    const lv_img_dsc_t *mirror_src;
+    uint32_t mirror_seq; // bumped for every frame, the buffer may be reused
+};
+
+// What the widgets hold, hidden ones included
+struct SceneState
+{
+    bool valid; // false until the first apply, which sets everything
+    enum SceneView view;
+    bool qr_small;
+    bool notification_shown;
+    char notification[SCENE_NOTIFICATION_SIZE];
+    const void *flash_src;
+    char message[SCENE_TEXT_SIZE];
+    char qr_text[2][SCENE_TEXT_SIZE]; // full screen, smaller
+    const lv_img_dsc_t *mirror_src;
+    uint32_t mirror_seq;
+};
+
+void scene_state_init(struct SceneState *state);
+
+// Number of LVGL calls scene_apply would make, 0 if the screen is up to date
+int scene_changes(const struct SceneState *state, const struct Scene *scene);
+
+// Makes the widgets show the scene and returns the number of LVGL calls made.
+// Call with the display lock held.
+int scene_apply(const struct SceneWidgets *widgets, struct SceneState *state, const struct Scene *scene);
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <sys/param.h>
+#include <sys/time.h>
 #include "esp_err.h"
 #include "esp_lcd_panel_io.h"
 #include "esp_lcd_panel_vendor.h"
@@ -31,6 +32,14 @@
 #include "../icon/icon.h"
 #include "../Camera/camera.h"
 #include "../SYS_MODE/sys_mode.h"
+#include "qr_render.h"
+#include "scene.h"
+#include "qr_swap.h"
+#include "panel_blit.h"
+#include "../MQTT/mqtt.h"
+
+// Only the glyphs of the strings shown, written by font_subset.py at build time
+LV_FONT_DECLARE(screen_font);
 
 char *screen_stater_state_to_string[] = {
     [NoQRConfig] = "NoQRConfig",
@@ -42,25 +51,225 @@ char *screen_stater_state_to_string[] = {
     [Success] = "Success",
 };
 
-#define ALLOWED_AGE_FOR_QR 10
 #define FLASH_TIME 4
 
+_Static_assert(QR_SWAP_TEXT_SIZE == MAX_QR_SIZE, "QRSwap doesn't hold a DrawQr text");
+
+static struct ScreenSwapStats swap_stats = {0};
+
+static int64_t screen_system_us(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+// Fires at the TOTP boundary. The swap goes ahead of whatever is queued, DrawQr
+// messages with the old code included.
+static void screen_swap_timer_cb(void *arg)
+{
+    struct ScreenConf *conf = arg;
+
+    struct ScreenMsg *msg = jalloc(sizeof(struct ScreenMsg));
+    msg->command = SwapQr;
+    if (xQueueSendToFront(conf->to_screen_queue, &msg, 0) != pdTRUE)
+    {
+        free(msg);
+    }
+}
+
+#define SCREEN_IDLE_WAIT pdMS_TO_TICKS(100)
+#define SCREEN_STATS_PERIOD_US (10 * 1000000)
+#define SCREEN_LVGL_PSRAM_SIZE LV_MEM_REGION_MAX_SIZE // CONFIG_LV_MEM_REGION_MAX_KILOBYTES, for the widgets
+
+static struct ScreenDrawStats draw_stats = {0};
+
+// Called by LVGL after each refresh that redrew something, in the LVGL task
+static void screen_monitor_cb(lv_disp_drv_t *drv, uint32_t time_ms, uint32_t px)
+{
+    draw_stats.frames++;
+    draw_stats.px += px;
+    draw_stats.render_ms += time_ms;
+}
+
+// Rates over the last SCREEN_STATS_PERIOD_US, CPU as a share of one core
+static void screen_log_draw_stats(void)
+{
+    static struct ScreenDrawStats last = {0};
+    static int64_t last_us = 0;
+
+    int64_t now = esp_timer_get_time();
+    if (now - last_us < SCREEN_STATS_PERIOD_US)
+    {
+        return;
+    }
+
+    double seconds = (now - last_us) / 1e6;
+    if (last_us != 0)
+    {
+        ESP_LOGI(TAG, "%.1f frames/s, %.0f px/s, render %.1f%% cpu, screen task %.2f%% cpu, %.1f wakeups/s, "
+                 "%.1f applies/s, %.1f lvgl calls/s",
+                 (draw_stats.frames - last.frames) / seconds, (draw_stats.px - last.px) / seconds,
+                 (draw_stats.render_ms - last.render_ms) / 10.0 / seconds,
+                 (draw_stats.busy_us - last.busy_us) / 1e4 / seconds, (draw_stats.wakeups - last.wakeups) / seconds,
+                 (draw_stats.applies - last.applies) / seconds, (draw_stats.lvgl_calls - last.lvgl_calls) / seconds);
+        if (draw_stats.mirror_frames != last.mirror_frames)
+        {
+            ESP_LOGI(TAG, "mirror %.1f frames/s, %.1f dropped/s, blit %.2f%% cpu",
+                     (draw_stats.mirror_frames - last.mirror_frames) / seconds,
+                     (draw_stats.mirror_dropped - last.mirror_dropped) / seconds,
+                     (draw_stats.mirror_us - last.mirror_us) / 1e4 / seconds);
+        }
+    }
+
+    memcpy(&last, &draw_stats, sizeof(struct ScreenDrawStats));
+    last_us = now;
+}
+
+// Expanded into PSRAM the first time each is flashed, from the cache afterwards
+static const void *screen_flash_src(enum Icon icon)
+{
+    const struct PackedIcon *packed;
+
+    switch (icon)
+    {
+    case OK_Icon:
+        packed = &success_packed;
+        break;
+    case NotFound_Icon:
+        packed = &failure_packed;
+        break;
+    case NoBackendAuthIcon:
+    case NoBackendIcon:
+        packed = &noBackend_packed;
+        break;
+    case NoTBAuthIcon:
+    case NoTBIcon:
+        packed = &noTB_packed;
+        break;
+    case NoWifiIcon:
+        packed = &noWifi_packed;
+        break;
+    case NoQRConfigIcon:
+        packed = &noQr_packed;
+        break;
+    case OtherClass_Icon:
+    default:
+        packed = &warning_packed;
+        break;
+    }
+
+    struct IconCacheStats before, after;
+    icon_get_stats(&before);
+    const lv_img_dsc_t *img = icon_get(packed);
+    icon_get_stats(&after);
+
+    if (after.misses != before.misses)
+    {
+        ESP_LOGI(TAG, "icon %s expanded in %lld us, %d KB of icons cached", packed->name, after.last_unpack_us,
+                 (int)(after.bytes / 1024));
+    }
+    else if (after.failed != before.failed)
+    {
+        ESP_LOGE(TAG, "icon %s could not be expanded", packed->name);
+    }
+    return img;
+}
+
+// Sends the LVGL heap, swap and drawing statistics as telemetry, at most once per period
+static void screen_telemetry_report(struct ScreenConf *conf)
+{
+    static int64_t reported_us = 0;
+    lv_mem_region_monitor_t mon[2];
+
+    int64_t now = esp_timer_get_time();
+    if (reported_us != 0 && now - reported_us < (int64_t)LVGL_MEM_TELEMETRY_PERIOD * 1000000)
+    {
+        return;
+    }
+    reported_us = now;
+
+    bsp_display_lock(0);
+    lv_mem_region_monitor(LV_MEM_REGION_FAST, &mon[0]);
+    lv_mem_region_monitor(LV_MEM_REGION_LARGE, &mon[1]);
+    bsp_display_unlock();
+
+    ESP_LOGI(TAG, "lvgl heap: internal %lu of %lu bytes, peak %lu, frag %d%%, psram %lu of %lu bytes, peak %lu, "
+             "frag %d%%, %lu spilled, %lu failed",
+             mon[0].used_size, mon[0].total_size, mon[0].max_used, mon[0].frag_pct, mon[1].used_size,
+             mon[1].total_size, mon[1].max_used, mon[1].frag_pct, mon[0].spilled + mon[1].spilled,
+             mon[0].failed + mon[1].failed);
+
+    jsend(conf->to_mqtt_queue, MQTTMsg, {
+        msg->command = LVGLMemReport;
+        for (int i = 0; i < 2; i++)
+        {
+            msg->data.lvgl_mem.used[i] = mon[i].used_size;
+            msg->data.lvgl_mem.max_used[i] = mon[i].max_used;
+            msg->data.lvgl_mem.biggest_free[i] = mon[i].free_biggest_size;
+            msg->data.lvgl_mem.failed[i] = mon[i].failed;
+            msg->data.lvgl_mem.spilled[i] = mon[i].spilled;
+            msg->data.lvgl_mem.frag_pct[i] = mon[i].frag_pct;
+        }
+    });
+
+    jsend(conf->to_mqtt_queue, MQTTMsg, {
+        msg->command = ScreenStatsReport;
+        memcpy(&msg->data.screen_stats.swap, &swap_stats, sizeof(struct ScreenSwapStats));
+        memcpy(&msg->data.screen_stats.draw, &draw_stats, sizeof(struct ScreenDrawStats));
+    });
+}
+
+static void screen_record_swap(int64_t from_us, const struct QRRenderStats *before)
+{
+    struct QRRenderStats after;
+    qr_render_get_stats(&after);
+
+    int64_t skew = screen_system_us() - from_us;
+    swap_stats.swaps++;
+    swap_stats.missed += after.misses != before->misses;
+    swap_stats.last_skew_us = skew;
+    swap_stats.max_skew_us = MAX(swap_stats.max_skew_us, skew);
+    swap_stats.total_skew_us += skew;
+
+    ESP_LOGI(TAG, "qr swapped %lld us after the boundary, avg %lld us, max %lld us, missed %d of %d", skew,
+             swap_stats.total_skew_us / swap_stats.swaps, swap_stats.max_skew_us, swap_stats.missed,
+             swap_stats.swaps);
+}
+
 void screen_task(void *arg)
 {
     int flash_timeout = 0;
-    enum Icon flash_icon_code = 0;
+    // Looked up once per Flash message: an icon that couldn't be expanded stays
+    // NULL for that flash instead of being retried on every wake
+    const void *flash_src = NULL;
 
     struct ScreenConf *conf = arg;
 
     struct meta_frame *held_mf = NULL;
 
-    int qr_timestamp = 0;
-    char qr_data[MAX_QR_SIZE] = {0};
+    // The TOTP code shown, and the next one encoded ahead and swapped in by swap_timer
+    static struct QRSwap qr_swap;
+    qr_swap_init(&qr_swap);
 
     char msg_text[MAX_QR_SIZE] = {0};
 
+    int64_t swap_from_us = 0; // a swap to get onto the panel this tick
+
+    esp_timer_handle_t swap_timer;
+    esp_timer_create_args_t swap_timer_args = {
+        .callback = &screen_swap_timer_cb,
+        .arg = conf,
+        .name = "qr swap",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&swap_timer_args, &swap_timer));
+
     enum StarterState starter_state = NoQRConfig;
 
+    // The widgets, their styles and the QR canvases go to the PSRAM region
+    bsp_display_lock(0);
+    lv_mem_region_t region = lv_mem_set_region(LV_MEM_REGION_LARGE);
+
     static lv_style_t style_bar_bg;
 
     lv_style_init(&style_bar_bg);
@@ -76,6 +285,7 @@ void screen_task(void *arg)
 
     static lv_style_t label_style;
     lv_style_set_text_color(&label_style, lv_color_black());
+    lv_style_set_text_font(&label_style, &screen_font);
 
     lv_obj_t *bg_image = lv_img_create(lv_scr_act());
     lv_obj_align(bg_image, LV_ALIGN_CENTER, 0, 0);
@@ -91,6 +301,10 @@ void screen_task(void *arg)
     lv_obj_t *qr_obj_smaller = lv_qrcode_create(lv_scr_act(), 170, lv_color_black(), lv_color_white());
     lv_obj_center(qr_obj_smaller);
 
+    // The TOTP URL keeps its length, only the code and ids change: keep the layout and
+    // the mask chosen for the first one instead of scoring all eight masks on each
+    lv_qrcode_set_fixed_layout(true, LV_QRCODE_MASK_AUTO);
+
     lv_obj_t *mirror_img = lv_img_create(lv_scr_act());
     int max_side = max(IMG_WIDTH, IMG_HEIGHT);
     float scale = 240.0 / (float)max_side;
@@ -106,14 +320,60 @@ void screen_task(void *arg)
     lv_obj_t *flash_img = lv_img_create(lv_scr_act());
     lv_obj_align(flash_img, LV_ALIGN_CENTER, 0, 0);
 
+    lv_obj_add_flag(bg_image, LV_OBJ_FLAG_HIDDEN);
+
+    lv_mem_set_region(region);
+    bsp_display_unlock();
+
+    struct SceneWidgets widgets = {
+        .flash_img = flash_img,
+        .msg_label = msg_label,
+        .notification = notification_textarea,
+        .qr_full = qr_obj_full_screen,
+        .qr_small = qr_obj_smaller,
+        .mirror_img = mirror_img,
+        .render_qr = qr_render,
+    };
+
+    static struct SceneState applied;
+    static struct Scene scene;
+    scene_state_init(&applied);
+
+    // One descriptor for every frame, LVGL keeps the pointer
+    static lv_img_dsc_t mirror_dsc = {
+        .header.always_zero = 0,
+        .header.cf = LV_IMG_CF_TRUE_COLOR,
+        .header.w = IMG_WIDTH,
+        .header.h = IMG_HEIGHT,
+        .data_size = IMG_WIDTH * IMG_HEIGHT * 2,
+    };
+    uint32_t mirror_seq = 0;
+
+    // Mirror frames skip LVGL, it is stopped while they go to the panel
+    bool blitting = false;
+    uint32_t blitted_seq = 0;
+    // panel_blit_begin said no, the frames go through the lv_img until the mirror
+    // view is left. Frames are always IMG_WIDTH x IMG_HEIGHT, so only a mode change
+    // can change its answer.
+    bool blit_refused = false;
+
+    bsp_display_lock(0);
+    lv_disp_get_default()->driver->monitor_cb = screen_monitor_cb;
+    bsp_display_unlock();
+
     while (1)
     {
-
         struct ScreenMsg *msg;
 
-        if (xQueueReceive(conf->to_screen_queue, &msg, get_rt_task_delay()) == pdPASS)
-        {
+        // Sleeps until a message comes. Mode changes made by other tasks and the flash
+        // and QR timeouts have no message, they are picked up within SCREEN_IDLE_WAIT.
+        bool received = xQueueReceive(conf->to_screen_queue, &msg, SCREEN_IDLE_WAIT) == pdPASS;
+        int64_t woke = esp_timer_get_time();
+        draw_stats.wakeups++;
 
+        // Everything queued is handled before drawing once
+        while (received)
+        {
             switch (msg->command)
             {
             case StarterStateInformToScreen:
@@ -129,202 +389,185 @@ void screen_task(void *arg)
             }
             case DrawQr:
             {
-                memcpy(qr_data, msg->data.text, MAX_QR_SIZE);
-                qr_timestamp = time(0);
+                if (!qr_swap_draw(&qr_swap, msg->data.text, time(0)))
+                {
+                    swap_stats.stale_dropped++;
+                }
+                break;
+            }
+            case PrepareQr:
+            {
+                qr_swap_prepare(&qr_swap, msg->data.prepared.text, msg->data.prepared.from_us);
+
+                bsp_display_lock(0);
+                qr_render_prepare(starter_state != Success ? qr_obj_smaller : qr_obj_full_screen, qr_swap.prepared,
+                                  strlen(qr_swap.prepared));
+                bsp_display_unlock();
+
+                int64_t delay = qr_swap.prepared_from_us - screen_system_us();
+                esp_timer_stop(swap_timer);
+                esp_timer_start_once(swap_timer, MAX(delay, 1));
+                break;
+            }
+            case SwapQr:
+            {
+                int64_t from_us = qr_swap_due(&qr_swap, time(0));
+                if (from_us != 0)
+                {
+                    swap_from_us = from_us;
+                }
                 break;
             }
             case Mirror:
             {
                 if (held_mf != NULL)
                 {
+                    draw_stats.mirror_dropped += blitting && blitted_seq != mirror_seq;
                     meta_frame_free(held_mf);
                 }
                 held_mf = msg->data.mf;
+                mirror_seq++;
                 break;
             }
             case Flash:
             {
-                flash_icon_code = msg->data.icon;
+                flash_src = screen_flash_src(msg->data.icon);
                 flash_timeout = time(0) + FLASH_TIME;
             }
             }
 
             free(msg);
+            received = xQueueReceive(conf->to_screen_queue, &msg, 0) == pdPASS;
         }
-        else
-        {
-            switch (get_mode())
-            {
 
-            case mirror:
-            {
-                break;
-            }
-            default:
-            {
-                vTaskDelay(get_task_delay());
-                break;
-            }
-            }
-        }
-
-        bsp_display_lock(0);
-
-        // ESP_LOGE(TAG, "time: %d, flash_timeout: %d, %d", (int)time(0), flash_timeout, time(0) < flash_timeout);
+        // The scene wanted now
+        scene.notification_shown = starter_state != Success;
+        snprintf(scene.notification, sizeof(scene.notification), "estado: %s",
+                 screen_stater_state_to_string[starter_state]);
 
         if (time(0) < flash_timeout)
         {
-
-            lv_obj_add_flag(qr_obj_full_screen, LV_OBJ_FLAG_HIDDEN);
-            lv_obj_add_flag(qr_obj_smaller, LV_OBJ_FLAG_HIDDEN);
-            lv_obj_add_flag(mirror_img, LV_OBJ_FLAG_HIDDEN);
-            lv_obj_add_flag(bg_image, LV_OBJ_FLAG_HIDDEN);
-            lv_obj_add_flag(msg_label, LV_OBJ_FLAG_HIDDEN);
-
-            lv_obj_clear_flag(flash_img, LV_OBJ_FLAG_HIDDEN);
-
-            switch (flash_icon_code)
-            {
-            case OK_Icon:
-                lv_img_set_src(flash_img, &success);
-                break;
-
-            case NotFound_Icon:
-                lv_img_set_src(flash_img, &failure);
-                break;
-            case NoBackendAuthIcon:
-            case NoBackendIcon:
-                lv_img_set_src(flash_img, &noBackend);
-                break;
-
-            case NoTBAuthIcon:
-            case NoTBIcon:
-                lv_img_set_src(flash_img, &noTB);
-                break;
-            case NoWifiIcon:
-                lv_img_set_src(flash_img, &noWifi);
-                break;
-
-            case NoQRConfigIcon:
-                lv_img_set_src(flash_img, &noQr);
-                break;
-            case OtherClass_Icon:
-                lv_img_set_src(flash_img, &warning);
-                break;
-            }
+            scene.view = SceneFlash;
+            scene.flash_src = flash_src;
         }
         else
         {
-            lv_obj_add_flag(flash_img, LV_OBJ_FLAG_HIDDEN);
-
-            if (starter_state != Success)
-            {
-                lv_obj_clear_flag(notification_textarea, LV_OBJ_FLAG_HIDDEN);
-
-                char notification[100];
-
-                snprintf(notification, sizeof(notification), "estado: %s", screen_stater_state_to_string[starter_state]);
-
-                lv_label_set_text(notification_textarea, notification);
-            }
-            else
-            {
-                lv_obj_add_flag(notification_textarea, LV_OBJ_FLAG_HIDDEN);
-            }
-
             switch (get_mode())
             {
-
             case msg_display:
             {
-
-                // ESP_LOGE(TAG, "msg_display %s", msg_text);
-
-                lv_obj_add_flag(qr_obj_full_screen, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(qr_obj_smaller, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(mirror_img, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(bg_image, LV_OBJ_FLAG_HIDDEN);
-
-                lv_obj_clear_flag(msg_label, LV_OBJ_FLAG_HIDDEN);
-
-                lv_label_set_text(msg_label, msg_text);
-
+                scene.view = SceneMessage;
+                strncpy(scene.message, msg_text, sizeof(scene.message));
                 break;
             }
             case qr_display:
             {
+                scene.view = SceneQr;
+                scene.qr_small = starter_state != Success;
 
-                // ESP_LOGE(TAG, "qr_display %s", qr_data);
-
-                lv_obj_add_flag(bg_image, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(msg_label, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(mirror_img, LV_OBJ_FLAG_HIDDEN);
-
-                lv_obj_t *used_qr = qr_obj_full_screen;
-                lv_obj_t *unused_qr = qr_obj_smaller;
-
-                if (starter_state != Success)
+                const char *shown_qr = qr_swap_shown(&qr_swap, time(0));
+                if (shown_qr != NULL)
                 {
-                    unused_qr = qr_obj_full_screen;
-                    used_qr = qr_obj_smaller;
-                }
-
-                lv_obj_add_flag(unused_qr, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_clear_flag(used_qr, LV_OBJ_FLAG_HIDDEN);
-
-                if (ALLOWED_AGE_FOR_QR > time(0) - qr_timestamp)
-
-                {
-                    lv_qrcode_update(used_qr, qr_data, strlen(qr_data));
+                    strncpy(scene.qr_text, shown_qr, sizeof(scene.qr_text));
                 }
                 else
                 {
-                    char err[] = "no tenemos el totp todavía";
-                    lv_qrcode_update(used_qr, err, sizeof(err));
+                    strncpy(scene.qr_text, "no tenemos el totp todavía", sizeof(scene.qr_text));
                 }
-
                 break;
             }
             case mirror:
             {
-                // ESP_LOGE(TAG, "mirror tick %p", held_mf);
-
-                lv_obj_add_flag(bg_image, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(msg_label, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(qr_obj_full_screen, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(qr_obj_smaller, LV_OBJ_FLAG_HIDDEN);
-
-                lv_obj_clear_flag(mirror_img, LV_OBJ_FLAG_HIDDEN);
-
-                lv_img_dsc_t img = {
-                    .header.always_zero = 0,
-                    .header.cf = LV_IMG_CF_TRUE_COLOR,
-                    .header.w = IMG_WIDTH,
-                    .header.h = IMG_HEIGHT,
-                    .data_size = sizeof(held_mf->buf),
-                    .data = held_mf->buf,
-                };
-
-                lv_img_set_src(mirror_img, &img);
-
+                scene.view = SceneMirror;
+                scene.mirror_src = NULL;
+                if (held_mf != NULL && !blitting)
+                {
+                    mirror_dsc.data = held_mf->buf;
+                    scene.mirror_src = &mirror_dsc;
+                    scene.mirror_seq = mirror_seq;
+                }
                 break;
             }
             case button_test:
             {
+                scene.view = SceneMessage;
+                strncpy(scene.message, "pulse los 4 botones para continuar", sizeof(scene.message));
+                break;
+            }
+            }
+        }
+
+        if (scene.view != SceneMirror)
+        {
+            blit_refused = false;
+        }
+        bool direct = scene.view == SceneMirror && held_mf != NULL && !blit_refused;
+        if (blitting && !direct)
+        {
+            bsp_display_lock(0);
+            panel_blit_end();
+            bsp_display_unlock();
+            blitting = false;
+        }
 
-                lv_obj_add_flag(qr_obj_full_screen, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(qr_obj_smaller, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(mirror_img, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(bg_image, LV_OBJ_FLAG_HIDDEN);
+        // The display lock and LVGL only when something differs from what is shown
+        if (scene_changes(&applied, &scene) > 0 || swap_from_us != 0)
+        {
+            bsp_display_lock(0);
 
-                lv_obj_clear_flag(msg_label, LV_OBJ_FLAG_HIDDEN);
-                lv_label_set_text_fmt(msg_label, "pulse los 4 botones para continuar");
+            struct QRRenderStats before;
+            qr_render_get_stats(&before);
 
-                break;
-            }
+            draw_stats.lvgl_calls += scene_apply(&widgets, &applied, &scene);
+            draw_stats.applies++;
+
+            if (swap_from_us != 0 && scene.view == SceneQr)
+            {
+                // Straight to the panel rather than at the next LVGL refresh
+                lv_refr_now(NULL);
+                screen_record_swap(swap_from_us, &before);
             }
+
+            bsp_display_unlock();
+        }
+        swap_from_us = 0;
+
+        if (direct && !blitting)
+        {
+            bsp_display_lock(0);
+            blitting = panel_blit_begin(IMG_WIDTH, IMG_HEIGHT);
+            bsp_display_unlock();
+            blit_refused = !blitting;
+            blitted_seq = mirror_seq - 1;
         }
-        bsp_display_unlock();
+        if (blitting && blitted_seq != mirror_seq)
+        {
+            int64_t start = esp_timer_get_time();
+            panel_blit_frame(held_mf->buf);
+            draw_stats.mirror_us += esp_timer_get_time() - start;
+            draw_stats.mirror_frames++;
+            blitted_seq = mirror_seq;
+        }
+
+        draw_stats.busy_us += esp_timer_get_time() - woke;
+        screen_log_draw_stats();
+        screen_telemetry_report(conf);
+    }
+}
+
+// LVGL's builtin pool stays in internal RAM for the render scratch, the rest can go here
+static void screen_add_lvgl_region(void)
+{
+    void *mem = heap_caps_malloc(SCREEN_LVGL_PSRAM_SIZE, MALLOC_CAP_SPIRAM);
+
+    bsp_display_lock(0);
+    bool added = mem != NULL && lv_mem_add_region(LV_MEM_REGION_LARGE, mem, SCREEN_LVGL_PSRAM_SIZE);
+    bsp_display_unlock();
+
+    if (!added)
+    {
+        ESP_LOGE(TAG, "no PSRAM region for LVGL, everything goes to its internal pool");
+        heap_caps_free(mem);
     }
 }
 
@@ -332,6 +575,7 @@ void screen_start(struct ScreenConf *conf)
 {
 
     bsp_display_backlight_on();
+    screen_add_lvgl_region();
 
     TaskHandle_t handle = jTaskCreate(&screen_task, "Screen task", 50000, conf, 1, MALLOC_CAP_SPIRAM);
     if (handle == NULL)
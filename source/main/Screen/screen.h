@@ -16,6 +16,8 @@ enum ScreenCommand
     StarterStateInformToScreen,
     Mirror,
     ShowMsg,
+    PrepareQr, // shown from data.prepared.from_us on
+    SwapQr,    // sent by the swap timer, the prepared code is due
 };
 
 enum Icon{
@@ -30,6 +32,12 @@ enum Icon{
     NoQRConfigIcon,
 };
 
+struct ScreenPreparedQr
+{
+    char text[MAX_QR_SIZE];
+    int64_t from_us; // system time
+};
+
 struct ScreenMsg
 {
     enum ScreenCommand command;
@@ -37,6 +45,7 @@ struct ScreenMsg
     {
         enum StarterState starter_state;
         char text[MAX_QR_SIZE];
+        struct ScreenPreparedQr prepared;
         struct meta_frame *mf;
         enum Icon icon;
     } data;
@@ -45,6 +54,34 @@ struct ScreenMsg
 struct ScreenConf
 {
     QueueHandle_t to_screen_queue;
+    QueueHandle_t to_mqtt_queue; // LVGL heap and drawing telemetry
+};
+
+// How late the prepared TOTP code reached the panel after its window began
+struct ScreenSwapStats
+{
+    int swaps;
+    int missed;      // the code wasn't prepared in time and was encoded at the swap
+    int stale_dropped; // DrawQr with the previous window's code, queued before the swap
+    int64_t last_skew_us;
+    int64_t max_skew_us;
+    int64_t total_skew_us;
+};
+
+// What drawing the screen costs, cumulative. screen_task logs the rates every 10 s
+// and sends the totals as telemetry with the LVGL heap.
+struct ScreenDrawStats
+{
+    int wakeups;    // screen_task iterations
+    int applies;    // iterations that found the scene changed and took the display lock
+    int lvgl_calls; // made by scene_apply
+    int frames;     // LVGL refreshes that redrew something
+    int64_t px;     // pixels redrawn
+    int64_t render_ms; // spent by LVGL in those refreshes
+    int64_t busy_us;   // screen_task awake
+    int mirror_frames;  // camera frames sent straight to the panel
+    int mirror_dropped; // camera frames replaced before they were sent
+    int64_t mirror_us;  // spent sending them
 };
 
 void screen_start(struct ScreenConf *conf);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sha/sha.h>
+
+#if defined(ESP_PLATFORM) || defined(HMAC_SHA1_WITH_MBEDTLS)
+#include "mbedtls/sha1.h"
+#define HMAC_SHA1_HAS_MBEDTLS 1
+#endif
+
+// HMAC-SHA1 behind a backend, so TOTP can use the SHA accelerator on the device
+// and be checked against OpenSSL on a host:
+//
+//   hmac_sha1_portable  the vendored software SHA-1 (lib/sha), available everywhere
+//   hmac_sha1_mbedtls   mbedTLS, which on the ESP32-S3 runs on the SHA peripheral
+//   hmac_sha1_openssl   OpenSSL's HMAC(), host builds with HMAC_SHA1_WITH_OPENSSL
+//
+// Keys are set once and a backend precomputes what it can from them, TOTP signs
+// one 8 byte counter per window with the same key.
+
+#define HMAC_SHA1_SIZE 20
+#define HMAC_SHA1_BLOCK_SIZE 64
+
+struct HmacSha1Backend;
+
+struct HmacSha1
+{
+    const struct HmacSha1Backend *backend;
+    union
+    {
+        struct
+        {
+            SHA1_CTX inner; // after the key ^ ipad block
+            SHA1_CTX outer; // after the key ^ opad block
+        } portable;
+#ifdef HMAC_SHA1_HAS_MBEDTLS
+        struct
+        {
+            mbedtls_sha1_context inner;
+            mbedtls_sha1_context outer;
+        } mbedtls;
+#endif
+        struct
+        {
+            uint8_t key[HMAC_SHA1_BLOCK_SIZE];
+            size_t len;
+        } raw;
+    };
+};
+
+struct HmacSha1Backend
+{
+    const char *name;
+    int (*init)(struct HmacSha1 *hmac, const uint8_t *key, size_t len);
+    int (*sign)(struct HmacSha1 *hmac, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE]);
+    void (*free)(struct HmacSha1 *hmac);
+};
+
+extern const struct HmacSha1Backend hmac_sha1_portable;
+#ifdef HMAC_SHA1_HAS_MBEDTLS
+extern const struct HmacSha1Backend hmac_sha1_mbedtls;
+#endif
+#ifdef HMAC_SHA1_WITH_OPENSSL
+extern const struct HmacSha1Backend hmac_sha1_openssl;
+#endif
+
+// All return 0 or -1 on a backend error
+int hmac_sha1_init(struct HmacSha1 *hmac, const struct HmacSha1Backend *backend, const uint8_t *key, size_t len);
+int hmac_sha1_sign(struct HmacSha1 *hmac, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE]);
+void hmac_sha1_free(struct HmacSha1 *hmac);
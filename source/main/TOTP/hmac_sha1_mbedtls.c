@@ -0,0 +1,72 @@
+#include "hmac_sha1.h"
+
+#include <string.h>
+
+// mbedtls_sha1_clone() resumes from the padded key states, so a signature costs
+// the final blocks only. With CONFIG_MBEDTLS_HARDWARE_SHA they run on the SHA
+// peripheral.
+
+static int pad_block(mbedtls_sha1_context *ctx, const uint8_t *key, size_t len, uint8_t pad)
+{
+    uint8_t block[HMAC_SHA1_BLOCK_SIZE];
+
+    for (int i = 0; i < HMAC_SHA1_BLOCK_SIZE; i++)
+    {
+        block[i] = (i < len ? key[i] : 0) ^ pad;
+    }
+
+    mbedtls_sha1_init(ctx);
+    int err = mbedtls_sha1_starts(ctx) || mbedtls_sha1_update(ctx, block, HMAC_SHA1_BLOCK_SIZE);
+    memset(block, 0, sizeof(block));
+    return err ? -1 : 0;
+}
+
+static int mbedtls_backend_init(struct HmacSha1 *hmac, const uint8_t *key, size_t len)
+{
+    uint8_t hashed[HMAC_SHA1_SIZE];
+
+    if (len > HMAC_SHA1_BLOCK_SIZE)
+    {
+        if (mbedtls_sha1(key, len, hashed) != 0)
+        {
+            return -1;
+        }
+        key = hashed;
+        len = HMAC_SHA1_SIZE;
+    }
+
+    if (pad_block(&hmac->mbedtls.inner, key, len, 0x36) < 0 || pad_block(&hmac->mbedtls.outer, key, len, 0x5c) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int mbedtls_backend_sign(struct HmacSha1 *hmac, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE])
+{
+    mbedtls_sha1_context ctx;
+    int err;
+
+    mbedtls_sha1_init(&ctx);
+    mbedtls_sha1_clone(&ctx, &hmac->mbedtls.inner);
+    err = mbedtls_sha1_update(&ctx, msg, len) || mbedtls_sha1_finish(&ctx, digest);
+
+    mbedtls_sha1_clone(&ctx, &hmac->mbedtls.outer);
+    err = err || mbedtls_sha1_update(&ctx, digest, HMAC_SHA1_SIZE) || mbedtls_sha1_finish(&ctx, digest);
+
+    mbedtls_sha1_free(&ctx);
+    return err ? -1 : 0;
+}
+
+static void mbedtls_backend_free(struct HmacSha1 *hmac)
+{
+    mbedtls_sha1_free(&hmac->mbedtls.inner);
+    mbedtls_sha1_free(&hmac->mbedtls.outer);
+}
+
+const struct HmacSha1Backend hmac_sha1_mbedtls = {
+    .name = "mbedtls",
+    .init = mbedtls_backend_init,
+    .sign = mbedtls_backend_sign,
+    .free = mbedtls_backend_free,
+};
@@ -0,0 +1,44 @@
+#include "hmac_sha1.h"
+
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+// Reference for host builds: the one-shot HMAC() with the raw key, nothing
+// precomputed, so it shares no code with the other backends
+
+static int openssl_init(struct HmacSha1 *hmac, const uint8_t *key, size_t len)
+{
+    if (len > HMAC_SHA1_BLOCK_SIZE)
+    {
+        unsigned int hashed_len = HMAC_SHA1_SIZE;
+        if (!EVP_Digest(key, len, hmac->raw.key, &hashed_len, EVP_sha1(), NULL))
+        {
+            return -1;
+        }
+        hmac->raw.len = hashed_len;
+        return 0;
+    }
+
+    memcpy(hmac->raw.key, key, len);
+    hmac->raw.len = len;
+    return 0;
+}
+
+static int openssl_sign(struct HmacSha1 *hmac, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE])
+{
+    unsigned int digest_len = HMAC_SHA1_SIZE;
+    return HMAC(EVP_sha1(), hmac->raw.key, hmac->raw.len, msg, len, digest, &digest_len) ? 0 : -1;
+}
+
+static void openssl_free(struct HmacSha1 *hmac)
+{
+    memset(&hmac->raw, 0, sizeof(hmac->raw));
+}
+
+const struct HmacSha1Backend hmac_sha1_openssl = {
+    .name = "openssl",
+    .init = openssl_init,
+    .sign = openssl_sign,
+    .free = openssl_free,
+};
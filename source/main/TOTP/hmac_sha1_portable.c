@@ -0,0 +1,110 @@
+#include "hmac_sha1.h"
+
+#include <string.h>
+
+void SHA1_Transform(uint32_t state[5], const uint8_t buffer[64]);
+
+int hmac_sha1_init(struct HmacSha1 *hmac, const struct HmacSha1Backend *backend, const uint8_t *key, size_t len)
+{
+    hmac->backend = backend;
+    return backend->init(hmac, key, len);
+}
+
+int hmac_sha1_sign(struct HmacSha1 *hmac, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE])
+{
+    return hmac->backend->sign(hmac, msg, len, digest);
+}
+
+void hmac_sha1_free(struct HmacSha1 *hmac)
+{
+    if (hmac->backend && hmac->backend->free)
+    {
+        hmac->backend->free(hmac);
+    }
+    hmac->backend = NULL;
+}
+
+static void pad_block(SHA1_CTX *ctx, const uint8_t *key, size_t len, uint8_t pad)
+{
+    uint8_t block[HMAC_SHA1_BLOCK_SIZE];
+
+    for (int i = 0; i < HMAC_SHA1_BLOCK_SIZE; i++)
+    {
+        block[i] = (i < len ? key[i] : 0) ^ pad;
+    }
+
+    SHA1_Init(ctx);
+    SHA1_Update(ctx, block, HMAC_SHA1_BLOCK_SIZE);
+    memset(block, 0, sizeof(block));
+}
+
+static int portable_init(struct HmacSha1 *hmac, const uint8_t *key, size_t len)
+{
+    uint8_t hashed[HMAC_SHA1_SIZE];
+
+    if (len > HMAC_SHA1_BLOCK_SIZE)
+    {
+        SHA1_CTX ctx;
+        SHA1_Init(&ctx);
+        SHA1_Update(&ctx, key, len);
+        SHA1_Final(hashed, &ctx);
+        key = hashed;
+        len = HMAC_SHA1_SIZE;
+    }
+
+    pad_block(&hmac->portable.inner, key, len, 0x36);
+    pad_block(&hmac->portable.outer, key, len, 0x5c);
+    return 0;
+}
+
+// Finishes a hash that compressed exactly one block so far, for a message short
+// enough to share the final block with the padding: one compression
+static void final_block(const SHA1_CTX *ctx, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE])
+{
+    uint32_t state[5];
+    uint8_t block[HMAC_SHA1_BLOCK_SIZE] = {0};
+    uint32_t bits = (HMAC_SHA1_BLOCK_SIZE + len) * 8;
+
+    memcpy(block, msg, len);
+    block[len] = 0x80;
+    block[HMAC_SHA1_BLOCK_SIZE - 2] = bits >> 8;
+    block[HMAC_SHA1_BLOCK_SIZE - 1] = bits & 0xff;
+
+    memcpy(state, ctx->state, sizeof(state));
+    SHA1_Transform(state, block);
+
+    for (int i = 0; i < HMAC_SHA1_SIZE; i++)
+    {
+        digest[i] = state[i / 4] >> (24 - 8 * (i % 4));
+    }
+}
+
+static int portable_sign(struct HmacSha1 *hmac, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE])
+{
+    if (len < HMAC_SHA1_BLOCK_SIZE - 8)
+    {
+        final_block(&hmac->portable.inner, msg, len, digest);
+    }
+    else
+    {
+        SHA1_CTX ctx;
+        memcpy(&ctx, &hmac->portable.inner, sizeof(SHA1_CTX));
+        SHA1_Update(&ctx, msg, len);
+        SHA1_Final(digest, &ctx);
+    }
+
+    final_block(&hmac->portable.outer, digest, HMAC_SHA1_SIZE, digest);
+    return 0;
+}
+
+static void portable_free(struct HmacSha1 *hmac)
+{
+    memset(&hmac->portable, 0, sizeof(hmac->portable));
+}
+
+const struct HmacSha1Backend hmac_sha1_portable = {
+    .name = "portable",
+    .init = portable_init,
+    .sign = portable_sign,
+    .free = portable_free,
+};
@@ -0,0 +1,340 @@
+/*
+ * Checks every HMAC-SHA1 backend against RFC 2202 and the TOTP engine on top
+ * of it against RFC 6238, then the backends against each other on messages of
+ * every length around the block boundaries. Also checks that the engine signs
+ * once per window and turns bad secrets down without retrying them. With -b it
+ * prints what one code costs with each backend, the measurement totp.c logs on
+ * the device when built with CONFIG_TOTP_BACKEND_BENCHMARK.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hmac_sha1.h"
+#include "totp_engine.h"
+
+#define BENCH_RUNS 1000000
+
+static const struct HmacSha1Backend *backends[] = {
+    &hmac_sha1_portable,
+#ifdef HMAC_SHA1_HAS_MBEDTLS
+    &hmac_sha1_mbedtls,
+#endif
+    &hmac_sha1_openssl,
+};
+
+#define BACKEND_COUNT (sizeof(backends) / sizeof(backends[0]))
+
+struct HmacVector
+{
+    int key_byte; // key is key_len copies of it, -1 for key_text
+    int key_len;
+    const char *key_text;
+    int data_byte; // data is data_len copies of it, -1 for data_text
+    int data_len;
+    const char *data_text;
+    const char *digest;
+};
+
+// RFC 2202 section 3, test case 4 has the key 0x01..0x19 and is built below
+static const struct HmacVector hmac_vectors[] = {
+    {0x0b, 20, NULL, -1, 0, "Hi There", "b617318655057264e28bc0b6fb378c8ef146be00"},
+    {-1, 0, "Jefe", -1, 0, "what do ya want for nothing?", "effcdf6ae5eb2fa2d27416d5f184df9c259a7c79"},
+    {0xaa, 20, NULL, 0xdd, 50, NULL, "125d7342b9ac11cd91a39af48aa17b4f63f175d3"},
+    {0, 25, NULL, 0xcd, 50, NULL, "4c9007f4026250c6bc8414f9bf50c86c2d7235da"},
+    {0x0c, 20, NULL, -1, 0, "Test With Truncation", "4c1a03424b55e07fe7f27be1d58bb9324a9a5a04"},
+    {0xaa, 80, NULL, -1, 0, "Test Using Larger Than Block-Size Key - Hash Key First",
+     "aa4ae5e15272d00e95705637ce8a3b55ed402112"},
+    {0xaa, 80, NULL, -1, 0, "Test Using Larger Than Block-Size Key and Larger Than One Block-Size Data",
+     "e8e99d0f45237d786d6bbaa7965c7808bbff1a91"},
+};
+
+// RFC 6238 appendix B, SHA-1 rows, 8 digits, 30 second steps. The secret is
+// "12345678901234567890" in base32.
+#define RFC6238_SEED "GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ"
+
+static const struct
+{
+    int64_t time;
+    int code;
+} totp_vectors[] = {
+    {59, 94287082},         {1111111109, 7081804},  {1111111111, 14050471},
+    {1234567890, 89005924}, {2000000000, 69279037}, {20000000000, 65353130},
+};
+
+static void hex(const uint8_t *bytes, int len, char *out)
+{
+    for (int i = 0; i < len; i++)
+    {
+        sprintf(&out[i * 2], "%02x", bytes[i]);
+    }
+}
+
+static void fill(uint8_t *buf, int byte, int len, const char *text, int *out_len)
+{
+    if (byte < 0)
+    {
+        *out_len = strlen(text);
+        memcpy(buf, text, *out_len);
+        return;
+    }
+
+    memset(buf, byte, len);
+    *out_len = len;
+}
+
+static int check_rfc2202(const struct HmacSha1Backend *backend)
+{
+    int failures = 0;
+
+    for (size_t v = 0; v < sizeof(hmac_vectors) / sizeof(hmac_vectors[0]); v++)
+    {
+        const struct HmacVector *vector = &hmac_vectors[v];
+        uint8_t key[128], data[128], digest[HMAC_SHA1_SIZE];
+        char digest_hex[HMAC_SHA1_SIZE * 2 + 1];
+        int key_len, data_len;
+        struct HmacSha1 hmac;
+
+        fill(key, vector->key_byte, vector->key_len, vector->key_text, &key_len);
+        fill(data, vector->data_byte, vector->data_len, vector->data_text, &data_len);
+        if (v == 3)
+        {
+            for (int i = 0; i < key_len; i++)
+            {
+                key[i] = i + 1;
+            }
+        }
+
+        if (hmac_sha1_init(&hmac, backend, key, key_len) < 0 || hmac_sha1_sign(&hmac, data, data_len, digest) < 0)
+        {
+            printf("%s: RFC 2202 case %zu: backend error\n", backend->name, v + 1);
+            failures++;
+            continue;
+        }
+        hmac_sha1_free(&hmac);
+
+        hex(digest, HMAC_SHA1_SIZE, digest_hex);
+        if (strcmp(digest_hex, vector->digest) != 0)
+        {
+            printf("%s: RFC 2202 case %zu: %s, expected %s\n", backend->name, v + 1, digest_hex, vector->digest);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+static int check_rfc6238(const struct HmacSha1Backend *backend)
+{
+    struct TOTPEngine engine = {0};
+    int failures = 0;
+
+    if (totp_engine_init(&engine, backend, RFC6238_SEED, 0, 30, 8) < 0)
+    {
+        printf("%s: RFC 6238: init failed\n", backend->name);
+        return 1;
+    }
+
+    for (size_t v = 0; v < sizeof(totp_vectors) / sizeof(totp_vectors[0]); v++)
+    {
+        int code = totp_engine_code(&engine, totp_vectors[v].time);
+        if (code != totp_vectors[v].code)
+        {
+            printf("%s: RFC 6238 at %lld: %08d, expected %08d\n", backend->name, (long long)totp_vectors[v].time,
+                   code, totp_vectors[v].code);
+            failures++;
+        }
+    }
+
+    totp_engine_free(&engine);
+    return failures;
+}
+
+// The boundaries totp.c prepares the next code for, with a t0 not on a window
+static int check_window_end(void)
+{
+    static const int64_t cases[][2] = {{15, 45}, {44, 45}, {45, 75}, {1000, 1005}, {1005, 1035}};
+    struct TOTPEngine engine = {0};
+    int failures = 0;
+
+    if (totp_engine_init(&engine, backends[0], RFC6238_SEED, 15, 30, 6) < 0)
+    {
+        printf("window end: init failed\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        int64_t end = totp_engine_window_end(&engine, cases[i][0]);
+        if (end != cases[i][1])
+        {
+            printf("window end at %lld: %lld, expected %lld\n", (long long)cases[i][0], (long long)end,
+                   (long long)cases[i][1]);
+            failures++;
+        }
+    }
+
+    totp_engine_free(&engine);
+    return failures;
+}
+
+static int counted_signs;
+
+static int counted_sign(struct HmacSha1 *hmac, const uint8_t *msg, size_t len, uint8_t digest[HMAC_SHA1_SIZE])
+{
+    counted_signs++;
+    return hmac_sha1_portable.sign(hmac, msg, len, digest);
+}
+
+// What totp_task relies on: one HMAC per window, the cached code in between, and
+// a bad secret remembered so it is only set up again once it changes
+static int check_engine(void)
+{
+    static const struct
+    {
+        int64_t now;
+        int signs; // total after the code at now
+    } steps[] = {{0, 1}, {1, 1}, {29, 1}, {30, 2}, {59, 2}, {31, 2}, {0, 3}, {1111111109, 4}};
+    struct HmacSha1Backend counting = hmac_sha1_portable;
+    struct TOTPEngine engine = {0};
+    int failures = 0;
+
+    counting.name = "counting";
+    counting.sign = counted_sign;
+    if (totp_engine_init(&engine, &counting, RFC6238_SEED, 0, 30, 8) < 0)
+    {
+        printf("engine: init failed\n");
+        return 1;
+    }
+
+    counted_signs = 0;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        int code = totp_engine_code(&engine, steps[i].now);
+        if (counted_signs != steps[i].signs)
+        {
+            printf("engine at %lld: %d signs, expected %d\n", (long long)steps[i].now, counted_signs, steps[i].signs);
+            failures++;
+        }
+        if (steps[i].now == 1111111109 && code != 7081804)
+        {
+            printf("engine at 1111111109: %08d from the cache path, expected 07081804\n", code);
+            failures++;
+        }
+    }
+
+    if (!totp_engine_matches(&engine, RFC6238_SEED, 0) || totp_engine_matches(&engine, RFC6238_SEED, 1))
+    {
+        printf("engine: matches() doesn't follow the secret and t0\n");
+        failures++;
+    }
+
+    static const char *bad[] = {"", "GEZDGNBV!Y3TQOJQ", "GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQGEZ"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        if (totp_engine_init(&engine, &counting, bad[i], 0, 30, 8) == 0 || totp_engine_code(&engine, 0) != -1)
+        {
+            printf("engine: secret \"%s\" accepted\n", bad[i]);
+            failures++;
+        }
+        // Too long to store is the one not remembered, there is no room for it
+        if (strlen(bad[i]) < TOTP_SEED_SIZE && !totp_engine_matches(&engine, bad[i], 0))
+        {
+            printf("engine: secret \"%s\" forgotten, it would be retried every tick\n", bad[i]);
+            failures++;
+        }
+    }
+
+    totp_engine_free(&engine);
+    return failures;
+}
+
+// Every key and message length from 0 to past two blocks, against the first
+// backend, which catches padding mistakes at the 55/56 and 64 byte boundaries
+static int check_lengths(void)
+{
+    uint8_t buf[160], expected[HMAC_SHA1_SIZE], digest[HMAC_SHA1_SIZE];
+    int failures = 0;
+
+    for (int i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = i * 31 + 7;
+    }
+
+    for (int key_len = 0; key_len <= 140; key_len += 5)
+    {
+        for (int len = 0; len <= 140; len++)
+        {
+            for (size_t b = 0; b < BACKEND_COUNT; b++)
+            {
+                struct HmacSha1 hmac;
+                hmac_sha1_init(&hmac, backends[b], &buf[10], key_len);
+                hmac_sha1_sign(&hmac, buf, len, b == 0 ? expected : digest);
+                hmac_sha1_free(&hmac);
+
+                if (b > 0 && memcmp(digest, expected, HMAC_SHA1_SIZE) != 0)
+                {
+                    printf("%s: key %d, message %d bytes: differs from %s\n", backends[b]->name, key_len, len,
+                           backends[0]->name);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    return failures;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void benchmark(void)
+{
+    for (size_t b = 0; b < BACKEND_COUNT; b++)
+    {
+        struct TOTPEngine engine = {0};
+        int sum = 0;
+
+        totp_engine_init(&engine, backends[b], RFC6238_SEED, 0, 30, 6);
+
+        // A new window every run, so no code comes from the cache
+        double start = now_us();
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            sum += totp_engine_code(&engine, (int64_t)run * 30);
+        }
+        double elapsed = now_us() - start;
+
+        printf("%-10s %8.3f us/code (checksum %d)\n", backends[b]->name, elapsed / BENCH_RUNS, sum);
+        totp_engine_free(&engine);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int failures = 0;
+
+    for (size_t b = 0; b < BACKEND_COUNT; b++)
+    {
+        failures += check_rfc2202(backends[b]);
+        failures += check_rfc6238(backends[b]);
+    }
+    failures += check_lengths();
+    failures += check_window_end();
+    failures += check_engine();
+
+    printf("%zu backends, %d failures\n", BACKEND_COUNT, failures);
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0)
+    {
+        benchmark();
+    }
+
+    return failures ? 1 : 0;
+}
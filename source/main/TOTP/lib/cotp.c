@@ -47,9 +47,7 @@
 #include <time.h>
 #include <unistd.h>
 
-#include "esp_log.h"
-
-#include "./hmac/hmac.h"
+#define COTP_MAX_BASE32 64
 
 static const int8_t base32_vals[256] = {
     /*
@@ -80,24 +78,22 @@ static const int8_t base32_vals[256] = {
 };
 /* static const char * base32_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567="; */
 
-int do_the_totp_thing(time_t now, const char *key, int window, int result_size)
+/* Validates and decodes a base32 secret into out, returns its length or -1 */
+int cotp_base32_decode(const char *key, uint8_t *out, size_t out_size)
 {
 
-  uint8_t *secret_key = alloca(30);
-  strcpy((char *)secret_key, key);
+  uint8_t secret_key[COTP_MAX_BASE32 + 1];
 
   size_t pos;
   size_t len;
   size_t keylen;
-  uint32_t endianness;
-  uint64_t t; /* number of steps */
-  uint64_t offset;
-  uint8_t hmac_result[20] = {0};
-  size_t hmac_result_len;
-  uint32_t bin_code;
-  uint32_t totp = -1;
 
-  len = strlen((char *)secret_key);
+  len = strlen(key);
+  if (len == 0 || len > COTP_MAX_BASE32 || len / 8 * 5 > out_size)
+  {
+    return -1;
+  }
+  strcpy((char *)secret_key, key);
 
   /* validates base32 key */
   if (((len & 0xF) != 0) && ((len & 0xF) != 8))
@@ -201,33 +197,23 @@ int do_the_totp_thing(time_t now, const char *key, int window, int result_size)
     secret_key[keylen + 4] |= (base32_vals[secret_key[pos + 7]] >> 0) & 0x1F; /* 5 LSB */
     keylen += 5;
   };
-  secret_key[keylen] = 0;
-
-  t = now / window;
+  memcpy(out, secret_key, keylen);
+  return keylen;
+}
 
-  /* converts T to big endian if system is little endian */
-  endianness = 0xdeadbeef;
-  if ((*(const uint8_t *)&endianness) == 0xef)
-  {
-    t = ((t & 0x00000000ffffffff) << 32) | ((t & 0xffffffff00000000) >> 32);
-    t = ((t & 0x0000ffff0000ffff) << 16) | ((t & 0xffff0000ffff0000) >> 16);
-    t = ((t & 0x00ff00ff00ff00ff) << 8) | ((t & 0xff00ff00ff00ff00) >> 8);
-  };
 
-  /* determines hash */
-  hmac_result_len = sizeof(hmac_result);
-  hmac_sha1(secret_key, keylen, (const unsigned char *)&t, sizeof(t), hmac_result,
-            &hmac_result_len);
+/* Dynamic truncation of an HMAC-SHA1 result to a code of digits digits */
+int cotp_truncate(const uint8_t hmac_result[20], int digits)
+{
+  uint64_t offset;
+  uint32_t bin_code;
 
-  /* dynamically truncates hash */
   offset = hmac_result[19] & 0x0f;
   bin_code = (hmac_result[offset] & 0x7f) << 24 |
              (hmac_result[offset + 1] & 0xff) << 16 |
              (hmac_result[offset + 2] & 0xff) << 8 |
              (hmac_result[offset + 3] & 0xff);
 
-  /* truncates code to result_size digits */
-  totp = bin_code % ((int)pow(10, result_size));
-
-  return totp;
+  /* truncates code to digits digits */
+  return bin_code % ((int)pow(10, digits));
 }
@@ -6,9 +6,10 @@
 #include "../Starter/starter.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <string.h>
 
-#include "lib/cotp.c"
+#include "totp_engine.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -16,9 +17,59 @@
 
 #define TAG "totp"
 
+#define TOTP_WINDOW 60 // seconds
+#define TOTP_DIGITS 6
+#define TOTP_BENCH_RUNS 1000
+#define TOTP_PREPARE_AHEAD 5 // seconds before the boundary the next code goes to the screen
+
+// mbedTLS runs SHA-1 on the accelerator with CONFIG_MBEDTLS_HARDWARE_SHA
+#define TOTP_HMAC_BACKEND hmac_sha1_mbedtls
+
+#ifdef CONFIG_TOTP_BACKEND_BENCHMARK
+static const struct HmacSha1Backend *totp_backends[] = {&hmac_sha1_portable, &hmac_sha1_mbedtls};
+
+// Logs what one code costs with each backend, measured on the real hardware.
+// Cache misses are forced by moving the clock one window per run.
+static void totp_backend_benchmark(void)
+{
+    struct TOTPEngine engine = {0};
+
+    for (size_t b = 0; b < sizeof(totp_backends) / sizeof(totp_backends[0]); b++)
+    {
+        if (totp_engine_init(&engine, totp_backends[b], "JBSWY3DPEHPK3PXP", 0, TOTP_WINDOW, TOTP_DIGITS) < 0)
+        {
+            ESP_LOGE(TAG, "backend %s: init failed", totp_backends[b]->name);
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+        for (int run = 0; run < TOTP_BENCH_RUNS; run++)
+        {
+            totp_engine_code(&engine, (int64_t)run * TOTP_WINDOW);
+        }
+        int64_t elapsed = esp_timer_get_time() - start;
+
+        ESP_LOGI(TAG, "backend %s: %.2f us/code", totp_backends[b]->name, (double)elapsed / TOTP_BENCH_RUNS);
+        totp_engine_free(&engine);
+    }
+}
+#endif
+
+static void totp_format_url(char *buf, size_t size, const struct ConnectionParameters *parameters, int totp)
+{
+    snprintf(buf, size, "%s?totp=%06d&espacioId=%d&dispositivoId=%d", parameters->qr_info.totp_form_base_url, totp,
+             parameters->qr_info.space_id, parameters->backend_info.device_id);
+}
+
 static void totp_task(void *arg)
 {
     struct TOTPConf *conf = arg;
+    static struct TOTPEngine engine = {0};
+    int64_t prepared_boundary = 0;
+
+#ifdef CONFIG_TOTP_BACKEND_BENCHMARK
+    totp_backend_benchmark();
+#endif
 
     while (1)
     {
@@ -32,7 +83,6 @@ static void totp_task(void *arg)
 
         if (get_mode() == qr_display)
         {
-
             struct ConnectionParameters parameters;
             j_nvs_get(nvs_conf_tag, &parameters, sizeof(struct ConnectionParameters));
 
@@ -44,15 +94,42 @@ static void totp_task(void *arg)
                 char *secret = parameters.backend_info.totp_seed;
                 int t0 = parameters.backend_info.totp_t0;
 
-                struct ConnectionParameters parameters;
-                j_nvs_get(nvs_conf_tag, &parameters, sizeof(struct ConnectionParameters));
-                int totp = do_the_totp_thing(now - t0, secret, 60, 6);
+                // The secret only changes when the backend sends new info
+                if (!totp_engine_matches(&engine, secret, t0) &&
+                    totp_engine_init(&engine, &TOTP_HMAC_BACKEND, secret, t0, TOTP_WINDOW, TOTP_DIGITS) < 0)
+                {
+                    ESP_LOGE(TAG, "invalid totp secret");
+                }
 
+                int totp = totp_engine_code(&engine, now);
+                if (totp < 0)
+                {
+                    continue;
+                }
 
                 jsend(conf->to_screen_queue, ScreenMsg, {
                     msg->command = DrawQr;
-                    snprintf(msg->data.text, sizeof(msg->data.text), "%s?totp=%06d&espacioId=%d&dispositivoId=%d", parameters.qr_info.totp_form_base_url, totp, parameters.qr_info.space_id, parameters.backend_info.device_id);
+                    totp_format_url(msg->data.text, sizeof(msg->data.text), &parameters, totp);
                 });
+
+                // The next code goes out ahead of time, so the screen has it encoded and
+                // swaps to it right at the boundary instead of after this task wakes up
+                int64_t boundary = totp_engine_window_end(&engine, now);
+                if (boundary - now <= TOTP_PREPARE_AHEAD && boundary != prepared_boundary)
+                {
+                    int next = totp_engine_code(&engine, boundary);
+                    if (next < 0)
+                    {
+                        continue;
+                    }
+
+                    jsend(conf->to_screen_queue, ScreenMsg, {
+                        msg->command = PrepareQr;
+                        totp_format_url(msg->data.prepared.text, sizeof(msg->data.prepared.text), &parameters, next);
+                        msg->data.prepared.from_us = boundary * 1000000;
+                    });
+                    prepared_boundary = boundary;
+                }
             }
         }
     }
@@ -0,0 +1,89 @@
+#include "totp_engine.h"
+
+#include <string.h>
+
+#include "lib/cotp.c"
+
+int totp_engine_init(struct TOTPEngine *engine, const struct HmacSha1Backend *backend, const char *seed, int t0,
+                     int window, int digits)
+{
+    uint8_t key[HMAC_SHA1_BLOCK_SIZE];
+
+    totp_engine_free(engine);
+
+    memset(engine, 0, sizeof(struct TOTPEngine));
+    engine->step = -1;
+
+    if (strlen(seed) >= TOTP_SEED_SIZE || window < 1 || digits < 1 || digits > 9)
+    {
+        return -1;
+    }
+
+    // Kept even if the secret is bad, so it isn't retried until it changes
+    strcpy(engine->seed, seed);
+    engine->t0 = t0;
+
+    int keylen = cotp_base32_decode(seed, key, sizeof(key));
+    int err = keylen < 0 ? -1 : hmac_sha1_init(&engine->hmac, backend, key, keylen);
+    memset(key, 0, sizeof(key));
+    if (err < 0)
+    {
+        return -1;
+    }
+
+    engine->window = window;
+    engine->digits = digits;
+    engine->ready = true;
+    return 0;
+}
+
+void totp_engine_free(struct TOTPEngine *engine)
+{
+    if (engine->ready)
+    {
+        hmac_sha1_free(&engine->hmac);
+        engine->ready = false;
+    }
+}
+
+bool totp_engine_matches(const struct TOTPEngine *engine, const char *seed, int t0)
+{
+    return engine->t0 == t0 && strcmp(engine->seed, seed) == 0;
+}
+
+int totp_engine_code(struct TOTPEngine *engine, int64_t now)
+{
+    if (!engine->ready)
+    {
+        return -1;
+    }
+
+    int64_t step = (now - engine->t0) / engine->window;
+    if (step == engine->step)
+    {
+        return engine->code;
+    }
+
+    uint8_t counter[8];
+    uint8_t digest[HMAC_SHA1_SIZE];
+
+    for (int i = 0; i < 8; i++)
+    {
+        counter[i] = (uint64_t)step >> (56 - 8 * i);
+    }
+
+    if (hmac_sha1_sign(&engine->hmac, counter, sizeof(counter), digest) < 0)
+    {
+        return -1;
+    }
+
+    engine->step = step;
+    engine->code = cotp_truncate(digest, engine->digits);
+    return engine->code;
+}
+
+int64_t totp_engine_window_end(const struct TOTPEngine *engine, int64_t now)
+{
+    int64_t step = (now - engine->t0) / engine->window;
+    return engine->t0 + (step + 1) * engine->window;
+}
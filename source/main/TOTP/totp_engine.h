@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "hmac_sha1.h"
+
+// RFC 6238 TOTP with everything that only depends on the secret done once: the
+// base32 decode and the HMAC key setup in the chosen backend. A code is then one
+// HMAC of the 8 byte counter, and only once per window, otherwise the cached one
+// is returned. Nothing here depends on ESP-IDF.
+
+#define TOTP_SEED_SIZE 33 // base32, as stored in BackendInfo
+
+struct TOTPEngine
+{
+    bool ready;
+    char seed[TOTP_SEED_SIZE]; // the secret it was built from, to notice changes
+    int t0;
+    int window; // seconds
+    int digits;
+    struct HmacSha1 hmac;
+    int64_t step;   // window of the cached code, -1 if none
+    int code;
+};
+
+// Returns -1 and leaves the engine not ready if the secret isn't valid base32 or
+// the backend fails. Safe to call again on an engine that was already set up.
+int totp_engine_init(struct TOTPEngine *engine, const struct HmacSha1Backend *backend, const char *seed, int t0,
+                     int window, int digits);
+
+// Releases the backend state, the engine is not ready afterwards
+void totp_engine_free(struct TOTPEngine *engine);
+
+// True if the engine was last initialised with this secret and t0, even if it
+// turned out invalid
+bool totp_engine_matches(const struct TOTPEngine *engine, const char *seed, int t0);
+
+// Code for the window now falls in, -1 if the engine isn't ready
+int totp_engine_code(struct TOTPEngine *engine, int64_t now);
+
+// Start of the window after the one now falls in, when the code changes
+int64_t totp_engine_window_end(const struct TOTPEngine *engine, int64_t now);
@@ -17,4 +17,18 @@ TaskHandle_t xTaskCreateCap(TaskFunction_t pxTaskCode,
     StaticTask_t *const pxTaskBuffer = heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL); // tiene que ser interna y byte addreseable
     xPortCheckValidTCBMem(pxTaskBuffer);
     return xTaskCreateStatic(pxTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, puxStackBuffer, pxTaskBuffer);
+}
+
+TaskHandle_t xTaskCreateCapPinned(TaskFunction_t pxTaskCode,
+                                  const char *const pcName,
+                                  const uint32_t ulStackDepth,
+                                  void *const pvParameters,
+                                  UBaseType_t uxPriority, uint32_t caps, BaseType_t xCoreID)
+{ // xTaskCreateCap on one core
+
+    StackType_t *const puxStackBuffer = heap_caps_malloc(ulStackDepth * sizeof(StackType_t), caps);
+    StaticTask_t *const pxTaskBuffer = heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+    xPortCheckValidTCBMem(pxTaskBuffer);
+    return xTaskCreateStaticPinnedToCore(pxTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, puxStackBuffer,
+                                         pxTaskBuffer, xCoreID);
 }
\ No newline at end of file
@@ -28,6 +28,7 @@
 // #define CAM_FRAME_SIZE FRAMESIZE_CIF // 400x296
 
 #define nvs_conf_tag "ConnParams"
+#define nvs_clock_tag "ClockDrift"
 
 #define PING_RATE 60
 
@@ -35,8 +36,18 @@
 #define DEFAULT_RT_TASK_DELAY 1
 #define DEFAULT_IDLE_TASK_DELAY 500
 #define DEFAULT_PING_DELAY (90000 / portTICK_PERIOD_MS)
+#define DEFAULT_QR_STOP_AFTER_FIRST true // attendance codes are shown one at a time
+#define DEFAULT_QR_DEDUP_TTL 10           // seconds a decoded payload is ignored after being sent
+#define DEFAULT_QR_PREFIX QR_DEFAULT_PREFIX // validation rules, in QR/qr_validate.h for validate_test
+#define DEFAULT_QR_MIN_LEN QR_DEFAULT_MIN_LEN
+#define DEFAULT_QR_MAX_LEN QR_DEFAULT_MAX_LEN
+#define DEFAULT_QR_FORMAT QR_DEFAULT_FORMAT
+#define DEFAULT_QR_ACCEPT_TOTP_FORM QR_DEFAULT_ACCEPT_TOTP_FORM
+#define QR_VALIDATION_TELEMETRY_PERIOD 60 // seconds between validation counter reports
+#define LVGL_MEM_TELEMETRY_PERIOD 300     // seconds between LVGL heap and drawing reports
 
 #define MAX_QR_SIZE 300
+#define QR_PREFIX_SIZE 32
 #define URL_SIZE 100
 #define OTA_URL_SIZE 256
 
@@ -47,6 +58,7 @@
 #define max(a,b) (((a) > (b)) ? (a) : (b))
 
 #define jTaskCreate xTaskCreateCap
+#define jTaskCreatePinned xTaskCreateCapPinned
 #define jalloc(x) heap_caps_malloc(x, MALLOC_CAP_SPIRAM);
 
 TaskHandle_t xTaskCreateCap(TaskFunction_t pxTaskCode,
@@ -55,6 +67,12 @@ TaskHandle_t xTaskCreateCap(TaskFunction_t pxTaskCode,
                             void *const pvParameters,
                             UBaseType_t uxPriority, uint32_t caps); // creates a task using psram instead of internal
 
+TaskHandle_t xTaskCreateCapPinned(TaskFunction_t pxTaskCode,
+                                  const char *const pcName,
+                                  const uint32_t ulStackDepth,
+                                  void *const pvParameters,
+                                  UBaseType_t uxPriority, uint32_t caps, BaseType_t xCoreID);
+
 #define jsend(queue, msgType, msgPrep) \
     {                                   \
         struct msgType *msg = jalloc(sizeof(struct msgType)); \
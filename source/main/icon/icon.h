@@ -1,7 +1,13 @@
-#include "./success.c"
-#include "./failure.c"
-#include "./warning.c"
-#include "./noQr.c"
-#include "./noWifi.c"
-#include "./noTB.c"
-#include "./noBackend.c"
+#pragma once
+
+#include "icon_pack.h"
+
+// Packed from the PNGs next to this file at build time, see pack_icons.py and
+// ICON_NAMES in main/CMakeLists.txt
+extern const struct PackedIcon success_packed;
+extern const struct PackedIcon failure_packed;
+extern const struct PackedIcon warning_packed;
+extern const struct PackedIcon noQr_packed;
+extern const struct PackedIcon noWifi_packed;
+extern const struct PackedIcon noTB_packed;
+extern const struct PackedIcon noBackend_packed;
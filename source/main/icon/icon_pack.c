@@ -0,0 +1,224 @@
+#include "icon_pack.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#define icon_alloc(size) heap_caps_malloc(size, MALLOC_CAP_SPIRAM)
+#define icon_now_us() esp_timer_get_time()
+#else
+#include <time.h>
+#define icon_alloc(size) malloc(size)
+static int64_t icon_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+struct IconCacheSlot
+{
+    const struct PackedIcon *icon;
+    lv_img_dsc_t img;
+};
+
+static struct IconCacheSlot cache[ICON_CACHE_SLOTS];
+static struct IconCacheStats stats = {0};
+
+// PackBits over elements of size bytes, see pack_icons.py. Indices are looked up
+// in the palette on the way out.
+static bool icon_unpack_packbits(const struct PackedIcon *icon, uint8_t *out, size_t out_size)
+{
+    const uint8_t *in = icon->data;
+    const uint8_t *end = in + icon->data_size;
+    const size_t size = icon->format & ICON_PACK_INDEXED ? 1 : 2;
+    size_t done = 0;
+
+    while (in < end)
+    {
+        uint8_t control = *in++;
+        size_t count = control < 128 ? control + 1 : control - 125;
+        size_t bytes = control < 128 ? count * size : size;
+
+        if ((size_t)(end - in) < bytes || done + count * 2 > out_size)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint8_t *element = control < 128 ? &in[i * size] : in;
+            if (size == 1)
+            {
+                if (*element >= icon->palette_size)
+                {
+                    return false;
+                }
+                element = &icon->palette[*element * 2];
+            }
+            out[done++] = element[0];
+            out[done++] = element[1];
+        }
+        in += bytes;
+    }
+
+    return done == out_size;
+}
+
+static bool icon_lz4_length(const uint8_t **in, const uint8_t *end, size_t *length)
+{
+    uint8_t more;
+    do
+    {
+        if (*in >= end)
+        {
+            return false;
+        }
+        more = *(*in)++;
+        *length += more;
+    } while (more == 255);
+    return true;
+}
+
+// A plain LZ4 block into out, which must come out exactly full
+static bool icon_unpack_lz4(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size)
+{
+    const uint8_t *end = in + in_size;
+    size_t done = 0;
+
+    while (in < end)
+    {
+        uint8_t token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !icon_lz4_length(&in, end, &literals))
+        {
+            return false;
+        }
+        if ((size_t)(end - in) < literals || out_size - done < literals)
+        {
+            return false;
+        }
+        memcpy(&out[done], in, literals);
+        in += literals;
+        done += literals;
+
+        if (in == end)
+        {
+            break; // the last sequence has no match
+        }
+
+        if (end - in < 2)
+        {
+            return false;
+        }
+        size_t offset = in[0] | in[1] << 8;
+        in += 2;
+        size_t match = (token & 15) + 4;
+        if ((token & 15) == 15 && !icon_lz4_length(&in, end, &match))
+        {
+            return false;
+        }
+        if (offset == 0 || offset > done || out_size - done < match)
+        {
+            return false;
+        }
+
+        // Byte by byte, the match may overlap what it copies
+        const uint8_t *from = &out[done - offset];
+        for (size_t i = 0; i < match; i++)
+        {
+            out[done + i] = from[i];
+        }
+        done += match;
+    }
+
+    return done == out_size;
+}
+
+bool icon_unpack(const struct PackedIcon *icon, uint8_t *pixels)
+{
+    const size_t count = (size_t)icon->width * icon->height;
+
+    if (!(icon->format & ICON_PACK_LZ4))
+    {
+        return icon_unpack_packbits(icon, pixels, count * 2);
+    }
+
+    if (!(icon->format & ICON_PACK_INDEXED))
+    {
+        return icon_unpack_lz4(icon->data, icon->data_size, pixels, count * 2);
+    }
+
+    // The indices go to the back half and are expanded forwards: pixel i is
+    // written at 2i, never past index i at count + i before it is read
+    uint8_t *indices = &pixels[count];
+    if (!icon_unpack_lz4(icon->data, icon->data_size, indices, count))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t index = indices[i];
+        if (index >= icon->palette_size)
+        {
+            return false;
+        }
+        pixels[2 * i] = icon->palette[2 * index];
+        pixels[2 * i + 1] = icon->palette[2 * index + 1];
+    }
+    return true;
+}
+
+const lv_img_dsc_t *icon_get(const struct PackedIcon *icon)
+{
+    struct IconCacheSlot *free_slot = NULL;
+
+    for (int i = 0; i < ICON_CACHE_SLOTS; i++)
+    {
+        if (cache[i].icon == icon)
+        {
+            stats.hits++;
+            return &cache[i].img;
+        }
+        if (cache[i].icon == NULL && free_slot == NULL)
+        {
+            free_slot = &cache[i];
+        }
+    }
+
+    int64_t start = icon_now_us();
+    size_t size = (size_t)icon->width * icon->height * 2;
+    uint8_t *pixels = free_slot != NULL ? icon_alloc(size) : NULL;
+    if (pixels == NULL || !icon_unpack(icon, pixels))
+    {
+        free(pixels);
+        stats.failed++;
+        return NULL;
+    }
+
+    free_slot->icon = icon;
+    free_slot->img.header.always_zero = 0;
+    free_slot->img.header.cf = LV_IMG_CF_TRUE_COLOR;
+    free_slot->img.header.w = icon->width;
+    free_slot->img.header.h = icon->height;
+    free_slot->img.data_size = size;
+    free_slot->img.data = pixels;
+
+    stats.misses++;
+    stats.bytes += size;
+    stats.last_unpack_us = icon_now_us() - start;
+    if (stats.last_unpack_us > stats.max_unpack_us)
+    {
+        stats.max_unpack_us = stats.last_unpack_us;
+    }
+    return &free_slot->img;
+}
+
+void icon_get_stats(struct IconCacheStats *stats_out)
+{
+    memcpy(stats_out, &stats, sizeof(struct IconCacheStats));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "lvgl.h"
+
+// The status icons are packed at build time by pack_icons.py instead of being
+// linked as 115 KB true colour arrays each. icon_get() expands one into PSRAM
+// the first time it is shown and hands out the same image afterwards.
+//
+// Pixels are RGB565 high byte first, the order the panel takes and the one the
+// LVGL converter's arrays had. data is a PackBits or LZ4 stream of them, or of
+// indices into palette when the icon has at most 256 colours.
+
+#define ICON_PACK_INDEXED 1 // data holds palette indices
+#define ICON_PACK_LZ4 2     // data is an LZ4 block, PackBits otherwise
+
+#define ICON_CACHE_SLOTS 16
+
+struct PackedIcon
+{
+    const char *name;
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;
+    uint16_t palette_size;
+    const uint8_t *palette; // palette_size pixels
+    const uint8_t *data;
+    uint32_t data_size;
+    uint32_t crc; // CRC-32 of the expanded pixels
+};
+
+struct IconCacheStats
+{
+    int hits;              // shown from the cache
+    int misses;            // expanded on the way
+    int failed;            // corrupt or no memory, nothing shown
+    int64_t last_unpack_us;
+    int64_t max_unpack_us;
+    size_t bytes;          // PSRAM held by the cache
+};
+
+// Expands icon into pixels, width * height * 2 bytes. Returns false if the data
+// doesn't decode to exactly that many.
+bool icon_unpack(const struct PackedIcon *icon, uint8_t *pixels);
+
+// The icon as an image for lv_img_set_src, NULL if it can't be expanded
+const lv_img_dsc_t *icon_get(const struct PackedIcon *icon);
+
+void icon_get_stats(struct IconCacheStats *stats);
@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""Packs the status icons from their PNGs into a C file of struct PackedIcon.
+
+Run by the build (main/CMakeLists.txt) and the host test, nothing generated is
+committed. Each icon is converted to RGB565 in the bytes order the panel takes
+(high byte first, as the LVGL converter's arrays were), made indexed when it has
+at most 256 colours, and compressed with PackBits or LZ4, whichever is smaller.
+icon_pack.c expands them again.
+
+    pack_icons.py -o icons_packed.c success.png failure.png ...
+
+Only the standard library is used, the PNGs are 8 bit RGB or RGBA.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+ICON_PACK_INDEXED = 1
+ICON_PACK_LZ4 = 2
+
+LZ4_MIN_MATCH = 4
+LZ4_LAST_LITERALS = 5   # the block ends with at least this many literals
+LZ4_MATCH_LIMIT = 12    # no match starts closer than this to the end
+
+
+def read_png(path):
+    """Returns (width, height, rgb bytes), alpha composited on white."""
+    data = open(path, 'rb').read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        sys.exit(f'{path}: not a PNG')
+
+    pos = 8
+    idat = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b'IHDR':
+            width, height, depth, colour, _, _, interlace = struct.unpack('>IIBBBBB', body)
+        elif kind == b'IDAT':
+            idat += body
+
+    if depth != 8 or colour not in (2, 6) or interlace != 0:
+        sys.exit(f'{path}: only 8 bit non interlaced RGB or RGBA')
+
+    bpp = 3 if colour == 2 else 4
+    stride = width * bpp
+    raw = zlib.decompress(idat)
+    prev = bytearray(stride)
+    rgb = bytearray()
+    for y in range(height):
+        kind = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for x in range(stride):
+            a = line[x - bpp] if x >= bpp else 0
+            b = prev[x]
+            c = prev[x - bpp] if x >= bpp else 0
+            if kind == 1:
+                line[x] = (line[x] + a) & 0xff
+            elif kind == 2:
+                line[x] = (line[x] + b) & 0xff
+            elif kind == 3:
+                line[x] = (line[x] + (a + b) // 2) & 0xff
+            elif kind == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                line[x] = (line[x] + (a if pa <= pb and pa <= pc else b if pb <= pc else c)) & 0xff
+        prev = line
+
+        for x in range(width):
+            px = line[x * bpp:(x + 1) * bpp]
+            alpha = px[3] if bpp == 4 else 255
+            rgb += bytes((v * alpha + 255 * (255 - alpha) + 127) // 255 for v in px[:3])
+
+    return width, height, rgb
+
+
+def rgb565(rgb):
+    """Big endian RGB565 pixels, levels as the LVGL converter picked them: the
+    channel rounded half up to the level's step, the top step kept for 255"""
+    def level(v, bits):
+        return min((v + (1 << (7 - bits))) >> (8 - bits), (1 << bits) - 1)
+
+    out = bytearray()
+    for i in range(0, len(rgb), 3):
+        v = level(rgb[i], 5) << 11 | level(rgb[i + 1], 6) << 5 | level(rgb[i + 2], 5)
+        out += v.to_bytes(2, 'big')
+    return bytes(out)
+
+
+def packbits(stream, size):
+    """PackBits over elements of size bytes: a control byte c, then either c + 1
+    literal elements (c < 128) or one element repeated c - 125 times."""
+    elements = [stream[i:i + size] for i in range(0, len(stream), size)]
+    out = bytearray()
+    i = 0
+    while i < len(elements):
+        run = 1
+        while i + run < len(elements) and run < 130 and elements[i + run] == elements[i]:
+            run += 1
+        if run >= 3:
+            out.append(run + 125)
+            out += elements[i]
+            i += run
+            continue
+
+        end = i + 1
+        while (end < len(elements) and end - i < 128 and
+               not (end + 2 < len(elements) and elements[end] == elements[end + 1] == elements[end + 2])):
+            end += 1
+        out.append(end - i - 1)
+        for element in elements[i:end]:
+            out += element
+        i = end
+    return bytes(out)
+
+
+def lz4_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def lz4(src):
+    """An LZ4 block, greedy matching on a hash of the last position of each 4 bytes"""
+    out = bytearray()
+    last = {}
+    anchor = 0
+    i = 0
+    while i + LZ4_MATCH_LIMIT <= len(src):
+        key = src[i:i + LZ4_MIN_MATCH]
+        candidate = last.get(key)
+        last[key] = i
+        if candidate is None or i - candidate > 0xffff:
+            i += 1
+            continue
+
+        match = LZ4_MIN_MATCH
+        while i + match < len(src) - LZ4_LAST_LITERALS and src[candidate + match] == src[i + match]:
+            match += 1
+
+        literals = i - anchor
+        out.append(min(literals, 15) << 4 | min(match - LZ4_MIN_MATCH, 15))
+        if literals >= 15:
+            lz4_length(out, literals - 15)
+        out += src[anchor:i]
+        out += (i - candidate).to_bytes(2, 'little')
+        if match - LZ4_MIN_MATCH >= 15:
+            lz4_length(out, match - LZ4_MIN_MATCH - 15)
+        i += match
+        anchor = i
+
+    literals = len(src) - anchor
+    out.append(min(literals, 15) << 4)
+    if literals >= 15:
+        lz4_length(out, literals - 15)
+    out += src[anchor:]
+    return bytes(out)
+
+
+def pack(pixels):
+    """Returns (format, palette, data, colours), the smallest of the encodings that fit"""
+    colours = sorted(set(pixels[i:i + 2] for i in range(0, len(pixels), 2)))
+    candidates = [(0, b'', packbits(pixels, 2)), (ICON_PACK_LZ4, b'', lz4(pixels))]
+
+    if len(colours) <= 256:
+        index = {colour: i for i, colour in enumerate(colours)}
+        indices = bytes(index[pixels[i:i + 2]] for i in range(0, len(pixels), 2))
+        palette = b''.join(colours)
+        candidates.append((ICON_PACK_INDEXED, palette, packbits(indices, 1)))
+        candidates.append((ICON_PACK_INDEXED | ICON_PACK_LZ4, palette, lz4(indices)))
+
+    fmt, palette, data = min(candidates, key=lambda c: len(c[1]) + len(c[2]))
+    return fmt, palette, data, len(colours)
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ', '.join(f'0x{b:02x}' for b in data[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def format_name(fmt):
+    return ('indexed ' if fmt & ICON_PACK_INDEXED else 'rgb565 ') + ('lz4' if fmt & ICON_PACK_LZ4 else 'packbits')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('-o', '--output', required=True)
+    parser.add_argument('pngs', nargs='+')
+    args = parser.parse_args()
+
+    out = ['// Generated by pack_icons.py from the PNGs in main/icon, do not edit',
+           '#include "icon/icon_pack.h"', '']
+    raw_total = 0
+    packed_total = 0
+
+    for path in args.pngs:
+        name = os.path.splitext(os.path.basename(path))[0]
+        width, height, rgb = read_png(path)
+        pixels = rgb565(rgb)
+        fmt, palette, data, colours = pack(pixels)
+
+        if palette:
+            out.append(f'static const uint8_t {name}_palette[] = {{\n{c_bytes(palette)}\n}};\n')
+        out.append(f'static const uint8_t {name}_data[] = {{\n{c_bytes(data)}\n}};\n')
+        out.append(f'const struct PackedIcon {name}_packed = {{\n'
+                   f'    .name = "{name}",\n'
+                   f'    .width = {width},\n'
+                   f'    .height = {height},\n'
+                   f'    .format = {fmt},\n'
+                   f'    .palette_size = {len(palette) // 2},\n'
+                   f'    .palette = {name + "_palette" if palette else "NULL"},\n'
+                   f'    .data = {name}_data,\n'
+                   f'    .data_size = {len(data)},\n'
+                   f'    .crc = 0x{zlib.crc32(pixels):08x},\n'
+                   f'}};\n')
+
+        raw_total += len(pixels)
+        packed_total += len(palette) + len(data)
+        print(f'{name}: {width}x{height}, {colours} colours, {format_name(fmt)}, '
+              f'{len(pixels)} -> {len(palette) + len(data)} bytes')
+
+    print(f'icons: {raw_total} -> {packed_total} bytes of flash ({100.0 * packed_total / raw_total:.1f}%)')
+
+    text = '\n'.join(out)
+    if not os.path.exists(args.output) or open(args.output).read() != text:
+        with open(args.output, 'w') as f:
+            f.write(text)
+
+
+if __name__ == '__main__':
+    main()
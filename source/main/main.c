@@ -40,6 +40,7 @@
 #include "Buttons/buttons.h"
 #include "TOTP/totp.h"
 #include "BT/bt.h"
+#include "Clock/clock.h"
 
 #include "nvs_plugin.h"
 #include "SYS_MODE/sys_mode.h"
@@ -140,6 +141,7 @@ void app_main(void)
 
     struct quirc *qr = quirc_new();
 
+    qr_place(qr, QR_IMAGE_CAPS, QR_WORK_CAPS);
     quirc_resize(qr, IMG_WIDTH, IMG_HEIGHT);
 
     struct QRConf *qr_conf = jalloc(sizeof(struct QRConf));
@@ -153,6 +155,11 @@ void app_main(void)
     qr_start(qr_conf);
     ESP_LOGI(TAG, "qr started");
 
+    // Discipline the system clock from the pings, before MQTT sends the first one
+
+    clock_start();
+    ESP_LOGI(TAG, "clock started");
+
     // Initialize MQTT
 
     struct MQTTConf *mqtt_conf = jalloc(sizeof(struct MQTTConf));
@@ -197,6 +204,7 @@ void app_main(void)
 
     struct ScreenConf *screen_conf = jalloc(sizeof(struct ScreenConf));
     screen_conf->to_screen_queue = to_screen_queue;
+    screen_conf->to_mqtt_queue = to_mqtt_queue;
 
     screen_start(screen_conf);
     ESP_LOGI(TAG, "screen started");